@@ -0,0 +1,736 @@
+#include "../lib/QRCode/QRCode.h"
+#include "../lib/Image/Sink.h"
+#include "../lib/Image/ObjectSink.h"
+#include "../lib/Image/SvgStream.h"
+#include "../lib/Image/BitmapStream.h"
+#include "../lib/Image/PrinterStream.h"
+#include "../lib/Image/Terminal.h"
+#include "../lib/Pipeline/ExportPipeline.h"
+#include "../lib/Ingest/Ingest.h"
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <condition_variable>
+#include <csignal>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+using namespace QR;
+
+namespace
+{
+	const char* const USAGE =
+		"usage: qrbulk [options] [file...]\n"
+		"       qrbulk [options] --csv COLUMN | --ndjson MEMBER | --shard I/N | --checkpoint FILE file\n"
+		"\n"
+		"Encodes one QR code per input record, read from the files or from standard input.\n"
+		"\n"
+		"  -0                  records end with NUL instead of a line feed\n"
+		"  -f, --format F      png (default), svg, svgz, pbm, pgm, bmp, tiff, zpl, escpos, txt\n"
+		"  -o, --output PATH   a directory (default .), an archive ending in .tar, - for a tar\n"
+		"                      on standard output, or null to encode without writing\n"
+		"  -e, --ecl L         error correction: L, M (default), Q or H\n"
+		"  -s, --scale N       pixels per module (default 4)\n"
+		"  -b, --border N      quiet zone in modules (default 4)\n"
+		"  -j, --threads N     worker threads (default: one per core)\n"
+		"      --workers E,R,C,W  workers of the encode, render, compress and write stages\n"
+		"      --ordered       write in input order\n"
+		"  -u, --unique        write repeated records once, instead of linking their names\n"
+		"      --no-dedupe     encode repeated records again, keeping no table of the records seen\n"
+		"      --csv COLUMN    the file is CSV; encode this column, by name or number from 0\n"
+		"      --no-header     the CSV file has no header line\n"
+		"      --ndjson MEMBER the file holds one JSON object per line; encode this member\n"
+		"      --shard I/N     read only part I (from 0) of N of the file, for N machines\n"
+		"      --checkpoint F  record progress in F, and resume from it if it exists\n"
+		"  -h, --help          show this text\n"
+		"\n"
+		"Files are named after the record number: 00000000.png, 00000001.png, ...\n"
+		"Identical records are encoded once; with a directory or a tar the later names are\n"
+		"hard links to the first. Finding them keeps a table of the distinct records, which\n"
+		"--no-dedupe turns off for inputs too large for it.\n"
+		"\n"
+		"A record that cannot be encoded (too long for any QR code) is reported on standard\n"
+		"error and skipped, and the others are still written; the exit status is then 2.\n"
+		"\n"
+		"With --csv, --ndjson, --shard or --checkpoint the single input file is mapped into\n"
+		"memory and split between the -j workers, each of which encodes and writes its own\n"
+		"records; files are then named after the byte offset of their record in the input\n"
+		"(000000004096.png), which stays the same when a job is resumed or sharded.\n"
+		"--ordered and --workers apply to the other mode only.\n";
+
+	/**
+	* @brief One output format: the file extension and the writer, or none for the pipeline's PNG.
+	*/
+	struct FORMAT
+	{
+		const char* name;
+		const char* extension;
+		std::function<void(const QRCODE&, SINK&, int scale, int border)> write;
+	};
+
+	const FORMAT FORMATS[] = {
+		{ "png", "png", nullptr },
+		{ "svg", "svg", [](const QRCODE& code, SINK& sink, int, int border)
+			{
+				SVG_OPTIONS options;
+				options.border = border;
+				SVG_STREAM::WRITE(sink, code.RUNS_GETTER(), options);
+			} },
+		{ "svgz", "svgz", [](const QRCODE& code, SINK& sink, int, int border)
+			{
+				SVG_OPTIONS options;
+				options.border = border;
+				options.gzip = true;
+				SVG_STREAM::WRITE(sink, code.RUNS_GETTER(), options);
+			} },
+		{ "pbm", "pbm", [](const QRCODE& code, SINK& sink, int scale, int border) { BITMAP_STREAM::PBM(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "pgm", "pgm", [](const QRCODE& code, SINK& sink, int scale, int border) { BITMAP_STREAM::PGM(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "bmp", "bmp", [](const QRCODE& code, SINK& sink, int scale, int border) { BITMAP_STREAM::BMP(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "tiff", "tif", [](const QRCODE& code, SINK& sink, int scale, int border) { BITMAP_STREAM::TIFF(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "zpl", "zpl", [](const QRCODE& code, SINK& sink, int scale, int border) { PRINTER_STREAM::ZPL(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "escpos", "bin", [](const QRCODE& code, SINK& sink, int scale, int border) { PRINTER_STREAM::ESCPOS(sink, code.VIEW_GETTER(), scale, border); } },
+		{ "txt", "txt", [](const QRCODE& code, SINK& sink, int, int border)
+			{
+				TERMINAL_OPTIONS options;
+				options.unicode = true;
+				options.color = false;
+				options.border = border;
+				TERMINAL(options).WRITE(code.VIEW_GETTER(), sink);
+			} },
+	};
+
+	/**
+	* @brief Passes objects on to another sink, or drops them, counting the bytes.
+	*
+	* Calls are serialized, so workers may share it.
+	*/
+	class COUNTING_SINK : public OBJECT_SINK
+	{
+	public:
+		explicit COUNTING_SINK(OBJECT_SINK* next) : Next(next), Bytes(0), Objects(0) {}
+
+		void PUT(const std::string& name, std::string&& data) override
+		{
+			Bytes += data.size();
+			Objects++;
+			std::lock_guard<std::mutex> lock(Lock);
+			if (Next != nullptr)
+				Next->PUT(name, std::move(data));
+		}
+
+		void LINK(const std::string& name, const std::string& target) override
+		{
+			Objects++;
+			std::lock_guard<std::mutex> lock(Lock);
+			if (Next != nullptr)
+				Next->LINK(name, target);
+		}
+
+		void FLUSH() override
+		{
+			std::lock_guard<std::mutex> lock(Lock);
+			if (Next != nullptr)
+				Next->FLUSH();
+		}
+
+		std::uint64_t BYTES_GETTER() const { return Bytes; }
+
+		std::uint64_t OBJECTS_GETTER() const { return Objects; }
+
+	private:
+		OBJECT_SINK* Next;
+
+		std::mutex Lock;
+
+		std::atomic<std::uint64_t> Bytes;
+
+		std::atomic<std::uint64_t> Objects;
+	};
+
+	/**
+	* @brief Reads delimited records from a list of streams, one after the other.
+	*/
+	class RECORD_READER
+	{
+	public:
+		RECORD_READER(std::vector<std::istream*> streams, char delimiter)
+			: Streams(std::move(streams)), Current(0), Delimiter(delimiter), Bytes(0)
+		{
+		}
+
+		/**
+		* @brief Reads the next non-empty record; a trailing carriage return is dropped from lines.
+		*/
+		bool NEXT(std::string& record)
+		{
+			while (Current < Streams.size())
+			{
+				if (!std::getline(*Streams[Current], record, Delimiter))
+				{
+					Current++;
+					continue;
+				}
+				Bytes += record.size() + 1;
+				if (Delimiter == '\n' && !record.empty() && record.back() == '\r')
+					record.pop_back();
+				if (!record.empty())
+					return true;
+			}
+			return false;
+		}
+
+		std::uint64_t BYTES_GETTER() const { return Bytes; }
+
+	private:
+		std::vector<std::istream*> Streams;
+
+		size_t Current;
+
+		char Delimiter;
+
+		std::uint64_t Bytes;
+	};
+
+	/**
+	* @brief Hash of the records seen so far, which are kept whole: two records are the same only
+	* if their bytes are, so a hash collision never links one record's file to another record.
+	* Looks up a string_view without copying it.
+	*/
+	struct RECORD_HASH
+	{
+		using is_transparent = void;
+
+		size_t operator()(std::string_view record) const { return std::hash<std::string_view>()(record); }
+	};
+
+	template <typename VALUE>
+	using RECORD_MAP = std::unordered_map<std::string, VALUE, RECORD_HASH, std::equal_to<>>;
+
+	int NUMBER(const char* text, int low, int high)
+	{
+		char* end = nullptr;
+		long value = std::strtol(text, &end, 10);
+		if (end == text || *end != '\0' || value < low || value > high)
+			throw std::invalid_argument(std::string("bad number: ") + text);
+		return static_cast<int>(value);
+	}
+
+	std::string RECORD_NAME(std::uint64_t number, const char* extension, int digits = 8)
+	{
+		std::ostringstream name;
+		name << std::setw(digits) << std::setfill('0') << number << '.' << extension;
+		return name.str();
+	}
+
+	/**
+	* @brief Prints the totals and the stage table, on standard error so a tar on standard output stays clean.
+	*
+	* @param failed Records that could not be encoded or rendered, repeats of them included.
+	*/
+	void REPORT(std::uint64_t records, std::uint64_t repeated, std::uint64_t failed, std::uint64_t in, std::uint64_t out,
+		double seconds, const PIPELINE_STATS& stats)
+	{
+		std::ostream& log = std::cerr;
+		const std::uint64_t encoded = stats.stages[1].items;
+		log << std::fixed << std::setprecision(2)
+			<< "records     " << records << " (" << encoded << " encoded, " << repeated << " repeated, "
+			<< failed << " failed)\n"
+			<< "time        " << seconds << " s\n"
+			<< "throughput  " << (seconds > 0 ? records / seconds : 0) << " codes/s, "
+			<< (seconds > 0 ? in / seconds / 1e6 : 0) << " MB/s in, "
+			<< (seconds > 0 ? out / seconds / 1e6 : 0) << " MB/s out ("
+			<< out << " bytes)\n\n"
+			<< "stage     workers     items    busy s  starved s  blocked s   util\n";
+		for (const STAGE_STATS& stage : stats.stages)
+		{
+			log << std::left << std::setw(9) << stage.name << std::right
+				<< std::setw(8) << stage.workers
+				<< std::setw(10) << stage.items
+				<< std::setw(10) << stage.busy
+				<< std::setw(11) << stage.starved
+				<< std::setw(11) << stage.blocked
+				<< std::setw(6) << std::setprecision(0) << 100 * stage.UTILIZATION(stats.seconds) << "%\n"
+				<< std::setprecision(2);
+		}
+		log << "bottleneck  " << stats.BOTTLENECK().name << '\n';
+	}
+
+	// The job SIGINT stops, so that it saves its checkpoint on the way out
+	std::atomic<INGEST*> Interrupted(nullptr);
+
+	extern "C" void INTERRUPT(int)
+	{
+		if (INGEST* job = Interrupted.load())
+			job->STOP();
+	}
+
+	/**
+	* @brief Encodes the payloads of one mapped file, each worker encoding, rendering and storing its own records.
+	*
+	* A repeated payload waits for its first copy to be stored and is then linked to it, so a
+	* link never points at a file that is not there yet, also when the job is interrupted.
+	* The payloads seen are kept as views into the mapping, and only those that had to be
+	* unescaped are copied; with `dedupe` off no table is kept and repeats are encoded again.
+	*
+	* A payload that cannot be encoded or rendered is reported with its shard and offset and
+	* skipped, along with its repeats, and the record counts as done: a rerun from the
+	* checkpoint does not stop at it again. Errors of the sink still end the run.
+	*
+	* @return The number of records skipped that way.
+	*/
+	std::uint64_t RUN_INGEST(const std::string& file, INGEST_OPTIONS ingest, const PIPELINE_OPTIONS& options,
+		const FORMAT& format, bool unique, bool dedupe, COUNTING_SINK& sink)
+	{
+		using clock = std::chrono::steady_clock;
+		enum class STATE : std::uint8_t
+		{
+			PENDING,
+			STORED,
+			REJECTED,
+			FAILED      // The sink failed and the run is ending
+		};
+		struct FIRST
+		{
+			std::uint64_t offset;
+			STATE state;
+		};
+
+		// Repeats wait on `settled` until their first copy leaves PENDING
+		std::mutex seenLock;
+		std::condition_variable settled;
+		std::unordered_map<std::string_view, FIRST, RECORD_HASH, std::equal_to<>> seen;
+		std::deque<std::string> copies;
+		std::atomic<std::uint64_t> repeated(0);
+		std::atomic<std::uint64_t> rejected(0);
+		std::atomic<std::uint64_t> failed(0);
+		std::mutex logLock;
+		std::atomic<std::uint64_t> nanoseconds[3] = {};
+		const RASTER raster(RASTER::FORMAT::MONO1, options.scale, options.border);
+		PNG_OPTIONS png;
+		png.level = options.level;
+		auto elapsed = [](clock::time_point since, std::atomic<std::uint64_t>& total)
+			{
+				auto now = clock::now();
+				total += static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count());
+				return now;
+			};
+		auto settle = [&](FIRST* first, STATE state)
+			{
+				if (first == nullptr)
+					return;
+				{
+					std::lock_guard<std::mutex> lock(seenLock);
+					first->state = state;
+				}
+				settled.notify_all();
+			};
+
+		ingest.commit = [&sink]() { sink.FLUSH(); };
+		INGEST job(file, ingest);
+		Interrupted.store(&job);
+		auto previous = std::signal(SIGINT, INTERRUPT);
+
+		INGEST_STATS result;
+		try
+		{
+			result = job.RUN([&](std::uint64_t offset, std::string_view payload)
+				{
+					std::string name = RECORD_NAME(offset, format.extension, 12);
+					FIRST* mine = nullptr;
+					if (dedupe)
+					{
+						std::unique_lock<std::mutex> lock(seenLock);
+						auto found = seen.find(payload);
+						if (found == seen.end())
+						{
+							std::string_view key = job.MAPPED(payload) ? payload : std::string_view(copies.emplace_back(payload));
+							mine = &seen.emplace(key, FIRST{ offset, STATE::PENDING }).first->second;
+						}
+						else
+						{
+							repeated++;
+							const FIRST& first = found->second;
+							settled.wait(lock, [&first]() { return first.state != STATE::PENDING; });
+							const STATE state = first.state;
+							const std::uint64_t target = first.offset;
+							lock.unlock();
+							if (state == STATE::FAILED)
+								throw std::runtime_error("the first copy of the record was not stored");
+							if (state == STATE::REJECTED)
+								failed++;
+							else if (!unique)
+								sink.LINK(name, RECORD_NAME(target, format.extension, 12));
+							return;
+						}
+					}
+
+					try
+					{
+						auto start = clock::now();
+						std::string data;
+						try
+						{
+							QRCODE code = QRCODE::ENCODE_SEGMENT(ENCODE::MODE::MODE_CHOOSER(payload.data(), payload.size()), options.ecl);
+							start = elapsed(start, nanoseconds[0]);
+							STRING_SINK out(data);
+							if (format.write)
+								format.write(code, out, options.scale, options.border);
+							else
+								PNG_STREAM::WRITE(out, code.VIEW_GETTER(), raster, png);
+							start = elapsed(start, nanoseconds[1]);
+						}
+						catch (const std::bad_alloc&)
+						{
+							throw;
+						}
+						catch (const std::exception& error)
+						{
+							{
+								std::lock_guard<std::mutex> lock(logLock);
+								std::cerr << "qrbulk: shard " << ingest.shard << " offset " << offset << ": " << error.what() << '\n';
+							}
+							rejected++;
+							failed++;
+							settle(mine, STATE::REJECTED);
+							return;
+						}
+						sink.PUT(name, std::move(data));
+						elapsed(start, nanoseconds[2]);
+						settle(mine, STATE::STORED);
+					}
+					catch (...)
+					{
+						settle(mine, STATE::FAILED);
+						throw;
+					}
+				});
+		}
+		catch (...)
+		{
+			std::signal(SIGINT, previous);
+			Interrupted.store(nullptr);
+			throw;
+		}
+		std::signal(SIGINT, previous);
+		Interrupted.store(nullptr);
+
+		// In the pipeline's terms: reading is the workers' parsing, rendering includes compression
+		const int workers = ingest.threads;
+		const std::uint64_t encoded = result.records - repeated - rejected;
+		PIPELINE_STATS stats{};
+		stats.seconds = result.seconds;
+		stats.stages[0] = STAGE_STATS{ "read", workers, result.records, result.parse, 0, 0, 0 };
+		stats.stages[1] = STAGE_STATS{ "encode", workers, encoded, nanoseconds[0] / 1e9, 0, 0, rejected };
+		stats.stages[2] = STAGE_STATS{ "render", workers, encoded, nanoseconds[1] / 1e9, 0, 0, 0 };
+		stats.stages[3] = STAGE_STATS{ "compress", 0, 0, 0, 0, 0, 0 };
+		stats.stages[4] = STAGE_STATS{ "write", workers, encoded, nanoseconds[2] / 1e9, 0, 0, 0 };
+		REPORT(result.records, repeated, failed, result.bytes, sink.BYTES_GETTER(), result.seconds, stats);
+
+		if (result.skipped > 0)
+			std::cerr << "skipped     " << result.skipped << " records without a payload\n";
+		if (result.resumed > 0)
+			std::cerr << "resumed     after " << result.resumed << " bytes done by earlier runs\n";
+		if (!result.complete)
+			std::cerr << "stopped     run again with the same --checkpoint to resume\n";
+		return failed;
+	}
+
+	int RUN(int argc, char** argv)
+	{
+		char delimiter = '\n';
+		const FORMAT* format = &FORMATS[0];
+		std::string output = ".";
+		PIPELINE_OPTIONS options;
+		int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+		bool workersGiven = false;
+		bool unique = false;
+		bool dedupe = true;
+		std::vector<std::string> files;
+		INGEST_OPTIONS ingest;
+		bool ingestGiven = false;
+
+		for (int i = 1; i < argc; i++)
+		{
+			std::string arg = argv[i];
+			auto value = [&]() -> const char*
+				{
+					if (i + 1 >= argc)
+						throw std::invalid_argument("missing value after " + arg);
+					return argv[++i];
+				};
+
+			if (arg == "-0")
+				delimiter = '\0';
+			else if (arg == "-f" || arg == "--format")
+			{
+				std::string name = value();
+				format = nullptr;
+				for (const FORMAT& candidate : FORMATS)
+					if (name == candidate.name)
+						format = &candidate;
+				if (format == nullptr)
+					throw std::invalid_argument("unknown format: " + name);
+			}
+			else if (arg == "-o" || arg == "--output")
+				output = value();
+			else if (arg == "-e" || arg == "--ecl")
+			{
+				std::string level = value();
+				if (level == "L")
+					options.ecl = QRCODE::VERSION::ERROR::LOW;
+				else if (level == "M")
+					options.ecl = QRCODE::VERSION::ERROR::MEDIUM;
+				else if (level == "Q")
+					options.ecl = QRCODE::VERSION::ERROR::QUARTILE;
+				else if (level == "H")
+					options.ecl = QRCODE::VERSION::ERROR::HIGH;
+				else
+					throw std::invalid_argument("unknown error correction level: " + level);
+			}
+			else if (arg == "-s" || arg == "--scale")
+				options.scale = NUMBER(value(), 1, 256);
+			else if (arg == "-b" || arg == "--border")
+				options.border = NUMBER(value(), 0, 64);
+			else if (arg == "-j" || arg == "--threads")
+				threads = NUMBER(value(), 1, 1024);
+			else if (arg == "--workers")
+			{
+				std::istringstream list(value());
+				std::string count;
+				int* stages[4] = { &options.encoders, &options.renderers, &options.compressors, &options.writers };
+				for (int stage = 0; stage < 4; stage++)
+				{
+					if (!std::getline(list, count, ','))
+						throw std::invalid_argument("--workers needs four counts");
+					*stages[stage] = NUMBER(count.c_str(), 1, 1024);
+				}
+				workersGiven = true;
+			}
+			else if (arg == "--ordered")
+				options.ordered = true;
+			else if (arg == "-u" || arg == "--unique")
+				unique = true;
+			else if (arg == "--no-dedupe")
+				dedupe = false;
+			else if (arg == "--csv" || arg == "--ndjson")
+			{
+				ingest.format = arg == "--csv" ? INGEST_FORMAT::CSV : INGEST_FORMAT::NDJSON;
+				ingest.field = value();
+				ingestGiven = true;
+			}
+			else if (arg == "--no-header")
+				ingest.header = false;
+			else if (arg == "--shard")
+			{
+				std::string shard = value();
+				size_t slash = shard.find('/');
+				if (slash == std::string::npos)
+					throw std::invalid_argument("--shard needs I/N");
+				ingest.shards = NUMBER(shard.substr(slash + 1).c_str(), 1, 1 << 20);
+				ingest.shard = NUMBER(shard.substr(0, slash).c_str(), 0, ingest.shards - 1);
+				ingestGiven = true;
+			}
+			else if (arg == "--checkpoint")
+			{
+				ingest.checkpoint = value();
+				ingestGiven = true;
+			}
+			else if (arg == "-h" || arg == "--help")
+			{
+				std::cout << USAGE;
+				return 0;
+			}
+			else if (arg.size() > 1 && arg[0] == '-')
+				throw std::invalid_argument("unknown option: " + arg);
+			else
+				files.push_back(arg);
+		}
+
+		if (ingestGiven)
+		{
+			if (files.size() != 1 || files[0] == "-")
+				throw std::invalid_argument("--csv, --ndjson, --shard and --checkpoint need one input file");
+			if (!ingest.checkpoint.empty() && (output == "-" || (output.size() > 4 && output.compare(output.size() - 4, 4, ".tar") == 0)))
+				throw std::invalid_argument("--checkpoint needs a directory or null output, as a tar cannot be resumed");
+			if (ingest.format == INGEST_FORMAT::LINES && delimiter == '\0')
+				ingest.format = INGEST_FORMAT::NUL;
+			ingest.threads = threads;
+		}
+
+		// Encoding costs several times the rest of the work, so it gets most of the threads. A
+		// format other than PNG renders and compresses in the render stage and only passes
+		// through the compress stage, so the compressors' share goes to the renderers
+		if (!workersGiven)
+		{
+			options.encoders = std::max(1, threads * 3 / 4);
+			options.renderers = 1;
+			options.compressors = std::max(1, threads - options.encoders);
+			options.writers = 1;
+			if (format->write)
+			{
+				options.renderers = options.compressors;
+				options.compressors = 1;
+			}
+		}
+		if (format->write)
+		{
+			const FORMAT* chosen = format;
+			const int scale = options.scale;
+			const int border = options.border;
+			options.render = [chosen, scale, border](const QRCODE& code, SINK& sink) { chosen->write(code, sink, scale, border); };
+		}
+
+		// Output
+		std::unique_ptr<std::ofstream> archive;
+		std::unique_ptr<SINK> bytes;
+		std::unique_ptr<OBJECT_SINK> target;
+		TAR_OBJECT_SINK* tar = nullptr;
+		if (output == "-" || (output.size() > 4 && output.compare(output.size() - 4, 4, ".tar") == 0))
+		{
+			if (output == "-")
+				bytes = std::make_unique<FD_SINK>(1);
+			else
+			{
+				archive = std::make_unique<std::ofstream>(output, std::ios::binary);
+				if (!*archive)
+					throw std::runtime_error("cannot create " + output);
+				bytes = std::make_unique<STREAM_SINK>(*archive);
+			}
+			auto archiveSink = std::make_unique<TAR_OBJECT_SINK>(*bytes);
+			tar = archiveSink.get();
+			target = std::move(archiveSink);
+		}
+		else if (output != "null")
+		{
+			std::filesystem::create_directories(output);
+			target = std::make_unique<DIRECTORY_OBJECT_SINK>(output, 256, std::max(1, options.writers));
+		}
+		COUNTING_SINK sink(target.get());
+
+		auto finish = [&]()
+			{
+				sink.FLUSH();
+				if (tar != nullptr)
+					tar->FINISH();
+				if (archive && !archive->flush())
+					throw std::runtime_error("Write failed");
+			};
+		if (ingestGiven)
+		{
+			const std::uint64_t failed = RUN_INGEST(files[0], ingest, options, *format, unique, dedupe, sink);
+			finish();
+			return failed > 0 ? 2 : 0;
+		}
+
+		// Input
+		std::vector<std::unique_ptr<std::ifstream>> opened;
+		std::vector<std::istream*> streams;
+		for (const std::string& file : files)
+		{
+			if (file == "-")
+			{
+				streams.push_back(&std::cin);
+				continue;
+			}
+			opened.push_back(std::make_unique<std::ifstream>(file, std::ios::binary));
+			if (!*opened.back())
+				throw std::runtime_error("cannot open " + file);
+			streams.push_back(opened.back().get());
+		}
+		if (streams.empty())
+			streams.push_back(&std::cin);
+		RECORD_READER reader(streams, delimiter);
+
+		// Repeated records are skipped here and linked once their first copy is written
+		RECORD_MAP<size_t> seen;
+		std::vector<std::pair<size_t, size_t>> repeats;
+		size_t records = 0;
+		const EXPORT_PIPELINE::SOURCE source = [&](std::string& name, std::string& text)
+			{
+				while (reader.NEXT(text))
+				{
+					size_t index = records++;
+					if (!dedupe)
+					{
+						name = RECORD_NAME(index, format->extension);
+						return true;
+					}
+					auto inserted = seen.emplace(text, index);
+					if (!inserted.second)
+					{
+						repeats.emplace_back(index, inserted.first->second);
+						continue;
+					}
+					name = RECORD_NAME(index, format->extension);
+					return true;
+				}
+				return false;
+			};
+
+		// Records that cannot be encoded are reported and left out; their repeats are not linked
+		std::mutex rejectLock;
+		std::unordered_set<std::string> rejected;
+		options.reject = [&](const std::string& name, const std::exception& error)
+			{
+				std::lock_guard<std::mutex> lock(rejectLock);
+				rejected.insert(name);
+				std::cerr << "qrbulk: " << name << ": " << error.what() << '\n';
+			};
+
+		EXPORT_PIPELINE pipeline(options);
+		PIPELINE_STATS stats = pipeline.RUN(source, sink);
+
+		auto start = std::chrono::steady_clock::now();
+		std::uint64_t failed = rejected.size();
+		for (const auto& repeat : repeats)
+		{
+			const std::string target = RECORD_NAME(repeat.second, format->extension);
+			if (rejected.count(target) != 0)
+				failed++;
+			else if (!unique)
+				sink.LINK(RECORD_NAME(repeat.first, format->extension), target);
+		}
+		finish();
+		const double seconds = stats.seconds + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		REPORT(records, repeats.size(), failed, reader.BYTES_GETTER(), sink.BYTES_GETTER(), seconds, stats);
+		return failed > 0 ? 2 : 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+#ifdef _WIN32
+	// Records and archives are bytes, not text
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	try
+	{
+		return RUN(argc, argv);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "qrbulk: " << e.what() << std::endl;
+		return 1;
+	}
+}
@@ -0,0 +1,636 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "../QRCode/QRCode.h"
+#include "../QRCode/MatrixView.h"
+#include "../Ingest/MappedFile.h"
+
+#include <bit>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
+
+namespace QR
+{
+    /**
+    * @brief Layout of an archive of finished symbols, looked up by key.
+    *
+    * All numbers are little-endian and everything starts on a multiple of 8 bytes:
+    *
+    *   header    "QRARCHIV", u32 format (1), u32 flags (0)
+    *   records   u8 version, u8 error correction level, u8 mask, u8 0, u32 key length,
+    *             the key padded with zeros to 8 bytes, then the module rows exactly as
+    *             MATRIX_VIEW reads them: SIZE rows of (SIZE + 63) / 64 words
+    *   index     u8 0 (where a record has its version), 3 zero bytes, u32 bits, u64 entry count
+    *   entries   u64 hash of the key, u64 offset of the record; sorted by hash, then offset
+    *   directory 2^bits + 1 u64: entries whose hash starts with the bits b are
+    *             entries[directory[b]] to entries[directory[b + 1]]
+    *   trailer   "QRINDEX1", u64 offset of the index, u64 entry count, u32 bits, u32 0
+    *
+    * More records and another index may follow: an archive is only ever appended to, and the
+    * last index, which covers every key, is the one that counts. It ends the file, unless a
+    * writer is appending records after it; readers then search back for its trailer.
+    *
+    * There are about as many directory slots as entries, so a lookup reads one directory slot
+    * and one or two entries. A record is the bare matrix, 168 bytes plus the key for
+    * version 1 and 4248 for version 40, read in place: nothing is decoded to render it.
+    */
+    struct ARCHIVE_FORMAT
+    {
+        static constexpr char MAGIC[8] = { 'Q', 'R', 'A', 'R', 'C', 'H', 'I', 'V' };
+        static constexpr char INDEX_MAGIC[8] = { 'Q', 'R', 'I', 'N', 'D', 'E', 'X', '1' };
+        static constexpr std::uint32_t FORMAT = 1;
+        static constexpr size_t HEADER_SIZE = 16;
+        static constexpr size_t RECORD_HEADER_SIZE = 8;
+        static constexpr size_t INDEX_HEADER_SIZE = 16;
+        static constexpr size_t ENTRY_SIZE = 16;
+        static constexpr size_t TRAILER_SIZE = 32;
+
+        /**
+        * @brief Hash of a key, the same on every machine: FNV-1a, then mixed so the top bits are even.
+        */
+        static std::uint64_t HASH(std::string_view key);
+
+        /**
+        * @brief Bytes of the module rows of a symbol of `version`.
+        */
+        static size_t MODULE_BYTES(int version);
+
+        /**
+        * @brief `length` rounded up to a multiple of 8.
+        */
+        static size_t PADDED(size_t length);
+
+        /**
+        * @brief Whether a whole index ends at `end` of the `data`; if so, where it starts, its
+        * entry count and its directory bits.
+        */
+        static bool INDEX_ENDS(const std::uint8_t* data, std::uint64_t end, std::uint64_t& index, std::uint64_t& count,
+            int& bits);
+
+        /**
+        * @brief End of the last whole index in the `size` bytes of `data`, or 0 if there is none.
+        */
+        static std::uint64_t LAST_INDEX(const std::uint8_t* data, std::uint64_t size, std::uint64_t& index,
+            std::uint64_t& count, int& bits);
+    };
+
+    /**
+    * @brief One symbol in a mapped archive. Holds a pointer into the mapping, nothing else.
+    *
+    * It converts to MATRIX_VIEW, so it can be handed to any renderer as it is:
+    * PNG_STREAM::WRITE(sink, record, raster), BITMAP_STREAM::PBM(sink, record, 4),
+    * TERMINAL().WRITE(record, sink), RUN_GEOMETRY(record) for SVG, and so on.
+    */
+    class ARCHIVE_RECORD
+    {
+    public:
+        explicit ARCHIVE_RECORD(const std::uint8_t* record = nullptr);
+
+        int VERSION_GETTER() const;
+
+        QRCODE::VERSION::ERROR ERROR_CORRECTION() const;
+
+        int MASK_GETTER() const;
+
+        int SIZE_GETTER() const;
+
+        std::string_view KEY_GETTER() const;
+
+        MATRIX_VIEW VIEW_GETTER() const;
+
+        operator MATRIX_VIEW() const;
+
+        /**
+        * @brief Bytes of the whole record, header, key and modules.
+        */
+        size_t BYTES() const;
+
+    private:
+        const std::uint8_t* Record;
+    };
+
+    /**
+    * @brief Appends symbols to an archive file and writes its index.
+    *
+    * Nothing written is changed or cut off again, so readers may have the file mapped while
+    * it is written: records and indexes are appended after the last index, and a reader
+    * opened in the meantime uses that index. An existing archive is reopened by reading its
+    * last index; the complete records a writer that did not FINISH appended after it are
+    * found by walking on from there, and a partly written record at the end is written over.
+    * A key appended again replaces the old record in the next index.
+    */
+    class ARCHIVE_WRITER
+    {
+    public:
+        /**
+        * @throws std::runtime_error if the file cannot be opened, or is not an archive.
+        */
+        explicit ARCHIVE_WRITER(const std::string& path);
+
+        /**
+        * @brief Finishes the archive if FINISH was not called since the last APPEND; errors are lost.
+        */
+        ~ARCHIVE_WRITER();
+
+        ARCHIVE_WRITER(const ARCHIVE_WRITER&) = delete;
+        ARCHIVE_WRITER& operator=(const ARCHIVE_WRITER&) = delete;
+
+        /**
+        * @brief Appends a finished symbol under `key`.
+        *
+        * @throws std::invalid_argument if the symbol is not masked yet.
+        * @throws std::runtime_error if the write fails.
+        */
+        void APPEND(std::string_view key, const QRCODE& code);
+
+        /**
+        * @brief Appends a symbol given by its parts, such as a record of another archive.
+        *
+        * @throws std::domain_error if the version or mask is out of range, or the view's size
+        * does not belong to the version.
+        */
+        void APPEND(std::string_view key, int version, QRCODE::VERSION::ERROR ecl, int mask, const MATRIX_VIEW& view);
+
+        /**
+        * @brief Appends an index, which makes the records appended so far visible to readers.
+        *
+        * APPEND may be called again afterwards; the next FINISH appends an index of all the keys.
+        */
+        void FINISH();
+
+        /**
+        * @brief Number of distinct keys.
+        */
+        size_t COUNT_GETTER() const;
+
+    private:
+        /**
+        * @brief Reads the keys of an existing archive, from its last index and by walking the
+        * records after it.
+        */
+        void LOAD(const std::string& path);
+
+        std::fstream File;
+
+        std::uint64_t End;  // Where the next record goes; anything after it is a partial record
+
+        std::unordered_map<std::string, std::uint64_t> Keys;
+
+        bool Dirty;
+    };
+
+    /**
+    * @brief Looks symbols up by key in a mapped archive.
+    *
+    * Opening checks the header and finds the last index; a lookup hashes the key, reads
+    * one directory slot and compares the keys of the entries with the same hash. Records are
+    * checked to lie inside the file before they are returned.
+    */
+    class ARCHIVE_READER
+    {
+    public:
+        /**
+        * @throws std::runtime_error if the file cannot be mapped or has no valid index.
+        */
+        explicit ARCHIVE_READER(const std::string& path);
+
+        ARCHIVE_READER(const ARCHIVE_READER&) = delete;
+        ARCHIVE_READER& operator=(const ARCHIVE_READER&) = delete;
+
+        /**
+        * @brief Finds the record stored under `key`.
+        *
+        * @return false if there is none.
+        * @throws std::runtime_error if the index points outside the records.
+        */
+        bool FIND(std::string_view key, ARCHIVE_RECORD& record) const;
+
+        /**
+        * @brief Number of records in the index.
+        */
+        size_t COUNT_GETTER() const;
+
+        /**
+        * @brief Record `index` of the index, in hash order; for walking the whole archive.
+        */
+        ARCHIVE_RECORD AT(size_t index) const;
+
+        /**
+        * @brief Offset in the file of record `index` of the index.
+        */
+        std::uint64_t OFFSET(size_t index) const;
+
+    private:
+        ARCHIVE_RECORD RECORD_AT(std::uint64_t offset) const;
+
+        MAPPED_FILE File;
+
+        const std::uint64_t* Entries;
+
+        const std::uint64_t* Directory;
+
+        std::uint64_t Count;
+
+        std::uint64_t Records;  // End of the records, where the index starts
+
+        int Bits;
+    };
+}
+
+inline std::uint64_t QR::ARCHIVE_FORMAT::HASH(std::string_view key)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key)
+        hash = (hash ^ c) * 1099511628211ULL;
+
+    // splitmix64's finalizer: FNV-1a alone leaves the top bits, which pick the slot, weak
+    hash ^= hash >> 30;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94D049BB133111EBULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+inline size_t QR::ARCHIVE_FORMAT::MODULE_BYTES(int version)
+{
+    const size_t size = static_cast<size_t>(4 * version + 17);
+    return size * ((size + 63) / 64) * 8;
+}
+
+inline size_t QR::ARCHIVE_FORMAT::PADDED(size_t length)
+{
+    return (length + 7) & ~size_t(7);
+}
+
+inline bool QR::ARCHIVE_FORMAT::INDEX_ENDS(const std::uint8_t* data, std::uint64_t end, std::uint64_t& index,
+    std::uint64_t& count, int& bits)
+{
+    if (end % 8 != 0 || end < HEADER_SIZE + INDEX_HEADER_SIZE + TRAILER_SIZE)
+        return false;
+    const std::uint8_t* trailer = data + end - TRAILER_SIZE;
+    if (std::memcmp(trailer, INDEX_MAGIC, 8) != 0)
+        return false;
+    std::uint32_t width;
+    std::memcpy(&index, trailer + 8, 8);
+    std::memcpy(&count, trailer + 16, 8);
+    std::memcpy(&width, trailer + 24, 4);
+
+    // The index must fill the space from its header to the trailer exactly
+    if (width < 1 || width > 40 || index < HEADER_SIZE || index % 8 != 0 || index > end
+        || count > (end - index) / ENTRY_SIZE
+        || index + INDEX_HEADER_SIZE + count * ENTRY_SIZE + ((std::uint64_t(1) << width) + 1) * 8 + TRAILER_SIZE != end)
+        return false;
+    const std::uint8_t* head = data + index;
+    std::uint32_t headBits;
+    std::uint64_t headCount;
+    std::memcpy(&headBits, head + 4, 4);
+    std::memcpy(&headCount, head + 8, 8);
+    if (head[0] != 0 || head[1] != 0 || head[2] != 0 || head[3] != 0 || headBits != width || headCount != count)
+        return false;
+    bits = static_cast<int>(width);
+    return true;
+}
+
+inline std::uint64_t QR::ARCHIVE_FORMAT::LAST_INDEX(const std::uint8_t* data, std::uint64_t size, std::uint64_t& index,
+    std::uint64_t& count, int& bits)
+{
+    for (std::uint64_t end = size - size % 8; end >= HEADER_SIZE + INDEX_HEADER_SIZE + TRAILER_SIZE; end -= 8)
+    {
+        if (INDEX_ENDS(data, end, index, count, bits))
+            return end;
+    }
+    return 0;
+}
+
+inline QR::ARCHIVE_RECORD::ARCHIVE_RECORD(const std::uint8_t* record)
+    : Record(record)
+{
+}
+
+inline int QR::ARCHIVE_RECORD::VERSION_GETTER() const
+{
+    return Record[0];
+}
+
+inline QR::QRCODE::VERSION::ERROR QR::ARCHIVE_RECORD::ERROR_CORRECTION() const
+{
+    return static_cast<QRCODE::VERSION::ERROR>(Record[1]);
+}
+
+inline int QR::ARCHIVE_RECORD::MASK_GETTER() const
+{
+    return Record[2];
+}
+
+inline int QR::ARCHIVE_RECORD::SIZE_GETTER() const
+{
+    return 4 * Record[0] + 17;
+}
+
+inline std::string_view QR::ARCHIVE_RECORD::KEY_GETTER() const
+{
+    std::uint32_t length;
+    std::memcpy(&length, Record + 4, 4);
+    return std::string_view(reinterpret_cast<const char*>(Record + ARCHIVE_FORMAT::RECORD_HEADER_SIZE), length);
+}
+
+inline QR::MATRIX_VIEW QR::ARCHIVE_RECORD::VIEW_GETTER() const
+{
+    const int size = SIZE_GETTER();
+    const std::uint8_t* modules = Record + ARCHIVE_FORMAT::RECORD_HEADER_SIZE + ARCHIVE_FORMAT::PADDED(KEY_GETTER().size());
+    return MATRIX_VIEW(reinterpret_cast<const std::uint64_t*>(modules), size, (static_cast<size_t>(size) + 63) / 64);
+}
+
+inline QR::ARCHIVE_RECORD::operator MATRIX_VIEW() const
+{
+    return VIEW_GETTER();
+}
+
+inline size_t QR::ARCHIVE_RECORD::BYTES() const
+{
+    return ARCHIVE_FORMAT::RECORD_HEADER_SIZE + ARCHIVE_FORMAT::PADDED(KEY_GETTER().size())
+        + ARCHIVE_FORMAT::MODULE_BYTES(VERSION_GETTER());
+}
+
+inline QR::ARCHIVE_WRITER::ARCHIVE_WRITER(const std::string& path)
+    : End(ARCHIVE_FORMAT::HEADER_SIZE), Dirty(true)
+{
+    // The rows are written as the host holds them
+    if constexpr (std::endian::native != std::endian::little)
+        throw std::runtime_error("Archives need a little-endian host");
+
+    std::error_code error;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if (size > 0 && !error)
+        LOAD(path);
+    else
+    {
+        std::ofstream create(path, std::ios::binary | std::ios::trunc);
+        create.write(ARCHIVE_FORMAT::MAGIC, 8);
+        const std::uint32_t format[2] = { ARCHIVE_FORMAT::FORMAT, 0 };
+        create.write(reinterpret_cast<const char*>(format), sizeof(format));
+        if (!create.flush())
+            throw std::runtime_error("Write failed");
+    }
+
+    File.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!File)
+        throw std::runtime_error("Open failed");
+    File.seekp(static_cast<std::streamoff>(End));
+}
+
+inline void QR::ARCHIVE_WRITER::LOAD(const std::string& path)
+{
+    const MAPPED_FILE file(path);
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(file.DATA());
+    const std::uint64_t size = file.SIZE_GETTER();
+    if (size < ARCHIVE_FORMAT::HEADER_SIZE || std::memcmp(data, ARCHIVE_FORMAT::MAGIC, 8) != 0)
+        throw std::runtime_error("Not an archive");
+
+    // The last index has the keys and their latest records
+    std::uint64_t offset = ARCHIVE_FORMAT::HEADER_SIZE;
+    std::uint64_t index, count;
+    int bits;
+    const std::uint64_t last = ARCHIVE_FORMAT::LAST_INDEX(data, size, index, count, bits);
+    bool indexed = false;
+    if (last != 0)
+    {
+        try
+        {
+            ARCHIVE_READER reader(path);
+            for (size_t i = 0; i < reader.COUNT_GETTER(); i++)
+                Keys[std::string(reader.AT(i).KEY_GETTER())] = reader.OFFSET(i);
+            offset = last;
+            indexed = true;
+        }
+        catch (const std::runtime_error&)
+        {
+            Keys.clear();
+        }
+    }
+
+    // Records after it were appended by a writer that stopped early: keep every complete one,
+    // the latest of each key, and skip older indexes if there was no usable last one
+    while (offset + ARCHIVE_FORMAT::RECORD_HEADER_SIZE <= size)
+    {
+        const std::uint8_t* head = data + offset;
+        if (head[0] == 0 && offset + ARCHIVE_FORMAT::INDEX_HEADER_SIZE <= size)
+        {
+            std::uint32_t width;
+            std::uint64_t entries;
+            std::memcpy(&width, head + 4, 4);
+            std::memcpy(&entries, head + 8, 8);
+            if (width < 1 || width > 40 || entries > size / ARCHIVE_FORMAT::ENTRY_SIZE)
+                break;
+            const std::uint64_t end = offset + ARCHIVE_FORMAT::INDEX_HEADER_SIZE + entries * ARCHIVE_FORMAT::ENTRY_SIZE
+                + ((std::uint64_t(1) << width) + 1) * 8 + ARCHIVE_FORMAT::TRAILER_SIZE;
+            if (end > size || !ARCHIVE_FORMAT::INDEX_ENDS(data, end, index, count, bits) || index != offset)
+                break;
+            offset = end;
+            continue;
+        }
+
+        std::uint32_t length;
+        std::memcpy(&length, head + 4, 4);
+        if (head[0] < 1 || head[0] > 40 || head[1] > 3 || head[2] > 7 || head[3] != 0)
+            break;
+        std::uint64_t bytes = ARCHIVE_FORMAT::RECORD_HEADER_SIZE + ARCHIVE_FORMAT::PADDED(length)
+            + ARCHIVE_FORMAT::MODULE_BYTES(head[0]);
+        if (bytes > size - offset)
+            break;
+        Keys[std::string(reinterpret_cast<const char*>(head + ARCHIVE_FORMAT::RECORD_HEADER_SIZE), length)] = offset;
+        offset += bytes;
+    }
+    End = offset;
+    Dirty = !indexed || End != last;
+}
+
+inline QR::ARCHIVE_WRITER::~ARCHIVE_WRITER()
+{
+    if (!Dirty)
+        return;
+    try
+    {
+        FINISH();
+    }
+    catch (...)
+    {
+    }
+}
+
+inline void QR::ARCHIVE_WRITER::APPEND(std::string_view key, const QRCODE& code)
+{
+    if (code.MASK_GETTER() < 0)
+        throw std::invalid_argument("Invalid value");
+    APPEND(key, code.VERSION_GETTER(), code.ERROR_CORRECTION(), code.MASK_GETTER(), code.VIEW_GETTER());
+}
+
+inline void QR::ARCHIVE_WRITER::APPEND(std::string_view key, int version, QRCODE::VERSION::ERROR ecl, int mask,
+    const MATRIX_VIEW& view)
+{
+    if (version < 1 || version > 40 || mask < 0 || mask > 7 || view.SIZE_GETTER() != 4 * version + 17
+        || key.size() > 0xFFFFFFFFu)
+        throw std::domain_error("value out of range");
+
+    const int size = view.SIZE_GETTER();
+    const size_t stride = (static_cast<size_t>(size) + 63) / 64;
+    const std::uint32_t length = static_cast<std::uint32_t>(key.size());
+    std::uint8_t head[ARCHIVE_FORMAT::RECORD_HEADER_SIZE] = {
+        static_cast<std::uint8_t>(version), static_cast<std::uint8_t>(ecl), static_cast<std::uint8_t>(mask), 0 };
+    std::memcpy(head + 4, &length, 4);
+    static const char zeros[8] = {};
+
+    File.write(reinterpret_cast<const char*>(head), sizeof(head));
+    File.write(key.data(), static_cast<std::streamsize>(key.size()));
+    File.write(zeros, static_cast<std::streamsize>(ARCHIVE_FORMAT::PADDED(key.size()) - key.size()));
+    for (int y = 0; y < size; y++)
+        File.write(reinterpret_cast<const char*>(view.ROW(y).data()), static_cast<std::streamsize>(stride * 8));
+    if (!File)
+        throw std::runtime_error("Write failed");
+
+    Keys[std::string(key)] = End;
+    End += ARCHIVE_FORMAT::RECORD_HEADER_SIZE + ARCHIVE_FORMAT::PADDED(key.size()) + ARCHIVE_FORMAT::MODULE_BYTES(version);
+    Dirty = true;
+}
+
+inline void QR::ARCHIVE_WRITER::FINISH()
+{
+    std::vector<std::uint64_t> entries;
+    entries.reserve(Keys.size() * 2);
+    {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> sorted;
+        sorted.reserve(Keys.size());
+        for (const auto& key : Keys)
+            sorted.emplace_back(ARCHIVE_FORMAT::HASH(key.first), key.second);
+        std::sort(sorted.begin(), sorted.end());
+        for (const auto& entry : sorted)
+        {
+            entries.push_back(entry.first);
+            entries.push_back(entry.second);
+        }
+    }
+
+    // About one slot per entry, at least two
+    const std::uint64_t count = Keys.size();
+    int bits = 1;
+    while (bits < 40 && (std::uint64_t(1) << bits) < count)
+        bits++;
+    std::vector<std::uint64_t> directory((size_t(1) << bits) + 1, 0);
+    size_t e = 0;
+    for (size_t slot = 0; slot < (size_t(1) << bits); slot++)
+    {
+        directory[slot] = e;
+        while (e < count && (entries[2 * e] >> (64 - bits)) == slot)
+            e++;
+    }
+    directory.back() = count;
+
+    const std::uint32_t width = static_cast<std::uint32_t>(bits);
+    std::uint8_t head[ARCHIVE_FORMAT::INDEX_HEADER_SIZE] = {};
+    std::memcpy(head + 4, &width, 4);
+    std::memcpy(head + 8, &count, 8);
+    std::uint8_t trailer[ARCHIVE_FORMAT::TRAILER_SIZE] = {};
+    std::memcpy(trailer, ARCHIVE_FORMAT::INDEX_MAGIC, 8);
+    std::memcpy(trailer + 8, &End, 8);
+    std::memcpy(trailer + 16, &count, 8);
+    std::memcpy(trailer + 24, &width, 4);
+
+    // The trailer goes out last, so a reader that finds it finds the whole index before it
+    File.seekp(static_cast<std::streamoff>(End));
+    File.write(reinterpret_cast<const char*>(head), sizeof(head));
+    File.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * 8));
+    File.write(reinterpret_cast<const char*>(directory.data()), static_cast<std::streamsize>(directory.size() * 8));
+    File.flush();
+    File.write(reinterpret_cast<const char*>(trailer), sizeof(trailer));
+    File.flush();
+    if (!File)
+        throw std::runtime_error("Write failed");
+
+    End += sizeof(head) + entries.size() * 8 + directory.size() * 8 + sizeof(trailer);
+    Dirty = false;
+}
+
+inline size_t QR::ARCHIVE_WRITER::COUNT_GETTER() const
+{
+    return Keys.size();
+}
+
+inline QR::ARCHIVE_READER::ARCHIVE_READER(const std::string& path)
+    : File(path), Entries(nullptr), Directory(nullptr), Count(0), Records(0), Bits(0)
+{
+    if constexpr (std::endian::native != std::endian::little)
+        throw std::runtime_error("Archives need a little-endian host");
+
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(File.DATA());
+    const std::uint64_t size = File.SIZE_GETTER();
+    if (size < ARCHIVE_FORMAT::HEADER_SIZE + ARCHIVE_FORMAT::TRAILER_SIZE || std::memcmp(data, ARCHIVE_FORMAT::MAGIC, 8) != 0)
+        throw std::runtime_error("Not an archive");
+
+    if (ARCHIVE_FORMAT::LAST_INDEX(data, size, Records, Count, Bits) == 0)
+        throw std::runtime_error("Archive has no valid index");
+
+    Entries = reinterpret_cast<const std::uint64_t*>(data + Records + ARCHIVE_FORMAT::INDEX_HEADER_SIZE);
+    Directory = Entries + 2 * Count;
+}
+
+inline QR::ARCHIVE_RECORD QR::ARCHIVE_READER::RECORD_AT(std::uint64_t offset) const
+{
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(File.DATA());
+    if (offset < ARCHIVE_FORMAT::HEADER_SIZE || offset % 8 != 0 || offset + ARCHIVE_FORMAT::RECORD_HEADER_SIZE > Records
+        || data[offset] < 1 || data[offset] > 40)
+        throw std::runtime_error("Archive is damaged");
+
+    ARCHIVE_RECORD record(data + offset);
+    if (record.BYTES() > Records - offset)
+        throw std::runtime_error("Archive is damaged");
+    return record;
+}
+
+inline bool QR::ARCHIVE_READER::FIND(std::string_view key, ARCHIVE_RECORD& record) const
+{
+    const std::uint64_t hash = ARCHIVE_FORMAT::HASH(key);
+    const std::uint64_t slot = hash >> (64 - Bits);
+    const std::uint64_t last = std::min(Directory[slot + 1], Count);
+    for (std::uint64_t i = Directory[slot]; i < last && Entries[2 * i] <= hash; i++)
+    {
+        if (Entries[2 * i] != hash)
+            continue;
+        ARCHIVE_RECORD candidate = RECORD_AT(Entries[2 * i + 1]);
+        if (candidate.KEY_GETTER() == key)
+        {
+            record = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline size_t QR::ARCHIVE_READER::COUNT_GETTER() const
+{
+    return static_cast<size_t>(Count);
+}
+
+inline QR::ARCHIVE_RECORD QR::ARCHIVE_READER::AT(size_t index) const
+{
+    if (index >= Count)
+        throw std::domain_error("value out of range");
+    return RECORD_AT(Entries[2 * index + 1]);
+}
+
+inline std::uint64_t QR::ARCHIVE_READER::OFFSET(size_t index) const
+{
+    if (index >= Count)
+        throw std::domain_error("value out of range");
+    return Entries[2 * index + 1];
+}
+
+#endif
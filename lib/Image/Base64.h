@@ -0,0 +1,208 @@
+#ifndef BASE64_H
+#define BASE64_H
+
+#include "Sink.h"
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QR_BASE64_SSE2 1
+#endif
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#include <tmmintrin.h>
+#define QR_BASE64_SSSE3 1
+#endif
+
+namespace QR
+{
+    /**
+    * @brief Base64 (RFC 4648, standard alphabet, padded) for text transports of binary output.
+    *
+    * 12 input bytes become 16 characters per step: the bytes are spread into one 32-bit lane
+    * per group of three (a byte shuffle with SSSE3, four scalar loads with SSE2), the four
+    * 6-bit indices are cut out with shifts and masks, and the alphabet is applied by adding
+    * an offset chosen with four compares, so there is no table lookup per character. The
+    * tail and targets without SSE2 use the scalar table.
+    */
+    struct BASE64
+    {
+        /**
+        * @brief Length of the encoding of `length` bytes.
+        */
+        static size_t ENCODED_LENGTH(size_t length);
+
+        /**
+        * @brief Appends the encoding of `length` bytes to `out`.
+        */
+        static void ENCODE(const std::uint8_t* data, size_t length, std::string& out);
+
+        /**
+        * @brief Returns the encoding of a string of bytes.
+        */
+        static std::string ENCODE(const std::string& data);
+
+    private:
+        /**
+        * @brief Encodes whole groups of three bytes, returns the number of bytes consumed.
+        */
+        static size_t ENCODE_BLOCKS(const std::uint8_t* data, size_t length, char* text);
+    };
+
+    /**
+    * @brief Base64-encodes everything written to it onto the end of a caller's string.
+    *
+    * Lets a streaming writer (PNG_STREAM, SVG_STREAM, ...) produce a data URI directly,
+    * without the binary output ever being held in full. At most two bytes are kept back
+    * between writes; FINISH() encodes them with the padding.
+    */
+    class BASE64_SINK : public SINK
+    {
+    public:
+        explicit BASE64_SINK(std::string& target);
+
+        void WRITE(const void* data, size_t length) override;
+
+        /**
+        * @brief Encodes the bytes kept back, with the padding. Nothing may be written after it.
+        */
+        void FINISH();
+
+    private:
+        std::string& Target;
+
+        std::uint8_t Pending[3];
+
+        size_t Count;
+    };
+}
+
+inline size_t QR::BASE64::ENCODED_LENGTH(size_t length)
+{
+    return (length + 2) / 3 * 4;
+}
+
+inline size_t QR::BASE64::ENCODE_BLOCKS(const std::uint8_t* data, size_t length, char* text)
+{
+    size_t i = 0;
+#if QR_BASE64_SSE2
+    // Index to character: +65 ('A'), +71 past 25, -4 past 51, -19 ('+') past 61, -16 ('/') past 62
+    const __m128i base = _mm_set1_epi8(65);
+    const __m128i over25 = _mm_set1_epi8(25);
+    const __m128i over51 = _mm_set1_epi8(51);
+    const __m128i over61 = _mm_set1_epi8(61);
+    const __m128i over62 = _mm_set1_epi8(62);
+
+    // The SSSE3 path loads 16 bytes to use 12, so it stops 4 bytes early
+#if QR_BASE64_SSSE3
+    const size_t slack = 4;
+    const __m128i spread = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+#else
+    const size_t slack = 0;
+#endif
+    for (; i + 12 + slack <= length; i += 12, text += 16)
+    {
+#if QR_BASE64_SSSE3
+        // Each lane holds b1 b0 b2 b1, so the multiplies below can move all four fields at once
+        __m128i lanes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), spread);
+        __m128i high = _mm_mulhi_epu16(_mm_and_si128(lanes, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        __m128i low = _mm_mullo_epi16(_mm_and_si128(lanes, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        __m128i indices = _mm_or_si128(high, low);
+#else
+        const std::uint8_t* in = data + i;
+        __m128i lanes = _mm_setr_epi32(
+            (in[0] << 16) | (in[1] << 8) | in[2], (in[3] << 16) | (in[4] << 8) | in[5],
+            (in[6] << 16) | (in[7] << 8) | in[8], (in[9] << 16) | (in[10] << 8) | in[11]);
+
+        // Lane b0 b1 b2 -> bytes (b0 >> 2), (b0 b1 >> 4) & 63, (b1 b2 >> 6) & 63, b2 & 63
+        __m128i indices = _mm_or_si128(
+            _mm_or_si128(_mm_srli_epi32(lanes, 18), _mm_and_si128(_mm_srli_epi32(lanes, 4), _mm_set1_epi32(0x3F00))),
+            _mm_or_si128(_mm_and_si128(_mm_slli_epi32(lanes, 10), _mm_set1_epi32(0x3F0000)),
+                _mm_and_si128(_mm_slli_epi32(lanes, 24), _mm_set1_epi32(0x3F000000))));
+#endif
+        __m128i offset = _mm_add_epi8(base, _mm_and_si128(_mm_cmpgt_epi8(indices, over25), _mm_set1_epi8(6)));
+        offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(indices, over51), _mm_set1_epi8(-75)));
+        offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(indices, over61), _mm_set1_epi8(-15)));
+        offset = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(indices, over62), _mm_set1_epi8(3)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text), _mm_add_epi8(indices, offset));
+    }
+#endif
+
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (; i + 3 <= length; i += 3, text += 4)
+    {
+        std::uint32_t group = (static_cast<std::uint32_t>(data[i]) << 16) | (data[i + 1] << 8) | data[i + 2];
+        text[0] = alphabet[group >> 18];
+        text[1] = alphabet[(group >> 12) & 63];
+        text[2] = alphabet[(group >> 6) & 63];
+        text[3] = alphabet[group & 63];
+    }
+    return i;
+}
+
+inline void QR::BASE64::ENCODE(const std::uint8_t* data, size_t length, std::string& out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    size_t start = out.size();
+    out.resize(start + ENCODED_LENGTH(length));
+    char* text = &out[start];
+
+    size_t i = ENCODE_BLOCKS(data, length, text);
+    text += i / 3 * 4;
+    if (i < length)
+    {
+        std::uint32_t group = static_cast<std::uint32_t>(data[i]) << 16;
+        if (i + 1 < length)
+            group |= data[i + 1] << 8;
+        text[0] = alphabet[group >> 18];
+        text[1] = alphabet[(group >> 12) & 63];
+        text[2] = i + 1 < length ? alphabet[(group >> 6) & 63] : '=';
+        text[3] = '=';
+    }
+}
+
+inline std::string QR::BASE64::ENCODE(const std::string& data)
+{
+    std::string out;
+    ENCODE(reinterpret_cast<const std::uint8_t*>(data.data()), data.size(), out);
+    return out;
+}
+
+inline QR::BASE64_SINK::BASE64_SINK(std::string& target)
+    : Target(target), Pending{ 0, 0, 0 }, Count(0)
+{
+}
+
+inline void QR::BASE64_SINK::WRITE(const void* data, size_t length)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+
+    // Complete the group kept back by the previous write
+    while (Count > 0 && Count < 3 && length > 0)
+    {
+        Pending[Count++] = *bytes++;
+        length--;
+    }
+    if (Count == 3)
+    {
+        BASE64::ENCODE(Pending, 3, Target);
+        Count = 0;
+    }
+
+    size_t whole = length - length % 3;
+    BASE64::ENCODE(bytes, whole, Target);
+    for (size_t i = whole; i < length; i++)
+        Pending[Count++] = bytes[i];
+}
+
+inline void QR::BASE64_SINK::FINISH()
+{
+    BASE64::ENCODE(Pending, Count, Target);
+    Count = 0;
+}
+
+#endif
@@ -0,0 +1,335 @@
+#ifndef BITMAPSTREAM_H
+#define BITMAPSTREAM_H
+
+#include "Sink.h"
+#include "Raster.h"
+#include "../QRCode/MatrixView.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Uncompressed (and PackBits) bitmap writers: PBM, PGM, BMP and TIFF.
+    *
+    * Every pixel row of a module row is identical, so each writer renders one line per module
+    * row with RASTER::RENDER_LINE, already laid out for the format, and hands the sink a list
+    * of slices pointing `scale` times at that line. With a gathering sink (FD_SINK uses writev)
+    * the image is never assembled in memory and no row is copied.
+    */
+    class BITMAP_STREAM
+    {
+    public:
+        /**
+        * @brief TIFF strip compression.
+        */
+        enum class TIFF_COMPRESSION
+        {
+            NONE,
+            PACKBITS
+        };
+
+        /**
+        * @brief Writes a binary PBM (P4): one bit per pixel, 1 = black.
+        *
+        * @throws std::domain_error if the scale or the border is out of range.
+        */
+        static void PBM(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1);
+
+        /**
+        * @brief Writes a binary PGM (P5) with 8-bit gray levels, the luma of the two colors.
+        */
+        static void PGM(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1,
+            RASTER::COLOR dark = RASTER::COLOR{ 0, 0, 0, 255 },
+            RASTER::COLOR light = RASTER::COLOR{ 255, 255, 255, 255 });
+
+        /**
+        * @brief Writes a 1-bit BMP whose two-entry palette holds the colors.
+        */
+        static void BMP(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1,
+            RASTER::COLOR dark = RASTER::COLOR{ 0, 0, 0, 255 },
+            RASTER::COLOR light = RASTER::COLOR{ 255, 255, 255, 255 });
+
+        /**
+        * @brief Writes a bilevel baseline TIFF with one strip per module row.
+        */
+        static void TIFF(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1,
+            TIFF_COMPRESSION compression = TIFF_COMPRESSION::PACKBITS);
+
+        /**
+        * @brief Renders one line per module row, each padded with zeros to `lineBytes`.
+        *
+        * The row generation shared by the writers here and by the printer command writers.
+        */
+        static std::vector<std::uint8_t> LINES(const MATRIX_VIEW& view, const RASTER& raster, size_t lineBytes);
+
+        /**
+        * @brief One slice per line of LINES' result.
+        */
+        static std::vector<SLICE> SLICES(const std::vector<std::uint8_t>& lines, size_t lineBytes);
+
+        /**
+        * @brief Writes each module row's line `repeat` times, from the top or from the bottom.
+        */
+        static void EMIT(SINK& sink, const std::vector<SLICE>& rows, int repeat, bool bottomUp);
+
+    private:
+        // Slices handed to the sink in one WRITEV
+        static constexpr size_t BATCH = 1024;
+
+        /**
+        * @brief Appends the PackBits (TIFF compression 32773) encoding of one row.
+        */
+        static void PACKBITS(const std::uint8_t* row, size_t length, std::vector<std::uint8_t>& out);
+
+        static void PUT16(std::vector<std::uint8_t>& out, std::uint32_t value);
+
+        static void PUT32(std::vector<std::uint8_t>& out, std::uint32_t value);
+    };
+}
+
+inline std::vector<std::uint8_t> QR::BITMAP_STREAM::LINES(const MATRIX_VIEW& view, const RASTER& raster, size_t lineBytes)
+{
+    int rows = view.SIZE_GETTER() + 2 * raster.BORDER_GETTER();
+    std::vector<std::uint8_t> lines(static_cast<size_t>(rows) * lineBytes, 0);
+    for (int row = 0; row < rows; row++)
+        raster.RENDER_LINE(view, row, lines.data() + static_cast<size_t>(row) * lineBytes);
+    return lines;
+}
+
+inline std::vector<QR::SLICE> QR::BITMAP_STREAM::SLICES(const std::vector<std::uint8_t>& lines, size_t lineBytes)
+{
+    std::vector<SLICE> rows;
+    for (size_t k = 0; k < lines.size(); k += lineBytes)
+        rows.push_back(SLICE{ lines.data() + k, lineBytes });
+    return rows;
+}
+
+inline void QR::BITMAP_STREAM::EMIT(SINK& sink, const std::vector<SLICE>& rows, int repeat, bool bottomUp)
+{
+    std::vector<SLICE> batch;
+    batch.reserve(BATCH);
+    for (size_t k = 0; k < rows.size(); k++)
+    {
+        const SLICE& row = rows[bottomUp ? rows.size() - 1 - k : k];
+        for (int i = 0; i < repeat; i++)
+        {
+            batch.push_back(row);
+            if (batch.size() == BATCH)
+            {
+                sink.WRITEV(batch.data(), batch.size());
+                batch.clear();
+            }
+        }
+    }
+    if (!batch.empty())
+        sink.WRITEV(batch.data(), batch.size());
+}
+
+inline void QR::BITMAP_STREAM::PUT16(std::vector<std::uint8_t>& out, std::uint32_t value)
+{
+    out.push_back(static_cast<std::uint8_t>(value));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+}
+
+inline void QR::BITMAP_STREAM::PUT32(std::vector<std::uint8_t>& out, std::uint32_t value)
+{
+    PUT16(out, value & 0xFFFF);
+    PUT16(out, value >> 16);
+}
+
+inline void QR::BITMAP_STREAM::PBM(SINK& sink, const MATRIX_VIEW& view, int scale, int border)
+{
+    const RASTER raster(RASTER::FORMAT::MONO1, scale, border);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+    size_t lineBytes = raster.ROW_BYTES(width);
+    std::vector<std::uint8_t> lines = LINES(view, raster, lineBytes);
+
+    std::string header = "P4\n" + std::to_string(width) + " " + std::to_string(width) + "\n";
+    sink.WRITE(header.data(), header.size());
+
+    std::vector<SLICE> rows = SLICES(lines, lineBytes);
+    EMIT(sink, rows, scale, false);
+}
+
+inline void QR::BITMAP_STREAM::PGM(SINK& sink, const MATRIX_VIEW& view, int scale, int border,
+    RASTER::COLOR dark, RASTER::COLOR light)
+{
+    const RASTER raster(RASTER::FORMAT::GRAY8, scale, border, dark, light);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+    size_t lineBytes = raster.ROW_BYTES(width);
+    std::vector<std::uint8_t> lines = LINES(view, raster, lineBytes);
+
+    std::string header = "P5\n" + std::to_string(width) + " " + std::to_string(width) + "\n255\n";
+    sink.WRITE(header.data(), header.size());
+
+    std::vector<SLICE> rows = SLICES(lines, lineBytes);
+    EMIT(sink, rows, scale, false);
+}
+
+inline void QR::BITMAP_STREAM::BMP(SINK& sink, const MATRIX_VIEW& view, int scale, int border,
+    RASTER::COLOR dark, RASTER::COLOR light)
+{
+    const RASTER raster(RASTER::FORMAT::MONO1, scale, border, dark, light);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+
+    // BMP rows are padded to 4 bytes and stored bottom-up
+    size_t lineBytes = (raster.ROW_BYTES(width) + 3) & ~static_cast<size_t>(3);
+    std::vector<std::uint8_t> lines = LINES(view, raster, lineBytes);
+    std::uint32_t imageBytes = static_cast<std::uint32_t>(lineBytes * width);
+
+    // File header, BITMAPINFOHEADER and a palette of light (index 0) then dark (index 1)
+    std::vector<std::uint8_t> header = { 'B', 'M' };
+    PUT32(header, 62 + imageBytes);
+    PUT32(header, 0);
+    PUT32(header, 62);
+    PUT32(header, 40);
+    PUT32(header, static_cast<std::uint32_t>(width));
+    PUT32(header, static_cast<std::uint32_t>(width));
+    PUT16(header, 1);
+    PUT16(header, 1);
+    PUT32(header, 0);
+    PUT32(header, imageBytes);
+    PUT32(header, 2835);    // 72 dpi
+    PUT32(header, 2835);
+    PUT32(header, 2);
+    PUT32(header, 2);
+    for (const RASTER::COLOR& color : { light, dark })
+    {
+        header.push_back(color.b);
+        header.push_back(color.g);
+        header.push_back(color.r);
+        header.push_back(0);
+    }
+    sink.WRITE(header.data(), header.size());
+
+    std::vector<SLICE> rows = SLICES(lines, lineBytes);
+    EMIT(sink, rows, scale, true);
+}
+
+inline void QR::BITMAP_STREAM::PACKBITS(const std::uint8_t* row, size_t length, std::vector<std::uint8_t>& out)
+{
+    size_t i = 0;
+    while (i < length)
+    {
+        // A repeat run of 2 to 128 bytes
+        size_t run = 1;
+        while (i + run < length && run < 128 && row[i + run] == row[i])
+            run++;
+        if (run >= 2)
+        {
+            out.push_back(static_cast<std::uint8_t>(257 - run));
+            out.push_back(row[i]);
+            i += run;
+            continue;
+        }
+
+        // A literal run of up to 128 bytes, ending where three equal bytes start
+        size_t start = i;
+        while (i < length && i - start < 128)
+        {
+            if (i + 2 < length && row[i] == row[i + 1] && row[i] == row[i + 2])
+                break;
+            i++;
+        }
+        out.push_back(static_cast<std::uint8_t>(i - start - 1));
+        out.insert(out.end(), row + start, row + i);
+    }
+}
+
+inline void QR::BITMAP_STREAM::TIFF(SINK& sink, const MATRIX_VIEW& view, int scale, int border,
+    TIFF_COMPRESSION compression)
+{
+    const RASTER raster(RASTER::FORMAT::MONO1, scale, border);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+    size_t lineBytes = raster.ROW_BYTES(width);
+    std::vector<std::uint8_t> lines = LINES(view, raster, lineBytes);
+    size_t strips = lines.size() / lineBytes;
+
+    // Each strip is one module row: its line, compressed on its own, `scale` times
+    std::vector<std::uint8_t> packed;
+    std::vector<SLICE> rows;
+    if (compression == TIFF_COMPRESSION::PACKBITS)
+    {
+        std::vector<size_t> ends;
+        for (size_t k = 0; k < lines.size(); k += lineBytes)
+        {
+            PACKBITS(lines.data() + k, lineBytes, packed);
+            ends.push_back(packed.size());
+        }
+        for (size_t k = 0; k < strips; k++)
+        {
+            size_t begin = k == 0 ? 0 : ends[k - 1];
+            rows.push_back(SLICE{ packed.data() + begin, ends[k] - begin });
+        }
+    }
+    else
+        rows = SLICES(lines, lineBytes);
+
+    // Little-endian header, then the IFD, the resolutions, the strip tables and the strips
+    const std::uint32_t entries = 12;
+    const std::uint32_t ifd = 8;
+    const std::uint32_t resolution = ifd + 2 + entries * 12 + 4;
+    const std::uint32_t offsets = resolution + 16;
+    const std::uint32_t counts = offsets + 4 * static_cast<std::uint32_t>(strips);
+
+    // A single strip's offset and byte count fit in the entries themselves
+    bool single = strips == 1;
+    std::uint32_t data = single ? offsets : counts + 4 * static_cast<std::uint32_t>(strips);
+
+    std::vector<std::uint8_t> header = { 'I', 'I', 42, 0 };
+    PUT32(header, ifd);
+    PUT16(header, entries);
+    auto entry = [&header](std::uint32_t tag, std::uint32_t type, std::uint32_t count, std::uint32_t value) {
+        PUT16(header, tag);
+        PUT16(header, type);
+        PUT32(header, count);
+        if (type == 3 && count == 1)
+        {
+            PUT16(header, value);
+            PUT16(header, 0);
+        }
+        else
+            PUT32(header, value);
+    };
+    const std::uint32_t typeShort = 3, typeLong = 4, typeRational = 5;
+    entry(256, typeLong, 1, static_cast<std::uint32_t>(width));                                    // ImageWidth
+    entry(257, typeLong, 1, static_cast<std::uint32_t>(width));                                    // ImageLength
+    entry(258, typeShort, 1, 1);                                                                    // BitsPerSample
+    entry(259, typeShort, 1, compression == TIFF_COMPRESSION::PACKBITS ? 32773 : 1);                // Compression
+    entry(262, typeShort, 1, 0);                                                                    // WhiteIsZero
+    entry(273, typeLong, static_cast<std::uint32_t>(strips), single ? data : offsets);        // StripOffsets
+    entry(277, typeShort, 1, 1);                                                                    // SamplesPerPixel
+    entry(278, typeLong, 1, static_cast<std::uint32_t>(scale));                                    // RowsPerStrip
+    entry(279, typeLong, static_cast<std::uint32_t>(strips),
+        single ? static_cast<std::uint32_t>(rows[0].length * scale) : counts);            // StripByteCounts
+    entry(282, typeRational, 1, resolution);                                                        // XResolution
+    entry(283, typeRational, 1, resolution + 8);                                                    // YResolution
+    entry(296, typeShort, 1, 2);                                                                    // ResolutionUnit: inch
+    PUT32(header, 0);
+
+    for (int i = 0; i < 2; i++)
+    {
+        PUT32(header, 72);
+        PUT32(header, 1);
+    }
+    if (!single)
+    {
+        std::uint32_t offset = data;
+        for (const SLICE& row : rows)
+        {
+            PUT32(header, offset);
+            offset += static_cast<std::uint32_t>(row.length * scale);
+        }
+        for (const SLICE& row : rows)
+            PUT32(header, static_cast<std::uint32_t>(row.length * scale));
+    }
+    sink.WRITE(header.data(), header.size());
+
+    EMIT(sink, rows, scale, false);
+}
+
+#endif
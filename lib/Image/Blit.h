@@ -0,0 +1,337 @@
+#ifndef BLIT_H
+#define BLIT_H
+
+#include "Raster.h"
+#include "../QRCode/MatrixView.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QR_BLIT_SSE2 1
+#endif
+
+namespace QR
+{
+    /**
+    * @brief Draws symbols into frames owned by the caller (video overlays, compositors).
+    *
+    * The frame is never read or written outside the part the symbol covers, which is clipped
+    * to the frame, so the symbol may hang over any edge. Each module row is turned once into
+    * spans of pixels of one color (on the stack), then every pixel row of it fills or blends
+    * those spans: opaque colors are stored 16 bytes at a time, translucent ones are blended
+    * with SSE2 as dst + (src - dst) * alpha, in 16-bit lanes. Nothing is allocated per frame.
+    */
+    class BLITTER
+    {
+    public:
+        /**
+        * @brief Frame layouts DRAW can write.
+        */
+        enum class FORMAT
+        {
+            RGBA32,     // 4 bytes per pixel: R, G, B, A
+            BGRA32,     // 4 bytes per pixel: B, G, R, A
+            NV12        // 8-bit Y plane, then interleaved U and V at half resolution (BT.601, video range)
+        };
+
+        /**
+        * @brief Prepares the colors for a frame layout.
+        *
+        * @param format The layout of the frames.
+        * @param scale The number of pixels per module side (1 - 256).
+        * @param border The width of the quiet zone, in modules; it is drawn in the light color.
+        * @param dark The color of dark modules; its alpha is the opacity of the drawing.
+        * @param light The color of light modules and the border; alpha 0 leaves the frame as is.
+        *
+        * @throws std::domain_error if the scale or the border is out of range.
+        */
+        BLITTER(FORMAT format, int scale, int border = 1,
+            RASTER::COLOR dark = RASTER::COLOR{ 0, 0, 0, 255 },
+            RASTER::COLOR light = RASTER::COLOR{ 255, 255, 255, 255 });
+
+        /**
+        * @brief Draws a symbol into an RGBA32 or BGRA32 frame with its top left corner at (x, y).
+        *
+        * @param view The packed modules to draw.
+        * @param frame The first byte of the frame's top row.
+        * @param width The frame width in pixels.
+        * @param height The frame height in pixels.
+        * @param stride The distance in bytes between the starts of two rows.
+        * @param x The frame column of the left edge of the border; may be negative.
+        * @param y The frame row of the top edge of the border; may be negative.
+        *
+        * @throws std::invalid_argument if the blitter was built for NV12.
+        */
+        void DRAW(const MATRIX_VIEW& view, std::uint8_t* frame, int width, int height, size_t stride, int x, int y) const;
+
+        /**
+        * @brief Draws a symbol into an NV12 frame with its top left corner at (x, y).
+        *
+        * Chroma is taken from the pixel at the top left of each 2 x 2 block.
+        *
+        * @param luma The first byte of the Y plane.
+        * @param lumaStride The distance in bytes between two Y rows.
+        * @param chroma The first byte of the interleaved UV plane.
+        * @param chromaStride The distance in bytes between two UV rows.
+        *
+        * @throws std::invalid_argument if the blitter was not built for NV12.
+        */
+        void DRAW(const MATRIX_VIEW& view, std::uint8_t* luma, size_t lumaStride, std::uint8_t* chroma, size_t chromaStride,
+            int width, int height, int x, int y) const;
+
+        /**
+        * @brief Width and height in pixels of a drawn symbol of `size` modules per side.
+        */
+        int PIXELS(int size) const;
+
+    private:
+        // A symbol row has at most 177 + 2 * 64 modules, so at most that many spans
+        static constexpr int MAX_SPANS = 177 + 2 * 64;
+
+        /**
+        * @brief One color as stored in a plane: the byte pattern and its blend factors.
+        */
+        struct PAINT
+        {
+            std::array<std::uint8_t, 16> bytes;     // The color repeated over 16 bytes
+            std::array<std::uint16_t, 8> value;     // The first 8 bytes as 16-bit lanes
+            std::uint16_t alpha;                    // 0 (skip) to 255 (store)
+        };
+
+        /**
+        * @brief Pixels [start, end) of a symbol row, all of one color.
+        */
+        struct SPAN
+        {
+            int start;
+            int end;
+            bool dark;
+        };
+
+        /**
+        * @brief Splits a module row (border included) into spans of pixels, returns their number.
+        */
+        int SPANS(const MATRIX_VIEW& view, int row, SPAN* spans) const;
+
+        /**
+        * @brief Draws the symbol into one plane, clipped to its `columns` x `rows` samples.
+        *
+        * A symbol pixel (sx, sy) lands on plane column (left + sx) / step and plane row
+        * (frameTop + sy) / step, where `step` is 2 for the subsampled chroma plane.
+        */
+        void PLANE(const MATRIX_VIEW& view, std::uint8_t* plane, size_t stride, int columns, int rows, int step,
+            int left, int frameTop, size_t pixelBytes, const PAINT& dark, const PAINT& light) const;
+
+        /**
+        * @brief Stores or blends one color over `bytes` bytes starting on a pixel boundary.
+        */
+        static void PAINT_BYTES(std::uint8_t* out, size_t bytes, const PAINT& paint);
+
+        static PAINT MAKE_PAINT(const std::uint8_t* pattern, size_t period, std::uint8_t alpha);
+
+        FORMAT Format;
+
+        int Scale;
+
+        int Border;
+
+        PAINT Dark;
+
+        PAINT Light;
+
+        // NV12 chroma
+        PAINT DarkChroma;
+
+        PAINT LightChroma;
+    };
+}
+
+inline QR::BLITTER::PAINT QR::BLITTER::MAKE_PAINT(const std::uint8_t* pattern, size_t period, std::uint8_t alpha)
+{
+    PAINT paint;
+    for (size_t i = 0; i < 16; i++)
+        paint.bytes[i] = pattern[i % period];
+    for (size_t i = 0; i < 8; i++)
+        paint.value[i] = paint.bytes[i];
+    paint.alpha = alpha;
+    return paint;
+}
+
+inline QR::BLITTER::BLITTER(FORMAT format, int scale, int border, RASTER::COLOR dark, RASTER::COLOR light)
+    : Format(format), Scale(scale), Border(border)
+{
+    if (scale < 1 || scale > 256 || border < 0 || border > 64)
+        throw std::domain_error("value out of range");
+
+    if (format == FORMAT::NV12)
+    {
+        // BT.601 video range, in fixed point
+        auto yuv = [](const RASTER::COLOR& c, std::uint8_t* y, std::uint8_t* uv) {
+            *y = static_cast<std::uint8_t>((66 * c.r + 129 * c.g + 25 * c.b + 128 + 4096) >> 8);
+            uv[0] = static_cast<std::uint8_t>((-38 * c.r - 74 * c.g + 112 * c.b + 128 + 32768) >> 8);
+            uv[1] = static_cast<std::uint8_t>((112 * c.r - 94 * c.g - 18 * c.b + 128 + 32768) >> 8);
+        };
+        std::uint8_t y[2], uv[2][2];
+        yuv(dark, &y[0], uv[0]);
+        yuv(light, &y[1], uv[1]);
+        Dark = MAKE_PAINT(&y[0], 1, dark.a);
+        Light = MAKE_PAINT(&y[1], 1, light.a);
+        DarkChroma = MAKE_PAINT(uv[0], 2, dark.a);
+        LightChroma = MAKE_PAINT(uv[1], 2, light.a);
+        return;
+    }
+
+    // The frame's alpha is blended like a channel whose source value is 255 (source over)
+    const bool bgra = format == FORMAT::BGRA32;
+    const std::uint8_t darkBytes[4] = { bgra ? dark.b : dark.r, dark.g, bgra ? dark.r : dark.b, 255 };
+    const std::uint8_t lightBytes[4] = { bgra ? light.b : light.r, light.g, bgra ? light.r : light.b, 255 };
+    Dark = MAKE_PAINT(darkBytes, 4, dark.a);
+    Light = MAKE_PAINT(lightBytes, 4, light.a);
+    DarkChroma = Dark;
+    LightChroma = Light;
+}
+
+inline int QR::BLITTER::PIXELS(int size) const
+{
+    return (size + 2 * Border) * Scale;
+}
+
+inline int QR::BLITTER::SPANS(const MATRIX_VIEW& view, int row, SPAN* spans) const
+{
+    const int size = view.SIZE_GETTER();
+    const int side = size + 2 * Border;
+    const int y = row - Border;
+    if (y < 0 || y >= size)
+    {
+        spans[0] = SPAN{ 0, side * Scale, false };
+        return 1;
+    }
+
+    // The left border is part of the first light span
+    std::span<const std::uint64_t> bits = view.ROW(y);
+    int count = 0;
+    int start = 0;
+    bool dark = false;
+    for (int x = 0; x < size; x++)
+    {
+        bool now = MATRIX_VIEW::TEST(bits, x);
+        if (now == dark)
+            continue;
+        int end = (x + Border) * Scale;
+        if (end > start)
+            spans[count++] = SPAN{ start, end, dark };
+        start = end;
+        dark = now;
+    }
+    if (dark)
+    {
+        int end = (size + Border) * Scale;
+        spans[count++] = SPAN{ start, end, true };
+        start = end;
+    }
+    if (start < side * Scale)
+        spans[count++] = SPAN{ start, side * Scale, false };
+    return count;
+}
+
+inline void QR::BLITTER::PAINT_BYTES(std::uint8_t* out, size_t bytes, const PAINT& paint)
+{
+    if (paint.alpha == 0)
+        return;
+
+    size_t i = 0;
+    if (paint.alpha == 255)
+    {
+        for (; i + 16 <= bytes; i += 16)
+            std::memcpy(out + i, paint.bytes.data(), 16);
+        std::memcpy(out + i, paint.bytes.data(), bytes - i);
+        return;
+    }
+
+    // dst + (src - dst) * a / 255, rounded, with x / 255 computed as (x + 128 + ((x + 128) >> 8)) >> 8
+    const int alpha = paint.alpha;
+#if QR_BLIT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weight = _mm_set1_epi16(static_cast<short>(alpha));
+    const __m128i inverse = _mm_set1_epi16(static_cast<short>(255 - alpha));
+    const __m128i half = _mm_set1_epi16(128);
+    __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(paint.value.data()));
+    source = _mm_mullo_epi16(source, weight);
+    for (; i + 16 <= bytes; i += 16)
+    {
+        __m128i frame = _mm_loadu_si128(reinterpret_cast<const __m128i*>(out + i));
+        __m128i low = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(frame, zero), inverse), source), half);
+        __m128i high = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(frame, zero), inverse), source), half);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+    }
+#endif
+    for (; i < bytes; i++)
+    {
+        int value = out[i] * (255 - alpha) + paint.bytes[i & 15] * alpha + 128;
+        out[i] = static_cast<std::uint8_t>((value + (value >> 8)) >> 8);
+    }
+}
+
+inline void QR::BLITTER::PLANE(const MATRIX_VIEW& view, std::uint8_t* plane, size_t stride, int columns, int rows, int step,
+    int left, int frameTop, size_t pixelBytes, const PAINT& dark, const PAINT& light) const
+{
+    const int side = PIXELS(view.SIZE_GETTER());
+    SPAN spans[MAX_SPANS];
+    int spanRow = -1;
+    int count = 0;
+
+    // The first symbol row on a frame row that is inside the plane and, for chroma, even
+    int first = std::max(0, -frameTop);
+    if ((frameTop + first) % step != 0)
+        first += step - (frameTop + first) % step;
+    for (int sy = first; sy < side; sy += step)
+    {
+        int planeRow = (frameTop + sy) / step;
+        if (planeRow >= rows)
+            break;
+        if (sy / Scale != spanRow)
+        {
+            spanRow = sy / Scale;
+            count = SPANS(view, spanRow, spans);
+        }
+
+        std::uint8_t* line = plane + stride * static_cast<size_t>(planeRow);
+        for (int k = 0; k < count; k++)
+        {
+            // Plane columns whose pixel (column * step) lies in the span
+            int begin = left + spans[k].start;
+            int end = left + spans[k].end;
+            begin = (begin + step - 1) / step;
+            end = (end + step - 1) / step;
+            begin = std::max(begin, 0);
+            end = std::min(end, columns);
+            if (begin < end)
+                PAINT_BYTES(line + pixelBytes * begin, pixelBytes * (end - begin), spans[k].dark ? dark : light);
+        }
+    }
+}
+
+inline void QR::BLITTER::DRAW(const MATRIX_VIEW& view, std::uint8_t* frame, int width, int height, size_t stride, int x, int y) const
+{
+    if (Format == FORMAT::NV12)
+        throw std::invalid_argument("Invalid value");
+    PLANE(view, frame, stride, width, height, 1, x, y, 4, Dark, Light);
+}
+
+inline void QR::BLITTER::DRAW(const MATRIX_VIEW& view, std::uint8_t* luma, size_t lumaStride, std::uint8_t* chroma, size_t chromaStride,
+    int width, int height, int x, int y) const
+{
+    if (Format != FORMAT::NV12)
+        throw std::invalid_argument("Invalid value");
+    PLANE(view, luma, lumaStride, width, height, 1, x, y, 1, Dark, Light);
+    PLANE(view, chroma, chromaStride, (width + 1) / 2, (height + 1) / 2, 2, x, y, 2, DarkChroma, LightChroma);
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+namespace QR
+{
+    /**
+    * @brief Running checksums used by the PNG, zlib and gzip writers.
+    *
+    * Both functions continue from a previous value, so data can be checksummed piece by piece.
+    */
+    struct CHECKSUM
+    {
+        /**
+        * @brief CRC-32 (ISO 3309, as used by PNG chunks and gzip), starting from 0.
+        */
+        static std::uint32_t CRC32(std::uint32_t crc, const std::uint8_t* data, size_t length);
+
+        /**
+        * @brief Adler-32 (RFC 1950, as used by zlib streams), starting from 1.
+        */
+        static std::uint32_t ADLER32(std::uint32_t adler, const std::uint8_t* data, size_t length);
+
+        /**
+        * @brief Adler-32 of two pieces of data from the checksums of each and the second one's length.
+        */
+        static std::uint32_t ADLER32_COMBINE(std::uint32_t first, std::uint32_t second, std::uint64_t secondLength);
+
+    private:
+        static const std::array<std::uint32_t, 256>& CRC_TABLE();
+    };
+}
+
+inline const std::array<std::uint32_t, 256>& QR::CHECKSUM::CRC_TABLE()
+{
+    static const std::array<std::uint32_t, 256> table = []()
+        {
+            std::array<std::uint32_t, 256> result{};
+            for (std::uint32_t n = 0; n < 256; n++)
+            {
+                std::uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                result[n] = c;
+            }
+            return result;
+        }();
+    return table;
+}
+
+inline std::uint32_t QR::CHECKSUM::CRC32(std::uint32_t crc, const std::uint8_t* data, size_t length)
+{
+    const std::array<std::uint32_t, 256>& table = CRC_TABLE();
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline std::uint32_t QR::CHECKSUM::ADLER32(std::uint32_t adler, const std::uint8_t* data, size_t length)
+{
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    while (length > 0)
+    {
+        // 5552 is the largest block whose sums cannot overflow 32 bits before the modulo
+        size_t block = length < 5552 ? length : 5552;
+        length -= block;
+        for (size_t i = 0; i < block; i++)
+        {
+            a += data[i];
+            b += a;
+        }
+        data += block;
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+inline std::uint32_t QR::CHECKSUM::ADLER32_COMBINE(std::uint32_t first, std::uint32_t second, std::uint64_t secondLength)
+{
+    // Each byte of the second piece adds the first piece's sum a to b once more (as in zlib)
+    const std::uint64_t base = 65521;
+    std::uint64_t remainder = secondLength % base;
+    std::uint64_t a = (first & 0xFFFF) + (second & 0xFFFF) + base - 1;
+    std::uint64_t b = remainder * (first & 0xFFFF) % base + (first >> 16) + (second >> 16) + base - remainder;
+    return static_cast<std::uint32_t>(((b % base) << 16) | (a % base));
+}
+
+#endif
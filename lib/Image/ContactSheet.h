@@ -0,0 +1,174 @@
+#ifndef CONTACTSHEET_H
+#define CONTACTSHEET_H
+
+#include "Sink.h"
+#include "Raster.h"
+#include "Deflate.h"
+#include "Checksum.h"
+#include "PngStream.h"
+#include "../QRCode/MatrixView.h"
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief CONTACT_SHEET layout and encoding choices.
+    */
+    struct SHEET_OPTIONS
+    {
+        int columns = 8;
+        int scale = 4;              // Pixels per module side
+        int border = 4;             // Quiet zone around each symbol, in modules
+        int threads = 0;            // Worker threads, 0 for one per hardware thread
+        int level = 6;              // Deflate effort, 1 (fastest) to 9 (smallest)
+        RASTER::COLOR dark = RASTER::COLOR{ 0, 0, 0, 255 };
+        RASTER::COLOR light = RASTER::COLOR{ 255, 255, 255, 255 };
+    };
+
+    /**
+    * @brief Writes many symbols as one 1-bit PNG, in a grid of equal cells.
+    *
+    * The sheet is split into stripes, one per row of cells. Worker threads take stripes in
+    * turn, render their symbols into that stripe of a shared 1-bit buffer, and deflate its
+    * scanlines as an independent piece: a fresh DEFLATE_STREAM, ended with a sync flush
+    * instead of a final block, so the pieces concatenate into one valid stream. Their Adler-32
+    * checksums are combined without reading the data again. Cells are a whole number of bytes
+    * wide, so every symbol starts on a byte and is drawn by RASTER::RENDER directly.
+    */
+    class CONTACT_SHEET
+    {
+    public:
+        /**
+        * @brief Writes the sheet holding `views`, in order, left to right and top to bottom.
+        *
+        * @throws std::domain_error if an option is out of range.
+        * @throws std::invalid_argument if there is no symbol or the sheet is too large.
+        */
+        static void WRITE(SINK& sink, const std::vector<MATRIX_VIEW>& views, const SHEET_OPTIONS& options = SHEET_OPTIONS());
+
+    private:
+        /**
+        * @brief Compressed scanlines of one stripe, and their Adler-32 and length.
+        */
+        struct STRIPE
+        {
+            std::string data;
+            std::uint32_t adler = 1;
+            std::uint64_t length = 0;
+        };
+    };
+}
+
+inline void QR::CONTACT_SHEET::WRITE(SINK& sink, const std::vector<MATRIX_VIEW>& views, const SHEET_OPTIONS& options)
+{
+    if (views.empty())
+        throw std::invalid_argument("Invalid value");
+    if (options.columns < 1 || options.threads < 0 || options.level < 1 || options.level > 9)
+        throw std::domain_error("value out of range");
+
+    const RASTER raster(RASTER::FORMAT::MONO1, options.scale, options.border, options.dark, options.light);
+    int largest = 0;
+    for (const MATRIX_VIEW& view : views)
+        largest = std::max(largest, view.SIZE_GETTER());
+
+    // Square cells, rounded up to whole bytes
+    const int cell = (raster.PIXELS(largest) + 7) & ~7;
+    const int columns = std::min(options.columns, static_cast<int>(views.size()));
+    const int rows = static_cast<int>((views.size() + columns - 1) / columns);
+    if (static_cast<std::uint64_t>(cell) * columns > 0x7FFFFFFF || static_cast<std::uint64_t>(cell) * rows > 0x7FFFFFFF)
+        throw std::invalid_argument("Invalid value");
+    const int width = cell * columns;
+    const int height = cell * rows;
+    const size_t rowBytes = static_cast<size_t>(width) / 8;
+
+    std::vector<std::uint8_t> pixels(rowBytes * height, 0);
+    std::vector<STRIPE> stripes(static_cast<size_t>(rows));
+    std::atomic<int> next(0);
+
+    auto work = [&]()
+        {
+            std::vector<std::uint8_t> filtered(rowBytes + 1);
+            for (int stripe = next++; stripe < rows; stripe = next++)
+            {
+                std::uint8_t* top = pixels.data() + rowBytes * static_cast<size_t>(stripe) * cell;
+                for (int column = 0; column < columns; column++)
+                {
+                    size_t index = static_cast<size_t>(stripe) * columns + column;
+                    if (index >= views.size())
+                        break;
+
+                    // Centered in the cell, on a byte boundary horizontally
+                    int side = raster.PIXELS(views[index].SIZE_GETTER());
+                    int x = column * cell + (((cell - side) / 2) & ~7);
+                    int y = (cell - side) / 2;
+                    raster.RENDER(views[index], top + rowBytes * y + x / 8, rowBytes);
+                }
+
+                // A row equal to the one above is sent with the Up filter, as all zeros
+                STRIPE& out = stripes[static_cast<size_t>(stripe)];
+                STRING_SINK compressed(out.data);
+                DEFLATE_STREAM deflate(compressed, false, options.level);
+                for (int row = 0; row < cell; row++)
+                {
+                    const std::uint8_t* line = top + rowBytes * row;
+                    if (row > 0 && std::memcmp(line, line - rowBytes, rowBytes) == 0)
+                    {
+                        filtered[0] = 2;
+                        std::memset(filtered.data() + 1, 0, rowBytes);
+                    }
+                    else
+                    {
+                        filtered[0] = 0;
+                        std::memcpy(filtered.data() + 1, line, rowBytes);
+                    }
+                    deflate.WRITE(filtered.data(), filtered.size());
+                    out.adler = CHECKSUM::ADLER32(out.adler, filtered.data(), filtered.size());
+                    out.length += filtered.size();
+                }
+
+                // Byte aligned and not final, so the next stripe's blocks can follow directly
+                deflate.FLUSH();
+            }
+        };
+
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, rows);
+    std::vector<std::future<void>> pending;
+    for (int i = 1; i < threads; i++)
+        pending.push_back(std::async(std::launch::async, work));
+    work();
+    for (std::future<void>& worker : pending)
+        worker.get();
+
+    PNG_STREAM::HEADER(sink, width, height, raster);
+    PNG_STREAM::IDAT_SINK idat(sink);
+
+    // zlib header (deflate, 32K window, default level), the stripes, an empty final block
+    const std::uint8_t header[2] = { 0x78, 0x9C };
+    idat.WRITE(header, sizeof(header));
+    std::uint32_t adler = 1;
+    for (const STRIPE& stripe : stripes)
+    {
+        idat.WRITE(stripe.data.data(), stripe.data.size());
+        adler = CHECKSUM::ADLER32_COMBINE(adler, stripe.adler, stripe.length);
+    }
+    const std::uint8_t trailer[6] = { 0x03, 0x00,
+        static_cast<std::uint8_t>(adler >> 24), static_cast<std::uint8_t>(adler >> 16),
+        static_cast<std::uint8_t>(adler >> 8), static_cast<std::uint8_t>(adler) };
+    idat.WRITE(trailer, sizeof(trailer));
+    idat.FINISH();
+
+    PNG_STREAM::CHUNK(sink, "IEND", nullptr, 0);
+    sink.FLUSH();
+}
+
+#endif
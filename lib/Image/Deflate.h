@@ -0,0 +1,665 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include "Sink.h"
+#include "Checksum.h"
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief Incremental zlib (RFC 1950) / DEFLATE (RFC 1951) compressor writing to a SINK.
+    *
+    * Uses LZ77 over a 32 KB window with hash chains. Matches and literals are gathered into
+    * blocks of BLOCK_TOKENS, each sent with its own Huffman codes or with the fixed ones,
+    * whichever is shorter. Rendered QR codes are long runs of a few byte values, where both
+    * steps do well. Memory use is fixed (about 320 KB) whatever the amount of data compressed.
+    */
+    class DEFLATE_STREAM
+    {
+    public:
+        /**
+        * @brief Starts a stream.
+        *
+        * @param sink The destination of the compressed bytes.
+        * @param zlib Whether to wrap the data in a zlib header and Adler-32 trailer.
+        * @param level Effort from 1 (shortest hash chains) to 9 (longest), as in zlib.
+        *
+        * @throws std::domain_error if the level is out of range.
+        */
+        explicit DEFLATE_STREAM(SINK& sink, bool zlib = true, int level = 6);
+
+        DEFLATE_STREAM(const DEFLATE_STREAM&) = delete;
+        DEFLATE_STREAM& operator=(const DEFLATE_STREAM&) = delete;
+
+        /**
+        * @brief Compresses `length` more bytes. Output is written to the sink as it fills up.
+        */
+        void WRITE(const void* data, size_t length);
+
+        /**
+        * @brief Sync flush: everything written so far becomes decodable from the sink's bytes.
+        *
+        * Ends the current block with an empty stored block, as zlib's Z_SYNC_FLUSH does, and
+        * then flushes the sink.
+        */
+        void FLUSH();
+
+        /**
+        * @brief Ends the stream and writes the trailer. Nothing may be written afterwards.
+        */
+        void FINISH();
+
+    private:
+        static constexpr size_t WINDOW = 32768;
+        static constexpr size_t MIN_MATCH = 3;
+        static constexpr size_t MAX_MATCH = 258;
+        static constexpr size_t MAX_DISTANCE = WINDOW - MAX_MATCH - MIN_MATCH - 1;
+        static constexpr int HASH_BITS = 15;
+        static constexpr size_t OUTPUT_BYTES = 16384;
+        static constexpr size_t BLOCK_TOKENS = 16384;
+
+        /**
+        * @brief Huffman code of a symbol, bit-reversed for LSB-first output.
+        */
+        struct CODE
+        {
+            std::uint16_t bits;
+            std::uint8_t length;
+        };
+
+        /**
+        * @brief A literal (distance 0) or a match of `value` bytes, waiting for its block.
+        */
+        struct TOKEN
+        {
+            std::uint16_t value;
+            std::uint16_t distance;
+        };
+
+        static const std::array<CODE, 288>& FIXED_CODES();
+
+        static const std::uint16_t LENGTH_BASE[29];
+        static const std::uint8_t LENGTH_EXTRA[29];
+        static const std::uint16_t DISTANCE_BASE[30];
+        static const std::uint8_t DISTANCE_EXTRA[30];
+
+        // Per level: candidates tried per position, and longest match whose positions are all indexed
+        static const std::uint16_t LEVEL_CHAIN[10];
+        static const std::uint16_t LEVEL_INSERT[10];
+
+        static std::uint32_t HASH(const std::uint8_t* p);
+
+        void PUT_BITS(std::uint32_t value, int count);
+
+        void ALIGN();
+
+        static int LENGTH_CODE(size_t length);
+
+        static int DISTANCE_CODE(size_t distance);
+
+        /**
+        * @brief Huffman code lengths of at most `limit` bits for `count` symbol frequencies.
+        *
+        * At least two symbols always get a code, so the result is a complete code.
+        */
+        static void BUILD_LENGTHS(const std::uint32_t* frequencies, int count, int limit, std::uint8_t* lengths);
+
+        /**
+        * @brief Canonical codes (RFC 1951, section 3.2.2) from code lengths.
+        */
+        static void BUILD_CODES(const std::uint8_t* lengths, int count, CODE* codes);
+
+        void LITERAL(std::uint8_t value);
+
+        void MATCH(size_t length, size_t distance);
+
+        /**
+        * @brief Sends the gathered tokens as one block with the cheaper of dynamic and fixed codes.
+        */
+        void EMIT_BLOCK(bool last);
+
+        /**
+        * @brief Inserts position `p` of the window into the hash chains.
+        */
+        void INSERT(size_t p);
+
+        /**
+        * @brief Encodes the buffered input; without `all`, keeps MAX_MATCH bytes of lookahead.
+        */
+        void PROCESS(bool all);
+
+        /**
+        * @brief Drops the oldest half of the window once it is full.
+        */
+        void SLIDE();
+
+        void DRAIN();
+
+        SINK& Out;
+
+        bool Zlib;
+
+        bool Finished;
+
+        int MaxChain;
+
+        size_t MaxInsert;
+
+        std::uint32_t Adler;
+
+        std::uint64_t Bits;
+
+        int BitCount;
+
+        // Input: 2 * WINDOW bytes; positions before `Start` are history, `Start` to `End` pending
+        std::vector<std::uint8_t> Window;
+
+        size_t Start;
+
+        size_t End;
+
+        // Most recent position of each hash, and the previous position with the same hash
+        std::vector<std::int32_t> Head;
+
+        std::vector<std::int32_t> Prev;
+
+        std::vector<TOKEN> Tokens;
+
+        std::vector<std::uint8_t> Pending;
+    };
+}
+
+inline const std::uint16_t QR::DEFLATE_STREAM::LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+inline const std::uint8_t QR::DEFLATE_STREAM::LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+inline const std::uint16_t QR::DEFLATE_STREAM::DISTANCE_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577 };
+inline const std::uint8_t QR::DEFLATE_STREAM::DISTANCE_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+inline const std::uint16_t QR::DEFLATE_STREAM::LEVEL_CHAIN[10] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+inline const std::uint16_t QR::DEFLATE_STREAM::LEVEL_INSERT[10] = { 0, 4, 8, 16, 16, 32, 32, 64, 128, 258 };
+
+inline const std::array<QR::DEFLATE_STREAM::CODE, 288>& QR::DEFLATE_STREAM::FIXED_CODES()
+{
+    static const std::array<CODE, 288> codes = []()
+        {
+            std::array<CODE, 288> result{};
+            for (int symbol = 0; symbol < 288; symbol++)
+            {
+                // RFC 1951, section 3.2.6
+                int code, length;
+                if (symbol < 144)      { code = 0x30 + symbol;          length = 8; }
+                else if (symbol < 256) { code = 0x190 + symbol - 144;   length = 9; }
+                else if (symbol < 280) { code = symbol - 256;           length = 7; }
+                else                   { code = 0xC0 + symbol - 280;    length = 8; }
+
+                // Huffman codes are sent most significant bit first
+                int reversed = 0;
+                for (int i = 0; i < length; i++)
+                    reversed |= ((code >> i) & 1) << (length - 1 - i);
+                result[symbol] = CODE{ static_cast<std::uint16_t>(reversed), static_cast<std::uint8_t>(length) };
+            }
+            return result;
+        }();
+    return codes;
+}
+
+inline QR::DEFLATE_STREAM::DEFLATE_STREAM(SINK& sink, bool zlib, int level)
+    : Out(sink), Zlib(zlib), Finished(false), Adler(1), Bits(0), BitCount(0),
+    Window(2 * WINDOW), Start(0), End(0), Head(std::size_t(1) << HASH_BITS, -1), Prev(WINDOW, -1)
+{
+    if (level < 1 || level > 9)
+        throw std::domain_error("value out of range");
+    MaxChain = LEVEL_CHAIN[level];
+    MaxInsert = LEVEL_INSERT[level];
+
+    Tokens.reserve(BLOCK_TOKENS);
+    Pending.reserve(OUTPUT_BYTES + 64);
+    if (Zlib)
+    {
+        // CM = 8 (deflate), CINFO = 7 (32 KB window), FLEVEL = 0 or 1; both are multiples of 31
+        Pending.push_back(0x78);
+        Pending.push_back(level < 6 ? 0x01 : 0x5E);
+    }
+}
+
+inline std::uint32_t QR::DEFLATE_STREAM::HASH(const std::uint8_t* p)
+{
+    std::uint32_t v = static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 | static_cast<std::uint32_t>(p[2]) << 16;
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline void QR::DEFLATE_STREAM::PUT_BITS(std::uint32_t value, int count)
+{
+    Bits |= static_cast<std::uint64_t>(value) << BitCount;
+    BitCount += count;
+    while (BitCount >= 8)
+    {
+        Pending.push_back(static_cast<std::uint8_t>(Bits));
+        Bits >>= 8;
+        BitCount -= 8;
+    }
+}
+
+inline void QR::DEFLATE_STREAM::ALIGN()
+{
+    if (BitCount > 0)
+        PUT_BITS(0, 8 - BitCount);
+}
+
+inline int QR::DEFLATE_STREAM::LENGTH_CODE(size_t length)
+{
+    return static_cast<int>(std::upper_bound(LENGTH_BASE, LENGTH_BASE + 29, length) - LENGTH_BASE) - 1;
+}
+
+inline int QR::DEFLATE_STREAM::DISTANCE_CODE(size_t distance)
+{
+    return static_cast<int>(std::upper_bound(DISTANCE_BASE, DISTANCE_BASE + 30, distance) - DISTANCE_BASE) - 1;
+}
+
+inline void QR::DEFLATE_STREAM::BUILD_LENGTHS(const std::uint32_t* frequencies, int count, int limit, std::uint8_t* lengths)
+{
+    std::vector<std::uint32_t> weights(frequencies, frequencies + count);
+    int used = 0;
+    for (int i = 0; i < count; i++)
+        used += weights[i] != 0;
+    for (int i = 0; used < 2 && i < count; i++)
+    {
+        if (weights[i] == 0)
+        {
+            weights[i] = 1;
+            used++;
+        }
+    }
+
+    std::vector<int> parent(2 * static_cast<size_t>(count));
+    while (true)
+    {
+        // Plain Huffman construction; the nodes past `count` are the internal ones
+        using NODE = std::pair<std::uint64_t, int>;
+        std::vector<NODE> heap;
+        for (int i = 0; i < count; i++)
+            if (weights[i] != 0)
+                heap.push_back(NODE(weights[i], i));
+        std::make_heap(heap.begin(), heap.end(), std::greater<NODE>());
+
+        int next = count;
+        while (heap.size() > 1)
+        {
+            std::pop_heap(heap.begin(), heap.end(), std::greater<NODE>());
+            NODE a = heap.back();
+            heap.pop_back();
+            std::pop_heap(heap.begin(), heap.end(), std::greater<NODE>());
+            NODE b = heap.back();
+            heap.pop_back();
+
+            parent[a.second] = next;
+            parent[b.second] = next;
+            heap.push_back(NODE(a.first + b.first, next++));
+            std::push_heap(heap.begin(), heap.end(), std::greater<NODE>());
+        }
+        int root = next - 1;
+
+        int longest = 0;
+        for (int i = 0; i < count; i++)
+        {
+            int depth = 0;
+            if (weights[i] != 0)
+                for (int node = i; node != root; node = parent[node])
+                    depth++;
+            lengths[i] = static_cast<std::uint8_t>(depth);
+            longest = std::max(longest, depth);
+        }
+        if (longest <= limit)
+            return;
+
+        // Too deep: flatten the distribution and try again
+        for (std::uint32_t& weight : weights)
+            if (weight != 0)
+                weight = (weight >> 1) | 1;
+    }
+}
+
+inline void QR::DEFLATE_STREAM::BUILD_CODES(const std::uint8_t* lengths, int count, CODE* codes)
+{
+    int lengthCount[16] = {};
+    for (int i = 0; i < count; i++)
+        lengthCount[lengths[i]]++;
+    lengthCount[0] = 0;
+
+    int nextCode[16] = {};
+    int code = 0;
+    for (int bits = 1; bits < 16; bits++)
+    {
+        code = (code + lengthCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        int length = lengths[i];
+        int value = length ? nextCode[length]++ : 0;
+        int reversed = 0;
+        for (int b = 0; b < length; b++)
+            reversed |= ((value >> b) & 1) << (length - 1 - b);
+        codes[i] = CODE{ static_cast<std::uint16_t>(reversed), static_cast<std::uint8_t>(length) };
+    }
+}
+
+inline void QR::DEFLATE_STREAM::LITERAL(std::uint8_t value)
+{
+    Tokens.push_back(TOKEN{ value, 0 });
+    if (Tokens.size() == BLOCK_TOKENS)
+        EMIT_BLOCK(false);
+}
+
+inline void QR::DEFLATE_STREAM::MATCH(size_t length, size_t distance)
+{
+    Tokens.push_back(TOKEN{ static_cast<std::uint16_t>(length), static_cast<std::uint16_t>(distance) });
+    if (Tokens.size() == BLOCK_TOKENS)
+        EMIT_BLOCK(false);
+}
+
+inline void QR::DEFLATE_STREAM::EMIT_BLOCK(bool last)
+{
+    std::uint32_t literalFrequency[286] = {};
+    std::uint32_t distanceFrequency[30] = {};
+    for (const TOKEN& token : Tokens)
+    {
+        if (token.distance == 0)
+            literalFrequency[token.value]++;
+        else
+        {
+            literalFrequency[257 + LENGTH_CODE(token.value)]++;
+            distanceFrequency[DISTANCE_CODE(token.distance)]++;
+        }
+    }
+    literalFrequency[256] = 1;
+
+    std::uint8_t literalLengths[286];
+    std::uint8_t distanceLengths[30];
+    BUILD_LENGTHS(literalFrequency, 286, 15, literalLengths);
+    BUILD_LENGTHS(distanceFrequency, 30, 15, distanceLengths);
+
+    int literalCount = 286;
+    while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+        literalCount--;
+    int distanceCount = 30;
+    while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+        distanceCount--;
+
+    // Run-length code the two length tables together (RFC 1951, section 3.2.7)
+    std::uint8_t all[286 + 30];
+    std::memcpy(all, literalLengths, static_cast<size_t>(literalCount));
+    std::memcpy(all + literalCount, distanceLengths, static_cast<size_t>(distanceCount));
+    const int total = literalCount + distanceCount;
+
+    std::vector<std::pair<std::uint8_t, std::uint8_t>> runs;    // Code length symbol, extra bits
+    std::uint32_t runFrequency[19] = {};
+    for (int i = 0; i < total; )
+    {
+        int run = 1;
+        while (i + run < total && all[i + run] == all[i])
+            run++;
+
+        if (all[i] == 0 && run >= 3)
+        {
+            int count = std::min(run, 138);
+            if (count >= 11)
+                runs.emplace_back(18, static_cast<std::uint8_t>(count - 11));
+            else
+                runs.emplace_back(17, static_cast<std::uint8_t>(count - 3));
+            i += count;
+        }
+        else if (all[i] != 0 && run >= 4)
+        {
+            runs.emplace_back(all[i], 0);
+            int count = std::min(run - 1, 6);
+            runs.emplace_back(16, static_cast<std::uint8_t>(count - 3));
+            i += 1 + count;
+        }
+        else
+        {
+            runs.emplace_back(all[i], 0);
+            i++;
+        }
+    }
+    for (const auto& item : runs)
+        runFrequency[item.first]++;
+
+    std::uint8_t runLengths[19];
+    BUILD_LENGTHS(runFrequency, 19, 7, runLengths);
+    static const int order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    int orderCount = 19;
+    while (orderCount > 4 && runLengths[order[orderCount - 1]] == 0)
+        orderCount--;
+
+    // Compare the two encodings; extra bits cost the same in both and are left out
+    const std::array<CODE, 288>& fixed = FIXED_CODES();
+    std::uint64_t dynamicBits = 14 + 3 * static_cast<std::uint64_t>(orderCount);
+    for (const auto& item : runs)
+        dynamicBits += runLengths[item.first] + (item.first == 16 ? 2 : item.first == 17 ? 3 : item.first == 18 ? 7 : 0);
+    std::uint64_t fixedBits = 0;
+    for (int i = 0; i < 286; i++)
+    {
+        dynamicBits += static_cast<std::uint64_t>(literalFrequency[i]) * literalLengths[i];
+        fixedBits += static_cast<std::uint64_t>(literalFrequency[i]) * fixed[i].length;
+    }
+    for (int i = 0; i < 30; i++)
+    {
+        dynamicBits += static_cast<std::uint64_t>(distanceFrequency[i]) * distanceLengths[i];
+        fixedBits += static_cast<std::uint64_t>(distanceFrequency[i]) * 5;
+    }
+
+    CODE literalCodes[286];
+    CODE distanceCodes[30];
+    if (dynamicBits < fixedBits)
+    {
+        PUT_BITS(last ? 5 : 4, 3);    // BFINAL, BTYPE = 10 (dynamic Huffman codes)
+        PUT_BITS(static_cast<std::uint32_t>(literalCount - 257), 5);
+        PUT_BITS(static_cast<std::uint32_t>(distanceCount - 1), 5);
+        PUT_BITS(static_cast<std::uint32_t>(orderCount - 4), 4);
+        for (int i = 0; i < orderCount; i++)
+            PUT_BITS(runLengths[order[i]], 3);
+
+        CODE runCodes[19];
+        BUILD_CODES(runLengths, 19, runCodes);
+        for (const auto& item : runs)
+        {
+            PUT_BITS(runCodes[item.first].bits, runCodes[item.first].length);
+            if (item.first >= 16)
+                PUT_BITS(item.second, item.first == 16 ? 2 : item.first == 17 ? 3 : 7);
+        }
+        BUILD_CODES(literalLengths, 286, literalCodes);
+        BUILD_CODES(distanceLengths, 30, distanceCodes);
+    }
+    else
+    {
+        PUT_BITS(last ? 3 : 2, 3);    // BFINAL, BTYPE = 01 (fixed Huffman codes)
+        std::copy(fixed.begin(), fixed.begin() + 286, literalCodes);
+        for (int d = 0; d < 30; d++)
+        {
+            int reversed = 0;
+            for (int b = 0; b < 5; b++)
+                reversed |= ((d >> b) & 1) << (4 - b);
+            distanceCodes[d] = CODE{ static_cast<std::uint16_t>(reversed), 5 };
+        }
+    }
+
+    for (const TOKEN& token : Tokens)
+    {
+        if (token.distance == 0)
+        {
+            PUT_BITS(literalCodes[token.value].bits, literalCodes[token.value].length);
+            continue;
+        }
+        int l = LENGTH_CODE(token.value);
+        PUT_BITS(literalCodes[257 + l].bits, literalCodes[257 + l].length);
+        PUT_BITS(static_cast<std::uint32_t>(token.value - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+        int d = DISTANCE_CODE(token.distance);
+        PUT_BITS(distanceCodes[d].bits, distanceCodes[d].length);
+        PUT_BITS(static_cast<std::uint32_t>(token.distance - DISTANCE_BASE[d]), DISTANCE_EXTRA[d]);
+
+        if (Pending.size() >= OUTPUT_BYTES)
+            DRAIN();
+    }
+    PUT_BITS(literalCodes[256].bits, literalCodes[256].length);
+    Tokens.clear();
+}
+
+inline void QR::DEFLATE_STREAM::INSERT(size_t p)
+{
+    std::uint32_t h = HASH(&Window[p]);
+    Prev[p & (WINDOW - 1)] = Head[h];
+    Head[h] = static_cast<std::int32_t>(p);
+}
+
+inline void QR::DEFLATE_STREAM::PROCESS(bool all)
+{
+    size_t limit = all ? End : (End > MAX_MATCH ? End - MAX_MATCH : 0);
+    while (Start < limit)
+    {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+
+        if (Start + MIN_MATCH <= End)
+        {
+            size_t maxLength = std::min(MAX_MATCH, End - Start);
+            std::int32_t candidate = Head[HASH(&Window[Start])];
+            for (int chain = MaxChain; candidate >= 0 && chain > 0; chain--)
+            {
+                size_t c = static_cast<size_t>(candidate);
+                if (Start - c > MAX_DISTANCE)
+                    break;
+                if (Window[c + bestLength] == Window[Start + bestLength])
+                {
+                    size_t length = 0;
+                    while (length < maxLength && Window[c + length] == Window[Start + length])
+                        length++;
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = Start - c;
+                        if (length == maxLength)
+                            break;
+                    }
+                }
+                std::int32_t next = Prev[c & (WINDOW - 1)];
+                if (next >= candidate)
+                    break;
+                candidate = next;
+            }
+        }
+
+        if (bestLength >= MIN_MATCH)
+        {
+            MATCH(bestLength, bestDistance);
+
+            // Like zlib's fast levels, only short matches are fully indexed; inside long runs
+            // (blank rows, Up filtered copies) the last position is enough to keep matching
+            if (bestLength <= MaxInsert)
+            {
+                for (size_t i = 0; i < bestLength; i++, Start++)
+                    if (Start + MIN_MATCH <= End)
+                        INSERT(Start);
+            }
+            else
+            {
+                Start += bestLength;
+                if (Start + MIN_MATCH <= End)
+                    INSERT(Start - 1);
+            }
+        }
+        else
+        {
+            LITERAL(Window[Start]);
+            if (Start + MIN_MATCH <= End)
+                INSERT(Start);
+            Start++;
+        }
+
+        if (Pending.size() >= OUTPUT_BYTES)
+            DRAIN();
+    }
+}
+
+inline void QR::DEFLATE_STREAM::SLIDE()
+{
+    std::memmove(Window.data(), Window.data() + WINDOW, WINDOW);
+    Start -= WINDOW;
+    End -= WINDOW;
+    for (std::int32_t& p : Head)
+        p = p >= static_cast<std::int32_t>(WINDOW) ? p - static_cast<std::int32_t>(WINDOW) : -1;
+    for (std::int32_t& p : Prev)
+        p = p >= static_cast<std::int32_t>(WINDOW) ? p - static_cast<std::int32_t>(WINDOW) : -1;
+}
+
+inline void QR::DEFLATE_STREAM::DRAIN()
+{
+    if (!Pending.empty())
+    {
+        Out.WRITE(Pending.data(), Pending.size());
+        Pending.clear();
+    }
+}
+
+inline void QR::DEFLATE_STREAM::WRITE(const void* data, size_t length)
+{
+    if (Finished)
+        throw std::logic_error("Stream finished");
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    Adler = CHECKSUM::ADLER32(Adler, bytes, length);
+    while (length > 0)
+    {
+        if (End == Window.size())
+            SLIDE();
+        size_t count = std::min(length, Window.size() - End);
+        std::memcpy(&Window[End], bytes, count);
+        End += count;
+        bytes += count;
+        length -= count;
+        PROCESS(false);
+    }
+}
+
+inline void QR::DEFLATE_STREAM::FLUSH()
+{
+    PROCESS(true);
+    if (!Tokens.empty())
+        EMIT_BLOCK(false);
+    PUT_BITS(0, 3);    // BFINAL = 0, BTYPE = 00 (stored), empty
+    ALIGN();
+    const std::uint8_t empty[4] = { 0x00, 0x00, 0xFF, 0xFF };
+    Pending.insert(Pending.end(), empty, empty + 4);
+    DRAIN();
+    Out.FLUSH();
+}
+
+inline void QR::DEFLATE_STREAM::FINISH()
+{
+    if (Finished)
+        return;
+    PROCESS(true);
+    EMIT_BLOCK(true);
+    ALIGN();
+    if (Zlib)
+    {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            Pending.push_back(static_cast<std::uint8_t>(Adler >> shift));
+    }
+    Finished = true;
+    DRAIN();
+}
+
+#endif
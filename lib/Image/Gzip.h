@@ -0,0 +1,82 @@
+#ifndef GZIP_H
+#define GZIP_H
+
+#include "Sink.h"
+#include "Deflate.h"
+#include "Checksum.h"
+
+#include <cstdint>
+
+namespace QR
+{
+    /**
+    * @brief Sink that gzip-compresses (RFC 1952) everything written to it into another sink.
+    *
+    * Used for SVGZ and other text outputs. FINISH must be called once all the data is written.
+    */
+    class GZIP_SINK : public SINK
+    {
+    public:
+        /**
+        * @param sink The destination of the compressed bytes.
+        * @param level Compression effort, 1 (fastest) to 9 (smallest).
+        */
+        explicit GZIP_SINK(SINK& sink, int level = 6);
+
+        void WRITE(const void* data, size_t length) override;
+
+        /**
+        * @brief Sync flush of the compressed stream, then of the destination.
+        */
+        void FLUSH() override;
+
+        /**
+        * @brief Ends the deflate stream and writes the CRC-32 and size trailer.
+        */
+        void FINISH();
+
+    private:
+        SINK& Out;
+
+        DEFLATE_STREAM Deflate;
+
+        std::uint32_t Crc;
+
+        std::uint32_t Size;
+    };
+}
+
+inline QR::GZIP_SINK::GZIP_SINK(SINK& sink, int level)
+    : Out(sink), Deflate(sink, false, level), Crc(0), Size(0)
+{
+    // Magic, deflate, no flags, no time stamp, no extra flags, unknown OS
+    static const std::uint8_t header[10] = { 0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF };
+    Out.WRITE(header, sizeof(header));
+}
+
+inline void QR::GZIP_SINK::WRITE(const void* data, size_t length)
+{
+    Crc = CHECKSUM::CRC32(Crc, static_cast<const std::uint8_t*>(data), length);
+    Size += static_cast<std::uint32_t>(length);
+    Deflate.WRITE(data, length);
+}
+
+inline void QR::GZIP_SINK::FLUSH()
+{
+    // The deflate stream writes to Out and flushes it after the empty stored block
+    Deflate.FLUSH();
+}
+
+inline void QR::GZIP_SINK::FINISH()
+{
+    Deflate.FINISH();
+    std::uint8_t trailer[8];
+    for (int i = 0; i < 4; i++)
+    {
+        trailer[i] = static_cast<std::uint8_t>(Crc >> (8 * i));
+        trailer[4 + i] = static_cast<std::uint8_t>(Size >> (8 * i));
+    }
+    Out.WRITE(trailer, sizeof(trailer));
+}
+
+#endif
@@ -2,7 +2,21 @@
 #define IMAGE_HPP
 
 #include "../../lib/QRCode/QRCode.h"
+#include "../../lib/QRCode/QRCodeSet.h"
 #include "../pngLoader/lodepng/lodepng.cpp"
+#include "Raster.h"
+#include "PngStream.h"
+#include "Base64.h"
+#include "ObjectSink.h"
+#include "SvgStream.h"
+#include "BitmapStream.h"
+#include "PrinterStream.h"
+#include "PdfStream.h"
+#include "ContactSheet.h"
+#include "Blit.h"
+#include "Terminal.h"
+#include "TerminalDisplay.h"
+#include "TerminalGraphics.h"
 
 #include <cstdint>
 #include <fstream>
@@ -49,6 +63,29 @@ namespace QR
 		*/
 		void PRINT_QR(const QR::QRCODE& qr, int color);
 
+		/**
+		* @brief Prints the QR code and a one module border as two-character ANSI background cells.
+		* @param qr The QR code object to be printed.
+		* @param colored The 8-bit ANSI color of dark modules.
+		* @param uncolored The 8-bit ANSI color of light modules.
+		*/
+		void PRINT_CELLS(const QR::QRCODE& qr, int colored, int uncolored);
+
+		/**
+		* @brief Prints the QR code to standard output with a single write.
+		* @param qr The QR code object to be printed.
+		* @param options Half blocks or two-character cells, colors or plain text, and the border.
+		*/
+		void PRINT_TERMINAL(const QR::QRCODE& qr, const QR::TERMINAL_OPTIONS& options = QR::TERMINAL_OPTIONS());
+
+		/**
+		* @brief Prints the QR code to standard output as a Sixel or kitty bitmap, or as half blocks.
+		* @param qr The QR code object to be printed.
+		* @param scale The pixels per module side of the bitmap.
+		* @param protocol The graphics protocol of the terminal; TEXT prints with PRINT_TERMINAL.
+		*/
+		void PRINT_GRAPHICS(const QR::QRCODE& qr, int scale = 4, QR::TERMINAL_PROTOCOL protocol = QR::TERMINAL_GRAPHICS::DETECT());
+
 		/**
 		* @brief Generates an SVG string representation of the QR code with black and white colors.
 		*
@@ -58,6 +95,15 @@ namespace QR
 		*/
 		std::string SVG_STRING(const QR::QRCODE& qr);
 
+		/**
+		* @brief Streams an SVG (or, with `options.gzip`, SVGZ) of the QR code to a sink.
+		*
+		* @param qr The QR code object to generate the SVG from.
+		* @param sink The destination of the SVG bytes.
+		* @param options The border, colors and compression.
+		*/
+		void SVG_WRITE(const QR::QRCODE& qr, QR::SINK& sink, const QR::SVG_OPTIONS& options = QR::SVG_OPTIONS());
+
 		/**
 		* @brief Generates a PNG file representation of the QR code.
 		*
@@ -79,6 +125,147 @@ namespace QR
 		*/
 		void PNG_FILE(const QR::QRCODE& qr, int scale, const char* filename, int r, int g, int b);
 
+		/**
+		* @brief Streams a PNG of the QR code to a sink, one scanline at a time.
+		*
+		* @param qr The QR code object to generate the PNG from.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param sink The destination of the PNG bytes (file descriptor, stream, callback...).
+		* @param r The red component of the QR code color (0-255).
+		* @param g The green component of the QR code color (0-255).
+		* @param b The blue component of the QR code color (0-255).
+		* @param options The compression backend and level; the image is a 1-bit, 2-color palette PNG.
+		*/
+		void PNG_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r = 0, int g = 0, int b = 0,
+			const QR::PNG_STREAM::OPTIONS& options = QR::PNG_STREAM::OPTIONS());
+
+		/**
+		* @brief Appends a `data:image/png;base64,` URI of the QR code to a caller's string.
+		*
+		* The PNG is base64-encoded as it is produced, so no file or intermediate buffer is used.
+		*
+		* @param qr The QR code object to generate the PNG from.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param out The string the URI is appended to; reuse it to keep its capacity.
+		* @param options The compression backend and level.
+		*/
+		void PNG_DATA_URI(const QR::QRCODE& qr, int scale, std::string& out,
+			const QR::PNG_STREAM::OPTIONS& options = QR::PNG_STREAM::OPTIONS());
+
+		/**
+		* @brief Appends a `data:image/svg+xml;base64,` URI of the QR code to a caller's string.
+		*
+		* @param qr The QR code object to generate the SVG from.
+		* @param out The string the URI is appended to; reuse it to keep its capacity.
+		* @param options The quiet zone and colors; `gzip` is ignored, browsers do not inflate data URIs.
+		*/
+		void SVG_DATA_URI(const QR::QRCODE& qr, std::string& out, const QR::SVG_OPTIONS& options = QR::SVG_OPTIONS());
+
+		/**
+		* @brief Streams a binary PBM (P4) of the QR code to a sink, with a one module border.
+		*
+		* @param qr The QR code object to write.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param sink The destination of the image bytes.
+		*/
+		void PBM_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink);
+
+		/**
+		* @brief Streams an 8-bit PGM (P5) of the QR code to a sink, in the gray levels of the colors.
+		*
+		* @param qr The QR code object to write.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param sink The destination of the image bytes.
+		* @param r The red component of the QR code color (0-255).
+		* @param g The green component of the QR code color (0-255).
+		* @param b The blue component of the QR code color (0-255).
+		*/
+		void PGM_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r = 0, int g = 0, int b = 0);
+
+		/**
+		* @brief Streams a 1-bit palette BMP of the QR code to a sink.
+		*
+		* @param qr The QR code object to write.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param sink The destination of the image bytes.
+		* @param r The red component of the QR code color (0-255).
+		* @param g The green component of the QR code color (0-255).
+		* @param b The blue component of the QR code color (0-255).
+		*/
+		void BMP_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r = 0, int g = 0, int b = 0);
+
+		/**
+		* @brief Streams a bilevel TIFF of the QR code to a sink.
+		*
+		* @param qr The QR code object to write.
+		* @param scale The scale factor for each module (pixel) in the QR code.
+		* @param sink The destination of the image bytes.
+		* @param compression No compression, or PackBits (smaller, still cheap to decode).
+		*/
+		void TIFF_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink,
+			QR::BITMAP_STREAM::TIFF_COMPRESSION compression = QR::BITMAP_STREAM::TIFF_COMPRESSION::PACKBITS);
+
+		/**
+		* @brief Streams a ZPL label holding the QR code as a compressed ^GF graphic field.
+		*
+		* @param qr The QR code object to print.
+		* @param scale The number of printer dots per module side.
+		* @param sink The printer connection, spool file or pipe.
+		*/
+		void ZPL_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink);
+
+		/**
+		* @brief Streams ESC/POS "GS v 0" raster commands printing the QR code.
+		*
+		* @param qr The QR code object to print.
+		* @param scale The number of printer dots per module side.
+		* @param sink The printer connection, spool file or pipe.
+		*/
+		void ESCPOS_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink);
+
+		/**
+		* @brief Streams a PDF of label sheets holding the QR codes, in order, on a grid.
+		*
+		* For very large jobs, feed a PDF_STREAM one symbol at a time instead of building the vector.
+		*
+		* @param codes The QR codes to place.
+		* @param sink The destination of the PDF bytes.
+		* @param options The page size, grid, margins, quiet zone and compression.
+		*/
+		void PDF_WRITE(const std::vector<QR::QRCODE>& codes, QR::SINK& sink, const QR::PDF_OPTIONS& options = QR::PDF_OPTIONS());
+
+		/**
+		* @brief Streams one 1-bit PNG showing the QR codes in a grid, rendered and compressed in parallel.
+		*
+		* @param codes The QR codes to place, left to right and top to bottom.
+		* @param sink The destination of the PNG bytes.
+		* @param options The columns, scale, quiet zone, colors, threads and compression level.
+		*/
+		void SHEET_WRITE(const std::vector<QR::QRCODE>& codes, QR::SINK& sink, const QR::SHEET_OPTIONS& options = QR::SHEET_OPTIONS());
+
+		/**
+		* @brief Prints every symbol of a Structured Append set, in sequence order.
+		* @param set The set of QR codes to be printed.
+		*/
+		void PRINT_QR(const QR::QRCODESET& set);
+
+		/**
+		* @brief Generates an SVG string showing the symbols of a Structured Append set side by side.
+		*
+		* @param set The set of QR codes to generate the SVG from.
+		* @return A string containing the SVG representation of the whole set.
+		*/
+		std::string SVG_STRING(const QR::QRCODESET& set);
+
+		/**
+		* @brief Generates a PNG file showing the symbols of a Structured Append set side by side.
+		*
+		* @param set The set of QR codes to generate the PNG from.
+		* @param scale The scale factor for each module (pixel).
+		* @param filename The path to the file where the PNG will be saved.
+		*/
+		void PNG_FILE(const QR::QRCODESET& set, int scale, const char* filename);
+
 	};
 
 }
@@ -95,67 +282,69 @@ void QR::IMAGE::PRINT_QR(QR::QRCODE& qr)
 
 inline void QR::IMAGE::PRINT_QR(QR::QRCODE& qr, int r, int g, int b)
 {
-	int colored = BLEND_ANSI_COLOR(r, g, b);
-	int uncolored = BLEND_ANSI_COLOR(255 - r, 255 - g, 255 - b);
-
-	for (int y = -1; y < qr.SIZE_GETTER() + 1; y++) {
-		for (int x = -1; x < qr.SIZE_GETTER() + 1; x++) {
-			if (qr.GET_MODULE(x, y))
-			{
-				 std::cout << "\033[48;5;" << colored << "m  \033[0m";
-			}
-			else
-			{
-				std::cout << "\033[48;5;" << uncolored << "m  \033[0m";
-			}
-		}
-		std::cout << std::endl;
-	}
-	std::cout << std::endl;
+	QR::TERMINAL_OPTIONS options;
+	options.dark = BLEND_ANSI_COLOR(r, g, b);
+	options.light = BLEND_ANSI_COLOR(255 - r, 255 - g, 255 - b);
+
+	PRINT_TERMINAL(qr, options);
 }
 
 inline void QR::IMAGE::PRINT_QR(const QR::QRCODE& qr, int color)
 {
-	for (int y = -1; y < qr.SIZE_GETTER() + 1; y++) {
-		for (int x = -1; x < qr.SIZE_GETTER() + 1; x++) {
-			int colored = color;
-			int uncolored = 255 - color;
-			if (qr.GET_MODULE(x, y))
-			{
-				std::cout << "\033[48;5;" << colored << "m  \033[0m";
-			}
-			else
-			{
-				std::cout << "\033[48;5;" << uncolored << "m  \033[0m";
-			}
-		}
-		std::cout << std::endl;
+	QR::TERMINAL_OPTIONS options;
+	options.dark = color;
+	options.light = 255 - color;
+
+	PRINT_TERMINAL(qr, options);
+}
+
+inline void QR::IMAGE::PRINT_CELLS(const QR::QRCODE& qr, int colored, int uncolored)
+{
+	QR::TERMINAL_OPTIONS options;
+	options.unicode = false;
+	options.dark = colored;
+	options.light = uncolored;
+
+	PRINT_TERMINAL(qr, options);
+}
+
+inline void QR::IMAGE::PRINT_TERMINAL(const QR::QRCODE& qr, const QR::TERMINAL_OPTIONS& options)
+{
+	std::string out;
+	QR::TERMINAL(options).RENDER(qr.VIEW_GETTER(), out);
+	out += '\n';
+
+	// Anything already buffered by std::cout goes first, then the frame in one write to stdout
+	std::cout.flush();
+	QR::FD_SINK sink(1);
+	sink.WRITE(out.data(), out.size());
+}
+
+inline void QR::IMAGE::PRINT_GRAPHICS(const QR::QRCODE& qr, int scale, QR::TERMINAL_PROTOCOL protocol)
+{
+	if (protocol == QR::TERMINAL_PROTOCOL::TEXT)
+	{
+		PRINT_TERMINAL(qr);
+		return;
 	}
-	std::cout << std::endl;
+
+	const QR::RASTER raster(QR::RASTER::FORMAT::MONO1, scale, 4);
+	std::cout.flush();
+	QR::FD_SINK sink(1);
+	if (protocol == QR::TERMINAL_PROTOCOL::SIXEL)
+		QR::TERMINAL_GRAPHICS::SIXEL(sink, qr.VIEW_GETTER(), raster);
+	else
+		QR::TERMINAL_GRAPHICS::KITTY(sink, qr.VIEW_GETTER(), raster);
 }
 
 std::string QR::IMAGE::SVG_STRING(const QR::QRCODE& qr)
 {
-	int border = 4;
-	std::stringstream sb;
-	sb << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
-	sb << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
-	sb << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 ";
-	sb << (qr.SIZE_GETTER() + border * 2) << " " << (qr.SIZE_GETTER() + border * 2) << "\" stroke=\"none\">\n";
-	sb << "\t<rect width=\"50%\" height=\"50%\" fill=\"#FFFFFF\"/>\n";
-	sb << "\t<path d=\"";
-	for (int y = 0; y < qr.SIZE_GETTER(); y++) {
-		for (int x = 0; x < qr.SIZE_GETTER(); x++) {
-			if (qr.GET_MODULE(x, y)) {
-				if (x != 0 || y != 0)
-					sb << " ";
-				sb << "M" << (x + border) << "," << (y + border) << "h1v1h-1z";
-			}
-		}
-	}
-	sb << "\" fill=\"#000000\"/>\n";
-	sb << "</svg>\n";
-	return sb.str();
+	return QR::SVG_STREAM::STRING(qr.RUNS_GETTER());
+}
+
+inline void QR::IMAGE::SVG_WRITE(const QR::QRCODE& qr, QR::SINK& sink, const QR::SVG_OPTIONS& options)
+{
+	QR::SVG_STREAM::WRITE(sink, qr.RUNS_GETTER(), options);
 }
 
 void QR::IMAGE::PNG_FILE(const QR::QRCODE& qr, int scale, const char* filename) 
@@ -164,48 +353,195 @@ void QR::IMAGE::PNG_FILE(const QR::QRCODE& qr, int scale, const char* filename)
 }
 
 void QR::IMAGE::PNG_FILE(const QR::QRCODE& qr, int scale, const char* filename, int r, int g, int b)
+{
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cerr << "Error opening PNG file: " << filename << std::endl;
+		return;
+	}
+
+	try {
+		QR::STREAM_SINK sink(file);
+		PNG_WRITE(qr, scale, sink, r, g, b);
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error encoding PNG: " << e.what() << std::endl;
+		return;
+	}
+	std::cout << "saved as: " << filename << std::endl;
+}
+
+inline void QR::IMAGE::PNG_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r, int g, int b,
+	const QR::PNG_STREAM::OPTIONS& options)
+{
+	// Two colors only, so one bit per pixel and a palette holding them
+	const QR::RASTER raster(QR::RASTER::FORMAT::MONO1, scale, 1,
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(r), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(b), 255 },
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(255 - r), static_cast<std::uint8_t>(255 - g), static_cast<std::uint8_t>(255 - b), 255 });
+	QR::PNG_STREAM::WRITE(sink, qr.VIEW_GETTER(), raster, options);
+}
+
+inline void QR::IMAGE::PNG_DATA_URI(const QR::QRCODE& qr, int scale, std::string& out, const QR::PNG_STREAM::OPTIONS& options)
+{
+	out += "data:image/png;base64,";
+	QR::BASE64_SINK sink(out);
+	PNG_WRITE(qr, scale, sink, 0, 0, 0, options);
+	sink.FINISH();
+}
+
+inline void QR::IMAGE::SVG_DATA_URI(const QR::QRCODE& qr, std::string& out, const QR::SVG_OPTIONS& options)
+{
+	QR::SVG_OPTIONS plain = options;
+	plain.gzip = false;
+
+	out += "data:image/svg+xml;base64,";
+	QR::BASE64_SINK sink(out);
+	QR::SVG_STREAM::WRITE(sink, qr.RUNS_GETTER(), plain);
+	sink.FINISH();
+}
+
+inline void QR::IMAGE::PBM_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink)
+{
+	QR::BITMAP_STREAM::PBM(sink, qr.VIEW_GETTER(), scale);
+}
+
+inline void QR::IMAGE::PGM_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r, int g, int b)
+{
+	QR::BITMAP_STREAM::PGM(sink, qr.VIEW_GETTER(), scale, 1,
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(r), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(b), 255 },
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(255 - r), static_cast<std::uint8_t>(255 - g), static_cast<std::uint8_t>(255 - b), 255 });
+}
+
+inline void QR::IMAGE::BMP_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink, int r, int g, int b)
+{
+	QR::BITMAP_STREAM::BMP(sink, qr.VIEW_GETTER(), scale, 1,
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(r), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(b), 255 },
+		QR::RASTER::COLOR{ static_cast<std::uint8_t>(255 - r), static_cast<std::uint8_t>(255 - g), static_cast<std::uint8_t>(255 - b), 255 });
+}
+
+inline void QR::IMAGE::TIFF_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink,
+	QR::BITMAP_STREAM::TIFF_COMPRESSION compression)
+{
+	QR::BITMAP_STREAM::TIFF(sink, qr.VIEW_GETTER(), scale, 1, compression);
+}
+
+inline void QR::IMAGE::ZPL_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink)
+{
+	QR::PRINTER_STREAM::ZPL(sink, qr.VIEW_GETTER(), scale);
+}
+
+inline void QR::IMAGE::ESCPOS_WRITE(const QR::QRCODE& qr, int scale, QR::SINK& sink)
+{
+	QR::PRINTER_STREAM::ESCPOS(sink, qr.VIEW_GETTER(), scale);
+}
+
+inline void QR::IMAGE::PDF_WRITE(const std::vector<QR::QRCODE>& codes, QR::SINK& sink, const QR::PDF_OPTIONS& options)
+{
+	QR::PDF_STREAM pdf(sink, options);
+	for (const QR::QRCODE& qr : codes)
+		pdf.ADD(qr.RUNS_GETTER());
+	pdf.FINISH();
+}
+
+inline void QR::IMAGE::SHEET_WRITE(const std::vector<QR::QRCODE>& codes, QR::SINK& sink, const QR::SHEET_OPTIONS& options)
+{
+	std::vector<QR::MATRIX_VIEW> views;
+	views.reserve(codes.size());
+	for (const QR::QRCODE& qr : codes)
+		views.push_back(qr.VIEW_GETTER());
+	QR::CONTACT_SHEET::WRITE(sink, views, options);
+}
+
+inline void QR::IMAGE::PRINT_QR(const QR::QRCODESET& set)
+{
+	QR::TERMINAL_OPTIONS options;
+	options.dark = 0;
+	options.light = 255;
+	const QR::TERMINAL terminal(options);
+
+	std::string out;
+	for (const QR::QRCODE& qr : set.SYMBOLS_GETTER())
+	{
+		terminal.RENDER(qr.VIEW_GETTER(), out);
+		out += '\n';
+	}
+
+	std::cout.flush();
+	QR::FD_SINK sink(1);
+	sink.WRITE(out.data(), out.size());
+}
+
+inline std::string QR::IMAGE::SVG_STRING(const QR::QRCODESET& set)
+{
+	// Symbols are placed left to right, sharing the quiet zone between neighbours
+	int border = 4;
+	int width = border;
+	int height = 0;
+	for (const QR::QRCODE& qr : set.SYMBOLS_GETTER())
+	{
+		width += qr.SIZE_GETTER() + border;
+		height = std::max(height, qr.SIZE_GETTER() + border * 2);
+	}
+
+	std::string result;
+	QR::STRING_SINK sink(result);
+	QR::SVG_STREAM svg(sink, width, height);
+	int left = border;
+	for (const QR::QRCODE& qr : set.SYMBOLS_GETTER())
+	{
+		svg.PATH(qr.RUNS_GETTER(), left, border);
+		left += qr.SIZE_GETTER() + border;
+	}
+	svg.FINISH();
+	return result;
+}
+
+inline void QR::IMAGE::PNG_FILE(const QR::QRCODESET& set, int scale, const char* filename)
 {
 	int border = 1;
-	int pixelSize = qr.SIZE_GETTER() + 2 * border;
-	int imageSize = pixelSize * scale;
-
-	std::vector<std::uint8_t> imageData(3 * imageSize * imageSize);
-
-	for (int row = -border; row < qr.SIZE_GETTER() + border; ++row) {
-		for (int col = -border; col < qr.SIZE_GETTER() + border; ++col) {
-			int startX = (border + col) * scale;
-			int startY = (border + row) * scale;
-			if (qr.GET_MODULE(row, col)) {
-				for (int y = startY; y < startY + scale; ++y) {
-					for (int x = startX; x < startX + scale; ++x) {
-						int index = 3 * (y * imageSize + x);
-						imageData[index + 0] = r;
-						imageData[index + 1] = g;
-						imageData[index + 2] = b;
-					}
-				}
-			}
-			else {
-				for (int y = startY; y < startY + scale; ++y) {
-					for (int x = startX; x < startX + scale; ++x) {
-						int index = 3 * (y * imageSize + x);
-						imageData[index + 0] = 255 - r;
-						imageData[index + 1] = 255 - g;
-						imageData[index + 2] = 255 - b;
-					}
-				}
-			}
-		}
+	int width = border;
+	int height = 0;
+	for (const QR::QRCODE& qr : set.SYMBOLS_GETTER())
+	{
+		width += qr.SIZE_GETTER() + border;
+		height = std::max(height, qr.SIZE_GETTER() + border * 2);
 	}
+	int imageWidth = width * scale;
+	int imageHeight = height * scale;
 
-	std::vector<unsigned char> png;
-	unsigned error = lodepng::encode(png, imageData, imageSize, imageSize, LCT_RGB, 8);
-	if (error) {
-		std::cerr << "Error encoding PNG: " << lodepng_error_text(error) << std::endl;
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cerr << "Error opening PNG file: " << filename << std::endl;
 		return;
 	}
 
-	lodepng::save_file(png, filename);
+	// Each scanline is assembled from the matching module row of every symbol, each rendered
+	// with its border in place; neighbouring symbols overlap on their shared light border
+	// Black on white, so 8-bit grayscale; MONO1 would need bit shifting at each symbol edge
+	const QR::RASTER raster(QR::RASTER::FORMAT::GRAY8, scale, border);
+	const std::vector<QR::QRCODE>& symbols = set.SYMBOLS_GETTER();
+	try {
+		QR::STREAM_SINK sink(file);
+		QR::PNG_STREAM::WRITE(sink, imageWidth, imageHeight, raster,
+			[&raster, &symbols, scale, border](int y, std::uint8_t* line) {
+				if (y % scale != 0)
+					return false;
+				int row = y / scale;
+				int left = border;
+				for (const QR::QRCODE& qr : symbols) {
+					std::uint8_t* out = line + raster.ROW_BYTES((left - border) * scale);
+					// Below a shorter symbol, repeat its top border row, which is all light
+					int symbolRow = row < qr.SIZE_GETTER() + 2 * border ? row : 0;
+					raster.RENDER_LINE(qr.VIEW_GETTER(), symbolRow, out);
+					left += qr.SIZE_GETTER() + border;
+				}
+				return true;
+			});
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error encoding PNG: " << e.what() << std::endl;
+		return;
+	}
 	std::cout << "saved as: " << filename << std::endl;
 }
 
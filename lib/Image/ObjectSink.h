@@ -0,0 +1,866 @@
+#ifndef OBJECTSINK_H
+#define OBJECTSINK_H
+
+#include "Sink.h"
+
+#include <mutex>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+// io_uring through the raw system calls, so nothing extra is linked; checked at run time
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define QR_OBJECT_URING 1
+#else
+#define QR_OBJECT_URING 0
+#endif
+
+namespace QR
+{
+    /**
+    * @brief Destination of many named outputs (files of a batch, members of an archive).
+    *
+    * Writers render each object into a string of their own and move it in, so a sink takes
+    * ownership of the buffer instead of copying it. Implementations throw std::runtime_error
+    * when a write fails and are safe to call from several threads.
+    */
+    class OBJECT_SINK
+    {
+    public:
+        virtual ~OBJECT_SINK() = default;
+
+        /**
+        * @brief Takes a finished object. `data` is moved from.
+        *
+        * @param name A relative path; '/' separates directories.
+        */
+        virtual void PUT(const std::string& name, std::string&& data) = 0;
+
+        /**
+        * @brief Gives an object already put a second name, without sending its data again.
+        *
+        * @throws std::invalid_argument if nothing was put under `target`.
+        */
+        virtual void LINK(const std::string& name, const std::string& target) = 0;
+
+        /**
+        * @brief Writes out any object still held back. Does nothing by default.
+        */
+        virtual void FLUSH() {}
+
+        /**
+        * @brief Runs any SINK writer (PNG_STREAM, SVG_STREAM, IMAGE::PNG_WRITE...) into a new
+        * buffer and puts the result.
+        */
+        void WRITE_OBJECT(const std::string& name, const std::function<void(SINK&)>& writer);
+    };
+
+    /**
+    * @brief Keeps every object in memory, in the order they were put.
+    */
+    class MEMORY_OBJECT_SINK : public OBJECT_SINK
+    {
+    public:
+        struct OBJECT
+        {
+            std::string name;
+            std::string data;
+        };
+
+        void PUT(const std::string& name, std::string&& data) override;
+
+        /**
+        * @brief Adds a copy of the target object under the new name.
+        */
+        void LINK(const std::string& name, const std::string& target) override;
+
+        /**
+        * @brief Moves out the objects put so far, leaving the sink empty.
+        */
+        std::vector<OBJECT> TAKE();
+
+        size_t COUNT_GETTER() const;
+
+    private:
+        mutable std::mutex Lock;
+
+        std::vector<OBJECT> Objects;
+
+        // Position of the last object put under each name
+        std::unordered_map<std::string, size_t> Index;
+    };
+
+    /**
+    * @brief Streams the objects as one POSIX ustar archive.
+    *
+    * Each member is its 512-byte header, the object and the zero padding to the next block,
+    * handed to the sink as one gathered WRITEV, so the object is never copied. Members are
+    * regular files, mode 0644, owned by uid and gid 0, with a fixed modification time so that
+    * equal inputs give equal archives.
+    */
+    class TAR_OBJECT_SINK : public OBJECT_SINK
+    {
+    public:
+        /**
+        * @param mtime Modification time of every member, in seconds since 1970.
+        */
+        explicit TAR_OBJECT_SINK(SINK& sink, std::uint64_t mtime = 0);
+
+        TAR_OBJECT_SINK(const TAR_OBJECT_SINK&) = delete;
+        TAR_OBJECT_SINK& operator=(const TAR_OBJECT_SINK&) = delete;
+
+        /**
+        * @throws std::invalid_argument if the name does not fit a ustar header, or the sink is finished.
+        */
+        void PUT(const std::string& name, std::string&& data) override;
+
+        /**
+        * @brief Writes a hard link member. The target is not checked: it must be an earlier member.
+        *
+        * @throws std::invalid_argument if a name does not fit a ustar header, or the sink is finished.
+        */
+        void LINK(const std::string& name, const std::string& target) override;
+
+        void FLUSH() override;
+
+        /**
+        * @brief Writes the two zero blocks that end the archive.
+        */
+        void FINISH();
+
+    private:
+        static constexpr size_t BLOCK = 512;
+
+        /**
+        * @brief Writes `value` as zero-padded octal digits followed by a NUL, in `width` bytes.
+        */
+        static void OCTAL(char* field, size_t width, std::uint64_t value);
+
+        /**
+        * @brief Fills a member header: '0' for a file of `size` bytes, '1' for a link to `target`.
+        */
+        void HEADER(char* header, const std::string& name, std::uint64_t size, char type, const std::string& target) const;
+
+        SINK& Out;
+
+        std::uint64_t Mtime;
+
+        std::mutex Lock;
+
+        bool Finished;
+    };
+
+    /**
+    * @brief Writes each object as a file under a directory, in batches.
+    *
+    * Objects are held until BATCH of them are waiting, then written together. On Linux the
+    * batch goes through io_uring: one submission opens every file, a second one writes each
+    * file and closes it (the close linked to the write), so a batch costs two system calls
+    * instead of three per file. Where io_uring is missing, not permitted or too old to open and
+    * close files (before Linux 5.6), the batch is split over worker threads doing open, write and
+    * close. Subdirectories must exist.
+    */
+    class DIRECTORY_OBJECT_SINK : public OBJECT_SINK
+    {
+    public:
+        /**
+        * @brief How the batches are written.
+        */
+        enum class BACKEND
+        {
+            IO_URING,
+            THREADS
+        };
+
+        /**
+        * @param directory An existing directory.
+        * @param batch Objects held before they are written, at least 1.
+        * @param threads Workers of the THREADS backend, 0 for one per hardware thread.
+        * @param backend IO_URING to use it when the system allows it, THREADS to never use it.
+        *
+        * @throws std::domain_error if the batch or the thread count is out of range.
+        * @throws std::runtime_error if the directory cannot be opened.
+        */
+        explicit DIRECTORY_OBJECT_SINK(const std::string& directory, size_t batch = 256, int threads = 0,
+            BACKEND backend = BACKEND::IO_URING);
+
+        /**
+        * @brief Writes the objects still held; errors are lost, call FLUSH first to see them.
+        */
+        ~DIRECTORY_OBJECT_SINK() override;
+
+        DIRECTORY_OBJECT_SINK(const DIRECTORY_OBJECT_SINK&) = delete;
+        DIRECTORY_OBJECT_SINK& operator=(const DIRECTORY_OBJECT_SINK&) = delete;
+
+        void PUT(const std::string& name, std::string&& data) override;
+
+        /**
+        * @brief Hard links the file of an object, or copies it where the file system cannot link.
+        */
+        void LINK(const std::string& name, const std::string& target) override;
+
+        void FLUSH() override;
+
+        BACKEND BACKEND_GETTER() const;
+
+    private:
+        struct OBJECT
+        {
+            std::string name;
+            std::string data;
+        };
+
+        /**
+        * @brief Writes the objects held back; the lock is taken by the caller.
+        */
+        void WRITE_PENDING();
+
+        /**
+        * @brief Writes a list of objects with the THREADS backend.
+        */
+        void WRITE_THREADS(std::vector<OBJECT>& objects) const;
+
+        /**
+        * @brief Writes one object with blocking calls.
+        */
+        void WRITE_FILE(const OBJECT& object) const;
+
+#if QR_OBJECT_URING
+        /**
+        * @brief A submission and a completion ring, mapped from the kernel.
+        */
+        class URING
+        {
+        public:
+            explicit URING(unsigned entries);
+
+            ~URING();
+
+            URING(const URING&) = delete;
+            URING& operator=(const URING&) = delete;
+
+            /**
+            * @brief Whether the ring is mapped and the kernel can open, write and close through it.
+            */
+            bool READY() const;
+
+            unsigned ENTRIES_GETTER() const;
+
+            /**
+            * @brief The next free submission entry, cleared; nullptr when the ring is full.
+            */
+            io_uring_sqe* SQE();
+
+            /**
+            * @brief Submits the queued entries and waits for `count` completions, storing each
+            * result at the index given by its user_data.
+            */
+            void SUBMIT(unsigned count, std::vector<int>& results);
+
+        private:
+            /**
+            * @brief Asks the kernel which operations it supports; false if it cannot say.
+            */
+            bool PROBE() const;
+
+            int Fd;
+
+            void* SqRing;
+            size_t SqSize;
+            void* CqRing;
+            size_t CqSize;
+            io_uring_sqe* Sqes;
+            size_t SqesSize;
+
+            unsigned* SqHead;
+            unsigned* SqTail;
+            unsigned* SqMask;
+            unsigned* SqArray;
+            unsigned* CqHead;
+            unsigned* CqTail;
+            unsigned* CqMask;
+            io_uring_cqe* Cqes;
+
+            unsigned Entries;
+            unsigned Queued;
+            bool Supported;
+        };
+
+        // Larger objects are written with blocking calls, a single write being limited to 2 GB
+        static constexpr size_t MAX_WRITE = size_t(1) << 30;
+
+        /**
+        * @brief Writes a list of objects through the ring.
+        *
+        * @return false if the kernel rejected the operations; the objects not written are left
+        * in the list.
+        */
+        bool WRITE_URING(std::vector<OBJECT>& objects);
+
+        std::unique_ptr<URING> Ring;
+#endif
+
+        std::string Directory;
+
+#ifndef _WIN32
+        int DirectoryFd;
+#endif
+
+        size_t Batch;
+
+        int Threads;
+
+        std::mutex Lock;
+
+        std::vector<OBJECT> Pending;
+    };
+}
+
+inline void QR::OBJECT_SINK::WRITE_OBJECT(const std::string& name, const std::function<void(SINK&)>& writer)
+{
+    std::string data;
+    STRING_SINK sink(data);
+    writer(sink);
+    PUT(name, std::move(data));
+}
+
+inline void QR::MEMORY_OBJECT_SINK::PUT(const std::string& name, std::string&& data)
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    Index[name] = Objects.size();
+    Objects.push_back(OBJECT{ name, std::move(data) });
+}
+
+inline void QR::MEMORY_OBJECT_SINK::LINK(const std::string& name, const std::string& target)
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    auto found = Index.find(target);
+    if (found == Index.end())
+        throw std::invalid_argument("Invalid value");
+    std::string copy = Objects[found->second].data;
+    Index[name] = Objects.size();
+    Objects.push_back(OBJECT{ name, std::move(copy) });
+}
+
+inline std::vector<QR::MEMORY_OBJECT_SINK::OBJECT> QR::MEMORY_OBJECT_SINK::TAKE()
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    std::vector<OBJECT> objects;
+    objects.swap(Objects);
+    Index.clear();
+    return objects;
+}
+
+inline size_t QR::MEMORY_OBJECT_SINK::COUNT_GETTER() const
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    return Objects.size();
+}
+
+inline QR::TAR_OBJECT_SINK::TAR_OBJECT_SINK(SINK& sink, std::uint64_t mtime)
+    : Out(sink), Mtime(mtime), Finished(false)
+{
+}
+
+inline void QR::TAR_OBJECT_SINK::OCTAL(char* field, size_t width, std::uint64_t value)
+{
+    field[width - 1] = '\0';
+    for (size_t i = width - 1; i-- > 0; value >>= 3)
+        field[i] = static_cast<char>('0' + (value & 7));
+}
+
+inline void QR::TAR_OBJECT_SINK::HEADER(char* header, const std::string& name, std::uint64_t size, char type,
+    const std::string& target) const
+{
+    // Names longer than 100 bytes are split at a '/' into the 155-byte prefix field
+    size_t split = 0;
+    if (name.size() > 100)
+    {
+        split = name.rfind('/', 155);
+        if (split == std::string::npos || name.size() - split - 1 > 100 || split == 0)
+            throw std::invalid_argument("Invalid value");
+    }
+    if (name.empty() || size > 077777777777ULL || target.size() > 100)
+        throw std::invalid_argument("Invalid value");
+
+    std::memset(header, 0, BLOCK);
+    if (split == 0)
+        std::memcpy(header, name.data(), name.size());
+    else
+    {
+        std::memcpy(header, name.data() + split + 1, name.size() - split - 1);
+        std::memcpy(header + 345, name.data(), split);
+    }
+    OCTAL(header + 100, 8, 0644);           // mode
+    OCTAL(header + 108, 8, 0);              // uid
+    OCTAL(header + 116, 8, 0);              // gid
+    OCTAL(header + 124, 12, size);          // size
+    OCTAL(header + 136, 12, Mtime);         // mtime
+    header[156] = type;
+    std::memcpy(header + 157, target.data(), target.size());
+    std::memcpy(header + 257, "ustar\0" "00", 8);
+
+    // The checksum is taken with its own field filled with spaces
+    std::memset(header + 148, ' ', 8);
+    unsigned sum = 0;
+    for (size_t i = 0; i < BLOCK; i++)
+        sum += static_cast<unsigned char>(header[i]);
+    OCTAL(header + 148, 7, sum);
+}
+
+inline void QR::TAR_OBJECT_SINK::PUT(const std::string& name, std::string&& data)
+{
+    char header[BLOCK];
+    HEADER(header, name, data.size(), '0', std::string());
+
+    static const char zeros[BLOCK] = {};
+    const SLICE slices[3] = {
+        { header, BLOCK },
+        { data.data(), data.size() },
+        { zeros, (BLOCK - data.size() % BLOCK) % BLOCK } };
+
+    std::lock_guard<std::mutex> guard(Lock);
+    if (Finished)
+        throw std::invalid_argument("Invalid value");
+    Out.WRITEV(slices, 3);
+}
+
+inline void QR::TAR_OBJECT_SINK::LINK(const std::string& name, const std::string& target)
+{
+    char header[BLOCK];
+    HEADER(header, name, 0, '1', target);
+
+    std::lock_guard<std::mutex> guard(Lock);
+    if (Finished)
+        throw std::invalid_argument("Invalid value");
+    Out.WRITE(header, BLOCK);
+}
+
+inline void QR::TAR_OBJECT_SINK::FLUSH()
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    Out.FLUSH();
+}
+
+inline void QR::TAR_OBJECT_SINK::FINISH()
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    if (Finished)
+        return;
+    static const char zeros[2 * BLOCK] = {};
+    Out.WRITE(zeros, sizeof(zeros));
+    Out.FLUSH();
+    Finished = true;
+}
+
+#if QR_OBJECT_URING
+inline QR::DIRECTORY_OBJECT_SINK::URING::URING(unsigned entries)
+    : Fd(-1), SqRing(MAP_FAILED), SqSize(0), CqRing(MAP_FAILED), CqSize(0), Sqes(nullptr), SqesSize(0),
+    Entries(0), Queued(0), Supported(false)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    Fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (Fd < 0)
+        return;
+
+    SqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    CqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single)
+        SqSize = CqSize = std::max(SqSize, CqSize);
+
+    SqRing = mmap(nullptr, SqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQ_RING);
+    CqRing = single ? SqRing : mmap(nullptr, CqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_CQ_RING);
+    SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, IORING_OFF_SQES);
+    if (SqRing == MAP_FAILED || CqRing == MAP_FAILED || sqes == MAP_FAILED)
+    {
+        if (sqes != MAP_FAILED)
+            munmap(sqes, SqesSize);
+        return;
+    }
+    Sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(SqRing);
+    char* cq = static_cast<char*>(CqRing);
+    SqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    Entries = params.sq_entries;
+    Supported = PROBE();
+}
+
+inline bool QR::DIRECTORY_OBJECT_SINK::URING::PROBE() const
+{
+    // The probe itself came with Linux 5.6, as did opening and closing files through the ring
+    const unsigned count = 256;
+    std::vector<std::uint8_t> buffer(sizeof(io_uring_probe) + count * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+    if (syscall(__NR_io_uring_register, Fd, IORING_REGISTER_PROBE, probe, count) < 0)
+        return false;
+
+    for (unsigned op : { unsigned(IORING_OP_OPENAT), unsigned(IORING_OP_WRITE), unsigned(IORING_OP_CLOSE) })
+    {
+        if (op >= probe->ops_len || (probe->ops[op].flags & IO_URING_OP_SUPPORTED) == 0)
+            return false;
+    }
+    return true;
+}
+
+inline QR::DIRECTORY_OBJECT_SINK::URING::~URING()
+{
+    if (Sqes != nullptr)
+        munmap(Sqes, SqesSize);
+    if (CqRing != MAP_FAILED && CqRing != SqRing)
+        munmap(CqRing, CqSize);
+    if (SqRing != MAP_FAILED)
+        munmap(SqRing, SqSize);
+    if (Fd >= 0)
+        close(Fd);
+}
+
+inline bool QR::DIRECTORY_OBJECT_SINK::URING::READY() const
+{
+    return Sqes != nullptr && Supported;
+}
+
+inline unsigned QR::DIRECTORY_OBJECT_SINK::URING::ENTRIES_GETTER() const
+{
+    return Entries;
+}
+
+inline io_uring_sqe* QR::DIRECTORY_OBJECT_SINK::URING::SQE()
+{
+    unsigned tail = *SqTail;
+    if (tail - __atomic_load_n(SqHead, __ATOMIC_ACQUIRE) >= Entries)
+        return nullptr;
+    unsigned index = tail & *SqMask;
+    io_uring_sqe* sqe = &Sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    SqArray[index] = index;
+    __atomic_store_n(SqTail, tail + 1, __ATOMIC_RELEASE);
+    Queued++;
+    return sqe;
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::URING::SUBMIT(unsigned count, std::vector<int>& results)
+{
+    unsigned submit = Queued;
+    Queued = 0;
+    unsigned done = 0;
+    while (done < count)
+    {
+        long entered = syscall(__NR_io_uring_enter, Fd, submit, count - done, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (entered < 0 && errno != EINTR)
+            throw std::runtime_error("Write failed");
+        if (entered > 0)
+            submit -= std::min(submit, static_cast<unsigned>(entered));
+
+        unsigned head = *CqHead;
+        for (unsigned tail = __atomic_load_n(CqTail, __ATOMIC_ACQUIRE); head != tail; head++, done++)
+        {
+            const io_uring_cqe& cqe = Cqes[head & *CqMask];
+            results[static_cast<size_t>(cqe.user_data)] = cqe.res;
+        }
+        __atomic_store_n(CqHead, head, __ATOMIC_RELEASE);
+    }
+}
+
+inline bool QR::DIRECTORY_OBJECT_SINK::WRITE_URING(std::vector<OBJECT>& objects)
+{
+    // Both phases use one entry per file and phase two two, so a round fits half the ring
+    const size_t round = Ring->ENTRIES_GETTER() / 2;
+    std::vector<int> fds(round), results(2 * round);
+    for (size_t first = 0; first < objects.size(); first += round)
+    {
+        const size_t count = std::min(round, objects.size() - first);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            io_uring_sqe* sqe = Ring->SQE();
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = DirectoryFd;
+            sqe->addr = reinterpret_cast<std::uint64_t>(objects[first + i].name.c_str());
+            sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            sqe->len = 0644;
+            sqe->user_data = i;
+        }
+        Ring->SUBMIT(static_cast<unsigned>(count), fds);
+
+        // An operation the kernel does not know fails every open of the round alike, before
+        // anything is written: close what did open and leave the round to the caller
+        bool rejected = false;
+        for (size_t i = 0; i < count; i++)
+            rejected = rejected || fds[i] == -EINVAL || fds[i] == -EOPNOTSUPP;
+        if (rejected)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (fds[i] >= 0)
+                    close(fds[i]);
+            }
+            objects.erase(objects.begin(), objects.begin() + static_cast<std::ptrdiff_t>(first));
+            return false;
+        }
+
+        bool failed = false;
+        unsigned queued = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            const std::string& data = objects[first + i].data;
+            if (fds[i] < 0)
+            {
+                failed = true;
+                continue;
+            }
+            if (data.size() > MAX_WRITE)
+                continue;
+
+            // A short write breaks the link and cancels the close; both are then done below
+            io_uring_sqe* sqe = Ring->SQE();
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fds[i];
+            sqe->addr = reinterpret_cast<std::uint64_t>(data.data());
+            sqe->len = static_cast<unsigned>(data.size());
+            sqe->off = 0;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = 2 * i;
+            sqe = Ring->SQE();
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = fds[i];
+            sqe->user_data = 2 * i + 1;
+            queued += 2;
+        }
+        Ring->SUBMIT(queued, results);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (fds[i] < 0)
+                continue;
+            const std::string& data = objects[first + i].data;
+            int written = data.size() > MAX_WRITE ? 0 : results[2 * i];
+            if (data.size() <= MAX_WRITE && results[2 * i + 1] != -ECANCELED)
+            {
+                if (written < 0 || static_cast<size_t>(written) != data.size() || results[2 * i + 1] != 0)
+                    failed = true;
+                continue;
+            }
+
+            FD_SINK rest(fds[i]);
+            try
+            {
+                if (written < 0)
+                    throw std::runtime_error("Write failed");
+                rest.WRITE(data.data() + written, data.size() - static_cast<size_t>(written));
+            }
+            catch (const std::runtime_error&)
+            {
+                failed = true;
+            }
+            close(fds[i]);
+        }
+        if (failed)
+            throw std::runtime_error("Write failed");
+    }
+    return true;
+}
+#endif
+
+inline QR::DIRECTORY_OBJECT_SINK::DIRECTORY_OBJECT_SINK(const std::string& directory, size_t batch, int threads,
+    BACKEND backend)
+    : Directory(directory), Batch(batch), Threads(threads)
+{
+    if (batch < 1 || threads < 0)
+        throw std::domain_error("value out of range");
+    if (Threads == 0)
+        Threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+#ifndef _WIN32
+    DirectoryFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (DirectoryFd < 0)
+        throw std::runtime_error("Cannot open directory");
+#endif
+#if QR_OBJECT_URING
+    if (backend == BACKEND::IO_URING)
+    {
+        Ring = std::make_unique<URING>(256);
+        if (!Ring->READY())
+            Ring.reset();
+    }
+#else
+    (void)backend;
+#endif
+}
+
+inline QR::DIRECTORY_OBJECT_SINK::~DIRECTORY_OBJECT_SINK()
+{
+    try
+    {
+        FLUSH();
+    }
+    catch (...)
+    {
+    }
+#ifndef _WIN32
+    close(DirectoryFd);
+#endif
+}
+
+inline QR::DIRECTORY_OBJECT_SINK::BACKEND QR::DIRECTORY_OBJECT_SINK::BACKEND_GETTER() const
+{
+#if QR_OBJECT_URING
+    if (Ring)
+        return BACKEND::IO_URING;
+#endif
+    return BACKEND::THREADS;
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::PUT(const std::string& name, std::string&& data)
+{
+    if (name.empty() || name[0] == '/')
+        throw std::invalid_argument("Invalid value");
+
+    std::lock_guard<std::mutex> guard(Lock);
+    Pending.push_back(OBJECT{ name, std::move(data) });
+    if (Pending.size() >= Batch)
+        WRITE_PENDING();
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::LINK(const std::string& name, const std::string& target)
+{
+    if (name.empty() || name[0] == '/')
+        throw std::invalid_argument("Invalid value");
+
+    // The target may still be waiting in the batch
+    std::lock_guard<std::mutex> guard(Lock);
+    WRITE_PENDING();
+
+    const std::filesystem::path directory(Directory);
+    const std::filesystem::path from = directory / target;
+    const std::filesystem::path to = directory / name;
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(from, error))
+        throw std::invalid_argument("Invalid value");
+    std::filesystem::remove(to, error);
+    std::filesystem::create_hard_link(from, to, error);
+    if (error && !std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, error))
+        throw std::runtime_error("Write failed");
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::FLUSH()
+{
+    std::lock_guard<std::mutex> guard(Lock);
+    WRITE_PENDING();
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::WRITE_PENDING()
+{
+    std::vector<OBJECT> objects;
+    objects.swap(Pending);
+#if QR_OBJECT_URING
+    if (Ring)
+    {
+        if (WRITE_URING(objects))
+            return;
+
+        // The probe passed but the kernel still refused; the threads take over from now on
+        Ring.reset();
+    }
+#endif
+    WRITE_THREADS(objects);
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::WRITE_FILE(const OBJECT& object) const
+{
+#ifdef _WIN32
+    std::ofstream file(Directory + "/" + object.name, std::ios::binary);
+    if (!file.write(object.data.data(), static_cast<std::streamsize>(object.data.size())) || !file.flush())
+        throw std::runtime_error("Write failed");
+#else
+    int fd = openat(DirectoryFd, object.name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Write failed");
+    FD_SINK sink(fd);
+    try
+    {
+        sink.WRITE(object.data.data(), object.data.size());
+    }
+    catch (...)
+    {
+        close(fd);
+        throw;
+    }
+    if (close(fd) != 0)
+        throw std::runtime_error("Write failed");
+#endif
+}
+
+inline void QR::DIRECTORY_OBJECT_SINK::WRITE_THREADS(std::vector<OBJECT>& objects) const
+{
+    const size_t workers = std::min(objects.size(), static_cast<size_t>(Threads));
+    if (workers <= 1)
+    {
+        for (const OBJECT& object : objects)
+            WRITE_FILE(object);
+        return;
+    }
+
+    // Interleaved shares, so files of similar size spread over the workers
+    auto work = [this, &objects, workers](size_t worker)
+        {
+            for (size_t i = worker; i < objects.size(); i += workers)
+                WRITE_FILE(objects[i]);
+        };
+    std::vector<std::future<void>> pending;
+    for (size_t worker = 1; worker < workers; worker++)
+        pending.push_back(std::async(std::launch::async, work, worker));
+    std::exception_ptr failure;
+    try
+    {
+        work(0);
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
+    for (std::future<void>& future : pending)
+    {
+        try
+        {
+            future.get();
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = std::current_exception();
+        }
+    }
+    if (failure)
+        std::rethrow_exception(failure);
+}
+
+#endif
@@ -0,0 +1,315 @@
+#ifndef PDFSTREAM_H
+#define PDFSTREAM_H
+
+#include "Sink.h"
+#include "Deflate.h"
+#include "../QRCode/RunGeometry.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <charconv>
+#include <stdexcept>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief PDF_STREAM page layout. Lengths are in points (1/72 inch).
+    */
+    struct PDF_OPTIONS
+    {
+        double pageWidth = 595.28;      // A4
+        double pageHeight = 841.89;
+        double margin = 36;             // Around the grid, on every side
+        double gutter = 12;             // Between cells
+        int columns = 4;
+        int rows = 6;
+        int border = 4;                 // Quiet zone, in modules
+        double captionSize = 8;         // Font size of the captions under the symbols, 0 for none
+        bool compress = true;           // Deflate the page contents
+        int level = 6;                  // Deflate effort, 1 (fastest) to 9 (smallest)
+    };
+
+    /**
+    * @brief Streams label sheets: symbols placed on a grid, page after page, as vector paths.
+    *
+    * Each symbol is one filled path of rectangles (RUN_GEOMETRY::RECTANGLES: horizontal runs,
+    * merged down identical rows) drawn in module units under a single transform, followed by
+    * an optional caption. The font and the resource dictionary are written once and shared by
+    * every page. A page is written out, optionally deflated, as soon as its grid is full, and
+    * only the page object offsets are kept, so the size of a job is not bound by memory.
+    */
+    class PDF_STREAM
+    {
+    public:
+        /**
+        * @brief Writes the file header and the shared objects.
+        *
+        * @throws std::domain_error if the grid does not fit on the page.
+        */
+        PDF_STREAM(SINK& sink, const PDF_OPTIONS& options = PDF_OPTIONS());
+
+        PDF_STREAM(const PDF_STREAM&) = delete;
+        PDF_STREAM& operator=(const PDF_STREAM&) = delete;
+
+        /**
+        * @brief Places a symbol in the next cell, starting a new page when the grid is full.
+        *
+        * @param runs The modules of the symbol.
+        * @param caption Text printed under the symbol (Latin-1), or empty.
+        */
+        void ADD(const RUN_GEOMETRY& runs, const std::string& caption = std::string());
+
+        /**
+        * @brief Writes the last page, the page tree and the cross-reference table.
+        */
+        void FINISH();
+
+        /**
+        * @brief Number of pages written or started so far.
+        */
+        int PAGES_GETTER() const;
+
+    private:
+        // Objects written by the constructor, ahead of the pages
+        static constexpr std::uint32_t CATALOG = 1;
+        static constexpr std::uint32_t PAGE_TREE = 2;
+        static constexpr std::uint32_t FONT = 3;
+        static constexpr std::uint32_t RESOURCES = 4;
+
+        void PUT(const std::string& text);
+
+        void PUT(const void* data, size_t length);
+
+        // Records the offset of the next object and writes its header
+        void BEGIN_OBJECT(std::uint32_t number);
+
+        // Writes the page in progress, if it holds any symbol
+        void END_PAGE();
+
+        // Appends a number with at most two decimals
+        static void NUMBER(std::string& out, double value);
+
+        SINK& Out;
+
+        PDF_OPTIONS Options;
+
+        // Byte offsets of objects 1 to n, for the cross-reference table
+        std::vector<std::uint64_t> Offsets;
+
+        std::vector<std::uint32_t> Pages;
+
+        std::uint64_t Written;
+
+        // Content stream of the page in progress, and the number of cells it has filled
+        std::string Content;
+
+        int Cells;
+
+        double CellWidth;
+
+        double CellHeight;
+
+        bool Finished;
+    };
+}
+
+inline QR::PDF_STREAM::PDF_STREAM(SINK& sink, const PDF_OPTIONS& options)
+    : Out(sink), Options(options), Written(0), Cells(0), Finished(false)
+{
+    if (options.columns < 1 || options.rows < 1 || options.border < 0 || options.captionSize < 0
+        || options.margin < 0 || options.gutter < 0)
+        throw std::domain_error("value out of range");
+    CellWidth = (options.pageWidth - 2 * options.margin - (options.columns - 1) * options.gutter) / options.columns;
+    CellHeight = (options.pageHeight - 2 * options.margin - (options.rows - 1) * options.gutter) / options.rows;
+    if (CellWidth <= 0 || CellHeight <= 1.5 * options.captionSize)
+        throw std::domain_error("value out of range");
+
+    // The binary comment marks the file as binary for transfer tools
+    PUT("%PDF-1.4\n%\xE2\xE3\xCF\xD3\n");
+    BEGIN_OBJECT(CATALOG);
+    PUT("<< /Type /Catalog /Pages 2 0 R >>\nendobj\n");
+    BEGIN_OBJECT(FONT);
+    PUT("<< /Type /Font /Subtype /Type1 /BaseFont /Helvetica /Encoding /WinAnsiEncoding >>\nendobj\n");
+    BEGIN_OBJECT(RESOURCES);
+    PUT("<< /Font << /F1 3 0 R >> >>\nendobj\n");
+}
+
+inline int QR::PDF_STREAM::PAGES_GETTER() const
+{
+    return static_cast<int>(Pages.size()) + (Cells > 0 ? 1 : 0);
+}
+
+inline void QR::PDF_STREAM::PUT(const void* data, size_t length)
+{
+    Out.WRITE(data, length);
+    Written += length;
+}
+
+inline void QR::PDF_STREAM::PUT(const std::string& text)
+{
+    PUT(text.data(), text.size());
+}
+
+inline void QR::PDF_STREAM::BEGIN_OBJECT(std::uint32_t number)
+{
+    if (Offsets.size() < number)
+        Offsets.resize(number, 0);
+    Offsets[number - 1] = Written;
+    PUT(std::to_string(number) + " 0 obj\n");
+}
+
+inline void QR::PDF_STREAM::NUMBER(std::string& out, double value)
+{
+    char text[32];
+    char* end = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, 2).ptr;
+
+    // "12.50" -> "12.5", "12.00" -> "12"
+    while (end[-1] == '0')
+        end--;
+    if (end[-1] == '.')
+        end--;
+    out.append(text, end);
+}
+
+inline void QR::PDF_STREAM::ADD(const RUN_GEOMETRY& runs, const std::string& caption)
+{
+    if (Finished)
+        throw std::invalid_argument("Invalid value");
+    if (Cells == Options.columns * Options.rows)
+        END_PAGE();
+
+    int column = Cells % Options.columns;
+    int row = Cells / Options.columns;
+    Cells++;
+
+    // The symbol is the largest square that fits the cell above the caption line
+    double captionHeight = Options.captionSize > 0 ? 1.5 * Options.captionSize : 0;
+    double side = std::min(CellWidth, CellHeight - captionHeight);
+    int modules = runs.SIZE_GETTER() + 2 * Options.border;
+    double module = side / modules;
+    double left = Options.margin + column * (CellWidth + Options.gutter) + (CellWidth - side) / 2;
+    double top = Options.pageHeight - Options.margin - row * (CellHeight + Options.gutter);
+
+    // Module units, y pointing down, origin at the first module (inside the quiet zone)
+    Content += "q ";
+    NUMBER(Content, module);
+    Content += " 0 0 ";
+    NUMBER(Content, -module);
+    Content += ' ';
+    NUMBER(Content, left + Options.border * module);
+    Content += ' ';
+    NUMBER(Content, top - Options.border * module);
+    Content += " cm\n";
+
+    char number[8];
+    for (const RUN_GEOMETRY::RECT& rect : runs.RECTANGLES())
+    {
+        for (std::uint16_t value : { rect.x, rect.y, rect.width, rect.height })
+        {
+            Content.append(number, std::to_chars(number, number + sizeof(number), value).ptr);
+            Content += ' ';
+        }
+        Content += "re\n";
+    }
+    Content += "f Q\n";
+
+    if (!caption.empty() && Options.captionSize > 0)
+    {
+        Content += "BT /F1 ";
+        NUMBER(Content, Options.captionSize);
+        Content += " Tf ";
+        NUMBER(Content, left + Options.border * module);
+        Content += ' ';
+        NUMBER(Content, top - side - Options.captionSize);
+        Content += " Td (";
+        for (char c : caption)
+        {
+            if (c == '(' || c == ')' || c == '\\')
+                Content += '\\';
+            Content += c;
+        }
+        Content += ") Tj ET\n";
+    }
+}
+
+inline void QR::PDF_STREAM::END_PAGE()
+{
+    if (Cells == 0)
+        return;
+
+    std::string stream;
+    if (Options.compress)
+    {
+        STRING_SINK sink(stream);
+        DEFLATE_STREAM deflate(sink, true, Options.level);
+        deflate.WRITE(Content.data(), Content.size());
+        deflate.FINISH();
+    }
+    const std::string& data = Options.compress ? stream : Content;
+
+    std::uint32_t contents = static_cast<std::uint32_t>(Offsets.size()) + 1;
+    BEGIN_OBJECT(contents);
+    PUT("<< /Length " + std::to_string(data.size()) + (Options.compress ? " /Filter /FlateDecode" : "") + " >>\nstream\n");
+    PUT(data);
+    PUT("\nendstream\nendobj\n");
+
+    std::string box;
+    NUMBER(box, Options.pageWidth);
+    box += ' ';
+    NUMBER(box, Options.pageHeight);
+    BEGIN_OBJECT(contents + 1);
+    PUT("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + box + "] /Resources 4 0 R /Contents "
+        + std::to_string(contents) + " 0 R >>\nendobj\n");
+    Pages.push_back(contents + 1);
+
+    Content.clear();
+    Cells = 0;
+}
+
+inline void QR::PDF_STREAM::FINISH()
+{
+    if (Finished)
+        return;
+    END_PAGE();
+
+    // The page tree is the only object that lists every page
+    BEGIN_OBJECT(PAGE_TREE);
+    PUT("<< /Type /Pages /Count " + std::to_string(Pages.size()) + " /Kids [");
+    std::string kids;
+    for (size_t i = 0; i < Pages.size(); i++)
+    {
+        kids += (i % 16 == 0 ? "\n" : " ") + std::to_string(Pages[i]) + " 0 R";
+        if (kids.size() > 4096)
+        {
+            PUT(kids);
+            kids.clear();
+        }
+    }
+    PUT(kids + " ] >>\nendobj\n");
+
+    std::uint64_t xref = Written;
+    std::string table = "xref\n0 " + std::to_string(Offsets.size() + 1) + "\n0000000000 65535 f \n";
+    char entry[24];
+    for (std::uint64_t offset : Offsets)
+    {
+        std::string digits = std::to_string(offset);
+        std::fill(entry, entry + 10, '0');
+        std::copy(digits.begin(), digits.end(), entry + 10 - digits.size());
+        std::copy_n(" 00000 n \n", 10, entry + 10);
+        table.append(entry, 20);
+        if (table.size() > 4096)
+        {
+            PUT(table);
+            table.clear();
+        }
+    }
+    table += "trailer\n<< /Size " + std::to_string(Offsets.size() + 1) + " /Root 1 0 R >>\nstartxref\n"
+        + std::to_string(xref) + "\n%%EOF\n";
+    PUT(table);
+    Out.FLUSH();
+    Finished = true;
+}
+
+#endif
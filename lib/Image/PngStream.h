@@ -0,0 +1,445 @@
+#ifndef PNGSTREAM_H
+#define PNGSTREAM_H
+
+#include "Sink.h"
+#include "Raster.h"
+#include "Deflate.h"
+#include "Checksum.h"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+// The zlib backend is opt-in, since it needs the application to link against zlib
+#if defined(QR_PNG_ZLIB) && __has_include(<zlib.h>)
+#include <zlib.h>
+#define QR_PNG_HAS_ZLIB 1
+#else
+#define QR_PNG_HAS_ZLIB 0
+#endif
+
+namespace QR
+{
+    /**
+    * @brief Compressors the IDAT data of PNG_STREAM can be produced with.
+    */
+    enum class PNG_BACKEND
+    {
+        QR_FAST,    // DEFLATE_STREAM: streaming, tuned for long runs and repeated rows
+        ZLIB,       // System zlib, streaming; needs QR_PNG_ZLIB defined and zlib linked
+        LODEPNG     // lodepng::compress; needs lodepng included first, buffers all the data
+    };
+
+    /**
+    * @brief PNG_STREAM encoding choices.
+    */
+    struct PNG_OPTIONS
+    {
+        PNG_BACKEND backend = PNG_BACKEND::QR_FAST;
+        int level = 6;          // Compression effort, 1 (fastest) to 9 (smallest)
+        bool palette = true;    // MONO1: 2-entry palette with the raster's colors, else 1-bit gray
+    };
+
+    /**
+    * @brief Streaming PNG encoder.
+    *
+    * Scanlines are generated one at a time, compressed incrementally and written as IDAT
+    * chunks of at most CHUNK_BYTES, so memory use is bounded by one pixel row plus the fixed
+    * compressor state, whatever the image size. A row equal to the one above it is sent with
+    * the Up filter, which turns the `scale - 1` repeated rows of each module into zeros.
+    *
+    * MONO1 rasters are written as 1-bit images, either with a two entry palette holding the
+    * raster's colors or as black on white grayscale; they are a 24th of the RGB size before
+    * compression.
+    */
+    class PNG_STREAM
+    {
+    public:
+        /**
+        * @brief Largest IDAT chunk payload written.
+        */
+        static constexpr size_t CHUNK_BYTES = 32768;
+
+        using BACKEND = PNG_BACKEND;
+
+        using OPTIONS = PNG_OPTIONS;
+
+        /**
+        * @brief Returns true if a backend was compiled in.
+        */
+        static bool AVAILABLE(BACKEND backend);
+
+        /**
+        * @brief Produces pixel row `y` into `line`, which still holds row `y - 1` on entry.
+        *
+        * Returns false when the row is identical to the previous one (and was left as is).
+        */
+        using LINE_SOURCE = std::function<bool(int y, std::uint8_t* line)>;
+
+        /**
+        * @brief Writes a PNG whose rows come from a callback.
+        *
+        * @param sink The destination of the file bytes.
+        * @param width The image width in pixels.
+        * @param height The image height in pixels.
+        * @param raster The pixel layout of the lines, and the palette colors for MONO1.
+        * @param source Called once per row, top to bottom.
+        * @param options The compressor and the 1-bit color mode.
+        *
+        * @throws std::invalid_argument if the dimensions are not supported or the backend is unavailable.
+        */
+        static void WRITE(SINK& sink, int width, int height, const RASTER& raster, const LINE_SOURCE& source,
+            const OPTIONS& options = OPTIONS());
+
+        /**
+        * @brief Writes a symbol as a PNG, rendering each module row once.
+        *
+        * @param sink The destination of the file bytes.
+        * @param view The packed modules to render.
+        * @param raster The scale, border, colors and pixel layout.
+        * @param options The compressor and the 1-bit color mode.
+        */
+        static void WRITE(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster, const OPTIONS& options = OPTIONS());
+
+        /**
+        * @brief Writes the signature, IHDR and, for palette images, PLTE and tRNS.
+        *
+        * For writers that produce their IDAT data themselves; returns the PNG color type.
+        *
+        * @throws std::invalid_argument if the dimensions are not supported.
+        */
+        static std::uint8_t HEADER(SINK& sink, int width, int height, const RASTER& raster, const OPTIONS& options = OPTIONS());
+
+        /**
+        * @brief Writes one chunk: length, type, data and CRC.
+        */
+        static void CHUNK(SINK& sink, const char* type, const std::uint8_t* data, size_t length);
+
+        /**
+        * @brief Collects compressed bytes and writes them out as IDAT chunks.
+        */
+        class IDAT_SINK : public SINK
+        {
+        public:
+            explicit IDAT_SINK(SINK& sink);
+
+            void WRITE(const void* data, size_t length) override;
+
+            /**
+            * @brief Writes the buffered bytes as a final, possibly short, chunk.
+            */
+            void FINISH();
+
+        private:
+            SINK& Out;
+
+            std::vector<std::uint8_t> Buffer;
+        };
+
+    private:
+        /**
+        * @brief Turns filtered scanlines into zlib data written to an IDAT_SINK.
+        */
+        class COMPRESSOR
+        {
+        public:
+            virtual ~COMPRESSOR() = default;
+
+            virtual void WRITE(const std::uint8_t* data, size_t length) = 0;
+
+            virtual void FINISH() = 0;
+        };
+
+        class FAST_COMPRESSOR;
+        class ZLIB_COMPRESSOR;
+        class LODEPNG_COMPRESSOR;
+
+        static std::unique_ptr<COMPRESSOR> MAKE_COMPRESSOR(const OPTIONS& options, SINK& idat);
+
+        static void PUT32(std::uint8_t* out, std::uint32_t value);
+    };
+}
+
+inline void QR::PNG_STREAM::PUT32(std::uint8_t* out, std::uint32_t value)
+{
+    out[0] = static_cast<std::uint8_t>(value >> 24);
+    out[1] = static_cast<std::uint8_t>(value >> 16);
+    out[2] = static_cast<std::uint8_t>(value >> 8);
+    out[3] = static_cast<std::uint8_t>(value);
+}
+
+inline void QR::PNG_STREAM::CHUNK(SINK& sink, const char* type, const std::uint8_t* data, size_t length)
+{
+    std::uint8_t header[8];
+    PUT32(header, static_cast<std::uint32_t>(length));
+    std::memcpy(header + 4, type, 4);
+
+    std::uint8_t crc[4];
+    PUT32(crc, CHECKSUM::CRC32(CHECKSUM::CRC32(0, header + 4, 4), data, length));
+
+    sink.WRITE(header, 8);
+    if (length > 0)
+        sink.WRITE(data, length);
+    sink.WRITE(crc, 4);
+}
+
+inline QR::PNG_STREAM::IDAT_SINK::IDAT_SINK(SINK& sink)
+    : Out(sink)
+{
+    Buffer.reserve(CHUNK_BYTES);
+}
+
+inline void QR::PNG_STREAM::IDAT_SINK::WRITE(const void* data, size_t length)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    while (length > 0)
+    {
+        size_t count = std::min(length, CHUNK_BYTES - Buffer.size());
+        Buffer.insert(Buffer.end(), bytes, bytes + count);
+        bytes += count;
+        length -= count;
+        if (Buffer.size() == CHUNK_BYTES)
+        {
+            CHUNK(Out, "IDAT", Buffer.data(), Buffer.size());
+            Buffer.clear();
+        }
+    }
+}
+
+inline void QR::PNG_STREAM::IDAT_SINK::FINISH()
+{
+    if (!Buffer.empty())
+        CHUNK(Out, "IDAT", Buffer.data(), Buffer.size());
+    Buffer.clear();
+}
+
+class QR::PNG_STREAM::FAST_COMPRESSOR : public QR::PNG_STREAM::COMPRESSOR
+{
+public:
+    FAST_COMPRESSOR(SINK& idat, int level) : Deflate(idat, true, level) {}
+
+    void WRITE(const std::uint8_t* data, size_t length) override { Deflate.WRITE(data, length); }
+
+    void FINISH() override { Deflate.FINISH(); }
+
+private:
+    DEFLATE_STREAM Deflate;
+};
+
+#if QR_PNG_HAS_ZLIB
+class QR::PNG_STREAM::ZLIB_COMPRESSOR : public QR::PNG_STREAM::COMPRESSOR
+{
+public:
+    ZLIB_COMPRESSOR(SINK& idat, int level) : Out(idat), Buffer(16384)
+    {
+        Stream = z_stream{};
+        if (deflateInit(&Stream, level) != Z_OK)
+            throw std::runtime_error("Compression failed");
+    }
+
+    ~ZLIB_COMPRESSOR() override { deflateEnd(&Stream); }
+
+    void WRITE(const std::uint8_t* data, size_t length) override
+    {
+        Stream.next_in = const_cast<Bytef*>(data);
+        Stream.avail_in = static_cast<uInt>(length);
+        RUN(Z_NO_FLUSH);
+    }
+
+    void FINISH() override { RUN(Z_FINISH); }
+
+private:
+    void RUN(int flush)
+    {
+        int result;
+        do
+        {
+            Stream.next_out = Buffer.data();
+            Stream.avail_out = static_cast<uInt>(Buffer.size());
+            result = deflate(&Stream, flush);
+            if (result == Z_STREAM_ERROR)
+                throw std::runtime_error("Compression failed");
+            Out.WRITE(Buffer.data(), Buffer.size() - Stream.avail_out);
+        } while (Stream.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+    }
+
+    SINK& Out;
+
+    z_stream Stream;
+
+    std::vector<std::uint8_t> Buffer;
+};
+#endif
+
+#ifdef LODEPNG_H
+class QR::PNG_STREAM::LODEPNG_COMPRESSOR : public QR::PNG_STREAM::COMPRESSOR
+{
+public:
+    LODEPNG_COMPRESSOR(SINK& idat, int level) : Out(idat), Settings(lodepng_default_compress_settings)
+    {
+        Settings.windowsize = level <= 3 ? 2048 : level <= 6 ? 8192 : 32768;
+    }
+
+    void WRITE(const std::uint8_t* data, size_t length) override { Data.insert(Data.end(), data, data + length); }
+
+    void FINISH() override
+    {
+        std::vector<unsigned char> compressed;
+        if (lodepng::compress(compressed, Data, Settings))
+            throw std::runtime_error("Compression failed");
+        Out.WRITE(compressed.data(), compressed.size());
+    }
+
+private:
+    SINK& Out;
+
+    LodePNGCompressSettings Settings;
+
+    std::vector<unsigned char> Data;
+};
+#endif
+
+inline bool QR::PNG_STREAM::AVAILABLE(BACKEND backend)
+{
+    switch (backend)
+    {
+    case BACKEND::QR_FAST:
+        return true;
+    case BACKEND::ZLIB:
+        return QR_PNG_HAS_ZLIB != 0;
+    case BACKEND::LODEPNG:
+#ifdef LODEPNG_H
+        return true;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+}
+
+inline std::unique_ptr<QR::PNG_STREAM::COMPRESSOR> QR::PNG_STREAM::MAKE_COMPRESSOR(const OPTIONS& options, SINK& idat)
+{
+    if (options.level < 1 || options.level > 9)
+        throw std::domain_error("value out of range");
+
+    switch (options.backend)
+    {
+    case BACKEND::QR_FAST:
+        return std::make_unique<FAST_COMPRESSOR>(idat, options.level);
+#if QR_PNG_HAS_ZLIB
+    case BACKEND::ZLIB:
+        return std::make_unique<ZLIB_COMPRESSOR>(idat, options.level);
+#endif
+#ifdef LODEPNG_H
+    case BACKEND::LODEPNG:
+        return std::make_unique<LODEPNG_COMPRESSOR>(idat, options.level);
+#endif
+    default:
+        throw std::invalid_argument("Backend not available");
+    }
+}
+
+inline std::uint8_t QR::PNG_STREAM::HEADER(SINK& sink, int width, int height, const RASTER& raster, const OPTIONS& options)
+{
+    if (width < 1 || height < 1)
+        throw std::invalid_argument("Invalid value");
+
+    const RASTER::FORMAT format = raster.FORMAT_GETTER();
+    const bool mono = format == RASTER::FORMAT::MONO1;
+    std::uint8_t colorType;
+    switch (format)
+    {
+    case RASTER::FORMAT::MONO1:  colorType = options.palette ? 3 : 0; break;
+    case RASTER::FORMAT::GRAY8:  colorType = 0; break;
+    case RASTER::FORMAT::RGB24:  colorType = 2; break;
+    case RASTER::FORMAT::RGBA32: colorType = 6; break;
+    default: throw std::invalid_argument("Invalid value");
+    }
+
+    static const std::uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    sink.WRITE(signature, 8);
+
+    std::uint8_t ihdr[13];
+    PUT32(ihdr, static_cast<std::uint32_t>(width));
+    PUT32(ihdr + 4, static_cast<std::uint32_t>(height));
+    ihdr[8] = mono ? 1 : 8;     // Bit depth
+    ihdr[9] = colorType;
+    ihdr[10] = 0;               // Deflate
+    ihdr[11] = 0;               // Adaptive filtering
+    ihdr[12] = 0;               // No interlace
+    CHUNK(sink, "IHDR", ihdr, sizeof(ihdr));
+
+    if (colorType == 3)
+    {
+        // Index 0 is light and index 1 dark, matching the MONO1 bits
+        const RASTER::COLOR light = raster.LIGHT_GETTER();
+        const RASTER::COLOR dark = raster.DARK_GETTER();
+        const std::uint8_t plte[6] = { light.r, light.g, light.b, dark.r, dark.g, dark.b };
+        CHUNK(sink, "PLTE", plte, sizeof(plte));
+        if (light.a != 255 || dark.a != 255)
+        {
+            const std::uint8_t trns[2] = { light.a, dark.a };
+            CHUNK(sink, "tRNS", trns, sizeof(trns));
+        }
+    }
+    return colorType;
+}
+
+inline void QR::PNG_STREAM::WRITE(SINK& sink, int width, int height, const RASTER& raster, const LINE_SOURCE& source,
+    const OPTIONS& options)
+{
+    // Created first so an unavailable backend is reported before anything is written
+    IDAT_SINK idat(sink);
+    std::unique_ptr<COMPRESSOR> compressor = MAKE_COMPRESSOR(options, idat);
+
+    const bool mono = raster.FORMAT_GETTER() == RASTER::FORMAT::MONO1;
+    const std::uint8_t colorType = HEADER(sink, width, height, raster, options);
+
+    const size_t rowBytes = raster.ROW_BYTES(width);
+    std::vector<std::uint8_t> line(rowBytes);
+    std::vector<std::uint8_t> filtered(rowBytes + 1);
+
+    // Filter type 2 (Up) with every difference zero, for rows equal to the one above
+    std::vector<std::uint8_t> up(rowBytes + 1, 0);
+    up[0] = 2;
+
+    for (int y = 0; y < height; y++)
+    {
+        bool changed = source(y, line.data()) || y == 0;
+        if (changed)
+        {
+            // Filter type 0 (None); 1-bit gray has 0 for black, the opposite of MONO1
+            filtered[0] = 0;
+            if (mono && colorType == 0)
+                for (size_t i = 0; i < rowBytes; i++)
+                    filtered[i + 1] = static_cast<std::uint8_t>(~line[i]);
+            else
+                std::memcpy(filtered.data() + 1, line.data(), rowBytes);
+            compressor->WRITE(filtered.data(), filtered.size());
+        }
+        else
+            compressor->WRITE(up.data(), up.size());
+    }
+    compressor->FINISH();
+    idat.FINISH();
+
+    CHUNK(sink, "IEND", nullptr, 0);
+    sink.FLUSH();
+}
+
+inline void QR::PNG_STREAM::WRITE(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster, const OPTIONS& options)
+{
+    const int pixels = raster.PIXELS(view.SIZE_GETTER());
+    const int scale = raster.SCALE_GETTER();
+    WRITE(sink, pixels, pixels, raster, [&view, &raster, scale](int y, std::uint8_t* line)
+        {
+            if (y % scale != 0)
+                return false;
+            raster.RENDER_LINE(view, y / scale, line);
+            return true;
+        }, options);
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef PRINTERSTREAM_H
+#define PRINTERSTREAM_H
+
+#include "Sink.h"
+#include "Raster.h"
+#include "BitmapStream.h"
+#include "../QRCode/MatrixView.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Label and receipt printer commands built straight from the packed module rows.
+    *
+    * Both languages take 1-bit rows with the first dot in the top bit and 1 = print, which is
+    * what RASTER's MONO1 lines hold, so no image is decoded or converted on the way.
+    */
+    class PRINTER_STREAM
+    {
+    public:
+        /**
+        * @brief Writes a ZPL label holding the symbol as a ^GF graphic field at (x, y) dots.
+        *
+        * The field uses ZPL's compressed ASCII: runs of a hex digit become a repeat count, rows
+        * ending in zeros or ones are cut short with ',' or '!', and each repeated dot row (all
+        * but the first of a module row) is a single ':'.
+        *
+        * @throws std::domain_error if the scale, the border or the position is out of range.
+        */
+        static void ZPL(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1, int x = 0, int y = 0);
+
+        /**
+        * @brief Writes ESC/POS "GS v 0" raster bit image commands, in bands of at most BAND_DOTS rows.
+        *
+        * @throws std::domain_error if the scale or the border is out of range, or the image is
+        * wider than the command allows.
+        */
+        static void ESCPOS(SINK& sink, const MATRIX_VIEW& view, int scale, int border = 1);
+
+        // Dot rows per GS v 0 command, within the limit of common receipt printers
+        static constexpr int BAND_DOTS = 1024;
+
+    private:
+        /**
+        * @brief Appends one row of a ^GF field in compressed ASCII.
+        */
+        static void ZPL_ROW(const std::uint8_t* row, size_t length, std::string& out);
+
+        /**
+        * @brief Appends `count` copies of a hex digit as repeat counts followed by the digit.
+        */
+        static void ZPL_RUN(char digit, size_t count, std::string& out);
+    };
+}
+
+inline void QR::PRINTER_STREAM::ZPL_RUN(char digit, size_t count, std::string& out)
+{
+    while (count > 0)
+    {
+        if (count == 1)
+        {
+            out += digit;
+            return;
+        }
+
+        // 'g' to 'z' count 20 to 400 and 'G' to 'Y' count 1 to 19; they add up
+        size_t chunk = count < 419 ? count : 419;
+        count -= chunk;
+        if (chunk >= 20)
+            out += static_cast<char>('g' + chunk / 20 - 1);
+        if (chunk % 20 != 0)
+            out += static_cast<char>('G' + chunk % 20 - 1);
+        out += digit;
+    }
+}
+
+inline void QR::PRINTER_STREAM::ZPL_ROW(const std::uint8_t* row, size_t length, std::string& out)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    std::string hex(2 * length, '0');
+    for (size_t i = 0; i < length; i++)
+    {
+        hex[2 * i] = digits[row[i] >> 4];
+        hex[2 * i + 1] = digits[row[i] & 15];
+    }
+
+    // ',' fills the rest of the row with zeros and '!' with ones
+    size_t end = hex.size();
+    char tail = 0;
+    while (end > 0 && hex[end - 1] == '0')
+        end--;
+    if (end < hex.size())
+        tail = ',';
+    else
+    {
+        while (end > 0 && hex[end - 1] == 'F')
+            end--;
+        if (end < hex.size())
+            tail = '!';
+    }
+
+    for (size_t i = 0; i < end;)
+    {
+        size_t run = 1;
+        while (i + run < end && hex[i + run] == hex[i])
+            run++;
+        ZPL_RUN(hex[i], run, out);
+        i += run;
+    }
+    if (tail != 0)
+        out += tail;
+}
+
+inline void QR::PRINTER_STREAM::ZPL(SINK& sink, const MATRIX_VIEW& view, int scale, int border, int x, int y)
+{
+    if (x < 0 || y < 0 || x > 32000 || y > 32000)
+        throw std::domain_error("value out of range");
+
+    const RASTER raster(RASTER::FORMAT::MONO1, scale, border);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+    size_t lineBytes = raster.ROW_BYTES(width);
+    std::vector<std::uint8_t> lines = BITMAP_STREAM::LINES(view, raster, lineBytes);
+
+    // For compressed ASCII, the byte count and the field count are both the uncompressed size
+    std::string total = std::to_string(lineBytes * static_cast<size_t>(width));
+    std::string out = "^XA^FO" + std::to_string(x) + "," + std::to_string(y)
+        + "^GFA," + total + "," + total + "," + std::to_string(lineBytes) + ",";
+    for (size_t k = 0; k < lines.size(); k += lineBytes)
+    {
+        ZPL_ROW(lines.data() + k, lineBytes, out);
+        out.append(static_cast<size_t>(scale) - 1, ':');
+    }
+    out += "^FS^XZ\n";
+    sink.WRITE(out.data(), out.size());
+}
+
+inline void QR::PRINTER_STREAM::ESCPOS(SINK& sink, const MATRIX_VIEW& view, int scale, int border)
+{
+    const RASTER raster(RASTER::FORMAT::MONO1, scale, border);
+    int width = raster.PIXELS(view.SIZE_GETTER());
+    size_t lineBytes = raster.ROW_BYTES(width);
+    if (lineBytes > 0xFFFF)
+        throw std::domain_error("value out of range");
+    std::vector<std::uint8_t> lines = BITMAP_STREAM::LINES(view, raster, lineBytes);
+    std::vector<SLICE> rows = BITMAP_STREAM::SLICES(lines, lineBytes);
+
+    // Whole module rows per band, so a band is a run of lines each repeated `scale` times
+    size_t perBand = static_cast<size_t>(BAND_DOTS / scale > 0 ? BAND_DOTS / scale : 1);
+    for (size_t first = 0; first < rows.size(); first += perBand)
+    {
+        size_t count = rows.size() - first < perBand ? rows.size() - first : perBand;
+        size_t dots = count * static_cast<size_t>(scale);
+        const std::uint8_t command[8] = {
+            0x1D, 'v', '0', 0,
+            static_cast<std::uint8_t>(lineBytes), static_cast<std::uint8_t>(lineBytes >> 8),
+            static_cast<std::uint8_t>(dots), static_cast<std::uint8_t>(dots >> 8) };
+        sink.WRITE(command, sizeof(command));
+        BITMAP_STREAM::EMIT(sink, std::vector<SLICE>(rows.begin() + first, rows.begin() + first + count), scale, false);
+    }
+}
+
+#endif
@@ -0,0 +1,361 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "../QRCode/MatrixView.h"
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief Renders packed symbols into pixel buffers owned by the caller.
+    *
+    * Every byte of packed modules (8 modules) is turned into pixels by copying one entry of a
+    * lookup table built once for the scale and colors, so a row costs one memcpy per 8 modules.
+    * Each scaled row is produced once and copied to the `scale - 1` rows below it, so rendering
+    * large symbols at large scales is bound by memory bandwidth.
+    */
+    class RASTER
+    {
+    public:
+        /**
+        * @brief Pixel layouts RENDER can write.
+        */
+        enum class FORMAT
+        {
+            MONO1,     // 1 bit per pixel, first pixel in the top bit, set bit = dark
+            GRAY8,     // 1 byte per pixel, luma of the color
+            RGB24,     // 3 bytes per pixel: R, G, B
+            RGBA32     // 4 bytes per pixel: R, G, B, A
+        };
+
+        /**
+        * @brief An 8-bit RGBA color.
+        */
+        struct COLOR
+        {
+            std::uint8_t r;
+            std::uint8_t g;
+            std::uint8_t b;
+            std::uint8_t a;
+        };
+
+        /**
+        * @brief Prepares a renderer and its lookup table.
+        *
+        * @param format The pixel layout of the destination buffers.
+        * @param scale The number of pixels per module side (1 - 256).
+        * @param border The width of the light quiet zone, in modules.
+        * @param dark The color of dark modules (for MONO1, only kept for palette based writers).
+        * @param light The color of light modules and the border (likewise).
+        *
+        * @throws std::domain_error if the scale or the border is out of range.
+        */
+        RASTER(FORMAT format, int scale, int border = 1,
+            COLOR dark = COLOR{ 0, 0, 0, 255 },
+            COLOR light = COLOR{ 255, 255, 255, 255 });
+
+        /**
+        * @brief Width and height in pixels of a rendered symbol of `size` modules per side.
+        */
+        int PIXELS(int size) const;
+
+        /**
+        * @brief Smallest stride, in bytes, able to hold a row of `width` pixels.
+        */
+        size_t ROW_BYTES(int width) const;
+
+        /**
+        * @brief Writes a symbol and its border into a caller-provided buffer.
+        *
+        * @param view The packed modules to render.
+        * @param buffer The top left pixel of the destination; PIXELS() rows are written.
+        * @param stride The distance in bytes between the starts of two rows (at least ROW_BYTES).
+        *
+        * @throws std::invalid_argument if the stride is too small for a row.
+        */
+        void RENDER(const MATRIX_VIEW& view, std::uint8_t* buffer, size_t stride) const;
+
+        /**
+        * @brief Renders a symbol into a new, tightly packed buffer.
+        *
+        * @param view The packed modules to render.
+        * @return PIXELS() rows of ROW_BYTES(PIXELS()) bytes each.
+        */
+        std::vector<std::uint8_t> RENDER(const MATRIX_VIEW& view) const;
+
+        /**
+        * @brief Writes one pixel row of module row `row`, counted from the top of the border.
+        *
+        * Every pixel row of a module row is identical, so streaming writers call this once per
+        * module row (0 to size + 2 * border - 1) and reuse the line `scale` times.
+        *
+        * @param view The packed modules to render.
+        * @param row The module row, border included. No bounds checks.
+        * @param line Receives ROW_BYTES(PIXELS()) bytes.
+        */
+        void RENDER_LINE(const MATRIX_VIEW& view, int row, std::uint8_t* line) const;
+
+        /**
+        * @brief Retrieves the pixel layout.
+        */
+        FORMAT FORMAT_GETTER() const;
+
+        /**
+        * @brief Retrieves the number of pixels per module side.
+        */
+        int SCALE_GETTER() const;
+
+        /**
+        * @brief Retrieves the width of the quiet zone, in modules.
+        */
+        int BORDER_GETTER() const;
+
+        /**
+        * @brief Retrieves the color of dark modules.
+        */
+        COLOR DARK_GETTER() const;
+
+        /**
+        * @brief Retrieves the color of light modules and of the border.
+        */
+        COLOR LIGHT_GETTER() const;
+
+    private:
+        /**
+        * @brief Bytes per pixel, or 0 for MONO1.
+        */
+        static int BYTES_PER_PIXEL(FORMAT format);
+
+        /**
+        * @brief Writes the bytes of one pixel of the given color.
+        */
+        void PIXEL(std::uint8_t* out, const COLOR& color) const;
+
+        FORMAT Format;
+
+        int Scale;
+
+        int Border;
+
+        COLOR Dark;
+
+        COLOR Light;
+
+        /**
+        * @brief Bytes of one lookup table entry: the pixels of 8 modules (8 * scale bits for MONO1).
+        */
+        size_t EntryBytes;
+
+        /**
+        * @brief 256 entries, one per value of a packed byte of modules.
+        */
+        std::vector<std::uint8_t> Lut;
+    };
+}
+
+inline QR::RASTER::RASTER(FORMAT format, int scale, int border, COLOR dark, COLOR light)
+    : Format(format), Scale(scale), Border(border), Dark(dark), Light(light)
+{
+    if (scale < 1 || scale > 256 || border < 0 || border > 256)
+        throw std::domain_error("value out of range");
+
+    int bytesPerPixel = BYTES_PER_PIXEL(format);
+    EntryBytes = bytesPerPixel == 0 ? static_cast<size_t>(scale) : static_cast<size_t>(8 * scale * bytesPerPixel);
+    Lut.assign(256 * EntryBytes, 0);
+
+    for (int value = 0; value < 256; value++)
+    {
+        std::uint8_t* entry = &Lut[static_cast<size_t>(value) * EntryBytes];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            bool isDark = ((value >> (7 - bit)) & 1) != 0;
+            for (int s = 0; s < scale; s++)
+            {
+                int pixel = bit * scale + s;
+                if (bytesPerPixel == 0)
+                {
+                    if (isDark)
+                        entry[pixel >> 3] |= static_cast<std::uint8_t>(0x80 >> (pixel & 7));
+                }
+                else
+                    PIXEL(entry + static_cast<size_t>(pixel) * bytesPerPixel, isDark ? Dark : Light);
+            }
+        }
+    }
+}
+
+inline int QR::RASTER::BYTES_PER_PIXEL(FORMAT format)
+{
+    switch (format)
+    {
+    case FORMAT::MONO1:  return 0;
+    case FORMAT::GRAY8:  return 1;
+    case FORMAT::RGB24:  return 3;
+    case FORMAT::RGBA32: return 4;
+    default: throw std::invalid_argument("Invalid value");
+    }
+}
+
+inline void QR::RASTER::PIXEL(std::uint8_t* out, const COLOR& color) const
+{
+    switch (Format)
+    {
+    case FORMAT::GRAY8:
+        out[0] = static_cast<std::uint8_t>((color.r * 299 + color.g * 587 + color.b * 114 + 500) / 1000);
+        break;
+    case FORMAT::RGBA32:
+        out[3] = color.a;
+        [[fallthrough]];
+    case FORMAT::RGB24:
+        out[0] = color.r;
+        out[1] = color.g;
+        out[2] = color.b;
+        break;
+    default:
+        break;
+    }
+}
+
+inline int QR::RASTER::PIXELS(int size) const
+{
+    return (size + 2 * Border) * Scale;
+}
+
+inline size_t QR::RASTER::ROW_BYTES(int width) const
+{
+    int bytesPerPixel = BYTES_PER_PIXEL(Format);
+    return bytesPerPixel == 0 ? (static_cast<size_t>(width) + 7) / 8 : static_cast<size_t>(width) * bytesPerPixel;
+}
+
+inline void QR::RASTER::RENDER(const MATRIX_VIEW& view, std::uint8_t* buffer, size_t stride) const
+{
+    if (stride < ROW_BYTES(PIXELS(view.SIZE_GETTER())))
+        throw std::invalid_argument("Invalid value");
+
+    // Each module row is rendered once, into its first pixel row, and copied to the others
+    const size_t rowBytes = ROW_BYTES(PIXELS(view.SIZE_GETTER()));
+    const int rows = view.SIZE_GETTER() + 2 * Border;
+    for (int row = 0; row < rows; row++)
+    {
+        std::uint8_t* first = buffer + static_cast<size_t>(row) * Scale * stride;
+        RENDER_LINE(view, row, first);
+        for (int s = 1; s < Scale; s++)
+            std::memcpy(first + s * stride, first, rowBytes);
+    }
+}
+
+inline std::vector<std::uint8_t> QR::RASTER::RENDER(const MATRIX_VIEW& view) const
+{
+    int pixels = PIXELS(view.SIZE_GETTER());
+    size_t rowBytes = ROW_BYTES(pixels);
+    std::vector<std::uint8_t> image(rowBytes * static_cast<size_t>(pixels));
+    RENDER(view, image.data(), rowBytes);
+    return image;
+}
+
+inline void QR::RASTER::RENDER_LINE(const MATRIX_VIEW& view, int row, std::uint8_t* line) const
+{
+    const int size = view.SIZE_GETTER();
+    const size_t rowBytes = ROW_BYTES(PIXELS(size));
+    const int y = row - Border;
+
+    if (Format == FORMAT::MONO1)
+    {
+        // Light pixels are zero bits. The modules start `Border * Scale` bits into the row,
+        // which is rarely byte aligned, so the table entries are shifted into place
+        std::memset(line, 0, rowBytes);
+        if (y < 0 || y >= size)
+            return;
+
+        std::span<const std::uint64_t> bits = view.ROW(y);
+        const size_t offset = static_cast<size_t>(Border) * Scale;
+        const int shift = static_cast<int>(offset & 7);
+        size_t out = offset >> 3;
+        for (int x = 0; x < size; x += 8, out += EntryBytes)
+        {
+            std::uint8_t value = MATRIX_VIEW::ROW_BYTE(bits, static_cast<size_t>(x) >> 3);
+            if (value == 0)
+                continue;
+            const std::uint8_t* entry = &Lut[value * EntryBytes];
+
+            // Entry bytes past the row only ever hold the zero padding modules
+            for (size_t j = 0; j < EntryBytes && out + j < rowBytes; j++)
+            {
+                line[out + j] |= static_cast<std::uint8_t>(entry[j] >> shift);
+                if (shift != 0 && out + j + 1 < rowBytes)
+                    line[out + j + 1] |= static_cast<std::uint8_t>(entry[j] << (8 - shift));
+            }
+        }
+        return;
+    }
+
+    const size_t pixelBytes = static_cast<size_t>(BYTES_PER_PIXEL(Format));
+    const size_t borderBytes = pixelBytes * Border * Scale;
+    const size_t moduleBytes = pixelBytes * Scale;
+
+    if (y < 0 || y >= size)
+    {
+        // Quiet zone: one light pixel, then doubling copies
+        PIXEL(line, Light);
+        for (size_t filled = pixelBytes; filled < rowBytes; filled *= 2)
+            std::memcpy(line + filled, line, std::min(filled, rowBytes - filled));
+        return;
+    }
+
+    std::span<const std::uint64_t> bits = view.ROW(y);
+    const std::uint8_t* light = &Lut[0];
+    std::uint8_t* out = line;
+    for (size_t left = borderBytes; left > 0; )
+    {
+        size_t count = std::min(left, EntryBytes);
+        std::memcpy(out, light, count);
+        out += count;
+        left -= count;
+    }
+    for (int x = 0; x < size; x += 8)
+    {
+        size_t count = static_cast<size_t>(std::min(8, size - x));
+        std::memcpy(out, &Lut[MATRIX_VIEW::ROW_BYTE(bits, static_cast<size_t>(x) >> 3) * EntryBytes], count * moduleBytes);
+        out += count * moduleBytes;
+    }
+    for (size_t left = borderBytes; left > 0; )
+    {
+        size_t count = std::min(left, EntryBytes);
+        std::memcpy(out, light, count);
+        out += count;
+        left -= count;
+    }
+}
+
+inline QR::RASTER::FORMAT QR::RASTER::FORMAT_GETTER() const
+{
+    return Format;
+}
+
+inline int QR::RASTER::SCALE_GETTER() const
+{
+    return Scale;
+}
+
+inline int QR::RASTER::BORDER_GETTER() const
+{
+    return Border;
+}
+
+inline QR::RASTER::COLOR QR::RASTER::DARK_GETTER() const
+{
+    return Dark;
+}
+
+inline QR::RASTER::COLOR QR::RASTER::LIGHT_GETTER() const
+{
+    return Light;
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef SINK_H
+#define SINK_H
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <functional>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#endif
+
+namespace QR
+{
+    /**
+    * @brief One piece of a gathered write.
+    */
+    struct SLICE
+    {
+        const void* data;
+        size_t length;
+    };
+
+    /**
+    * @brief Destination of the bytes produced by the streaming writers.
+    *
+    * Writers hand over their output in pieces as it is produced, so they never need to hold
+    * a whole encoded image. Implementations throw std::runtime_error when a write fails.
+    */
+    class SINK
+    {
+    public:
+        virtual ~SINK() = default;
+
+        /**
+        * @brief Appends `length` bytes to the destination.
+        */
+        virtual void WRITE(const void* data, size_t length) = 0;
+
+        /**
+        * @brief Appends `count` pieces in order. WRITEs each piece by default; sinks that can
+        * gather (writev) override it, so writers can repeat rows without copying them.
+        */
+        virtual void WRITEV(const SLICE* slices, size_t count);
+
+        /**
+        * @brief Pushes any bytes buffered by the destination onwards. Does nothing by default.
+        */
+        virtual void FLUSH() {}
+    };
+
+    /**
+    * @brief Writes to a file descriptor, retrying short writes.
+    */
+    class FD_SINK : public SINK
+    {
+    public:
+        /**
+        * @param fd An open descriptor; it is not closed by the sink.
+        */
+        explicit FD_SINK(int fd);
+
+        void WRITE(const void* data, size_t length) override;
+
+        void WRITEV(const SLICE* slices, size_t count) override;
+
+    private:
+        int Fd;
+    };
+
+    /**
+    * @brief Writes to a std::ostream.
+    */
+    class STREAM_SINK : public SINK
+    {
+    public:
+        explicit STREAM_SINK(std::ostream& stream);
+
+        void WRITE(const void* data, size_t length) override;
+
+        void FLUSH() override;
+
+    private:
+        std::ostream& Stream;
+    };
+
+    /**
+    * @brief Hands every piece of output to a callback.
+    */
+    class CALLBACK_SINK : public SINK
+    {
+    public:
+        explicit CALLBACK_SINK(std::function<void(const std::uint8_t*, size_t)> callback);
+
+        void WRITE(const void* data, size_t length) override;
+
+    private:
+        std::function<void(const std::uint8_t*, size_t)> Callback;
+    };
+
+    /**
+    * @brief Appends to a std::string owned by the caller.
+    */
+    class STRING_SINK : public SINK
+    {
+    public:
+        explicit STRING_SINK(std::string& target);
+
+        void WRITE(const void* data, size_t length) override;
+
+    private:
+        std::string& Target;
+    };
+}
+
+inline void QR::SINK::WRITEV(const SLICE* slices, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        WRITE(slices[i].data, slices[i].length);
+}
+
+inline QR::FD_SINK::FD_SINK(int fd)
+    : Fd(fd)
+{
+}
+
+inline void QR::FD_SINK::WRITE(const void* data, size_t length)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (length > 0)
+    {
+#ifdef _WIN32
+        int written = _write(Fd, bytes, static_cast<unsigned>(length > 0x40000000 ? 0x40000000 : length));
+#else
+        ssize_t written = ::write(Fd, bytes, length);
+        if (written < 0 && errno == EINTR)
+            continue;
+#endif
+        if (written <= 0)
+            throw std::runtime_error("Write failed");
+        bytes += written;
+        length -= static_cast<size_t>(written);
+    }
+}
+
+inline void QR::FD_SINK::WRITEV(const SLICE* slices, size_t count)
+{
+#ifdef _WIN32
+    SINK::WRITEV(slices, count);
+#else
+    struct iovec vectors[IOV_MAX < 1024 ? IOV_MAX : 1024];
+    const size_t most = sizeof(vectors) / sizeof(vectors[0]);
+    size_t done = 0;    // Bytes of slices[0] already written
+    while (count > 0)
+    {
+        size_t n = count < most ? count : most;
+        for (size_t i = 0; i < n; i++)
+        {
+            vectors[i].iov_base = const_cast<char*>(static_cast<const char*>(slices[i].data)) + (i == 0 ? done : 0);
+            vectors[i].iov_len = slices[i].length - (i == 0 ? done : 0);
+        }
+        ssize_t written = ::writev(Fd, vectors, static_cast<int>(n));
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0 || (written == 0 && vectors[0].iov_len > 0))
+            throw std::runtime_error("Write failed");
+
+        // Skip the slices written in full, and remember how far into the next one the write got
+        size_t left = static_cast<size_t>(written) + done;
+        while (count > 0 && left >= slices[0].length)
+        {
+            left -= slices[0].length;
+            slices++;
+            count--;
+        }
+        done = left;
+    }
+#endif
+}
+
+inline QR::STREAM_SINK::STREAM_SINK(std::ostream& stream)
+    : Stream(stream)
+{
+}
+
+inline void QR::STREAM_SINK::WRITE(const void* data, size_t length)
+{
+    if (!Stream.write(static_cast<const char*>(data), static_cast<std::streamsize>(length)))
+        throw std::runtime_error("Write failed");
+}
+
+inline void QR::STREAM_SINK::FLUSH()
+{
+    if (!Stream.flush())
+        throw std::runtime_error("Write failed");
+}
+
+inline QR::CALLBACK_SINK::CALLBACK_SINK(std::function<void(const std::uint8_t*, size_t)> callback)
+    : Callback(std::move(callback))
+{
+}
+
+inline void QR::CALLBACK_SINK::WRITE(const void* data, size_t length)
+{
+    Callback(static_cast<const std::uint8_t*>(data), length);
+}
+
+inline QR::STRING_SINK::STRING_SINK(std::string& target)
+    : Target(target)
+{
+}
+
+inline void QR::STRING_SINK::WRITE(const void* data, size_t length)
+{
+    Target.append(static_cast<const char*>(data), length);
+}
+
+#endif
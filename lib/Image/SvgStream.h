@@ -0,0 +1,227 @@
+#ifndef SVGSTREAM_H
+#define SVGSTREAM_H
+
+#include "Sink.h"
+#include "Gzip.h"
+#include "../QRCode/RunGeometry.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief SVG_STREAM output choices.
+    */
+    struct SVG_OPTIONS
+    {
+        int border = 4;                     // Quiet zone, in modules
+        const char* dark = "#000000";       // Fill of the dark modules
+        const char* light = "#FFFFFF";      // Fill of the background
+        bool gzip = false;                  // Write SVGZ (gzip-compressed SVG)
+        int level = 6;                      // Gzip effort, 1 (fastest) to 9 (smallest)
+    };
+
+    /**
+    * @brief Streaming SVG writer.
+    *
+    * Dark modules are drawn as one stroked path per symbol: the path runs along the middle of
+    * each row with a stroke one module wide, and every run of dark modules is a single "h n"
+    * segment reached with a relative move from the end of the previous one. That is about six
+    * bytes per run instead of fifteen per module. Numbers are formatted with std::to_chars into
+    * a small buffer that is handed to the sink when full, so no iostream is involved and memory
+    * does not grow with the symbol.
+    */
+    class SVG_STREAM
+    {
+    public:
+        /**
+        * @brief Writes the SVG header and the background.
+        *
+        * @param sink The destination of the file bytes.
+        * @param width The width of the drawing, in modules (borders included).
+        * @param height The height of the drawing, in modules (borders included).
+        * @param options Colors and compression; `border` is not used by this constructor.
+        */
+        SVG_STREAM(SINK& sink, int width, int height, const SVG_OPTIONS& options = SVG_OPTIONS());
+
+        SVG_STREAM(const SVG_STREAM&) = delete;
+        SVG_STREAM& operator=(const SVG_STREAM&) = delete;
+
+        /**
+        * @brief Draws the dark modules of one symbol whose first module is at (left, top).
+        */
+        void PATH(const RUN_GEOMETRY& runs, int left, int top);
+
+        /**
+        * @brief Closes the document and, for SVGZ, the compressed stream.
+        */
+        void FINISH();
+
+        /**
+        * @brief Writes a complete SVG of one symbol to a sink.
+        */
+        static void WRITE(SINK& sink, const RUN_GEOMETRY& runs, const SVG_OPTIONS& options = SVG_OPTIONS());
+
+        /**
+        * @brief Returns a complete SVG of one symbol, in a string allocated once.
+        */
+        static std::string STRING(const RUN_GEOMETRY& runs, const SVG_OPTIONS& options = SVG_OPTIONS());
+
+        /**
+        * @brief Upper bound on the uncompressed size of WRITE's output, in bytes.
+        */
+        static size_t SIZE_BOUND(const RUN_GEOMETRY& runs, const SVG_OPTIONS& options = SVG_OPTIONS());
+
+    private:
+        static constexpr size_t BUFFER_BYTES = 8192;
+
+        // Longest segment: "m-65535,65535h65535"
+        static constexpr size_t MAX_SEGMENT = 24;
+
+        void PUT(const char* text);
+
+        void PUT(int value);
+
+        void DRAIN();
+
+        SINK* Out;
+
+        std::unique_ptr<GZIP_SINK> Gzip;
+
+        SVG_OPTIONS Options;
+
+        std::vector<char> Buffer;
+
+        size_t Used;
+
+        bool Finished;
+    };
+}
+
+inline QR::SVG_STREAM::SVG_STREAM(SINK& sink, int width, int height, const SVG_OPTIONS& options)
+    : Out(&sink), Options(options), Buffer(BUFFER_BYTES), Used(0), Finished(false)
+{
+    if (Options.gzip)
+    {
+        Gzip = std::make_unique<GZIP_SINK>(sink, Options.level);
+        Out = Gzip.get();
+    }
+
+    PUT("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    PUT("<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n");
+    PUT("<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" viewBox=\"0 0 ");
+    PUT(width);
+    PUT(" ");
+    PUT(height);
+    PUT("\" stroke=\"none\">\n");
+    PUT("\t<rect width=\"100%\" height=\"100%\" fill=\"");
+    PUT(Options.light);
+    PUT("\"/>\n");
+}
+
+inline void QR::SVG_STREAM::PUT(const char* text)
+{
+    size_t length = std::strlen(text);
+    while (length > 0)
+    {
+        if (Used == Buffer.size())
+            DRAIN();
+        size_t count = std::min(length, Buffer.size() - Used);
+        std::memcpy(Buffer.data() + Used, text, count);
+        Used += count;
+        text += count;
+        length -= count;
+    }
+}
+
+inline void QR::SVG_STREAM::PUT(int value)
+{
+    if (Buffer.size() - Used < 16)
+        DRAIN();
+    std::to_chars_result result = std::to_chars(Buffer.data() + Used, Buffer.data() + Buffer.size(), value);
+    Used = static_cast<size_t>(result.ptr - Buffer.data());
+}
+
+inline void QR::SVG_STREAM::DRAIN()
+{
+    if (Used > 0)
+        Out->WRITE(Buffer.data(), Used);
+    Used = 0;
+}
+
+inline void QR::SVG_STREAM::PATH(const RUN_GEOMETRY& runs, int left, int top)
+{
+    if (runs.COUNT_GETTER() == 0)
+        return;
+
+    // Shifted down half a module, so a one module wide stroke along y covers rows y to y + 1
+    PUT("\t<path transform=\"translate(");
+    PUT(left);
+    PUT(",");
+    PUT(top);
+    PUT(".5)\" stroke=\"");
+    PUT(Options.dark);
+    PUT("\" d=\"");
+
+    bool first = true;
+    int x = 0;
+    int y = 0;
+    for (int row = 0; row < runs.SIZE_GETTER(); row++)
+    {
+        for (const RUN_GEOMETRY::RUN& run : runs.ROW(row))
+        {
+            // Moves are relative to the end of the previous segment
+            PUT(first ? "M" : "m");
+            PUT(run.x - x);
+            PUT(",");
+            PUT(row - y);
+            PUT("h");
+            PUT(run.length);
+            first = false;
+            x = run.x + run.length;
+            y = row;
+        }
+    }
+    PUT("\"/>\n");
+}
+
+inline void QR::SVG_STREAM::FINISH()
+{
+    if (Finished)
+        return;
+    PUT("</svg>\n");
+    DRAIN();
+    if (Gzip)
+        Gzip->FINISH();
+    Finished = true;
+}
+
+inline void QR::SVG_STREAM::WRITE(SINK& sink, const RUN_GEOMETRY& runs, const SVG_OPTIONS& options)
+{
+    int side = runs.SIZE_GETTER() + 2 * options.border;
+    SVG_STREAM svg(sink, side, side, options);
+    svg.PATH(runs, options.border, options.border);
+    svg.FINISH();
+}
+
+inline size_t QR::SVG_STREAM::SIZE_BOUND(const RUN_GEOMETRY& runs, const SVG_OPTIONS& options)
+{
+    // Header, background and path element, plus one segment per run
+    return 512 + std::strlen(options.dark) + std::strlen(options.light) + runs.COUNT_GETTER() * MAX_SEGMENT;
+}
+
+inline std::string QR::SVG_STREAM::STRING(const RUN_GEOMETRY& runs, const SVG_OPTIONS& options)
+{
+    std::string result;
+    result.reserve(options.gzip ? SIZE_BOUND(runs, options) / 4 : SIZE_BOUND(runs, options));
+    STRING_SINK sink(result);
+    WRITE(sink, runs, options);
+    return result;
+}
+
+#endif
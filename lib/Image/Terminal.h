@@ -0,0 +1,247 @@
+#ifndef TERMINAL_H
+#define TERMINAL_H
+
+#include "Sink.h"
+#include "../QRCode/MatrixView.h"
+
+#include <span>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief TERMINAL output choices.
+    */
+    struct TERMINAL_OPTIONS
+    {
+#ifdef _WIN32
+        bool unicode = false;   // Consoles start in a legacy code page, so two characters per module
+#else
+        bool unicode = true;    // Half blocks, two module rows per line; otherwise two characters per module
+#endif
+        bool color = true;      // 256-color escapes; otherwise plain characters, for logs and pipes
+        int dark = 0;           // ANSI 256-color index of dark modules
+        int light = 15;         // ANSI 256-color index of light modules and the border
+        int border = 1;         // Quiet zone, in modules
+        bool invert = false;    // Without color, draw the light modules instead of the dark ones
+    };
+
+    /**
+    * @brief Renders packed symbols as terminal text.
+    *
+    * In unicode mode each text line holds two module rows: the upper one is drawn with the
+    * foreground color and the lower one with the background color, using U+2580, U+2584, U+2588
+    * and spaces. Both colors are set once per line, so a line never contains more than one escape
+    * sequence. In the two-character mode the background escape is emitted only where the color
+    * changes. The whole frame is built in one string and handed to the sink in a single write.
+    */
+    class TERMINAL
+    {
+    public:
+        /**
+        * @throws std::domain_error if a color or the border is out of range.
+        */
+        explicit TERMINAL(const TERMINAL_OPTIONS& options = TERMINAL_OPTIONS());
+
+        /**
+        * @brief Appends the frame of a symbol to `out`, so a caller can reuse one buffer.
+        */
+        void RENDER(const MATRIX_VIEW& view, std::string& out) const;
+
+        /**
+        * @brief Returns the frame of a symbol.
+        */
+        std::string FRAME(const MATRIX_VIEW& view) const;
+
+        /**
+        * @brief Writes the frame of a symbol to a sink in a single WRITE call.
+        */
+        void WRITE(const MATRIX_VIEW& view, SINK& sink) const;
+
+        /**
+        * @brief Appends cells `first` to `last - 1` of text line `line` of a frame, without a newline.
+        *
+        * Cells are counted in modules from the left edge of the border. The colors are set before
+        * the first cell and reset after the last one, so the span can be drawn anywhere on screen.
+        */
+        void LINE(const MATRIX_VIEW& view, int line, int first, int last, std::string& out) const;
+
+        /**
+        * @brief Number of text lines in the frame of a symbol of the given size.
+        */
+        int LINES(int size) const;
+
+        /**
+        * @brief Number of module rows drawn on one text line: 2 with half blocks, 1 otherwise.
+        */
+        int ROWS_PER_LINE() const;
+
+        /**
+        * @brief Number of terminal columns one module takes: 1 with half blocks, 2 otherwise.
+        */
+        int COLUMNS_PER_MODULE() const;
+
+        /**
+        * @brief Upper bound on the length of the frame of a symbol of the given size, in bytes.
+        */
+        size_t FRAME_BOUND(int size) const;
+
+        /**
+        * @brief Returns the options the renderer was built with.
+        */
+        const TERMINAL_OPTIONS& OPTIONS_GETTER() const;
+
+    private:
+        // Whether module (x, y) of the frame, border included, is dark
+        bool DARK(const MATRIX_VIEW& view, int x, int y) const;
+
+        void HALF_BLOCKS(const MATRIX_VIEW& view, int y, int first, int last, std::string& out) const;
+
+        void CELLS(const MATRIX_VIEW& view, int y, int first, int last, std::string& out) const;
+
+        TERMINAL_OPTIONS Options;
+
+        // "\033[38;5;<dark>;48;5;<light>m", set at the start of every half block line
+        std::string Colors;
+
+        std::string DarkCell;
+
+        std::string LightCell;
+    };
+}
+
+inline QR::TERMINAL::TERMINAL(const TERMINAL_OPTIONS& options)
+    : Options(options)
+{
+    if (options.dark < 0 || options.dark > 255 || options.light < 0 || options.light > 255
+        || options.border < 0 || options.border > 64)
+        throw std::domain_error("value out of range");
+
+    Colors = "\033[38;5;" + std::to_string(options.dark) + ";48;5;" + std::to_string(options.light) + "m";
+    DarkCell = "\033[48;5;" + std::to_string(options.dark) + "m";
+    LightCell = "\033[48;5;" + std::to_string(options.light) + "m";
+}
+
+inline const QR::TERMINAL_OPTIONS& QR::TERMINAL::OPTIONS_GETTER() const
+{
+    return Options;
+}
+
+inline int QR::TERMINAL::LINES(int size) const
+{
+    int side = size + 2 * Options.border;
+    return (side + ROWS_PER_LINE() - 1) / ROWS_PER_LINE();
+}
+
+inline int QR::TERMINAL::ROWS_PER_LINE() const
+{
+    return Options.unicode ? 2 : 1;
+}
+
+inline int QR::TERMINAL::COLUMNS_PER_MODULE() const
+{
+    return Options.unicode ? 1 : 2;
+}
+
+inline size_t QR::TERMINAL::FRAME_BOUND(int size) const
+{
+    size_t side = static_cast<size_t>(size) + 2 * static_cast<size_t>(Options.border);
+    size_t lines = static_cast<size_t>(LINES(size));
+    if (Options.unicode)
+        // Three UTF-8 bytes per cell, the colors and a reset per line
+        return lines * (side * 3 + Colors.size() + 5);
+    if (Options.color)
+        // In the worst case the color changes at every module
+        return lines * (side * (DarkCell.size() + 2) + 5);
+    return lines * (side * 2 + 1);
+}
+
+inline bool QR::TERMINAL::DARK(const MATRIX_VIEW& view, int x, int y) const
+{
+    x -= Options.border;
+    y -= Options.border;
+    int size = view.SIZE_GETTER();
+    return x >= 0 && y >= 0 && x < size && y < size && view.TEST(x, y);
+}
+
+inline void QR::TERMINAL::RENDER(const MATRIX_VIEW& view, std::string& out) const
+{
+    int size = view.SIZE_GETTER();
+    int side = size + 2 * Options.border;
+    out.reserve(out.size() + FRAME_BOUND(size));
+    for (int line = 0; line < LINES(size); line++)
+    {
+        LINE(view, line, 0, side, out);
+        out += '\n';
+    }
+}
+
+inline void QR::TERMINAL::LINE(const MATRIX_VIEW& view, int line, int first, int last, std::string& out) const
+{
+    if (Options.unicode)
+        HALF_BLOCKS(view, 2 * line, first, last, out);
+    else
+        CELLS(view, line, first, last, out);
+}
+
+inline std::string QR::TERMINAL::FRAME(const MATRIX_VIEW& view) const
+{
+    std::string out;
+    RENDER(view, out);
+    return out;
+}
+
+inline void QR::TERMINAL::WRITE(const MATRIX_VIEW& view, SINK& sink) const
+{
+    std::string out = FRAME(view);
+    sink.WRITE(out.data(), out.size());
+}
+
+inline void QR::TERMINAL::HALF_BLOCKS(const MATRIX_VIEW& view, int y, int first, int last, std::string& out) const
+{
+    // Indexed by (upper << 1) | lower, where a set bit is drawn with the foreground
+    static const char* const glyphs[4] = { " ", "\xE2\x96\x84", "\xE2\x96\x80", "\xE2\x96\x88" };
+
+    // Without color the ink is whatever the terminal draws text with
+    bool flip = !Options.color && Options.invert;
+    int side = view.SIZE_GETTER() + 2 * Options.border;
+    if (Options.color)
+        out += Colors;
+    for (int x = first; x < last; x++)
+    {
+        bool upper = DARK(view, x, y) != flip;
+        bool lower = y + 1 < side && DARK(view, x, y + 1) != flip;
+        out += glyphs[(upper << 1) | lower];
+    }
+    if (Options.color)
+        out += "\033[0m";
+}
+
+inline void QR::TERMINAL::CELLS(const MATRIX_VIEW& view, int y, int first, int last, std::string& out) const
+{
+    if (Options.color)
+    {
+        // -1 until the first cell of the span, so it always sets its color
+        int current = -1;
+        for (int x = first; x < last; x++)
+        {
+            int dark = DARK(view, x, y);
+            if (dark != current)
+            {
+                out += dark ? DarkCell : LightCell;
+                current = dark;
+            }
+            out += "  ";
+        }
+        out += "\033[0m";
+    }
+    else
+    {
+        for (int x = first; x < last; x++)
+            out += DARK(view, x, y) != Options.invert ? "##" : "  ";
+    }
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef TERMINALDISPLAY_H
+#define TERMINALDISPLAY_H
+
+#include "Sink.h"
+#include "Terminal.h"
+#include "../QRCode/MatrixView.h"
+
+#include <bit>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <charconv>
+
+namespace QR
+{
+    /**
+    * @brief Keeps a symbol on screen and redraws only what changed, for codes that rotate.
+    *
+    * The display remembers the packed rows of the last symbol it drew. SHOW XORs them with the
+    * rows of the new symbol and, for every text line, redraws only the spans of cells holding a
+    * changed module, each placed with a cursor positioning escape. Spans separated by a few
+    * unchanged cells are merged, as repeating those cells is cheaper than another escape. A
+    * symbol of another size (a new version) is repainted in full. Each SHOW is one sink write.
+    */
+    class TERMINAL_DISPLAY
+    {
+    public:
+        /**
+        * @param sink The terminal; it must stay alive as long as the display.
+        * @param options How the frames are drawn, as for TERMINAL.
+        * @param row The screen line of the top of the frame, from 1.
+        * @param column The screen column of the left of the frame, from 1.
+        *
+        * @throws std::domain_error if an option or the position is out of range.
+        */
+        TERMINAL_DISPLAY(SINK& sink, const TERMINAL_OPTIONS& options = TERMINAL_OPTIONS(), int row = 1, int column = 1);
+
+        TERMINAL_DISPLAY(const TERMINAL_DISPLAY&) = delete;
+        TERMINAL_DISPLAY& operator=(const TERMINAL_DISPLAY&) = delete;
+
+        /**
+        * @brief Brings the screen up to date with a symbol.
+        *
+        * @return The number of bytes written to the sink (0 if nothing changed).
+        */
+        size_t SHOW(const MATRIX_VIEW& view);
+
+        /**
+        * @brief Forgets the screen contents, so the next SHOW repaints the whole frame.
+        */
+        void INVALIDATE();
+
+        /**
+        * @brief Moves the cursor to the line below the frame and shows it again.
+        */
+        void CLOSE();
+
+    private:
+        // Unchanged cells worth redrawing rather than starting a new span (about one escape's worth)
+        static constexpr int MERGE_GAP = 8;
+
+        // Cursor to text line `line` of the frame, at cell `x` (in modules, border included)
+        void MOVE(int line, int x);
+
+        // Blanks the previous frame, then draws every line of the new one
+        void REPAINT(const MATRIX_VIEW& view);
+
+        void UPDATE(const MATRIX_VIEW& view);
+
+        // Draws cells first to last - 1 of a text line
+        void SPAN(const MATRIX_VIEW& view, int line, int first, int last);
+
+        SINK& Out;
+
+        TERMINAL Terminal;
+
+        int Row;
+
+        int Column;
+
+        // Packed rows of the symbol on screen, `Stride` words per row
+        std::vector<std::uint64_t> Last;
+
+        // Size of the symbol on screen, -1 if the screen is unknown
+        int Size;
+
+        size_t Stride;
+
+        // Changed modules of the rows on one text line
+        std::vector<std::uint64_t> Changed;
+
+        std::string Buffer;
+    };
+}
+
+inline QR::TERMINAL_DISPLAY::TERMINAL_DISPLAY(SINK& sink, const TERMINAL_OPTIONS& options, int row, int column)
+    : Out(sink), Terminal(options), Row(row), Column(column), Size(-1), Stride(0)
+{
+    if (row < 1 || column < 1)
+        throw std::domain_error("value out of range");
+}
+
+inline void QR::TERMINAL_DISPLAY::INVALIDATE()
+{
+    Size = -1;
+}
+
+inline void QR::TERMINAL_DISPLAY::MOVE(int line, int x)
+{
+    char number[12];
+    Buffer += "\033[";
+    Buffer.append(number, std::to_chars(number, number + sizeof(number), Row + line).ptr);
+    Buffer += ';';
+    Buffer.append(number, std::to_chars(number, number + sizeof(number), Column + x * Terminal.COLUMNS_PER_MODULE()).ptr);
+    Buffer += 'H';
+}
+
+inline void QR::TERMINAL_DISPLAY::SPAN(const MATRIX_VIEW& view, int line, int first, int last)
+{
+    MOVE(line, first);
+    Terminal.LINE(view, line, first, last, Buffer);
+}
+
+inline size_t QR::TERMINAL_DISPLAY::SHOW(const MATRIX_VIEW& view)
+{
+    Buffer.clear();
+    if (view.SIZE_GETTER() != Size)
+        REPAINT(view);
+    else
+        UPDATE(view);
+
+    const std::uint64_t* words = view.DATA();
+    Size = view.SIZE_GETTER();
+    Stride = view.STRIDE_GETTER();
+    Last.assign(words, words + static_cast<size_t>(Size) * Stride);
+
+    if (Buffer.empty())
+        return 0;
+    Out.WRITE(Buffer.data(), Buffer.size());
+    Out.FLUSH();
+    return Buffer.size();
+}
+
+inline void QR::TERMINAL_DISPLAY::REPAINT(const MATRIX_VIEW& view)
+{
+    const TERMINAL_OPTIONS& options = Terminal.OPTIONS_GETTER();
+
+    // Hide the cursor, and blank what is left of a previous frame
+    Buffer += "\033[?25l";
+    if (Size >= 0)
+    {
+        size_t width = static_cast<size_t>(Size + 2 * options.border) * Terminal.COLUMNS_PER_MODULE();
+        for (int line = 0; line < Terminal.LINES(Size); line++)
+        {
+            MOVE(line, 0);
+            Buffer += "\033[0m";
+            Buffer.append(width, ' ');
+        }
+    }
+
+    int side = view.SIZE_GETTER() + 2 * options.border;
+    for (int line = 0; line < Terminal.LINES(view.SIZE_GETTER()); line++)
+        SPAN(view, line, 0, side);
+}
+
+inline void QR::TERMINAL_DISPLAY::UPDATE(const MATRIX_VIEW& view)
+{
+    int border = Terminal.OPTIONS_GETTER().border;
+    int rows = Terminal.ROWS_PER_LINE();
+    const std::uint64_t* words = view.DATA();
+    size_t stride = view.STRIDE_GETTER();
+
+    for (int line = 0; line < Terminal.LINES(Size); line++)
+    {
+        // XOR of the old and new rows drawn on this line; the border never changes
+        Changed.assign(stride, 0);
+        bool any = false;
+        for (int r = 0; r < rows; r++)
+        {
+            int y = line * rows + r - border;
+            if (y < 0 || y >= Size)
+                continue;
+            const std::uint64_t* now = words + static_cast<size_t>(y) * stride;
+            const std::uint64_t* then = Last.data() + static_cast<size_t>(y) * Stride;
+            for (size_t w = 0; w < stride; w++)
+            {
+                Changed[w] |= now[w] ^ then[w];
+                any |= Changed[w] != 0;
+            }
+        }
+        if (!any)
+            continue;
+
+        // Spans of changed modules, found a word at a time, merged across short gaps
+        int first = -1;
+        int last = -1;
+        for (size_t w = 0; w < stride; w++)
+        {
+            std::uint64_t bits = Changed[w];
+            while (bits != 0)
+            {
+                int offset = std::countl_zero(bits);
+                int start = static_cast<int>(w * 64) + offset;
+                std::uint64_t rest = ~bits << offset;
+                int length = rest == 0 ? 64 - offset : std::countl_zero(rest);
+                bits = offset + length < 64 ? bits & (~0ULL >> (offset + length)) : 0;
+
+                if (first >= 0 && start - last <= MERGE_GAP)
+                {
+                    last = start + length;
+                    continue;
+                }
+                if (first >= 0)
+                    SPAN(view, line, first + border, last + border);
+                first = start;
+                last = start + length;
+            }
+        }
+        SPAN(view, line, first + border, last + border);
+    }
+}
+
+inline void QR::TERMINAL_DISPLAY::CLOSE()
+{
+    Buffer.clear();
+    if (Size >= 0)
+        MOVE(Terminal.LINES(Size), 0);
+    Buffer += "\033[0m\033[?25h";
+    Out.WRITE(Buffer.data(), Buffer.size());
+    Out.FLUSH();
+}
+
+#endif
@@ -0,0 +1,248 @@
+#ifndef TERMINALGRAPHICS_H
+#define TERMINALGRAPHICS_H
+
+#include "Sink.h"
+#include "Raster.h"
+#include "Base64.h"
+#include "PngStream.h"
+#include "../QRCode/MatrixView.h"
+
+#include <string>
+#include <cstdlib>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief Ways of showing an image in a terminal.
+    */
+    enum class TERMINAL_PROTOCOL
+    {
+        TEXT,       // No graphics: TERMINAL's half blocks or cells
+        SIXEL,      // DEC Sixel (xterm -ti vt340, foot, mlterm, WezTerm, iTerm2, ...)
+        KITTY       // kitty graphics protocol (kitty, Ghostty, WezTerm, Konsole, ...)
+    };
+
+    /**
+    * @brief Sends symbols to terminals as bitmaps, at a chosen pixel scale.
+    *
+    * Sixel output is built straight from the packed module rows: each band of six pixel rows
+    * holds at most two module rows per scale, every module column becomes one sixel character
+    * repeated `scale` times, and equal neighbours are merged into a single "!count" repeat, so a
+    * band costs a few bytes per module run whatever the scale. Only two color registers are
+    * defined. kitty output is the 1-bit PNG of PNG_STREAM, base64 encoded in KITTY_CHUNK pieces;
+    * the terminal scales nothing and the transfer is a few hundred bytes for most symbols.
+    */
+    class TERMINAL_GRAPHICS
+    {
+    public:
+        /**
+        * @brief Guesses the protocol of the terminal on standard output from the environment.
+        *
+        * Returns TEXT when standard output is not a terminal or the terminal is not known to
+        * support either protocol; terminals are not queried, so nothing is read from the input.
+        */
+        static TERMINAL_PROTOCOL DETECT();
+
+        /**
+        * @brief Writes a symbol as one Sixel image, followed by a line feed.
+        *
+        * The raster's format is ignored; its scale, border and colors are used.
+        */
+        static void SIXEL(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster);
+
+        /**
+        * @brief Writes a symbol as a kitty graphics image (a 1-bit PNG), followed by a line feed.
+        *
+        * The raster's format is ignored; its scale, border and colors are used.
+        */
+        static void KITTY(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster);
+
+        // Base64 bytes per kitty escape, the protocol's limit
+        static constexpr size_t KITTY_CHUNK = 4096;
+
+    private:
+        /**
+        * @brief Value of an environment variable, or an empty string.
+        */
+        static std::string ENVIRONMENT(const char* name);
+
+        /**
+        * @brief Appends `count` copies of a sixel character, as a repeat when shorter.
+        */
+        static void SIXEL_RUN(char sixel, size_t count, std::string& out);
+
+        /**
+        * @brief Appends a color register definition, in the percent RGB space of Sixel.
+        */
+        static void SIXEL_COLOR(int index, RASTER::COLOR color, std::string& out);
+    };
+}
+
+inline std::string QR::TERMINAL_GRAPHICS::ENVIRONMENT(const char* name)
+{
+#ifdef _MSC_VER
+    char* value = nullptr;
+    size_t length = 0;
+    std::string result;
+    if (_dupenv_s(&value, &length, name) == 0 && value != nullptr)
+        result = value;
+    std::free(value);
+    return result;
+#else
+    const char* value = std::getenv(name);
+    return value != nullptr ? std::string(value) : std::string();
+#endif
+}
+
+inline QR::TERMINAL_PROTOCOL QR::TERMINAL_GRAPHICS::DETECT()
+{
+#ifdef _WIN32
+    if (!_isatty(1))
+        return TERMINAL_PROTOCOL::TEXT;
+#else
+    if (!isatty(1))
+        return TERMINAL_PROTOCOL::TEXT;
+#endif
+
+    const std::string term = ENVIRONMENT("TERM");
+    const std::string program = ENVIRONMENT("TERM_PROGRAM");
+
+    // Multiplexers pass neither protocol through by default
+    if (!ENVIRONMENT("TMUX").empty() || term.rfind("screen", 0) == 0)
+        return TERMINAL_PROTOCOL::TEXT;
+
+    if (!ENVIRONMENT("KITTY_WINDOW_ID").empty() || term == "xterm-kitty" || term == "xterm-ghostty"
+        || program == "ghostty" || program == "WezTerm" || !ENVIRONMENT("KONSOLE_VERSION").empty())
+        return TERMINAL_PROTOCOL::KITTY;
+
+    if (term.find("sixel") != std::string::npos || term == "foot" || term == "foot-extra"
+        || term.rfind("mlterm", 0) == 0 || term == "contour" || term == "yaft-256color"
+        || program == "iTerm.app" || program == "mintty")
+        return TERMINAL_PROTOCOL::SIXEL;
+
+    return TERMINAL_PROTOCOL::TEXT;
+}
+
+inline void QR::TERMINAL_GRAPHICS::SIXEL_RUN(char sixel, size_t count, std::string& out)
+{
+    if (count > 3)
+    {
+        out += '!';
+        out += std::to_string(count);
+        out += sixel;
+    }
+    else
+        out.append(count, sixel);
+}
+
+inline void QR::TERMINAL_GRAPHICS::SIXEL_COLOR(int index, RASTER::COLOR color, std::string& out)
+{
+    out += '#';
+    out += std::to_string(index);
+    out += ";2";
+    for (int channel : { color.r, color.g, color.b })
+    {
+        out += ';';
+        out += std::to_string((channel * 100 + 127) / 255);
+    }
+}
+
+inline void QR::TERMINAL_GRAPHICS::SIXEL(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster)
+{
+    const int size = view.SIZE_GETTER();
+    const int border = raster.BORDER_GETTER();
+    const int scale = raster.SCALE_GETTER();
+    const int side = size + 2 * border;
+    const int pixels = raster.PIXELS(size);
+
+    // 1:1 pixels, the background left alone; both colors are painted explicitly
+    std::string out = "\033P0;1;0q\"1;1;" + std::to_string(pixels) + ";" + std::to_string(pixels);
+    SIXEL_COLOR(0, raster.LIGHT_GETTER(), out);
+    SIXEL_COLOR(1, raster.DARK_GETTER(), out);
+
+    std::string band;
+    for (int top = 0; top < pixels; top += 6)
+    {
+        const int rows = std::min(6, pixels - top);
+        const int full = (1 << rows) - 1;
+        bool anyDark = false;
+
+        for (int color = 0; color < 2; color++)
+        {
+            band.clear();
+            char current = 0;
+            size_t count = 0;
+            for (int x = 0; x < side; x++)
+            {
+                int bits = 0;
+                if (x >= border && x < border + size)
+                {
+                    for (int r = 0; r < rows; r++)
+                    {
+                        int y = (top + r) / scale - border;
+                        if (y >= 0 && y < size && MATRIX_VIEW::TEST(view.ROW(y), x - border))
+                            bits |= 1 << r;
+                    }
+                }
+                if (color == 0)
+                    bits = ~bits & full;
+                else
+                    anyDark = anyDark || bits != 0;
+
+                char sixel = static_cast<char>(63 + bits);
+                if (sixel != current && count > 0)
+                {
+                    SIXEL_RUN(current, count, band);
+                    count = 0;
+                }
+                current = sixel;
+                count += static_cast<size_t>(scale);
+            }
+
+            // Trailing empty sixels draw nothing
+            if (current != '?')
+                SIXEL_RUN(current, count, band);
+            if (color == 1 && !anyDark)
+                break;
+            if (color == 1)
+                out += '$';
+            out += color == 0 ? "#0" : "#1";
+            out += band;
+        }
+        if (top + 6 < pixels)
+            out += '-';
+    }
+    out += "\033\\\n";
+    sink.WRITE(out.data(), out.size());
+    sink.FLUSH();
+}
+
+inline void QR::TERMINAL_GRAPHICS::KITTY(SINK& sink, const MATRIX_VIEW& view, const RASTER& raster)
+{
+    const RASTER mono(RASTER::FORMAT::MONO1, raster.SCALE_GETTER(), raster.BORDER_GETTER(),
+        raster.DARK_GETTER(), raster.LIGHT_GETTER());
+    std::string png;
+    STRING_SINK pngSink(png);
+    PNG_STREAM::WRITE(pngSink, view, mono, PNG_OPTIONS());
+
+    // Transmit and display, PNG data, no replies; every escape but the last has m=1
+    constexpr size_t bytes = KITTY_CHUNK / 4 * 3;
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(png.data());
+    std::string out;
+    for (size_t offset = 0; offset < png.size(); offset += bytes)
+    {
+        bool last = offset + bytes >= png.size();
+        out += offset == 0 ? "\033_Ga=T,f=100,q=2," : "\033_G";
+        out += last ? "m=0;" : "m=1;";
+        BASE64::ENCODE(data + offset, std::min(bytes, png.size() - offset), out);
+        out += "\033\\";
+    }
+    out += '\n';
+    sink.WRITE(out.data(), out.size());
+    sink.FLUSH();
+}
+
+#endif
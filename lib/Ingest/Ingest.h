@@ -0,0 +1,951 @@
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "MappedFile.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+
+namespace QR
+{
+    /**
+    * @brief How the records of an input file are laid out.
+    */
+    enum class INGEST_FORMAT
+    {
+        LINES,      // One payload per line; a trailing carriage return is dropped
+        NUL,        // One payload per NUL-terminated record (find -print0, xargs -0)
+        CSV,        // Comma-separated values (RFC 4180): quoted fields may hold separators, quotes and line feeds
+        NDJSON      // One JSON object per line; the payload is one of its members
+    };
+
+    /**
+    * @brief INGEST choices.
+    */
+    struct INGEST_OPTIONS
+    {
+        INGEST_FORMAT format = INGEST_FORMAT::LINES;
+        std::string field;              // CSV: column name, or number from 0 (default 0); NDJSON: member name
+        bool header = true;             // CSV: the first record names the columns and is no payload
+        char separator = ',';           // CSV: field separator
+        int threads = 0;                // Workers; 0 for one per core
+        std::uint64_t chunk = 64 << 20; // Largest piece of the file a worker takes at a time, in bytes
+        int shard = 0;                  // The part of the file this process reads, 0 to shards - 1
+        int shards = 1;                 // Parts the file is split into, one per machine
+        std::string checkpoint;         // File recording progress, read back to resume; empty for none
+        double interval = 2;            // Seconds between checkpoints
+
+        // Called before each checkpoint is saved; makes the output of every record delivered so
+        // far durable (flushes a sink), as the checkpoint will say those records are done
+        std::function<void()> commit;
+    };
+
+    /**
+    * @brief What INGEST::RUN did.
+    */
+    struct INGEST_STATS
+    {
+        std::uint64_t records;      // Payloads delivered
+        std::uint64_t skipped;      // Records without the field, or with an empty one
+        std::uint64_t bytes;        // Input bytes read by this run
+        std::uint64_t resumed;      // Input bytes done by earlier runs, according to the checkpoint
+        double parse;               // Worker seconds spent finding records and fields
+        double seconds;
+        bool complete;              // False if STOP or an error ended the run early
+    };
+
+    /**
+    * @brief Reads the payloads of a large CSV, NDJSON or line file in parallel, resumably.
+    *
+    * The file is mapped, not read: payloads are handed out as views into the mapping, so a
+    * record is never copied unless its field has to be unescaped (a CSV field with doubled
+    * quotes, a JSON string with backslashes), which happens in a buffer of the worker. A view
+    * is valid until the callback returns.
+    *
+    * The file is cut into shards of equal size, each moved forward to the next record start so
+    * that every record belongs to exactly one shard. The cut depends only on the file and the
+    * shard count, so N machines given the same file and "shard i of N" read disjoint records
+    * that together are the whole file, without talking to each other. Inside its shard a
+    * process cuts again into chunks, which the workers take one at a time. In CSV a line feed
+    * ends a record only outside quotes; whether a position is quoted is known from the parity
+    * of the quotes before it, which is counted once, in parallel, when the file is cut.
+    *
+    * Each chunk keeps the offset of its first record not yet delivered. Every `interval`
+    * seconds RUN calls `commit` and then saves those offsets to the checkpoint file (by
+    * writing a new file and renaming it over the old). A run started with the same file,
+    * shard and checkpoint skips what the checkpoint says is done, so after a crash a record is
+    * delivered again only if it came after the last checkpoint: delivery is at least once.
+    * Records are identified by their byte offset in the file, which does not change between
+    * runs or machines.
+    */
+    class INGEST
+    {
+    public:
+        /**
+        * @brief Called once per payload, from several workers at once.
+        *
+        * @param offset Offset of the record in the file, a stable identifier.
+        */
+        using RECORD = std::function<void(std::uint64_t offset, std::string_view payload)>;
+
+        /**
+        * @brief Maps the file and finds this shard's records, or reads the checkpoint.
+        *
+        * @throws std::domain_error if an option is out of range.
+        * @throws std::invalid_argument if the CSV column or NDJSON member is missing or unknown.
+        * @throws std::runtime_error if the file cannot be mapped, or the checkpoint belongs to
+        * another file or shard.
+        */
+        explicit INGEST(const std::string& path, const INGEST_OPTIONS& options = INGEST_OPTIONS());
+
+        INGEST(const INGEST&) = delete;
+        INGEST& operator=(const INGEST&) = delete;
+
+        /**
+        * @brief Delivers every payload not done yet, then saves a final checkpoint.
+        *
+        * An exception from `record` stops the workers; the checkpoint is saved without the
+        * failed record and the exception is rethrown, so a resumed run meets the record again.
+        * A record that can never succeed (a payload too long to encode) should be dealt with in
+        * `record`, which then returns: the record is done.
+        */
+        INGEST_STATS RUN(const RECORD& record);
+
+        /**
+        * @brief Asks the workers to stop after their current record; safe in a signal handler.
+        */
+        void STOP();
+
+        /**
+        * @brief First byte of this shard's records.
+        */
+        std::uint64_t BEGIN_GETTER() const;
+
+        /**
+        * @brief End of this shard's records.
+        */
+        std::uint64_t END_GETTER() const;
+
+        /**
+        * @brief Whether `payload` is a view into the mapping, valid as long as the INGEST is,
+        * rather than into a worker's buffer, valid only until the callback returns.
+        */
+        bool MAPPED(std::string_view payload) const;
+
+    private:
+        struct CHUNK
+        {
+            std::uint64_t start;
+            std::uint64_t end;
+            std::atomic<std::uint64_t> done;    // Start of the first record not delivered
+        };
+
+        struct WORKER_STATS
+        {
+            std::uint64_t records = 0;
+            std::uint64_t skipped = 0;
+            double parse = 0;
+        };
+
+        /**
+        * @brief Quote characters in [from, to), counted by all workers.
+        */
+        std::uint64_t QUOTES(std::uint64_t from, std::uint64_t to) const;
+
+        /**
+        * @brief The first record start at or after `offset`.
+        *
+        * @param quoted Whether `offset` is inside a quoted CSV field.
+        */
+        std::uint64_t RECORD_START(std::uint64_t offset, bool quoted) const;
+
+        /**
+        * @brief Offset `part` of `parts` of the way from `begin` to `end`, without overflow.
+        */
+        static std::uint64_t POINT(std::uint64_t begin, std::uint64_t end, std::uint64_t part, std::uint64_t parts);
+
+        /**
+        * @brief Cuts the shard into chunks of at most `chunk` bytes, at least four per worker.
+        */
+        void SPLIT();
+
+        /**
+        * @brief Takes the chunks and their progress from the checkpoint, if it exists.
+        */
+        bool LOAD();
+
+        void SAVE(const std::vector<std::uint64_t>& done) const;
+
+        /**
+        * @brief Snapshots the progress, commits the output it covers and saves it.
+        */
+        void CHECKPOINT();
+
+        void WORK(const RECORD& record, std::atomic<size_t>& next, WORKER_STATS& stats);
+
+        /**
+        * @brief Finds the record at `p` and its payload.
+        *
+        * @return The start of the next record; `found` tells whether the record had a payload,
+        * and `empty` whether it was a blank line, which is not counted as skipped.
+        */
+        const char* NEXT(const char* p, const char* end, std::string_view& payload, bool& found,
+            bool& empty, std::string& scratch) const;
+
+        /**
+        * @brief Parses the CSV record at `p`, keeping field `column`.
+        *
+        * @return The start of the next record.
+        */
+        static const char* CSV_RECORD(const char* p, const char* end, size_t column, char separator,
+            std::string_view& field, bool& found, std::string& scratch);
+
+        /**
+        * @brief Finds member `name` of the JSON object in `line`: a string, a number or a boolean.
+        */
+        static bool JSON_MEMBER(std::string_view line, std::string_view name, std::string_view& value,
+            std::string& scratch);
+
+        /**
+        * @brief Decodes the backslash escapes of a JSON string body into `out`.
+        */
+        static bool JSON_UNESCAPE(std::string_view raw, std::string& out);
+
+        /**
+        * @brief End of the JSON string whose body starts at `p`: its closing quote, or `end`.
+        */
+        static const char* JSON_STRING_END(const char* p, const char* end, bool& escaped);
+
+        /**
+        * @brief Skips the JSON value at `p`, including nested objects and arrays.
+        */
+        static const char* JSON_SKIP(const char* p, const char* end);
+
+        MAPPED_FILE File;
+
+        INGEST_OPTIONS Options;
+
+        int Workers;
+
+        char Delimiter;
+
+        size_t Column;
+
+        std::uint64_t Begin;
+
+        std::uint64_t End;
+
+        std::unique_ptr<CHUNK[]> Chunks;
+
+        size_t ChunkCount;
+
+        std::atomic<bool> Stopped;
+    };
+}
+
+inline QR::INGEST::INGEST(const std::string& path, const INGEST_OPTIONS& options)
+    : File(path), Options(options), Workers(options.threads), Delimiter('\n'), Column(0),
+    Begin(0), End(0), ChunkCount(0), Stopped(false)
+{
+    if (options.threads < 0 || options.chunk == 0 || options.shards < 1 || options.shard < 0
+        || options.shard >= options.shards || !(options.interval > 0))
+        throw std::domain_error("value out of range");
+
+    if (Workers == 0)
+        Workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    if (options.format == INGEST_FORMAT::NUL)
+        Delimiter = '\0';
+    if (options.format == INGEST_FORMAT::NDJSON && options.field.empty())
+        throw std::invalid_argument("NDJSON member name missing");
+    File.SEQUENTIAL();
+
+    const char* data = File.DATA();
+    const std::uint64_t size = File.SIZE_GETTER();
+    const bool csv = options.format == INGEST_FORMAT::CSV;
+
+    // The CSV column, by number or by its name in the header
+    std::uint64_t first = 0;
+    if (csv)
+    {
+        bool numbered = !options.field.empty() && options.field.size() < 10
+            && std::all_of(options.field.begin(), options.field.end(), [](char c) { return c >= '0' && c <= '9'; });
+        if (numbered)
+            Column = static_cast<size_t>(std::stoul(options.field));
+        else if (!options.field.empty() && !options.header)
+            throw std::invalid_argument("CSV column must be a number without a header");
+
+        if (options.header && size > 0)
+        {
+            std::string_view name;
+            std::string scratch;
+            bool found = true;
+            const char* next = data;
+            for (size_t column = 0; found; column++)
+            {
+                next = CSV_RECORD(data, data + size, column, options.separator, name, found, scratch);
+                if (!numbered && !options.field.empty() && found && name == options.field)
+                {
+                    Column = column;
+                    numbered = true;
+                }
+            }
+            first = static_cast<std::uint64_t>(next - data);
+        }
+        if (!numbered && !options.field.empty())
+            throw std::invalid_argument("CSV column not found");
+    }
+
+    // This process's shard; a quote count tells whether its ends are quoted
+    std::uint64_t from = POINT(0, size, static_cast<std::uint64_t>(options.shard), static_cast<std::uint64_t>(options.shards));
+    std::uint64_t to = POINT(0, size, static_cast<std::uint64_t>(options.shard) + 1, static_cast<std::uint64_t>(options.shards));
+    std::uint64_t before = csv ? QUOTES(0, from) : 0;
+    std::uint64_t inside = csv ? QUOTES(from, to) : 0;
+    Begin = std::max(first, RECORD_START(from, (before & 1) != 0));
+    End = std::max(Begin, RECORD_START(to, ((before + inside) & 1) != 0));
+
+    if (Options.checkpoint.empty() || !LOAD())
+        SPLIT();
+}
+
+inline std::uint64_t QR::INGEST::POINT(std::uint64_t begin, std::uint64_t end, std::uint64_t part, std::uint64_t parts)
+{
+    const std::uint64_t length = end - begin;
+    return begin + length / parts * part + length % parts * part / parts;
+}
+
+inline std::uint64_t QR::INGEST::QUOTES(std::uint64_t from, std::uint64_t to) const
+{
+    const char* data = File.DATA();
+    auto count = [data](std::uint64_t a, std::uint64_t b)
+        {
+            return static_cast<std::uint64_t>(std::count(data + a, data + b, '"'));
+        };
+    if (to <= from)
+        return 0;
+    if (to - from < (std::uint64_t(16) << 20) || Workers == 1)
+        return count(from, to);
+
+    std::vector<std::future<std::uint64_t>> parts;
+    for (int w = 0; w < Workers; w++)
+        parts.push_back(std::async(std::launch::async, count,
+            POINT(from, to, static_cast<std::uint64_t>(w), static_cast<std::uint64_t>(Workers)),
+            POINT(from, to, static_cast<std::uint64_t>(w) + 1, static_cast<std::uint64_t>(Workers))));
+    std::uint64_t total = 0;
+    for (auto& part : parts)
+        total += part.get();
+    return total;
+}
+
+inline std::uint64_t QR::INGEST::RECORD_START(std::uint64_t offset, bool quoted) const
+{
+    const char* data = File.DATA();
+    const std::uint64_t size = File.SIZE_GETTER();
+    if (offset == 0 || offset >= size)
+        return std::min(offset, size);
+
+    // A record starts after a delimiter outside quotes; start looking at the byte before `offset`
+    std::uint64_t i = offset - 1;
+    if (Options.format != INGEST_FORMAT::CSV)
+    {
+        const void* found = std::memchr(data + i, Delimiter, static_cast<size_t>(size - i));
+        return found != nullptr ? static_cast<std::uint64_t>(static_cast<const char*>(found) - data) + 1 : size;
+    }
+
+    bool inside = quoted != (data[i] == '"');
+    for (; i < size; i++)
+    {
+        if (data[i] == '"')
+            inside = !inside;
+        else if (data[i] == '\n' && !inside)
+            return i + 1;
+    }
+    return size;
+}
+
+inline void QR::INGEST::SPLIT()
+{
+    const std::uint64_t length = End - Begin;
+    std::uint64_t parts = std::max<std::uint64_t>(static_cast<std::uint64_t>(Workers) * 4, (length + Options.chunk - 1) / Options.chunk);
+    // Not much below 64 KiB a chunk, where the bookkeeping would outweigh the work
+    parts = std::max<std::uint64_t>(1, std::min(parts, length / 65536 + 1));
+
+    const bool csv = Options.format == INGEST_FORMAT::CSV;
+    std::vector<std::uint64_t> points = { Begin };
+    std::uint64_t quotes = 0;
+    std::uint64_t previous = Begin;
+    for (std::uint64_t part = 1; part < parts; part++)
+    {
+        std::uint64_t nominal = POINT(Begin, End, part, parts);
+        if (csv)
+        {
+            // Begin is outside quotes, so only the quotes since then matter
+            quotes += QUOTES(previous, nominal);
+            previous = nominal;
+        }
+        std::uint64_t start = std::min(End, RECORD_START(nominal, (quotes & 1) != 0));
+        if (start > points.back())
+            points.push_back(start);
+    }
+    if (End > points.back() || points.size() == 1)
+        points.push_back(End);
+
+    ChunkCount = points.size() - 1;
+    Chunks.reset(new CHUNK[ChunkCount]);
+    for (size_t c = 0; c < ChunkCount; c++)
+    {
+        Chunks[c].start = points[c];
+        Chunks[c].end = points[c + 1];
+        Chunks[c].done.store(points[c], std::memory_order_relaxed);
+    }
+}
+
+inline bool QR::INGEST::LOAD()
+{
+    std::ifstream in(Options.checkpoint);
+    if (!in)
+        return false;
+
+    std::string magic;
+    int version = 0;
+    std::uint64_t size = 0, begin = 0, end = 0;
+    int shard = -1, shards = 0, format = -1;
+    size_t count = 0;
+    in >> magic >> version >> size >> shard >> shards >> format >> begin >> end >> count;
+    if (!in || magic != "QRINGEST" || version != 1 || size != File.SIZE_GETTER() || shard != Options.shard
+        || shards != Options.shards || format != static_cast<int>(Options.format) || begin != Begin || end != End
+        || count == 0 || count > (size_t(1) << 24))
+        throw std::runtime_error("Checkpoint does not match the input");
+
+    std::unique_ptr<CHUNK[]> chunks(new CHUNK[count]);
+    std::uint64_t previous = Begin;
+    for (size_t c = 0; c < count; c++)
+    {
+        std::uint64_t start = 0, stop = 0, done = 0;
+        in >> start >> stop >> done;
+        if (!in || start != previous || start > done || done > stop || stop > End)
+            throw std::runtime_error("Checkpoint does not match the input");
+        chunks[c].start = start;
+        chunks[c].end = stop;
+        chunks[c].done.store(done, std::memory_order_relaxed);
+        previous = stop;
+    }
+    if (previous != End)
+        throw std::runtime_error("Checkpoint does not match the input");
+
+    Chunks = std::move(chunks);
+    ChunkCount = count;
+    return true;
+}
+
+inline void QR::INGEST::SAVE(const std::vector<std::uint64_t>& done) const
+{
+    const std::string temporary = Options.checkpoint + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        out << "QRINGEST 1\n" << File.SIZE_GETTER() << ' ' << Options.shard << ' ' << Options.shards << ' '
+            << static_cast<int>(Options.format) << ' ' << Begin << ' ' << End << ' ' << ChunkCount << '\n';
+        for (size_t c = 0; c < ChunkCount; c++)
+            out << Chunks[c].start << ' ' << Chunks[c].end << ' ' << done[c] << '\n';
+        out.flush();
+        if (!out)
+            throw std::runtime_error("Write failed");
+    }
+
+    // A reader sees the old checkpoint or the new one, never half of one
+    std::error_code error;
+    std::filesystem::rename(temporary, Options.checkpoint, error);
+    if (error)
+        throw std::runtime_error("Write failed");
+}
+
+inline void QR::INGEST::CHECKPOINT()
+{
+    if (Options.checkpoint.empty())
+        return;
+
+    // Snapshot first: what is committed next covers at least these records
+    std::vector<std::uint64_t> done(ChunkCount);
+    for (size_t c = 0; c < ChunkCount; c++)
+        done[c] = Chunks[c].done.load(std::memory_order_acquire);
+    if (Options.commit)
+        Options.commit();
+    SAVE(done);
+}
+
+inline const char* QR::INGEST::NEXT(const char* p, const char* end, std::string_view& payload, bool& found,
+    bool& empty, std::string& scratch) const
+{
+    if (Options.format == INGEST_FORMAT::CSV)
+    {
+        empty = *p == '\n' || (*p == '\r' && p + 1 < end && p[1] == '\n');
+        const char* next = CSV_RECORD(p, end, Column, Options.separator, payload, found, scratch);
+        found = found && !payload.empty();
+        return next;
+    }
+
+    const void* delimiter = std::memchr(p, Delimiter, static_cast<size_t>(end - p));
+    const char* stop = delimiter != nullptr ? static_cast<const char*>(delimiter) : end;
+    const char* next = delimiter != nullptr ? stop + 1 : end;
+    std::string_view line(p, static_cast<size_t>(stop - p));
+    if (Options.format != INGEST_FORMAT::NUL && !line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+
+    if (Options.format == INGEST_FORMAT::NDJSON)
+    {
+        empty = line.find_first_not_of(" \t") == std::string_view::npos;
+        found = !empty && JSON_MEMBER(line, Options.field, payload, scratch) && !payload.empty();
+    }
+    else
+    {
+        empty = line.empty();
+        found = !empty;
+        payload = line;
+    }
+    return next;
+}
+
+inline const char* QR::INGEST::CSV_RECORD(const char* p, const char* end, size_t column, char separator,
+    std::string_view& field, bool& found, std::string& scratch)
+{
+    found = false;
+    for (size_t index = 0;; index++)
+    {
+        if (p < end && *p == '"')
+        {
+            // Quoted: up to the quote not followed by another; doubled quotes stand for one
+            const char* q = p + 1;
+            bool doubled = false;
+            for (;;)
+            {
+                const void* quote = std::memchr(q, '"', static_cast<size_t>(end - q));
+                if (quote == nullptr)
+                {
+                    q = end;
+                    break;
+                }
+                q = static_cast<const char*>(quote);
+                if (q + 1 < end && q[1] == '"')
+                {
+                    doubled = true;
+                    q += 2;
+                    continue;
+                }
+                break;
+            }
+
+            if (index == column)
+            {
+                found = true;
+                field = std::string_view(p + 1, static_cast<size_t>(q - p - 1));
+                if (doubled)
+                {
+                    scratch.clear();
+                    for (size_t i = 0; i < field.size(); i++)
+                    {
+                        scratch += field[i];
+                        if (field[i] == '"')
+                            i++;
+                    }
+                    field = scratch;
+                }
+            }
+
+            // Anything between the closing quote and the separator is ignored
+            p = q < end ? q + 1 : end;
+            while (p < end && *p != separator && *p != '\n')
+                p++;
+        }
+        else
+        {
+            const char* q = p;
+            while (q < end && *q != separator && *q != '\n')
+                q++;
+            if (index == column)
+            {
+                found = true;
+                field = std::string_view(p, static_cast<size_t>(q - p));
+                if ((q == end || *q == '\n') && !field.empty() && field.back() == '\r')
+                    field.remove_suffix(1);
+            }
+            p = q;
+        }
+
+        if (p >= end)
+            return end;
+        if (*p == '\n')
+            return p + 1;
+        p++;
+    }
+}
+
+inline const char* QR::INGEST::JSON_STRING_END(const char* p, const char* end, bool& escaped)
+{
+    escaped = false;
+    while (p < end && *p != '"')
+    {
+        if (*p == '\\')
+        {
+            escaped = true;
+            p++;
+        }
+        p++;
+    }
+    return std::min(p, end);
+}
+
+inline const char* QR::INGEST::JSON_SKIP(const char* p, const char* end)
+{
+    int depth = 0;
+    bool escaped;
+    while (p < end)
+    {
+        char c = *p;
+        if (c == '"')
+        {
+            p = JSON_STRING_END(p + 1, end, escaped);
+            if (p < end)
+                p++;
+            if (depth == 0)
+                return p;
+            continue;
+        }
+        if (c == '{' || c == '[')
+            depth++;
+        else if (c == '}' || c == ']')
+        {
+            if (depth == 0)
+                return p;
+            if (--depth == 0)
+                return p + 1;
+        }
+        else if (depth == 0 && (c == ',' || c == ' ' || c == '\t'))
+            return p;
+        p++;
+    }
+    return end;
+}
+
+inline bool QR::INGEST::JSON_UNESCAPE(std::string_view raw, std::string& out)
+{
+    auto hex = [](const char* h, std::uint32_t& value)
+        {
+            value = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                char c = h[i];
+                int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                if (digit < 0)
+                    return false;
+                value = value << 4 | static_cast<std::uint32_t>(digit);
+            }
+            return true;
+        };
+
+    out.clear();
+    for (size_t i = 0; i < raw.size(); i++)
+    {
+        if (raw[i] != '\\')
+        {
+            out += raw[i];
+            continue;
+        }
+        if (++i >= raw.size())
+            return false;
+        switch (raw[i])
+        {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+            std::uint32_t code;
+            if (i + 4 >= raw.size() || !hex(raw.data() + i + 1, code))
+                return false;
+            i += 4;
+
+            // A high surrogate needs the low one after it
+            if (code >= 0xD800 && code < 0xDC00)
+            {
+                std::uint32_t low;
+                if (i + 6 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !hex(raw.data() + i + 3, low)
+                    || low < 0xDC00 || low >= 0xE000)
+                    return false;
+                i += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (code >= 0xDC00 && code < 0xE000)
+                return false;
+
+            // UTF-8
+            if (code < 0x80)
+                out += static_cast<char>(code);
+            else if (code < 0x800)
+            {
+                out += static_cast<char>(0xC0 | code >> 6);
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000)
+            {
+                out += static_cast<char>(0xE0 | code >> 12);
+                out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            else
+            {
+                out += static_cast<char>(0xF0 | code >> 18);
+                out += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+                out += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool QR::INGEST::JSON_MEMBER(std::string_view line, std::string_view name, std::string_view& value,
+    std::string& scratch)
+{
+    const char* p = line.data();
+    const char* end = p + line.size();
+    auto space = [&]()
+        {
+            while (p < end && (*p == ' ' || *p == '\t'))
+                p++;
+        };
+
+    space();
+    if (p >= end || *p != '{')
+        return false;
+    p++;
+
+    bool escaped;
+    for (;;)
+    {
+        space();
+        if (p >= end || *p != '"')
+            return false;
+        const char* key = p + 1;
+        p = JSON_STRING_END(key, end, escaped);
+        if (p >= end)
+            return false;
+        std::string_view raw(key, static_cast<size_t>(p - key));
+        bool match = escaped ? JSON_UNESCAPE(raw, scratch) && scratch == name : raw == name;
+        p++;
+
+        space();
+        if (p >= end || *p != ':')
+            return false;
+        p++;
+        space();
+        if (p >= end)
+            return false;
+
+        if (match)
+        {
+            if (*p == '"')
+            {
+                const char* body = p + 1;
+                p = JSON_STRING_END(body, end, escaped);
+                if (p >= end)
+                    return false;
+                value = std::string_view(body, static_cast<size_t>(p - body));
+                if (!escaped)
+                    return true;
+                if (!JSON_UNESCAPE(value, scratch))
+                    return false;
+                value = scratch;
+                return true;
+            }
+            if (*p == '{' || *p == '[')
+                return false;
+
+            // Numbers and booleans as written
+            const char* token = p;
+            while (p < end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t')
+                p++;
+            value = std::string_view(token, static_cast<size_t>(p - token));
+            return value != "null";
+        }
+
+        p = JSON_SKIP(p, end);
+        space();
+        if (p >= end || *p != ',')
+            return false;
+        p++;
+    }
+}
+
+inline void QR::INGEST::WORK(const RECORD& record, std::atomic<size_t>& next, WORKER_STATS& stats)
+{
+    using clock = std::chrono::steady_clock;
+    const char* data = File.DATA();
+    std::string scratch;
+    double callback = 0;
+    auto started = clock::now();
+
+    try
+    {
+        for (size_t c = next++; c < ChunkCount && !Stopped.load(std::memory_order_relaxed); c = next++)
+        {
+            CHUNK& chunk = Chunks[c];
+            const char* p = data + chunk.done.load(std::memory_order_relaxed);
+            const char* end = data + chunk.end;
+            while (p < end)
+            {
+                if (Stopped.load(std::memory_order_relaxed))
+                    break;
+
+                std::string_view payload;
+                bool found, empty;
+                const char* recordStart = p;
+                p = NEXT(p, end, payload, found, empty, scratch);
+                if (found)
+                {
+                    auto before = clock::now();
+                    record(static_cast<std::uint64_t>(recordStart - data), payload);
+                    callback += std::chrono::duration<double>(clock::now() - before).count();
+                    stats.records++;
+                }
+                else if (!empty)
+                    stats.skipped++;
+                chunk.done.store(static_cast<std::uint64_t>(p - data), std::memory_order_release);
+            }
+            if (p >= end)
+                File.RELEASE(chunk.start, chunk.end - chunk.start);
+        }
+    }
+    catch (...)
+    {
+        Stopped.store(true);
+        stats.parse += std::chrono::duration<double>(clock::now() - started).count() - callback;
+        throw;
+    }
+    stats.parse += std::chrono::duration<double>(clock::now() - started).count() - callback;
+}
+
+inline QR::INGEST_STATS QR::INGEST::RUN(const RECORD& record)
+{
+    auto start = std::chrono::steady_clock::now();
+    INGEST_STATS result{};
+
+    std::uint64_t before = 0;
+    for (size_t c = 0; c < ChunkCount; c++)
+        before += Chunks[c].done.load(std::memory_order_relaxed) - Chunks[c].start;
+    result.resumed = before;
+
+    std::atomic<size_t> next(0);
+    std::vector<WORKER_STATS> stats(static_cast<size_t>(Workers));
+    std::vector<std::future<void>> workers;
+    for (int w = 0; w < Workers; w++)
+        workers.push_back(std::async(std::launch::async, &INGEST::WORK, this, std::cref(record), std::ref(next), std::ref(stats[static_cast<size_t>(w)])));
+
+    // Checkpoints while the workers run; a failing commit stops them
+    std::exception_ptr failure;
+    const auto interval = std::chrono::duration<double>(Options.interval);
+    for (auto& worker : workers)
+    {
+        while (worker.wait_for(interval) == std::future_status::timeout)
+        {
+            if (failure)
+                continue;
+            try
+            {
+                CHECKPOINT();
+            }
+            catch (...)
+            {
+                failure = std::current_exception();
+                STOP();
+            }
+        }
+    }
+    for (auto& worker : workers)
+    {
+        try
+        {
+            worker.get();
+        }
+        catch (...)
+        {
+            if (!failure)
+                failure = std::current_exception();
+        }
+    }
+    // After an error too, keeping the progress made before it as far as it can be committed
+    try
+    {
+        CHECKPOINT();
+    }
+    catch (...)
+    {
+        if (!failure)
+            failure = std::current_exception();
+    }
+
+    std::uint64_t after = 0;
+    result.complete = true;
+    for (size_t c = 0; c < ChunkCount; c++)
+    {
+        std::uint64_t done = Chunks[c].done.load(std::memory_order_relaxed);
+        after += done - Chunks[c].start;
+        result.complete = result.complete && done == Chunks[c].end;
+    }
+    result.bytes = after - before;
+    for (const WORKER_STATS& worker : stats)
+    {
+        result.records += worker.records;
+        result.skipped += worker.skipped;
+        result.parse += worker.parse;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (failure)
+        std::rethrow_exception(failure);
+    return result;
+}
+
+inline void QR::INGEST::STOP()
+{
+    Stopped.store(true, std::memory_order_relaxed);
+}
+
+inline std::uint64_t QR::INGEST::BEGIN_GETTER() const
+{
+    return Begin;
+}
+
+inline std::uint64_t QR::INGEST::END_GETTER() const
+{
+    return End;
+}
+
+inline bool QR::INGEST::MAPPED(std::string_view payload) const
+{
+    const char* data = File.DATA();
+    return payload.data() >= data && payload.data() + payload.size() <= data + File.SIZE_GETTER();
+}
+
+#endif
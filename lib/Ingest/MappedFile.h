@@ -0,0 +1,207 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+// Without GDI, whose ERROR macro would clash with QRCODE::VERSION::ERROR
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOGDI
+#define NOGDI
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace QR
+{
+    /**
+    * @brief A whole file mapped read-only into memory.
+    *
+    * The pages are read by the kernel on first touch and can be dropped again with RELEASE, so a
+    * file of many gigabytes is read once, without a copy into the process and without holding
+    * more of it resident than the readers are working on. An empty file maps to no memory.
+    */
+    class MAPPED_FILE
+    {
+    public:
+        /**
+        * @throws std::runtime_error if the file cannot be opened or mapped.
+        */
+        explicit MAPPED_FILE(const std::string& path);
+
+        ~MAPPED_FILE();
+
+        MAPPED_FILE(const MAPPED_FILE&) = delete;
+        MAPPED_FILE& operator=(const MAPPED_FILE&) = delete;
+
+        const char* DATA() const;
+
+        std::uint64_t SIZE_GETTER() const;
+
+        std::string_view VIEW() const;
+
+        /**
+        * @brief Tells the kernel the file is about to be read from start to end (read-ahead).
+        */
+        void SEQUENTIAL() const;
+
+        /**
+        * @brief Drops the pages of a range that has been read; they are read again if touched.
+        */
+        void RELEASE(std::uint64_t offset, std::uint64_t length) const;
+
+    private:
+        const char* Data;
+
+        std::uint64_t Size;
+
+#ifdef _WIN32
+        HANDLE File;
+
+        HANDLE Mapping;
+#endif
+    };
+}
+
+#ifdef _WIN32
+
+inline QR::MAPPED_FILE::MAPPED_FILE(const std::string& path)
+    : Data(nullptr), Size(0), File(INVALID_HANDLE_VALUE), Mapping(nullptr)
+{
+    File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Open failed");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(File, &size))
+    {
+        CloseHandle(File);
+        throw std::runtime_error("Open failed");
+    }
+    Size = static_cast<std::uint64_t>(size.QuadPart);
+    if (Size == 0)
+        return;
+
+    Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (Mapping != nullptr)
+        Data = static_cast<const char*>(MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (Data == nullptr)
+    {
+        if (Mapping != nullptr)
+            CloseHandle(Mapping);
+        CloseHandle(File);
+        throw std::runtime_error("Map failed");
+    }
+}
+
+inline QR::MAPPED_FILE::~MAPPED_FILE()
+{
+    if (Data != nullptr)
+        UnmapViewOfFile(Data);
+    if (Mapping != nullptr)
+        CloseHandle(Mapping);
+    if (File != INVALID_HANDLE_VALUE)
+        CloseHandle(File);
+}
+
+inline void QR::MAPPED_FILE::SEQUENTIAL() const
+{
+    // FILE_FLAG_SEQUENTIAL_SCAN already asks for read-ahead
+}
+
+inline void QR::MAPPED_FILE::RELEASE(std::uint64_t offset, std::uint64_t length) const
+{
+    // Unmodified mapped pages are trimmed from the working set by the system as needed
+    (void)offset;
+    (void)length;
+}
+
+#else
+
+inline QR::MAPPED_FILE::MAPPED_FILE(const std::string& path)
+    : Data(nullptr), Size(0)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw std::runtime_error("Open failed");
+
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Open failed");
+    }
+    Size = static_cast<std::uint64_t>(status.st_size);
+    if (Size > 0)
+    {
+        void* address = ::mmap(nullptr, static_cast<size_t>(Size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Map failed");
+        }
+        Data = static_cast<const char*>(address);
+    }
+
+    // The mapping keeps the file open
+    ::close(fd);
+}
+
+inline QR::MAPPED_FILE::~MAPPED_FILE()
+{
+    if (Data != nullptr)
+        ::munmap(const_cast<char*>(Data), static_cast<size_t>(Size));
+}
+
+inline void QR::MAPPED_FILE::SEQUENTIAL() const
+{
+    if (Data != nullptr)
+        ::madvise(const_cast<char*>(Data), static_cast<size_t>(Size), MADV_SEQUENTIAL);
+}
+
+inline void QR::MAPPED_FILE::RELEASE(std::uint64_t offset, std::uint64_t length) const
+{
+    if (Data == nullptr || offset >= Size)
+        return;
+
+    // Whole pages inside the range only, so the neighbours' pages stay
+    const std::uint64_t page = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    std::uint64_t first = (offset + page - 1) / page * page;
+    std::uint64_t last = std::min(offset + length, Size) / page * page;
+    if (last > first)
+        ::madvise(const_cast<char*>(Data) + first, static_cast<size_t>(last - first), MADV_DONTNEED);
+}
+
+#endif
+
+inline const char* QR::MAPPED_FILE::DATA() const
+{
+    return Data;
+}
+
+inline std::uint64_t QR::MAPPED_FILE::SIZE_GETTER() const
+{
+    return Size;
+}
+
+inline std::string_view QR::MAPPED_FILE::VIEW() const
+{
+    return std::string_view(Data, static_cast<size_t>(Size));
+}
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Bounded multi-producer, multi-consumer queue without locks.
+    *
+    * A ring of cells, each with a sequence number telling whether it is free for the producer
+    * at a given position or full for the consumer at that position (D. Vyukov's design): a
+    * push or pop is one compare-and-swap on the tail or head index plus one release store, and
+    * producers and consumers never touch the same index. The blocking PUSH and POP spin
+    * briefly, then yield, then sleep, which is the backpressure between pipeline stages; they
+    * report how long they waited so a stage can tell starving from being blocked.
+    *
+    * The queue is closed once every producer has called PRODUCER_DONE, or at once by CLOSE;
+    * POP then drains what is left and returns false.
+    */
+    template <typename T>
+    class BOUNDED_QUEUE
+    {
+    public:
+        /**
+        * @param capacity Rounded up to a power of two, at least 2.
+        * @param producers Number of PRODUCER_DONE calls that close the queue.
+        *
+        * @throws std::domain_error if the capacity or the number of producers is out of range.
+        */
+        BOUNDED_QUEUE(size_t capacity, int producers);
+
+        BOUNDED_QUEUE(const BOUNDED_QUEUE&) = delete;
+        BOUNDED_QUEUE& operator=(const BOUNDED_QUEUE&) = delete;
+
+        /**
+        * @brief Moves `value` in if a cell is free. Never blocks.
+        */
+        bool TRY_PUSH(T& value);
+
+        /**
+        * @brief Moves the oldest value out, if there is one. Never blocks.
+        */
+        bool TRY_POP(T& value);
+
+        /**
+        * @brief Waits for a free cell and moves `value` in.
+        *
+        * @param waited Incremented by the time spent waiting, in seconds.
+        * @return false, leaving `value` alone, if the queue was closed.
+        */
+        bool PUSH(T& value, double& waited);
+
+        /**
+        * @brief Waits for a value and moves it out.
+        *
+        * @param waited Incremented by the time spent waiting, in seconds.
+        * @return false once the queue is closed and empty.
+        */
+        bool POP(T& value, double& waited);
+
+        /**
+        * @brief Called by each producer when it has pushed its last value.
+        */
+        void PRODUCER_DONE();
+
+        /**
+        * @brief Closes the queue at once, failing pushes and waking waiters; used to abort.
+        */
+        void CLOSE();
+
+        bool CLOSED() const;
+
+        size_t CAPACITY_GETTER() const;
+
+    private:
+        struct CELL
+        {
+            std::atomic<size_t> sequence;
+            T value;
+        };
+
+        /**
+        * @brief Spins, then yields, then sleeps, a little longer on every attempt.
+        */
+        static void BACKOFF(int attempt);
+
+        std::unique_ptr<CELL[]> Cells;
+
+        size_t Mask;
+
+        // Apart, so producers and consumers do not share a cache line
+        alignas(64) std::atomic<size_t> Tail;
+
+        alignas(64) std::atomic<size_t> Head;
+
+        alignas(64) std::atomic<int> Producers;
+
+        std::atomic<bool> Closed;
+    };
+}
+
+template <typename T>
+inline QR::BOUNDED_QUEUE<T>::BOUNDED_QUEUE(size_t capacity, int producers)
+    : Tail(0), Head(0), Producers(producers), Closed(false)
+{
+    if (capacity < 1 || capacity > (size_t(1) << 30) || producers < 1)
+        throw std::domain_error("value out of range");
+
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    Cells.reset(new CELL[size]);
+    Mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+        Cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template <typename T>
+inline bool QR::BOUNDED_QUEUE<T>::TRY_PUSH(T& value)
+{
+    CELL* cell;
+    size_t position = Tail.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &Cells[position & Mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+        if (difference == 0)
+        {
+            if (Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return false;   // Full: the cell still holds the value from one lap ago
+        else
+            position = Tail.load(std::memory_order_relaxed);
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+inline bool QR::BOUNDED_QUEUE<T>::TRY_POP(T& value)
+{
+    CELL* cell;
+    size_t position = Head.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        cell = &Cells[position & Mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position + 1);
+        if (difference == 0)
+        {
+            if (Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return false;   // Empty
+        else
+            position = Head.load(std::memory_order_relaxed);
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(position + Mask + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+inline void QR::BOUNDED_QUEUE<T>::BACKOFF(int attempt)
+{
+    if (attempt < 16)
+        return;
+    if (attempt < 64)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(attempt < 256 ? 20 : 200));
+}
+
+template <typename T>
+inline bool QR::BOUNDED_QUEUE<T>::PUSH(T& value, double& waited)
+{
+    if (TRY_PUSH(value))
+        return true;
+
+    auto start = std::chrono::steady_clock::now();
+    bool pushed = false;
+    for (int attempt = 0; !Closed.load(std::memory_order_acquire); attempt++)
+    {
+        if (TRY_PUSH(value))
+        {
+            pushed = true;
+            break;
+        }
+        BACKOFF(attempt);
+    }
+    waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return pushed;
+}
+
+template <typename T>
+inline bool QR::BOUNDED_QUEUE<T>::POP(T& value, double& waited)
+{
+    if (TRY_POP(value))
+        return true;
+
+    auto start = std::chrono::steady_clock::now();
+    bool popped = false;
+    for (int attempt = 0;; attempt++)
+    {
+        // Read before trying, so a value pushed just before the close is not missed
+        bool closed = Closed.load(std::memory_order_acquire);
+        if (TRY_POP(value))
+        {
+            popped = true;
+            break;
+        }
+        if (closed)
+            break;
+        BACKOFF(attempt);
+    }
+    waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return popped;
+}
+
+template <typename T>
+inline void QR::BOUNDED_QUEUE<T>::PRODUCER_DONE()
+{
+    if (Producers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        Closed.store(true, std::memory_order_release);
+}
+
+template <typename T>
+inline void QR::BOUNDED_QUEUE<T>::CLOSE()
+{
+    Closed.store(true, std::memory_order_release);
+}
+
+template <typename T>
+inline bool QR::BOUNDED_QUEUE<T>::CLOSED() const
+{
+    return Closed.load(std::memory_order_acquire);
+}
+
+template <typename T>
+inline size_t QR::BOUNDED_QUEUE<T>::CAPACITY_GETTER() const
+{
+    return Mask + 1;
+}
+
+#endif
@@ -0,0 +1,424 @@
+#ifndef EXPORTPIPELINE_H
+#define EXPORTPIPELINE_H
+
+#include "BoundedQueue.h"
+#include "../QRCode/QRCode.h"
+#include "../Image/Sink.h"
+#include "../Image/Raster.h"
+#include "../Image/Deflate.h"
+#include "../Image/PngStream.h"
+#include "../Image/ObjectSink.h"
+
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <exception>
+#include <functional>
+
+namespace QR
+{
+    /**
+    * @brief EXPORT_PIPELINE workers, queue depth, ordering and symbol settings.
+    */
+    struct PIPELINE_OPTIONS
+    {
+        int encoders = 1;           // Workers per stage
+        int renderers = 1;
+        int compressors = 1;
+        int writers = 1;            // Forced to 1 when `ordered`
+        size_t depth = 64;          // Items each queue holds before its producers wait
+        bool ordered = false;       // Write in input order; otherwise each item as soon as it is ready
+        QRCODE::VERSION::ERROR ecl = QRCODE::VERSION::ERROR::MEDIUM;
+        int scale = 4;              // Pixels per module side
+        int border = 4;             // Quiet zone, in modules
+        int level = 6;              // Deflate effort, 1 (fastest) to 9 (smallest)
+
+        // Another format: when set, the render stage writes each symbol with it, in place of
+        // the PNG scanlines, and the compress stage passes the output on unchanged
+        std::function<void(const QRCODE& code, SINK& sink)> render;
+
+        // Called from the workers with the name of an item whose encoding or rendering threw
+        // (a payload too long for any version, say) and the error; the item is then dropped
+        std::function<void(const std::string& name, const std::exception& error)> reject;
+    };
+
+    /**
+    * @brief Time accounting of one pipeline stage, summed over its workers.
+    */
+    struct STAGE_STATS
+    {
+        const char* name;
+        int workers;
+        std::uint64_t items;
+        double busy;        // Seconds spent on items
+        double starved;     // Seconds waiting for input
+        double blocked;     // Seconds waiting for room in the next queue (backpressure)
+        std::uint64_t failed;   // Items this stage dropped because they could not be encoded or rendered
+
+        /**
+        * @brief Share of the stage's worker time spent on items, 0 to 1, over a run of `seconds`.
+        */
+        double UTILIZATION(double seconds) const;
+    };
+
+    /**
+    * @brief What EXPORT_PIPELINE::RUN did, stage by stage.
+    */
+    struct PIPELINE_STATS
+    {
+        static constexpr int STAGES = 5;
+
+        // read (the caller's thread), encode, render, compress, write
+        STAGE_STATS stages[STAGES];
+
+        double seconds;
+
+        /**
+        * @brief The stage with the highest utilization, the one worth more workers.
+        */
+        const STAGE_STATS& BOTTLENECK() const;
+    };
+
+    /**
+    * @brief Bulk PNG export as five stages joined by bounded lock-free queues.
+    *
+    * read -> encode -> render -> compress -> write. The source is read on the calling thread;
+    * every other stage has its own workers, so deflate, encoding and the writes of earlier items
+    * overlap. A full queue holds its producers back, which bounds the memory in flight to about
+    * four queue depths of items. Rendering writes the PNG scanlines already filtered: the first
+    * pixel row of each module row as is, the `scale - 1` copies as zero Up-filtered rows, which
+    * DEFLATE_STREAM folds into long matches. PIPELINE_OPTIONS::render replaces these two
+    * stages by any SINK writer, for the other formats.
+    *
+    * Items normally reach the output in the order they finish. With `ordered`, a single writer
+    * holds back items that overtook an earlier one until it is written; the reorder buffer is
+    * then bounded only by how far items can overtake.
+    *
+    * An item that cannot be encoded or rendered is dropped: it is counted in the stage's
+    * `failed`, handed to PIPELINE_OPTIONS::reject and the run goes on. Any other exception (from
+    * the source, the compressor or the output) closes every queue, the workers stop and RUN
+    * rethrows the first one.
+    */
+    class EXPORT_PIPELINE
+    {
+    public:
+        /**
+        * @brief Fills in the name and text of the next symbol; returns false at the end of the input.
+        */
+        using SOURCE = std::function<bool(std::string& name, std::string& text)>;
+
+        /**
+        * @brief Receives each finished image, and may move it away. Called from the writer
+        * workers, concurrently when there are several.
+        */
+        using OUTPUT = std::function<void(const std::string& name, std::string& data)>;
+
+        /**
+        * @throws std::domain_error if a worker count, the depth or a symbol setting is out of range.
+        */
+        explicit EXPORT_PIPELINE(const PIPELINE_OPTIONS& options = PIPELINE_OPTIONS());
+
+        /**
+        * @brief Exports every symbol of `source` to `output` and returns the stage statistics.
+        */
+        PIPELINE_STATS RUN(const SOURCE& source, const OUTPUT& output) const;
+
+        /**
+        * @brief Exports every symbol of `source` into an object sink, moving each image in, and
+        * flushes the sink at the end.
+        */
+        PIPELINE_STATS RUN(const SOURCE& source, OBJECT_SINK& sink) const;
+
+    private:
+        /**
+        * @brief One symbol on its way through the stages.
+        */
+        struct ITEM
+        {
+            size_t index;
+            std::string name;
+            std::string text;
+            std::optional<QRCODE> code;
+            int width = 0;
+            std::vector<std::uint8_t> scanlines;    // Filter byte and pixels of every row
+            std::string data;                       // The finished image
+            bool rejected = false;                  // Dropped; still passed on so the ordered writer can skip it
+        };
+
+        using QUEUE = BOUNDED_QUEUE<std::unique_ptr<ITEM>>;
+
+        void ENCODE_ITEM(ITEM& item) const;
+
+        void RENDER_ITEM(ITEM& item) const;
+
+        void COMPRESS_ITEM(ITEM& item) const;
+
+        PIPELINE_OPTIONS Options;
+
+        RASTER Raster;
+    };
+}
+
+inline double QR::STAGE_STATS::UTILIZATION(double seconds) const
+{
+    return seconds > 0 && workers > 0 ? busy / (seconds * workers) : 0;
+}
+
+inline const QR::STAGE_STATS& QR::PIPELINE_STATS::BOTTLENECK() const
+{
+    int worst = 0;
+    for (int i = 1; i < STAGES; i++)
+    {
+        if (stages[i].UTILIZATION(seconds) > stages[worst].UTILIZATION(seconds))
+            worst = i;
+    }
+    return stages[worst];
+}
+
+inline QR::EXPORT_PIPELINE::EXPORT_PIPELINE(const PIPELINE_OPTIONS& options)
+    : Options(options), Raster(RASTER::FORMAT::MONO1, options.scale, options.border)
+{
+    if (options.encoders < 1 || options.renderers < 1 || options.compressors < 1 || options.writers < 1
+        || options.depth < 1 || options.level < 1 || options.level > 9)
+        throw std::domain_error("value out of range");
+    if (Options.ordered)
+        Options.writers = 1;
+}
+
+inline void QR::EXPORT_PIPELINE::ENCODE_ITEM(ITEM& item) const
+{
+    item.code.emplace(QRCODE::ENCODE_SEGMENT(ENCODE::MODE::MODE_CHOOSER(item.text.data(), item.text.size()), Options.ecl));
+}
+
+inline void QR::EXPORT_PIPELINE::RENDER_ITEM(ITEM& item) const
+{
+    if (Options.render)
+    {
+        STRING_SINK sink(item.data);
+        Options.render(*item.code, sink);
+        item.code.reset();
+        return;
+    }
+
+    const MATRIX_VIEW view = item.code->VIEW_GETTER();
+    const int scale = Raster.SCALE_GETTER();
+    item.width = Raster.PIXELS(view.SIZE_GETTER());
+    const size_t rowBytes = Raster.ROW_BYTES(item.width);
+    const int rows = view.SIZE_GETTER() + 2 * Raster.BORDER_GETTER();
+
+    // One module row is rendered once; its copies are Up-filtered rows of zeros
+    item.scanlines.assign((rowBytes + 1) * static_cast<size_t>(item.width), 0);
+    std::uint8_t* out = item.scanlines.data();
+    for (int row = 0; row < rows; row++)
+    {
+        Raster.RENDER_LINE(view, row, out + 1);
+        out += rowBytes + 1;
+        for (int copy = 1; copy < scale; copy++, out += rowBytes + 1)
+            out[0] = 2;
+    }
+    item.code.reset();
+}
+
+inline void QR::EXPORT_PIPELINE::COMPRESS_ITEM(ITEM& item) const
+{
+    if (Options.render)
+        return;
+
+    STRING_SINK sink(item.data);
+    PNG_STREAM::HEADER(sink, item.width, item.width, Raster);
+    PNG_STREAM::IDAT_SINK idat(sink);
+    DEFLATE_STREAM deflate(idat, true, Options.level);
+    deflate.WRITE(item.scanlines.data(), item.scanlines.size());
+    deflate.FINISH();
+    idat.FINISH();
+    PNG_STREAM::CHUNK(sink, "IEND", nullptr, 0);
+
+    item.scanlines.clear();
+    item.scanlines.shrink_to_fit();
+}
+
+inline QR::PIPELINE_STATS QR::EXPORT_PIPELINE::RUN(const SOURCE& source, const OUTPUT& output) const
+{
+    const int workers[PIPELINE_STATS::STAGES] = { 1, Options.encoders, Options.renderers, Options.compressors, Options.writers };
+    const char* const names[PIPELINE_STATS::STAGES] = { "read", "encode", "render", "compress", "write" };
+
+    PIPELINE_STATS stats{};
+    for (int i = 0; i < PIPELINE_STATS::STAGES; i++)
+    {
+        stats.stages[i].name = names[i];
+        stats.stages[i].workers = workers[i];
+    }
+
+    // queues[i] feeds stage i + 1 and is closed when the last worker of stage i is done
+    std::vector<std::unique_ptr<QUEUE>> queues;
+    for (int i = 0; i + 1 < PIPELINE_STATS::STAGES; i++)
+        queues.push_back(std::make_unique<QUEUE>(Options.depth, workers[i]));
+
+    std::mutex lock;
+    std::exception_ptr failure;
+    std::atomic<bool> failed(false);
+    auto fail = [&]()
+        {
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!failure)
+                    failure = std::current_exception();
+            }
+            failed.store(true);
+            for (auto& queue : queues)
+                queue->CLOSE();
+        };
+
+    auto merge = [&](STAGE_STATS& into, const STAGE_STATS& local)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            into.items += local.items;
+            into.busy += local.busy;
+            into.starved += local.starved;
+            into.blocked += local.blocked;
+            into.failed += local.failed;
+        };
+
+    // Items ready for the ordered writer, and the index it writes next
+    std::map<size_t, std::unique_ptr<ITEM>> early;
+    size_t next = 0;
+
+    auto work = [&](int stage)
+        {
+            STAGE_STATS local{};
+            QUEUE& in = *queues[static_cast<size_t>(stage) - 1];
+            QUEUE* out = stage + 1 < PIPELINE_STATS::STAGES ? queues[static_cast<size_t>(stage)].get() : nullptr;
+            try
+            {
+                std::unique_ptr<ITEM> item;
+                while (in.POP(item, local.starved))
+                {
+                    if (failed.load())
+                        break;
+                    auto start = std::chrono::steady_clock::now();
+                    bool dropped = item->rejected;
+                    switch (stage)
+                    {
+                    case 1:
+                    case 2:
+                        if (dropped)
+                            break;
+
+                        // The symbol's own errors drop the item; running out of memory does not
+                        try
+                        {
+                            if (stage == 1)
+                                ENCODE_ITEM(*item);
+                            else
+                                RENDER_ITEM(*item);
+                        }
+                        catch (const std::bad_alloc&)
+                        {
+                            throw;
+                        }
+                        catch (const std::exception& error)
+                        {
+                            item->rejected = dropped = true;
+                            item->code.reset();
+                            item->data.clear();
+                            local.failed++;
+                            if (Options.reject)
+                                Options.reject(item->name, error);
+                        }
+                        break;
+                    case 3:
+                        if (!dropped)
+                            COMPRESS_ITEM(*item);
+                        break;
+                    default:
+                        if (!Options.ordered)
+                        {
+                            if (!dropped)
+                                output(item->name, item->data);
+                        }
+                        else
+                        {
+                            early.emplace(item->index, std::move(item));
+                            for (auto first = early.begin(); first != early.end() && first->first == next; first = early.erase(first), next++)
+                            {
+                                if (!first->second->rejected)
+                                    output(first->second->name, first->second->data);
+                            }
+                        }
+                        break;
+                    }
+                    local.busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    if (!dropped)
+                        local.items++;
+                    if (out != nullptr && !out->PUSH(item, local.blocked))
+                        break;
+                }
+            }
+            catch (...)
+            {
+                fail();
+            }
+            if (out != nullptr)
+                out->PRODUCER_DONE();
+            merge(stats.stages[stage], local);
+        };
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::future<void>> pending;
+    for (int stage = 1; stage < PIPELINE_STATS::STAGES; stage++)
+    {
+        for (int i = 0; i < workers[stage]; i++)
+            pending.push_back(std::async(std::launch::async, work, stage));
+    }
+
+    // The read stage, on the calling thread
+    STAGE_STATS& read = stats.stages[0];
+    try
+    {
+        for (size_t index = 0;; index++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            std::unique_ptr<ITEM> item = std::make_unique<ITEM>();
+            item->index = index;
+            bool more = source(item->name, item->text);
+            read.busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (!more || !queues[0]->PUSH(item, read.blocked))
+                break;
+            read.items++;
+        }
+    }
+    catch (...)
+    {
+        fail();
+    }
+    queues[0]->PRODUCER_DONE();
+
+    for (std::future<void>& worker : pending)
+        worker.get();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    if (failure)
+        std::rethrow_exception(failure);
+    return stats;
+}
+
+inline QR::PIPELINE_STATS QR::EXPORT_PIPELINE::RUN(const SOURCE& source, OBJECT_SINK& sink) const
+{
+    PIPELINE_STATS stats = RUN(source, [&sink](const std::string& name, std::string& data)
+        {
+            sink.PUT(name, std::move(data));
+        });
+    sink.FLUSH();
+    return stats;
+}
+
+#endif
@@ -4,13 +4,27 @@
 #include <vector>
 #include <stdexcept>
 #include <cmath>
+#include <cstdint>
 
 namespace QR
 {
-    struct BITBUFFER : public std::vector<bool>
+    /**
+    * @brief Growable bit string packed into 64-bit words, most significant bit first.
+    *
+    * Appends shift whole words into place instead of storing bit by bit, and segments are
+    * concatenated a word at a time.
+    */
+    struct BITBUFFER
     {
     public:
-        BITBUFFER() : std::vector<bool>() {}
+        BITBUFFER() : Bits(0) {}
+
+        explicit BITBUFFER(const std::vector<bool>& bits) : Bits(0)
+        {
+            reserve(bits.size());
+            for (bool bit : bits)
+                APPEND_WORD(bit ? 1 : 0, 1);
+        }
 
         static bool BINARY_BITS(long value, int length)
         {
@@ -22,10 +36,7 @@ namespace QR
             if (length < 0 || length > 31 || value >> length != 0)
                 throw std::domain_error("Value out of range");
 
-            for (int i = length - 1; i >= 0; i--)
-            {
-                this->push_back(BINARY_BITS(value, i));
-            }
+            APPEND_WORD(value, length);
         }
 
         void APPEND_BITS(std::uint32_t value)
@@ -35,12 +46,73 @@ namespace QR
             if (length < 0 || length > 31)
                 throw std::domain_error("Value out of range");
 
-            for (int i = length - 1; i >= 0; i--)
+            APPEND_WORD(value, length);
+        }
+
+        // Appends the low `length` bits (0 to 64) of `value`, most significant first; higher
+        // bits are ignored. No range check is done: callers pack several code groups into one word.
+        void APPEND_WORD(std::uint64_t value, int length)
+        {
+            if (length == 0)
+                return;
+            if (length < 64)
+                value &= (std::uint64_t(1) << length) - 1;
+
+            int free = static_cast<int>(-Bits & 63);
+            if (free == 0)
+                Words.push_back(value << (64 - length));
+            else if (length <= free)
+                Words.back() |= value << (free - length);
+            else
             {
-                this->push_back(((value >> i) & 1) != 0);
+                Words.back() |= value >> (length - free);
+                Words.push_back(value << (64 - (length - free)));
             }
+            Bits += static_cast<size_t>(length);
+        }
+
+        // Appends every bit of `other`, a word at a time
+        void APPEND_BUFFER(const BITBUFFER& other)
+        {
+            size_t full = other.Bits / 64;
+            for (size_t i = 0; i < full; i++)
+                APPEND_WORD(other.Words[i], 64);
+            int rest = static_cast<int>(other.Bits & 63);
+            if (rest != 0)
+                APPEND_WORD(other.Words[full] >> (64 - rest), rest);
+        }
+
+        // Replaces `out` with the buffer's bytes; a final partial byte is padded with zeros
+        void TO_BYTES(std::vector<std::uint8_t>& out) const
+        {
+            out.resize((Bits + 7) / 8);
+            for (size_t i = 0; i < out.size(); i++)
+                out[i] = static_cast<std::uint8_t>(Words[i >> 3] >> (56 - 8 * (i & 7)));
+        }
+
+        bool operator[](size_t index) const
+        {
+            return ((Words[index >> 6] >> (63 - (index & 63))) & 1) != 0;
+        }
+
+        size_t size() const
+        {
+            return Bits;
+        }
+
+        bool empty() const
+        {
+            return Bits == 0;
+        }
+
+        void reserve(size_t bits)
+        {
+            Words.reserve((bits + 63) / 64);
         }
 
+    private:
+        std::vector<std::uint64_t> Words;
+        size_t Bits;
     };
 }
 
@@ -0,0 +1,313 @@
+#ifndef CHARCLASS_H
+#define CHARCLASS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "BitBuffer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QR_CHARCLASS_SSE2 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QR_CHARCLASS_AVX2 1
+#endif
+
+namespace QR
+{
+    /**
+    * @brief Character classification and bulk packing kernels for the QR text modes.
+    *
+    * Classification tags 16 bytes (SSE2) or 32 bytes (AVX2) per step as numeric,
+    * alphanumeric or byte, with a scalar lookup-table tail. Packing turns digit triples
+    * into 10-bit groups and alphanumeric pairs into 11-bit groups through a 64-bit
+    * accumulator, so the bit buffer is touched once per word instead of once per bit.
+    */
+    struct CHARCLASS
+    {
+        /**
+        * @brief Tag describing the narrowest QR mode able to hold a character.
+        *
+        * The values are ordered, so the narrowest mode covering a run of characters is
+        * the maximum of their tags.
+        */
+        enum class TAG : std::uint8_t
+        {
+            NUMERIC = 0,       // '0' - '9'
+            ALPHANUMERIC = 1,  // Upper case letters, digits and " $%*+-./:"
+            BYTE = 2           // Anything else
+        };
+
+        /**
+        * @brief Alphanumeric value (0 - 44) of every byte, or 0xFF if the byte is not
+        * part of the alphanumeric character set.
+        */
+        static const std::uint8_t ALPHANUMERIC_VALUE[256];
+
+        /**
+        * @brief Returns the narrowest mode able to encode the whole input.
+        *
+        * @param input Pointer to the characters to classify.
+        * @param length Number of characters to classify.
+        * @return `TAG::NUMERIC`, `TAG::ALPHANUMERIC` or `TAG::BYTE`.
+        */
+        static TAG CLASSIFY(const char* input, size_t length);
+
+        /**
+        * @brief Writes the tag of every input character into `tags`.
+        *
+        * @param input Pointer to the characters to classify.
+        * @param length Number of characters to classify.
+        * @param tags Output array holding at least `length` entries.
+        */
+        static void TAG_BYTES(const char* input, size_t length, TAG* tags);
+
+        /**
+        * @brief Appends the numeric mode encoding of `input` to `out`.
+        *
+        * @throws std::domain_error if the input contains a non digit character.
+        */
+        static void PACK_NUMERIC(const char* input, size_t length, BITBUFFER& out);
+
+        /**
+        * @brief Appends the alphanumeric mode encoding of `input` to `out`.
+        *
+        * @throws std::domain_error if the input contains a character outside the alphanumeric set.
+        */
+        static void PACK_ALPHANUMERIC(const char* input, size_t length, BITBUFFER& out);
+
+    private:
+#if QR_CHARCLASS_SSE2
+        // Byte mask (0xFF / 0x00) of the lanes lying in [lo, hi].
+        static __m128i IN_RANGE(__m128i v, char lo, char hi);
+
+        static __m128i DIGIT_MASK(__m128i v);
+
+        static __m128i ALPHANUMERIC_MASK(__m128i v, __m128i digits);
+#endif
+#if QR_CHARCLASS_AVX2
+        static __m256i IN_RANGE(__m256i v, char lo, char hi);
+
+        static __m256i DIGIT_MASK(__m256i v);
+
+        static __m256i ALPHANUMERIC_MASK(__m256i v, __m256i digits);
+#endif
+    };
+}
+
+#if QR_CHARCLASS_SSE2
+inline __m128i QR::CHARCLASS::IN_RANGE(__m128i v, char lo, char hi)
+{
+    // Unsigned (v - lo) <= (hi - lo) without a native unsigned compare
+    __m128i t = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(t, _mm_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+inline __m128i QR::CHARCLASS::DIGIT_MASK(__m128i v)
+{
+    return IN_RANGE(v, '0', '9');
+}
+
+inline __m128i QR::CHARCLASS::ALPHANUMERIC_MASK(__m128i v, __m128i digits)
+{
+    // ' ', '$' - '%', '*' - '+', '-' - ':' and 'A' - 'Z'; the digits sit inside '-' - ':'
+    __m128i m = _mm_or_si128(digits, IN_RANGE(v, 'A', 'Z'));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+    m = _mm_or_si128(m, IN_RANGE(v, '$', '%'));
+    m = _mm_or_si128(m, IN_RANGE(v, '*', '+'));
+    return _mm_or_si128(m, IN_RANGE(v, '-', ':'));
+}
+#endif
+
+#if QR_CHARCLASS_AVX2
+inline __m256i QR::CHARCLASS::IN_RANGE(__m256i v, char lo, char hi)
+{
+    __m256i t = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(t, _mm256_set1_epi8(static_cast<char>(hi - lo))), t);
+}
+
+inline __m256i QR::CHARCLASS::DIGIT_MASK(__m256i v)
+{
+    return IN_RANGE(v, '0', '9');
+}
+
+inline __m256i QR::CHARCLASS::ALPHANUMERIC_MASK(__m256i v, __m256i digits)
+{
+    __m256i m = _mm256_or_si256(digits, IN_RANGE(v, 'A', 'Z'));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+    m = _mm256_or_si256(m, IN_RANGE(v, '$', '%'));
+    m = _mm256_or_si256(m, IN_RANGE(v, '*', '+'));
+    return _mm256_or_si256(m, IN_RANGE(v, '-', ':'));
+}
+#endif
+
+inline QR::CHARCLASS::TAG QR::CHARCLASS::CLASSIFY(const char* input, size_t length)
+{
+    size_t i = 0;
+    bool numeric = true;
+
+#if QR_CHARCLASS_AVX2
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i digits = DIGIT_MASK(v);
+        if (_mm256_movemask_epi8(ALPHANUMERIC_MASK(v, digits)) != -1)
+            return TAG::BYTE;
+        numeric = numeric && _mm256_movemask_epi8(digits) == -1;
+    }
+#endif
+#if QR_CHARCLASS_SSE2
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i digits = DIGIT_MASK(v);
+        if (_mm_movemask_epi8(ALPHANUMERIC_MASK(v, digits)) != 0xFFFF)
+            return TAG::BYTE;
+        numeric = numeric && _mm_movemask_epi8(digits) == 0xFFFF;
+    }
+#endif
+    for (; i < length; i++)
+    {
+        std::uint8_t c = static_cast<std::uint8_t>(input[i]);
+        if (ALPHANUMERIC_VALUE[c] == 0xFF)
+            return TAG::BYTE;
+        numeric = numeric && ALPHANUMERIC_VALUE[c] < 10;
+    }
+    return numeric ? TAG::NUMERIC : TAG::ALPHANUMERIC;
+}
+
+inline void QR::CHARCLASS::TAG_BYTES(const char* input, size_t length, TAG* tags)
+{
+    size_t i = 0;
+
+    // tag = 2 + alphanumeric mask + digit mask, with the masks being 0 or -1 per lane
+#if QR_CHARCLASS_AVX2
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i));
+        __m256i digits = DIGIT_MASK(v);
+        __m256i t = _mm256_add_epi8(_mm256_set1_epi8(2), ALPHANUMERIC_MASK(v, digits));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(tags + i), _mm256_add_epi8(t, digits));
+    }
+#endif
+#if QR_CHARCLASS_SSE2
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i digits = DIGIT_MASK(v);
+        __m128i t = _mm_add_epi8(_mm_set1_epi8(2), ALPHANUMERIC_MASK(v, digits));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(tags + i), _mm_add_epi8(t, digits));
+    }
+#endif
+    for (; i < length; i++)
+    {
+        std::uint8_t value = ALPHANUMERIC_VALUE[static_cast<std::uint8_t>(input[i])];
+        tags[i] = value < 10 ? TAG::NUMERIC : value == 0xFF ? TAG::BYTE : TAG::ALPHANUMERIC;
+    }
+}
+
+inline void QR::CHARCLASS::PACK_NUMERIC(const char* input, size_t length, BITBUFFER& out)
+{
+    const std::uint8_t* p = reinterpret_cast<const std::uint8_t*>(input);
+    std::uint32_t bad = 0;
+
+    out.reserve(out.size() + length / 3 * 10 + 7);
+
+    // Six 10-bit groups (60 bits) per accumulator flush
+    size_t i = 0;
+    for (; i + 18 <= length; i += 18)
+    {
+        std::uint64_t acc = 0;
+        for (size_t k = i; k < i + 18; k += 3)
+        {
+            std::uint32_t d0 = p[k] - '0', d1 = p[k + 1] - '0', d2 = p[k + 2] - '0';
+            bad |= (d0 > 9) | (d1 > 9) | (d2 > 9);
+            acc = acc << 10 | (d0 * 100 + d1 * 10 + d2);
+        }
+        out.APPEND_WORD(acc, 60);
+    }
+    for (; i + 3 <= length; i += 3)
+    {
+        std::uint32_t d0 = p[i] - '0', d1 = p[i + 1] - '0', d2 = p[i + 2] - '0';
+        bad |= (d0 > 9) | (d1 > 9) | (d2 > 9);
+        out.APPEND_WORD(d0 * 100 + d1 * 10 + d2, 10);
+    }
+    if (length - i == 2)
+    {
+        std::uint32_t d0 = p[i] - '0', d1 = p[i + 1] - '0';
+        bad |= (d0 > 9) | (d1 > 9);
+        out.APPEND_WORD(d0 * 10 + d1, 7);
+    }
+    else if (length - i == 1)
+    {
+        std::uint32_t d0 = p[i] - '0';
+        bad |= d0 > 9;
+        out.APPEND_WORD(d0, 4);
+    }
+
+    if (bad)
+        throw std::domain_error("String contains non-numeric characters");
+}
+
+inline void QR::CHARCLASS::PACK_ALPHANUMERIC(const char* input, size_t length, BITBUFFER& out)
+{
+    const std::uint8_t* p = reinterpret_cast<const std::uint8_t*>(input);
+    std::uint32_t bad = 0;
+
+    out.reserve(out.size() + length / 2 * 11 + 6);
+
+    // Five 11-bit groups (55 bits) per accumulator flush; invalid bytes map to 0xFF
+    size_t i = 0;
+    for (; i + 10 <= length; i += 10)
+    {
+        std::uint64_t acc = 0;
+        for (size_t k = i; k < i + 10; k += 2)
+        {
+            std::uint32_t a = ALPHANUMERIC_VALUE[p[k]], b = ALPHANUMERIC_VALUE[p[k + 1]];
+            bad |= a | b;
+            acc = acc << 11 | (a * 45 + b);
+        }
+        out.APPEND_WORD(acc, 55);
+    }
+    for (; i + 2 <= length; i += 2)
+    {
+        std::uint32_t a = ALPHANUMERIC_VALUE[p[i]], b = ALPHANUMERIC_VALUE[p[i + 1]];
+        bad |= a | b;
+        out.APPEND_WORD((a * 45 + b) & 0x7FF, 11);
+    }
+    if (i < length)
+    {
+        std::uint32_t a = ALPHANUMERIC_VALUE[p[i]];
+        bad |= a;
+        out.APPEND_WORD(a & 0x3F, 6);
+    }
+
+    if (bad & 0x80)
+        throw std::domain_error("String contains unencodable characters in alphanumeric mode");
+}
+
+const std::uint8_t QR::CHARCLASS::ALPHANUMERIC_VALUE[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x00
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x10
+    0x24, 0xFF, 0xFF, 0xFF, 0x25, 0x26, 0xFF, 0xFF, 0xFF, 0xFF, 0x27, 0x28, 0xFF, 0x29, 0x2A, 0x2B,  // 0x20
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x2C, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x30
+    0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,  // 0x40
+    0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x50
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x60
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x70
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x80
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0x90
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xA0
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xB0
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xC0
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xD0
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xE0
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,  // 0xF0
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef MATRIXVIEW_H
+#define MATRIXVIEW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <span>
+
+namespace QR
+{
+    /**
+    * @brief Read-only, non-owning view of a square matrix of packed modules.
+    *
+    * Each row is `stride` 64-bit words. Module x of a row is bit (63 - x % 64) of word x / 64,
+    * so the first module of a row is the most significant bit and the bytes of a word, read
+    * from the top, are already in the MSB-first order used by PNG, PBM, BMP and printer
+    * formats. Padding bits past the last module are always zero. The view never copies and
+    * does no bounds checks; it stays valid as long as the matrix it was taken from.
+    */
+    class MATRIX_VIEW
+    {
+    public:
+        /**
+        * @brief Iterates over the rows of the matrix as packed word spans.
+        */
+        class ROW_ITERATOR
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::span<const std::uint64_t>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            ROW_ITERATOR(const std::uint64_t* row, size_t stride) : Row(row), Stride(stride) {}
+
+            value_type operator*() const { return value_type(Row, Stride); }
+            ROW_ITERATOR& operator++() { Row += Stride; return *this; }
+            ROW_ITERATOR operator++(int) { ROW_ITERATOR old = *this; Row += Stride; return old; }
+            bool operator==(const ROW_ITERATOR& other) const { return Row == other.Row; }
+            bool operator!=(const ROW_ITERATOR& other) const { return Row != other.Row; }
+
+        private:
+            const std::uint64_t* Row;
+            size_t Stride;
+        };
+
+        /**
+        * @brief Iterates down one column, yielding the color of each module.
+        */
+        class COLUMN_ITERATOR
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = bool;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = bool;
+
+            COLUMN_ITERATOR(const std::uint64_t* word, size_t stride, int shift) : Word(word), Stride(stride), Shift(shift) {}
+
+            bool operator*() const { return ((*Word >> Shift) & 1) != 0; }
+            COLUMN_ITERATOR& operator++() { Word += Stride; return *this; }
+            COLUMN_ITERATOR operator++(int) { COLUMN_ITERATOR old = *this; Word += Stride; return old; }
+            bool operator==(const COLUMN_ITERATOR& other) const { return Word == other.Word; }
+            bool operator!=(const COLUMN_ITERATOR& other) const { return Word != other.Word; }
+
+        private:
+            const std::uint64_t* Word;
+            size_t Stride;
+            int Shift;
+        };
+
+        /**
+        * @brief A begin/end pair usable in range-based for loops.
+        */
+        template <typename ITERATOR>
+        struct RANGE
+        {
+            ITERATOR first;
+            ITERATOR last;
+
+            ITERATOR begin() const { return first; }
+            ITERATOR end() const { return last; }
+        };
+
+        /**
+        * @brief Creates a view over `size` rows of `stride` words starting at `words`.
+        */
+        MATRIX_VIEW(const std::uint64_t* words, int size, size_t stride);
+
+        /**
+        * @brief Number of modules per side.
+        */
+        int SIZE_GETTER() const;
+
+        /**
+        * @brief Number of 64-bit words per row.
+        */
+        size_t STRIDE_GETTER() const;
+
+        /**
+        * @brief Packed words of row `y`.
+        */
+        std::span<const std::uint64_t> ROW(int y) const;
+
+        /**
+        * @brief Returns true if the module at (x, y) is dark. No bounds checks.
+        */
+        bool TEST(int x, int y) const;
+
+        /**
+        * @brief Returns true if module `x` of a packed row is dark. No bounds checks.
+        */
+        static bool TEST(std::span<const std::uint64_t> row, int x);
+
+        /**
+        * @brief Byte `k` of a packed row: modules 8k to 8k + 7, the first one in the top bit.
+        */
+        static std::uint8_t ROW_BYTE(std::span<const std::uint64_t> row, size_t k);
+
+        /**
+        * @brief All rows, top to bottom.
+        */
+        RANGE<ROW_ITERATOR> ROWS() const;
+
+        /**
+        * @brief The modules of column `x`, top to bottom.
+        */
+        RANGE<COLUMN_ITERATOR> COLUMN(int x) const;
+
+        /**
+        * @brief Raw packed storage: SIZE_GETTER() rows of STRIDE_GETTER() words.
+        */
+        const std::uint64_t* DATA() const;
+
+    private:
+        const std::uint64_t* Words;
+
+        int Size;
+
+        size_t Stride;
+    };
+}
+
+inline QR::MATRIX_VIEW::MATRIX_VIEW(const std::uint64_t* words, int size, size_t stride)
+    : Words(words), Size(size), Stride(stride)
+{
+}
+
+inline int QR::MATRIX_VIEW::SIZE_GETTER() const
+{
+    return Size;
+}
+
+inline size_t QR::MATRIX_VIEW::STRIDE_GETTER() const
+{
+    return Stride;
+}
+
+inline std::span<const std::uint64_t> QR::MATRIX_VIEW::ROW(int y) const
+{
+    return std::span<const std::uint64_t>(Words + static_cast<size_t>(y) * Stride, Stride);
+}
+
+inline bool QR::MATRIX_VIEW::TEST(int x, int y) const
+{
+    return ((Words[static_cast<size_t>(y) * Stride + (static_cast<unsigned>(x) >> 6)] >> (63 - (x & 63))) & 1) != 0;
+}
+
+inline bool QR::MATRIX_VIEW::TEST(std::span<const std::uint64_t> row, int x)
+{
+    return ((row[static_cast<unsigned>(x) >> 6] >> (63 - (x & 63))) & 1) != 0;
+}
+
+inline std::uint8_t QR::MATRIX_VIEW::ROW_BYTE(std::span<const std::uint64_t> row, size_t k)
+{
+    return static_cast<std::uint8_t>(row[k >> 3] >> (56 - 8 * (k & 7)));
+}
+
+inline QR::MATRIX_VIEW::RANGE<QR::MATRIX_VIEW::ROW_ITERATOR> QR::MATRIX_VIEW::ROWS() const
+{
+    return { ROW_ITERATOR(Words, Stride), ROW_ITERATOR(Words + static_cast<size_t>(Size) * Stride, Stride) };
+}
+
+inline QR::MATRIX_VIEW::RANGE<QR::MATRIX_VIEW::COLUMN_ITERATOR> QR::MATRIX_VIEW::COLUMN(int x) const
+{
+    const std::uint64_t* top = Words + (static_cast<unsigned>(x) >> 6);
+    int shift = 63 - (x & 63);
+    return { COLUMN_ITERATOR(top, Stride, shift), COLUMN_ITERATOR(top + static_cast<size_t>(Size) * Stride, Stride, shift) };
+}
+
+inline const std::uint64_t* QR::MATRIX_VIEW::DATA() const
+{
+    return Words;
+}
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef QRCACHE_H
+#define QRCACHE_H
+
+#include "QRCode.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <unordered_map>
+
+namespace QR
+{
+    /**
+    * @brief Thread-safe, sharded LRU cache of encoded symbols.
+    *
+    * Entries are keyed on the payload and every ENCODE_SEGMENT parameter that changes the
+    * symbol, and hold a shared immutable QRCODE plus, optionally, rendered outputs (PNG, SVG...)
+    * stored under a caller chosen format name. Each shard has its own lock, LRU list and slice
+    * of the byte budget, so lookups on different shards never contend.
+    */
+    class QRCACHE
+    {
+    public:
+        /**
+        * @brief Counters aggregated over all shards.
+        */
+        struct STATS
+        {
+            std::uint64_t hits;        // Lookups answered from the cache
+            std::uint64_t misses;      // Lookups that had to encode or render
+            std::uint64_t evictions;   // Entries dropped to stay within the byte budget
+            std::uint64_t entries;     // Entries currently cached
+            std::uint64_t bytes;       // Estimated bytes currently cached
+        };
+
+        /**
+        * @brief Creates an empty cache.
+        *
+        * @param byteBudget Upper bound on the estimated bytes held by all shards together.
+        * @param shardCount Number of independently locked shards (at least 1).
+        */
+        explicit QRCACHE(size_t byteBudget = 64u << 20, size_t shardCount = 16);
+
+        QRCACHE(const QRCACHE&) = delete;
+        QRCACHE& operator=(const QRCACHE&) = delete;
+
+        /**
+        * @brief Returns the cached symbol for a text payload, encoding and caching it on a miss.
+        *
+        * The parameters have the same meaning as in QRCODE::ENCODE_SEGMENT. The payload may
+        * contain NUL bytes; an empty one gives a symbol without data.
+        *
+        * @return A shared, immutable QR code, valid even after it is evicted.
+        */
+        std::shared_ptr<const QRCODE> ENCODE_TEXT(std::string_view text, QRCODE::VERSION::ERROR ecl,
+            int minVersion = 1,
+            int maxVersion = 40,
+            int mask = -1,
+            bool boostEcl = true);
+
+        /**
+        * @brief Returns cached rendered bytes of a text payload, rendering them on a miss.
+        *
+        * @param text The payload, encoded with ENCODE_TEXT's defaults for the other parameters.
+        * @param ecl The error correction level.
+        * @param format Name of the rendering (for example "png:6" or "svg"); one entry per name.
+        * @param render Called outside any lock to produce the bytes from the symbol.
+        * @return The shared rendered bytes.
+        */
+        std::shared_ptr<const std::string> RENDER_TEXT(std::string_view text, QRCODE::VERSION::ERROR ecl,
+            const std::string& format,
+            const std::function<std::string(const QRCODE&)>& render);
+
+        /**
+        * @brief Retrieves the hit, miss and eviction counters and the current occupancy.
+        */
+        STATS STATS_GETTER() const;
+
+        /**
+        * @brief Drops every entry; the counters are kept.
+        */
+        void CLEAR();
+
+    private:
+        /**
+        * @brief Everything that identifies a symbol.
+        */
+        struct KEY
+        {
+            std::string payload;
+            QRCODE::VERSION::ERROR ecl;
+            int minVersion;
+            int maxVersion;
+            int mask;
+            bool boostEcl;
+            size_t hash;
+
+            bool operator==(const KEY& other) const;
+        };
+
+        // The index points at the key held by the LRU entry, so the payload is stored once
+        struct KEY_HASH
+        {
+            size_t operator()(const KEY* key) const { return key->hash; }
+        };
+
+        struct KEY_EQUAL
+        {
+            bool operator()(const KEY* a, const KEY* b) const { return *a == *b; }
+        };
+
+        struct ENTRY
+        {
+            KEY key;
+            std::shared_ptr<const QRCODE> symbol;
+            std::vector<std::pair<std::string, std::shared_ptr<const std::string>>> renders;
+            size_t bytes;
+        };
+
+        // Own cache line per shard so the locks do not false-share
+        struct alignas(64) SHARD
+        {
+            mutable std::mutex lock;
+            std::list<ENTRY> lru;    // Most recently used first
+            std::unordered_map<const KEY*, std::list<ENTRY>::iterator, KEY_HASH, KEY_EQUAL> index;
+            size_t bytes = 0;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::uint64_t evictions = 0;
+        };
+
+        static KEY MAKE_KEY(std::string_view text, QRCODE::VERSION::ERROR ecl, int minVersion, int maxVersion, int mask, bool boostEcl);
+
+        // Rough memory footprint of a symbol: packed modules, runs and the object itself
+        static size_t SYMBOL_BYTES(const QRCODE& qr);
+
+        // Bookkeeping of an entry besides ENTRY itself: the list links, and the index node
+        // (next pointer, value, cached hash) with its bucket slot
+        static constexpr size_t NODE_BYTES = 2 * sizeof(void*) +
+            sizeof(std::pair<const KEY* const, std::list<ENTRY>::iterator>) + 2 * sizeof(void*) + sizeof(size_t);
+
+        SHARD& SHARD_OF(const KEY& key);
+
+        // Evicts from the tail until the shard is back in budget, always keeping the newest entry.
+        // Must be called with the shard locked.
+        void TRIM(SHARD& shard);
+
+        std::shared_ptr<const QRCODE> LOOKUP_OR_ENCODE(const KEY& key, bool count);
+
+        size_t ShardBudget;
+
+        std::vector<std::unique_ptr<SHARD>> Shards;
+    };
+}
+
+inline bool QR::QRCACHE::KEY::operator==(const KEY& other) const
+{
+    return hash == other.hash && ecl == other.ecl && minVersion == other.minVersion &&
+        maxVersion == other.maxVersion && mask == other.mask && boostEcl == other.boostEcl &&
+        payload == other.payload;
+}
+
+inline QR::QRCACHE::QRCACHE(size_t byteBudget, size_t shardCount)
+{
+    if (shardCount == 0)
+        throw std::invalid_argument("Invalid value");
+
+    ShardBudget = byteBudget / shardCount;
+    for (size_t i = 0; i < shardCount; i++)
+        Shards.push_back(std::make_unique<SHARD>());
+}
+
+inline QR::QRCACHE::KEY QR::QRCACHE::MAKE_KEY(std::string_view text, QRCODE::VERSION::ERROR ecl,
+    int minVersion, int maxVersion, int mask, bool boostEcl)
+{
+    size_t hash = std::hash<std::string_view>()(text);
+    size_t params = static_cast<size_t>(ecl) | static_cast<size_t>(minVersion) << 2 |
+        static_cast<size_t>(maxVersion) << 8 | static_cast<size_t>(mask + 1) << 14 |
+        static_cast<size_t>(boostEcl) << 18;
+    hash ^= params + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+    return KEY{ std::string(text), ecl, minVersion, maxVersion, mask, boostEcl, hash };
+}
+
+inline size_t QR::QRCACHE::SYMBOL_BYTES(const QRCODE& qr)
+{
+    size_t size = static_cast<size_t>(qr.SIZE_GETTER());
+    return sizeof(QRCODE) + size * ((size + 63) / 64) * 8 + qr.RUNS_GETTER().BYTES_GETTER();
+}
+
+inline QR::QRCACHE::SHARD& QR::QRCACHE::SHARD_OF(const KEY& key)
+{
+    // High bits pick the shard; the low bits are used by the shard's own hash table
+    std::uint64_t hash = key.hash;
+    return *Shards[static_cast<size_t>((hash >> 32 ^ hash >> 16) % Shards.size())];
+}
+
+inline void QR::QRCACHE::TRIM(SHARD& shard)
+{
+    while (shard.bytes > ShardBudget && shard.lru.size() > 1)
+    {
+        ENTRY& victim = shard.lru.back();
+        shard.bytes -= victim.bytes;
+        shard.index.erase(&victim.key);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+}
+
+inline std::shared_ptr<const QR::QRCODE> QR::QRCACHE::LOOKUP_OR_ENCODE(const KEY& key, bool count)
+{
+    SHARD& shard = SHARD_OF(key);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto found = shard.index.find(&key);
+        if (found != shard.index.end())
+        {
+            shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+            if (count)
+                shard.hits++;
+            return found->second->symbol;
+        }
+        if (count)
+            shard.misses++;
+    }
+
+    // Encode without holding the lock; a concurrent miss on the same key keeps the first result.
+    // The payload may hold NUL bytes, and an empty one is a symbol without segments
+    std::vector<ENCODE> segments;
+    if (!key.payload.empty())
+        segments = ENCODE::MODE::MODE_CHOOSER(key.payload.data(), key.payload.size());
+    std::shared_ptr<const QRCODE> symbol = std::make_shared<const QRCODE>(QRCODE::ENCODE_SEGMENT(
+        segments, key.ecl, key.minVersion, key.maxVersion, key.mask, key.boostEcl));
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found = shard.index.find(&key);
+    if (found != shard.index.end())
+        return found->second->symbol;
+
+    size_t bytes = sizeof(ENTRY) + NODE_BYTES + key.payload.size() + SYMBOL_BYTES(*symbol);
+    shard.lru.push_front(ENTRY{ key, symbol, {}, bytes });
+    shard.index.emplace(&shard.lru.front().key, shard.lru.begin());
+    shard.bytes += bytes;
+    TRIM(shard);
+    return symbol;
+}
+
+inline std::shared_ptr<const QR::QRCODE> QR::QRCACHE::ENCODE_TEXT(std::string_view text, QRCODE::VERSION::ERROR ecl,
+    int minVersion, int maxVersion, int mask, bool boostEcl)
+{
+    return LOOKUP_OR_ENCODE(MAKE_KEY(text, ecl, minVersion, maxVersion, mask, boostEcl), true);
+}
+
+inline std::shared_ptr<const std::string> QR::QRCACHE::RENDER_TEXT(std::string_view text, QRCODE::VERSION::ERROR ecl,
+    const std::string& format,
+    const std::function<std::string(const QRCODE&)>& render)
+{
+    KEY key = MAKE_KEY(text, ecl, 1, 40, -1, true);
+    SHARD& shard = SHARD_OF(key);
+    {
+        std::lock_guard<std::mutex> guard(shard.lock);
+        auto found = shard.index.find(&key);
+        if (found != shard.index.end())
+        {
+            for (const auto& rendered : found->second->renders)
+            {
+                if (rendered.first == format)
+                {
+                    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+                    shard.hits++;
+                    return rendered.second;
+                }
+            }
+        }
+        shard.misses++;
+    }
+
+    std::shared_ptr<const QRCODE> symbol = LOOKUP_OR_ENCODE(key, false);
+    std::shared_ptr<const std::string> bytes = std::make_shared<const std::string>(render(*symbol));
+
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found = shard.index.find(&key);
+    if (found == shard.index.end())
+        return bytes;    // Evicted while rendering; hand the bytes out uncached
+
+    ENTRY& entry = *found->second;
+    for (const auto& rendered : entry.renders)
+    {
+        if (rendered.first == format)
+            return rendered.second;
+    }
+    entry.renders.emplace_back(format, bytes);
+    size_t added = format.size() + bytes->size() + sizeof(entry.renders[0]);
+    entry.bytes += added;
+    shard.bytes += added;
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    TRIM(shard);
+    return bytes;
+}
+
+inline QR::QRCACHE::STATS QR::QRCACHE::STATS_GETTER() const
+{
+    STATS stats{ 0, 0, 0, 0, 0 };
+    for (const std::unique_ptr<SHARD>& shard : Shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        stats.hits += shard->hits;
+        stats.misses += shard->misses;
+        stats.evictions += shard->evictions;
+        stats.entries += shard->lru.size();
+        stats.bytes += shard->bytes;
+    }
+    return stats;
+}
+
+inline void QR::QRCACHE::CLEAR()
+{
+    for (std::unique_ptr<SHARD>& shard : Shards)
+    {
+        std::lock_guard<std::mutex> guard(shard->lock);
+        shard->index.clear();
+        shard->lru.clear();
+        shard->bytes = 0;
+    }
+}
+
+#endif
@@ -5,9 +5,14 @@
 #include "QREncode.h"
 #include "ReedSolomon.h"
 #include "BitBuffer.h"
+#include "UrlCompact.h"
+#include "MatrixView.h"
+#include "RunGeometry.h"
 
 #include <sstream>
 #include <array>
+#include <climits>
+#include <bit>
 
 namespace QR
 {
@@ -147,14 +152,24 @@ namespace QR
         int maskPattern;
 
         /**
-         * @brief The 2D matrix representing the QR code.
+         * @brief Number of 64-bit words per packed row of `Matrix` and `isMasked`.
          */
-        std::vector<std::vector<bool>> Matrix;
+        size_t stride;
 
         /**
-         * @brief A 2D matrix indicating whether each module (pixel) in the QR code has been masked.
+         * @brief The QR code modules, packed as described in MATRIX_VIEW (first module in the top bit).
          */
-        std::vector<std::vector<bool>> isMasked;
+        std::vector<std::uint64_t> Matrix;
+
+        /**
+         * @brief Packed rows marking the function modules, which masking must leave alone.
+         */
+        std::vector<std::uint64_t> isMasked;
+
+        /**
+         * @brief Dark runs of every row, extracted once the final mask is applied.
+         */
+        RUN_GEOMETRY Runs;
 
         /**
          * @brief The version of the QR code (ranges from 1 to 40).
@@ -191,6 +206,95 @@ namespace QR
          */
         static const int PENALTY_N4;
 
+        /**
+         * @brief Starts a symbol: sizes the packed rows and draws the function patterns.
+         *
+         * The result is not masked yet; codewords are placed with DRAW_CODEWORDS.
+         */
+        QRCODE(int VERSION, QR::QRCODE::VERSION::ERROR ECL);
+
+        // Module writers. Only the encode stages call them, so a masked symbol cannot drift
+        // from the runs MASK_FINISH computed for it
+
+        /**
+         * @brief Places a position marker (finder pattern) at the specified coordinates (x, y).
+         *
+         * Position markers are used to define the corners of the QR code, aiding in alignment
+         * when scanned. They are typically found at the top-left, top-right, and bottom-left corners.
+         *
+         * @param x The x-coordinate of the position marker's starting point.
+         * @param y The y-coordinate of the position marker's starting point.
+         */
+        void POSITION_MARKER(int x, int y);
+
+        /**
+         * @brief Places an alignment marker at the specified coordinates (x, y).
+         *
+         * Alignment markers help correct distortions in the QR code when it's being scanned.
+         * They are more common in higher versions of QR codes.
+         *
+         * @param x The x-coordinate of the alignment marker's center.
+         * @param y The y-coordinate of the alignment marker's center.
+         */
+        void ALIGNMENT_MARKER(int x, int y);
+
+        /**
+         * @brief Applies a specified mask pattern to the QR code.
+         *
+         * Masking patterns are used to ensure that the data modules are evenly distributed,
+         * which helps avoid patterns that could confuse QR code readers.
+         *
+         * @param mask The mask pattern to apply.
+         */
+        void MASK_APPLY(int mask);
+
+        /**
+         * @brief Sets the color of a module (cell) at the specified coordinates (x, y).
+         *
+         * @param x The x-coordinate of the module.
+         * @param y The y-coordinate of the module.
+         * @param isColored Set to `true` to make the module black, `false` to make it white.
+         */
+        void SET_MODULE(int x, int y, bool isColored);
+
+        /**
+         * @brief Draws the version information pattern on the QR code.
+         *
+         * Version information is included for QR codes version 7 and above.
+         * It contains a 6-bit code and is placed near the alignment patterns.
+         * This function encodes the version number into a pattern that helps scanners
+         * to identify the QR code's version.
+         */
+        void DRAW_VERSION();
+
+        /**
+         * @brief Draws the format bits on the QR code based on the specified mask pattern.
+         *
+         * The format bits encode the error correction level and the mask pattern used for the QR code.
+         * These bits are crucial for QR code readers to decode the data correctly and are placed
+         * near the position markers.
+         *
+         * @param mask The mask pattern to be encoded in the format bits.
+         */
+        void DRAW_FORMAT_BITS(int mask);
+
+        /**
+         * @brief Draws all functional patterns onto the QR code matrix.
+         *
+         * This function handles the placement of various functional patterns
+         * that are required for a QR code to be scannable. These include position
+         * markers, alignment patterns, timing patterns, and other necessary structures
+         * like the dark module and reserved areas for format and version information.
+         */
+        void DRAW_FUNCTIONS();
+
+        /**
+         * @brief Draws the codewords into the QR code matrix.
+         *
+         * @param data A vector of 8-bit unsigned integers representing the QR code data.
+         */
+        void DRAW_CODEWORDS(const std::vector<std::uint8_t>& data);
+
     public:
         /**
          * @brief Constructs a QRCODE object with specified version, error correction level, data codewords, and mask pattern.
@@ -223,6 +327,19 @@ namespace QR
          */
         static QRCODE ENCODE_BINARY(const std::vector<std::uint8_t>& data, QR::QRCODE::VERSION::ERROR ecl);
 
+        /**
+         * @brief Encodes a URL after upper casing its case-insensitive parts (see URLCOMPACT).
+         *
+         * The scheme and host then fit in alphanumeric segments, while the path and query
+         * keep their exact spelling in byte segments.
+         *
+         * @param url The URL to encode.
+         * @param ecl The error correction level for the QR code.
+         * @param bitsSaved If not null, receives the number of data bits saved against ENCODE_TEXT.
+         * @return A QR code object representing the compacted URL.
+         */
+        static QRCODE ENCODE_URL(const char* url, QR::QRCODE::VERSION::ERROR ecl, int* bitsSaved = nullptr);
+
         /**
          * @brief Encodes multiple segments into a QR code.
          *
@@ -240,47 +357,83 @@ namespace QR
             int mask = -1,
             bool boostEcl = true);
 
+        /**
+         * @brief Parameters of a symbol that follow from its segments, before any codeword is built.
+         */
+        struct PLAN
+        {
+            int version;            // Smallest version in range holding the segments
+            VERSION::ERROR ecl;     // Requested level, raised if boosting was allowed and the data still fits
+            int dataBits;           // Segment bits, before the terminator and the padding
+        };
+
+        /*
+         * Staged encoding. ENCODE_SEGMENT runs these steps in order; callers that produce the
+         * symbol themselves can stop after any of them, keeping the output buffers of one call
+         * to reuse in the next:
+         *
+         *   PLAN_SEGMENTS -> DATA_CODEWORDS -> ECC_CODEWORDS -> PLACE -> MASK_FINISH
+         */
 
         /**
-         * @brief Places a position marker (finder pattern) at the specified coordinates (x, y).
+         * @brief Stage 1: chooses the version and final error correction level of the segments.
          *
-         * Position markers are used to define the corners of the QR code, aiding in alignment
-         * when scanned. They are typically found at the top-left, top-right, and bottom-left corners.
+         * The parameters have the same meaning as in ENCODE_SEGMENT.
          *
-         * @param x The x-coordinate of the position marker's starting point.
-         * @param y The y-coordinate of the position marker's starting point.
+         * @throws std::invalid_argument if the version range is invalid.
+         * @throws data_too_long if the segments do not fit in `maxVersion`.
          */
-        void POSITION_MARKER(int x, int y);
+        static PLAN PLAN_SEGMENTS(const std::vector<ENCODE>& segments, VERSION::ERROR ecl,
+            int minVersion = 1,
+            int maxVersion = 40,
+            bool boostEcl = true);
 
         /**
-         * @brief Places an alignment marker at the specified coordinates (x, y).
+         * @brief Stage 2: builds the data codewords, with the terminator and the pad bytes.
          *
-         * Alignment markers help correct distortions in the QR code when it's being scanned.
-         * They are more common in higher versions of QR codes.
+         * @param out Replaced by the GET_CAPACITY_CODEWORDS(plan.version, plan.ecl) codewords.
+         * @throws data_too_long if the segments do not fit the plan.
+         */
+        static void DATA_CODEWORDS(const std::vector<ENCODE>& segments, const PLAN& plan, std::vector<std::uint8_t>& out);
+
+        /**
+         * @brief Stage 3: adds the Reed-Solomon codewords of every block and interleaves the blocks.
          *
-         * @param x The x-coordinate of the alignment marker's center.
-         * @param y The y-coordinate of the alignment marker's center.
+         * This is the codeword stream in placement order, for hardware that draws the matrix itself.
+         *
+         * @param data The data codewords of stage 2.
+         * @param out Replaced by the GET_CAPACITY_BITS(version) / 8 codewords.
+         * @throws std::invalid_argument if `data` does not have the capacity of the version and level.
          */
-        void ALIGNMENT_MARKER(int x, int y);
+        static void ECC_CODEWORDS(int version, VERSION::ERROR ecl, const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>& out);
 
         /**
-         * @brief Applies a specified mask pattern to the QR code.
+         * @brief Stage 4: draws the function patterns and places the codewords of stage 3, unmasked.
          *
-         * Masking patterns are used to ensure that the data modules are evenly distributed,
-         * which helps avoid patterns that could confuse QR code readers.
+         * VIEW_GETTER shows the placed matrix, whose format area holds placeholder bits. The
+         * result is not a finished symbol: RUNS_GETTER is empty until MASK_FINISH is called.
          *
-         * @param mask The mask pattern to apply.
+         * @throws std::domain_error if the version or the number of codewords is wrong.
          */
-        void MASK_APPLY(int mask);
+        static QRCODE PLACE(int version, VERSION::ERROR ecl, const std::vector<std::uint8_t>& codewords);
 
         /**
-         * @brief Sets the color of a module (cell) at the specified coordinates (x, y).
+         * @brief Stage 5: applies a mask, or the one with the lowest penalty, and draws the format bits.
          *
-         * @param x The x-coordinate of the module.
-         * @param y The y-coordinate of the module.
-         * @param isColored Set to `true` to make the module black, `false` to make it white.
+         * @param mask The mask pattern (0 - 7), or -1 to choose it.
+         * @return The mask applied.
+         * @throws std::domain_error if `mask` is out of range.
+         * @throws std::invalid_argument if the symbol is already masked.
          */
-        void SET_MODULE(int x, int y, bool isColored);
+        int MASK_FINISH(int mask = -1);
+
+        /**
+         * @brief Retrieves the mask pattern of the symbol.
+         *
+         * @return The mask (0 - 7), or -1 for a placed symbol not masked yet.
+         */
+        int MASK_GETTER() const;
+
 
         /**
          * @brief Retrieves the color status of a module at the specified coordinates (x, y).
@@ -318,29 +471,6 @@ namespace QR
 
 
 
-        /**
-        * @brief Draws the version information pattern on the QR code.
-        *
-        * Version information is included for QR codes version 7 and above.
-        * It contains a 6-bit code and is placed near the alignment patterns.
-        * This function encodes the version number into a pattern that helps scanners
-        * to identify the QR code's version.
-        */
-        void DRAW_VERSION();
-
-
-        /**
-        * @brief Draws the format bits on the QR code based on the specified mask pattern.
-        *
-        * The format bits encode the error correction level and the mask pattern used for the QR code.
-        * These bits are crucial for QR code readers to decode the data correctly and are placed
-        * near the position markers.
-        *
-        * @param mask The mask pattern to be encoded in the format bits.
-        */
-        void DRAW_FORMAT_BITS(int mask);
-
-
         /**
         * @brief Retrieves the alignment pattern positions for the current QR code version.
         *
@@ -381,23 +511,6 @@ namespace QR
         void printMask();
 
 
-        /**
-        * @brief Draws all functional patterns onto the QR code matrix.
-        *
-        * This function handles the placement of various functional patterns
-        * that are required for a QR code to be scannable. These include position
-        * markers, alignment patterns, timing patterns, and other necessary structures
-        * like the dark module and reserved areas for format and version information.
-        */
-        void DRAW_FUNCTIONS();
-
-        /**
-        * @brief Draws the codewords into the QR code matrix.
-        *
-        * @param data A vector of 8-bit unsigned integers representing the QR code data.
-        */
-        void DRAW_CODEWORDS(const std::vector<std::uint8_t>& data);
-
         /**
          * @brief Counts penalty patterns based on the run history.
          *
@@ -432,12 +545,28 @@ namespace QR
         long GET_PENALY_SCORE() const;
 
         /**
-         * @brief Retrieves the QR code matrix.
+         * @brief Retrieves a copy of the QR code matrix.
+         *
+         * Prefer VIEW_GETTER, which reads the packed rows in place.
          *
          * @return A 2D vector of booleans representing the QR code matrix.
          */
         const std::vector<std::vector<bool>> MATRIX_GETTER() const;
 
+        /**
+         * @brief Retrieves a read-only view of the packed modules, without copying them.
+         *
+         * @return A view valid for the lifetime of this QRCODE.
+         */
+        MATRIX_VIEW VIEW_GETTER() const;
+
+        /**
+         * @brief Retrieves the run-length description of the symbol, computed once at construction.
+         *
+         * @return The dark runs of every row, shared by all renderers.
+         */
+        const RUN_GEOMETRY& RUNS_GETTER() const;
+
         const std::vector<std::vector<unsigned char>> CONVERT(const std::vector<std::vector<bool>>& Matrix1);
     };
 
@@ -448,26 +577,48 @@ namespace QR
     };
 }
 
+inline QR::QRCODE::QRCODE(int VERSION, QR::QRCODE::VERSION::ERROR ECL)
+    : version(VERSION), mask(-1), ErrorCorrection(ECL)
+{
+    if (VERSION < 1 || VERSION > 40)
+        throw std::domain_error("value out of range");
+    size = VERSION * 4 + 17;
+    stride = (static_cast<size_t>(size) + 63) / 64;
+
+    Matrix.assign(stride * static_cast<size_t>(size), 0);
+    isMasked.assign(stride * static_cast<size_t>(size), 0);
+
+    DRAW_FUNCTIONS();
+}
+
 QR::QRCODE::QRCODE(int VERSION,
     QR::QRCODE::VERSION::ERROR ECL,
     std::vector<std::uint8_t>& DataCodeWords,
     int MASK)
-    : version(VERSION), ErrorCorrection(ECL)
+    : QRCODE(VERSION, ECL)
 {
-    if (VERSION < 1 || VERSION > 40)
-        throw std::domain_error("value out of range");
     if (MASK < -1 || MASK > 7)
         throw std::domain_error("value out of range");
-    size = VERSION * 4 + 17;
 
-    size_t sz = static_cast<size_t>(size);
+    std::vector<std::uint8_t> allcodewords;
+    ECC_CODEWORDS(version, ErrorCorrection, DataCodeWords, allcodewords);
+    DRAW_CODEWORDS(allcodewords);
+    MASK_FINISH(MASK);
+}
 
-    Matrix = std::vector<std::vector<bool>>(sz, std::vector<bool>(sz));
-    isMasked = std::vector<std::vector<bool>>(sz, std::vector<bool>(sz));
+inline QR::QRCODE QR::QRCODE::PLACE(int version, VERSION::ERROR ecl, const std::vector<std::uint8_t>& codewords)
+{
+    QRCODE placed(version, ecl);
+    placed.DRAW_CODEWORDS(codewords);
+    return placed;
+}
 
-    DRAW_FUNCTIONS();
-    const std::vector<std::uint8_t> allcodewords = ADD_ECC_INTER(DataCodeWords);
-    DRAW_CODEWORDS(allcodewords);
+inline int QR::QRCODE::MASK_FINISH(int MASK)
+{
+    if (MASK < -1 || MASK > 7)
+        throw std::domain_error("value out of range");
+    if (mask != -1)
+        throw std::invalid_argument("Invalid value");
 
     // Do masking
     if (MASK == -1) {  // Automatically choose best mask
@@ -491,6 +642,15 @@ QR::QRCODE::QRCODE(int VERSION,
     isMasked.clear();
     isMasked.shrink_to_fit();
 
+    // The module writers are private and MASK_FINISH runs once, so the symbol is immutable
+    // from here on and the runs can be shared by every renderer
+    Runs = RUN_GEOMETRY(VIEW_GETTER());
+    return MASK;
+}
+
+inline int QR::QRCODE::MASK_GETTER() const
+{
+    return mask;
 }
 
 inline QR::QRCODE QR::QRCODE::ENCODE_TEXT(const char* text, QR::QRCODE::VERSION::ERROR ecl)
@@ -505,14 +665,45 @@ inline QR::QRCODE QR::QRCODE::ENCODE_BINARY(const std::vector<std::uint8_t>& dat
     return ENCODE_SEGMENT(segments, ecl);
 }
 
+inline QR::QRCODE QR::QRCODE::ENCODE_URL(const char* url, QR::QRCODE::VERSION::ERROR ecl, int* bitsSaved)
+{
+    // The best split depends on the character count widths, so segment once per version group
+    const int groups[3][2] = { {1, 9}, {10, 26}, {27, 40} };
+    for (int g = 0; g < 3; g++)
+    {
+        URLCOMPACT::RESULT compact = URLCOMPACT::COMPACT(url, groups[g][1]);
+        int dataUseBits = ENCODE::GET_TOTAL_BITS(compact.SEGMENTS, groups[g][1]);
+        if (g < 2 && (dataUseBits == -1 ||
+            dataUseBits > VERSION::GET_CAPACITY_CODEWORDS(groups[g][1], ecl) * 8))
+            continue;
+        if (bitsSaved != nullptr)
+            *bitsSaved = compact.BITS_SAVED;
+        return ENCODE_SEGMENT(compact.SEGMENTS, ecl, groups[g][0], groups[g][1]);
+    }
+    throw std::logic_error("Unreachable");
+}
+
 inline QR::QRCODE QR::QRCODE::ENCODE_SEGMENT(const std::vector<ENCODE>& segments, VERSION::ERROR ecl,
     int minVersion,
     int maxVersion,
     int msk,
     bool boostEcl)
 {
-    if (!(VERSION::MIN_VERSION <= minVersion && VERSION::MAX_VERSION >= maxVersion && minVersion <= maxVersion) ||
-        msk < -1 || msk > 7)
+    if (msk < -1 || msk > 7)
+        throw std::invalid_argument("Invalid value");
+
+    const PLAN plan = PLAN_SEGMENTS(segments, ecl, minVersion, maxVersion, boostEcl);
+    std::vector<std::uint8_t> dataCodeWord;
+    DATA_CODEWORDS(segments, plan, dataCodeWord);
+    return QRCODE(plan.version, plan.ecl, dataCodeWord, msk);
+}
+
+inline QR::QRCODE::PLAN QR::QRCODE::PLAN_SEGMENTS(const std::vector<ENCODE>& segments, VERSION::ERROR ecl,
+    int minVersion,
+    int maxVersion,
+    bool boostEcl)
+{
+    if (!(VERSION::MIN_VERSION <= minVersion && VERSION::MAX_VERSION >= maxVersion && minVersion <= maxVersion))
     {
         throw std::invalid_argument("Invalid value");
     }
@@ -544,30 +735,34 @@ inline QR::QRCODE QR::QRCODE::ENCODE_SEGMENT(const std::vector<ENCODE>& segments
         if (boostEcl && dataUseBits <= QR::QRCODE::VERSION::GET_CAPACITY_CODEWORDS(version, newEcl) * 8)
             ecl = newEcl;
     }
+    return PLAN{ version, ecl, dataUseBits };
+}
+
+inline void QR::QRCODE::DATA_CODEWORDS(const std::vector<ENCODE>& segments, const PLAN& plan, std::vector<std::uint8_t>& out)
+{
+    size_t data_capacity = static_cast<size_t>(QRCODE::VERSION::GET_CAPACITY_CODEWORDS(plan.version, plan.ecl)) * 8;
+    int dataUseBits = QR::ENCODE::GET_TOTAL_BITS(segments, plan.version);
+    if (dataUseBits == -1 || static_cast<size_t>(dataUseBits) > data_capacity)
+        throw data_too_long("segment too long");
 
     BITBUFFER buffer;
+    buffer.reserve(data_capacity);
 
     for (const ENCODE& moder : segments)
     {
         buffer.APPEND_BITS(static_cast<uint32_t>(moder.MODE_GETTER().MODE_BITS()), 4);
         buffer.APPEND_BITS(static_cast<uint32_t>(moder.SIZE_GETTER()),
-            moder.MODE_GETTER().CHAR_COUNTER_BITS(version));
-        buffer.insert(buffer.end(), moder.DATA_GETTER().begin(),
-            moder.DATA_GETTER().end());
+            moder.MODE_GETTER().CHAR_COUNTER_BITS(plan.version));
+        buffer.APPEND_BUFFER(moder.DATA_GETTER());
     }
     assert(buffer.size() == static_cast<unsigned int>(dataUseBits));
-    size_t data_capacity = static_cast<size_t>(QRCODE::VERSION::GET_CAPACITY_CODEWORDS(version, ecl)) * 8;
     buffer.APPEND_BITS(0, std::min(4, static_cast<int>(data_capacity - buffer.size())));
     buffer.APPEND_BITS(0, (8 - static_cast<int>(buffer.size() % 8)) % 8);
 
     for (std::uint8_t pad_byte = 0xEC; buffer.size() < data_capacity; pad_byte ^= 0xEC ^ 0x11)
         buffer.APPEND_BITS(pad_byte, 8);
 
-    std::vector<std::uint8_t> dataCodeWord(buffer.size() / 8);
-    for (size_t i = 0; i < buffer.size(); i++)
-        dataCodeWord.at(i >> 3) |= (buffer.at(i) ? 1 : 0) << (7 - (i & 7));
-
-    return QRCODE(version, ecl, dataCodeWord, msk);
+    buffer.TO_BYTES(out);
 }
 
 
@@ -644,48 +839,54 @@ void QR::QRCODE::MASK_APPLY(int mask)
 
     for (size_t y = 0; y < s; y++)
     {
-        for (size_t x = 0; x < s; x++)
+        for (size_t w = 0; w < stride; w++)
         {
-            bool invert = false;
-            switch (maskPattern)
+            // Gather the inversions of up to 64 modules, then flip the word once
+            std::uint64_t inverted = 0;
+            for (size_t x = w * 64; x < std::min(s, w * 64 + 64); x++)
             {
-            case 0:
-                invert = (x + y) % 2 == 0;
-                break;
-            case 1:
-                invert = y % 2 == 0;
-                break;
-            case 2:
-                invert = x % 3 == 0;
-                break;
-            case 3:
-                invert = (x + y) % 3 == 0;
-                break;
-            case 4:
-                invert = (x / 3 + y / 2) % 2 == 0;
-                break;
-            case 5:
-                invert = x * y % 2 + x * y % 3 == 0;
-                break;
-            case 6:
-                invert = (x + y % 2 + x + y % 3) == 0;
-                break;
-            case 7:
-                invert = ((x + y) % 2 + x * y % 3) % 2 == 0;
-                break;
-            default:
-                throw std::invalid_argument("Invalid mask pattern");
+                bool invert = false;
+                switch (maskPattern)
+                {
+                case 0:
+                    invert = (x + y) % 2 == 0;
+                    break;
+                case 1:
+                    invert = y % 2 == 0;
+                    break;
+                case 2:
+                    invert = x % 3 == 0;
+                    break;
+                case 3:
+                    invert = (x + y) % 3 == 0;
+                    break;
+                case 4:
+                    invert = (x / 3 + y / 2) % 2 == 0;
+                    break;
+                case 5:
+                    invert = x * y % 2 + x * y % 3 == 0;
+                    break;
+                case 6:
+                    invert = (x + y % 2 + x + y % 3) == 0;
+                    break;
+                case 7:
+                    invert = ((x + y) % 2 + x * y % 3) % 2 == 0;
+                    break;
+                default:
+                    throw std::invalid_argument("Invalid mask pattern");
+                }
+                inverted |= static_cast<std::uint64_t>(invert) << (63 - (x & 63));
             }
-            Matrix[y][x] = Matrix[y][x] ^ (invert & !isMasked[y][x]);
+            Matrix[y * stride + w] ^= inverted & ~isMasked[y * stride + w];
         }
     }
 }
 
 void QR::QRCODE::printMask()
 {
-    for (const auto& row : Matrix) {
-        for (bool val : row) {
-            std::cout << (val ? "1" : "0") << " ";
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            std::cout << (MODULE(x, y) ? "1" : "0") << " ";
         }
         std::cout << std::endl;
     }
@@ -693,17 +894,17 @@ void QR::QRCODE::printMask()
 
 inline void QR::QRCODE::SET_MODULE(int x, int y, bool isColored)
 {
-    size_t dx = static_cast<size_t>(x);
-    size_t dy = static_cast<size_t>(y);
+    size_t index = static_cast<size_t>(y) * stride + (static_cast<size_t>(x) >> 6);
+    std::uint64_t bit = std::uint64_t(1) << (63 - (x & 63));
 
-    Matrix[dy][dx] = isColored;  
-    isMasked[dy][dx] = true;
+    Matrix[index] = isColored ? Matrix[index] | bit : Matrix[index] & ~bit;
+    isMasked[index] |= bit;
 }
 
 
 inline bool QR::QRCODE::MODULE(int x, int y) const
 {
-    return Matrix[static_cast<size_t>(y)][static_cast<size_t>(x)];
+    return ((Matrix[static_cast<size_t>(y) * stride + (static_cast<size_t>(x) >> 6)] >> (63 - (x & 63))) & 1) != 0;
 }
 
 inline bool QR::QRCODE::GET_MODULE(int x, int y) const
@@ -800,40 +1001,41 @@ std::vector<int> QR::QRCODE::ALIGMNET_PATTERN_GETTER() const
 
 inline std::vector<std::uint8_t> QR::QRCODE::ADD_ECC_INTER(const std::vector<std::uint8_t>& data) const
 {
-    if (data.size() != static_cast<unsigned int>(QR::QRCODE::VERSION::GET_CAPACITY_CODEWORDS(version, ErrorCorrection)))
+    std::vector<std::uint8_t> result;
+    ECC_CODEWORDS(version, ErrorCorrection, data, result);
+    return result;
+}
+
+inline void QR::QRCODE::ECC_CODEWORDS(int version, VERSION::ERROR ecl, const std::vector<std::uint8_t>& data, std::vector<std::uint8_t>& out)
+{
+    if (data.size() != static_cast<unsigned int>(QR::QRCODE::VERSION::GET_CAPACITY_CODEWORDS(version, ecl)))
         throw std::invalid_argument("Invalid argument");
 
-    int numBlocks = QR::QRCODE::VERSION::NUM_ERROR_CORRECTION_BLOCKS[static_cast<int>(ErrorCorrection)][version];
-    int blockEcc = QR::QRCODE::VERSION::ECC_CODEWORDS_PER_BLOCK[static_cast<int>(ErrorCorrection)][version];
+    int numBlocks = QR::QRCODE::VERSION::NUM_ERROR_CORRECTION_BLOCKS[static_cast<int>(ecl)][version];
+    int blockEcc = QR::QRCODE::VERSION::ECC_CODEWORDS_PER_BLOCK[static_cast<int>(ecl)][version];
     int rawCodeWords = QR::QRCODE::VERSION::GET_CAPACITY_BITS(version) / 8;
     int numShortBlocks = numBlocks - rawCodeWords % numBlocks;
-    int shortBlockLen = rawCodeWords / numBlocks;
+    int shortData = rawCodeWords / numBlocks - blockEcc;
 
-    std::vector<std::vector<std::uint8_t>> blocks;
     const std::vector<std::uint8_t> rsDivisor = REEDSOLOMON::COMPUTE_DIVISOR(blockEcc);
 
+    // Interleaved straight into place: codeword j of every block in turn, the extra data
+    // codeword of the long blocks after the others, then the ECC codewords likewise
+    out.resize(static_cast<size_t>(rawCodeWords));
+    std::vector<std::uint8_t> block;
     for (int i = 0, k = 0; i < numBlocks; i++) {
-        std::vector<uint8_t> dat(data.cbegin() + k, data.cbegin() + (k + shortBlockLen - blockEcc + (i < numShortBlocks ? 0 : 1)));
-        k += static_cast<int>(dat.size());
-        const std::vector<uint8_t> ecc = QR::REEDSOLOMON::COMPUTE_REMAINDER(dat, rsDivisor);
-        if (i < numShortBlocks)
-            dat.push_back(0);
-        dat.insert(dat.end(), ecc.cbegin(), ecc.cend());
-        blocks.push_back(std::move(dat));
-    }
-
-    std::vector<std::uint8_t> result;
-    for (size_t i = 0; i < blocks[0].size(); i++)
-    {
-        for (size_t j = 0; j < blocks.size(); j++)
-        {
-            if (i != static_cast<unsigned int>(shortBlockLen - blockEcc) ||
-                j >= static_cast<unsigned int>(numShortBlocks))
-                result.push_back(blocks[j][i]);
-        }
+        int length = shortData + (i < numShortBlocks ? 0 : 1);
+        block.assign(data.cbegin() + k, data.cbegin() + k + length);
+        k += length;
+        for (int j = 0; j < shortData; j++)
+            out[static_cast<size_t>(j) * numBlocks + i] = block[static_cast<size_t>(j)];
+        if (i >= numShortBlocks)
+            out[static_cast<size_t>(shortData) * numBlocks + (i - numShortBlocks)] = block[static_cast<size_t>(shortData)];
+
+        const std::vector<uint8_t> ecc = QR::REEDSOLOMON::COMPUTE_REMAINDER(block, rsDivisor);
+        for (int j = 0; j < blockEcc; j++)
+            out[data.size() + static_cast<size_t>(j) * numBlocks + i] = ecc[static_cast<size_t>(j)];
     }
-    assert(result.size() == static_cast<unsigned int>(rawCodeWords));
-    return result;
 }
 
 inline void QR::QRCODE::DRAW_FUNCTIONS()
@@ -881,8 +1083,13 @@ inline void QR::QRCODE::DRAW_CODEWORDS(const std::vector<std::uint8_t>& data)
                 size_t x = static_cast<size_t>(right - j);  // Actual x coordinate
                 bool upward = ((right + 1) & 2) == 0;
                 size_t y = static_cast<size_t>(upward ? size - 1 - vert : vert);  // Actual y coordinate
-                if (!isMasked.at(y).at(x) && i < data.size() * 8) {
-                    Matrix.at(y).at(x) = BITBUFFER::BINARY_BITS(data.at(i >> 3), 7 - static_cast<int>(i & 7));
+                size_t index = y * stride + (x >> 6);
+                std::uint64_t bit = std::uint64_t(1) << (63 - (x & 63));
+                if (!(isMasked.at(index) & bit) && i < data.size() * 8) {
+                    if (BITBUFFER::BINARY_BITS(data.at(i >> 3), 7 - static_cast<int>(i & 7)))
+                        Matrix[index] |= bit;
+                    else
+                        Matrix[index] &= ~bit;
                     i++;
                 }
             }
@@ -1007,13 +1214,10 @@ inline long QR::QRCODE::GET_PENALY_SCORE() const
         }
     }
 
+    // Padding bits past the last module are always zero, so whole words can be counted
     int dark = 0;
-    for (const std::vector<bool>& row : Matrix) {
-        for (bool color : row) {
-            if (color)
-                dark++;
-        }
-    }
+    for (std::uint64_t word : Matrix)
+        dark += std::popcount(word);
     int total = size * size;
     int k = static_cast<int>((std::abs(dark * 20L - total * 10L) + total - 1) / total) - 1;
     assert(0 <= k && k <= 9);
@@ -1028,7 +1232,21 @@ inline long QR::QRCODE::GET_PENALY_SCORE() const
 
 inline const std::vector<std::vector<bool>> QR::QRCODE::MATRIX_GETTER() const
 {
-    return Matrix;
+    std::vector<std::vector<bool>> matrix(static_cast<size_t>(size), std::vector<bool>(static_cast<size_t>(size)));
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++)
+            matrix[static_cast<size_t>(y)][static_cast<size_t>(x)] = MODULE(x, y);
+    return matrix;
+}
+
+inline QR::MATRIX_VIEW QR::QRCODE::VIEW_GETTER() const
+{
+    return MATRIX_VIEW(Matrix.data(), size, stride);
+}
+
+inline const QR::RUN_GEOMETRY& QR::QRCODE::RUNS_GETTER() const
+{
+    return Runs;
 }
 
 const std::vector<std::vector<unsigned char>> QR::QRCODE::CONVERT(const std::vector<std::vector<bool>>& Matrix1)
@@ -0,0 +1,256 @@
+#ifndef QRCODESET_H
+#define QRCODESET_H
+
+#include "QRCode.h"
+
+#include <future>
+#include <cstring>
+
+namespace QR
+{
+    /**
+    * @brief A Structured Append set: one message split over up to 16 symbols.
+    *
+    * Every symbol starts with a Structured Append header (mode 0x3) holding its position,
+    * the number of symbols and the parity of the whole message, so a reader can put the
+    * message back together in any scanning order. This lifts the version 40 capacity limit
+    * and keeps large payloads in several small, fast to scan symbols.
+    */
+    class QRCODESET
+    {
+    public:
+        /**
+        * @brief Maximum number of symbols in a Structured Append set.
+        */
+        static constexpr int MAX_SYMBOLS = 16;
+
+        /**
+        * @brief Criterion used to choose how many symbols a message is split into.
+        */
+        enum class OBJECTIVE
+        {
+            TOTAL_MODULES,     // Smallest sum of modules over all symbols
+            LARGEST_VERSION    // Smallest version of the biggest symbol, then fewest modules
+        };
+
+        /**
+        * @brief Encodes a text string into a Structured Append set.
+        *
+        * @param text The input text to encode.
+        * @param ecl The error correction level for every symbol.
+        * @param objective The criterion used to pick the split.
+        * @param maxSymbols Upper bound on the number of symbols (1 - 16).
+        * @return The set of symbols, encoded in parallel.
+        *
+        * @throws data_too_long if the text does not fit in `maxSymbols` version 40 symbols.
+        */
+        static QRCODESET ENCODE_TEXT(const char* text, QRCODE::VERSION::ERROR ecl,
+            OBJECTIVE objective = OBJECTIVE::TOTAL_MODULES,
+            int maxSymbols = MAX_SYMBOLS);
+
+        /**
+        * @brief Encodes binary data into a Structured Append set using byte mode segments.
+        *
+        * @param data The bytes to encode.
+        * @param ecl The error correction level for every symbol.
+        * @param objective The criterion used to pick the split.
+        * @param maxSymbols Upper bound on the number of symbols (1 - 16).
+        * @return The set of symbols, encoded in parallel.
+        *
+        * @throws data_too_long if the data does not fit in `maxSymbols` version 40 symbols.
+        */
+        static QRCODESET ENCODE_BINARY(const std::vector<std::uint8_t>& data, QRCODE::VERSION::ERROR ecl,
+            OBJECTIVE objective = OBJECTIVE::TOTAL_MODULES,
+            int maxSymbols = MAX_SYMBOLS);
+
+        /**
+        * @brief Retrieves the symbols of the set, in sequence order.
+        */
+        const std::vector<QRCODE>& SYMBOLS_GETTER() const;
+
+        /**
+        * @brief Retrieves the number of symbols in the set.
+        */
+        int COUNT_GETTER() const;
+
+        /**
+        * @brief Retrieves the parity byte (XOR of every message byte) shared by the symbols.
+        */
+        std::uint8_t PARITY_GETTER() const;
+
+    private:
+        /**
+        * @brief Segments and version chosen for one chunk of the message.
+        */
+        struct PLAN
+        {
+            int version;
+            std::vector<ENCODE> segments;
+        };
+
+        QRCODESET(std::vector<QRCODE>&& symbols, std::uint8_t parity);
+
+        /**
+        * @brief Finds the smallest version holding a chunk plus its Structured Append header.
+        *
+        * @return False if the chunk does not fit in a version 40 symbol.
+        */
+        static bool PLAN_CHUNK(const char* data, size_t length, bool text, QRCODE::VERSION::ERROR ecl, PLAN& plan);
+
+        static QRCODESET ENCODE_MESSAGE(const char* data, size_t length, bool text, QRCODE::VERSION::ERROR ecl,
+            OBJECTIVE objective, int maxSymbols);
+
+        std::vector<QRCODE> Symbols;
+
+        std::uint8_t Parity;
+    };
+}
+
+inline QR::QRCODESET::QRCODESET(std::vector<QRCODE>&& symbols, std::uint8_t parity)
+    : Symbols(std::move(symbols)), Parity(parity)
+{
+}
+
+inline QR::QRCODESET QR::QRCODESET::ENCODE_TEXT(const char* text, QRCODE::VERSION::ERROR ecl,
+    OBJECTIVE objective, int maxSymbols)
+{
+    return ENCODE_MESSAGE(text, std::strlen(text), true, ecl, objective, maxSymbols);
+}
+
+inline QR::QRCODESET QR::QRCODESET::ENCODE_BINARY(const std::vector<std::uint8_t>& data, QRCODE::VERSION::ERROR ecl,
+    OBJECTIVE objective, int maxSymbols)
+{
+    return ENCODE_MESSAGE(reinterpret_cast<const char*>(data.data()), data.size(), false, ecl, objective, maxSymbols);
+}
+
+inline const std::vector<QR::QRCODE>& QR::QRCODESET::SYMBOLS_GETTER() const
+{
+    return Symbols;
+}
+
+inline int QR::QRCODESET::COUNT_GETTER() const
+{
+    return static_cast<int>(Symbols.size());
+}
+
+inline std::uint8_t QR::QRCODESET::PARITY_GETTER() const
+{
+    return Parity;
+}
+
+inline bool QR::QRCODESET::PLAN_CHUNK(const char* data, size_t length, bool text, QRCODE::VERSION::ERROR ecl, PLAN& plan)
+{
+    // Mode indicator (4 bits) and header (16 bits) of the Structured Append segment
+    const int headerBits = 20;
+    const int groups[3][2] = { {1, 9}, {10, 26}, {27, 40} };
+
+    for (int g = 0; g < 3; g++)
+    {
+        std::vector<ENCODE> segments;
+        if (text)
+            segments = ENCODE::MODE::MODE_SEGMENTER(data, length, groups[g][1]);
+        else
+            segments.push_back(ENCODE::MODE::BYTE_TO_BINARY(std::vector<std::uint8_t>(
+                reinterpret_cast<const std::uint8_t*>(data), reinterpret_cast<const std::uint8_t*>(data) + length)));
+
+        int dataBits = ENCODE::GET_TOTAL_BITS(segments, groups[g][1]);
+        if (dataBits == -1)
+            continue;
+
+        for (int version = groups[g][0]; version <= groups[g][1]; version++)
+        {
+            if (headerBits + dataBits <= QRCODE::VERSION::GET_CAPACITY_CODEWORDS(version, ecl) * 8)
+            {
+                plan.version = version;
+                plan.segments = std::move(segments);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+inline QR::QRCODESET QR::QRCODESET::ENCODE_MESSAGE(const char* data, size_t length, bool text, QRCODE::VERSION::ERROR ecl,
+    OBJECTIVE objective, int maxSymbols)
+{
+    if (length == 0)
+        throw std::domain_error("Invalid value");
+    if (maxSymbols < 1 || maxSymbols > MAX_SYMBOLS)
+        throw std::invalid_argument("Invalid value");
+
+    std::uint8_t parity = 0;
+    for (size_t i = 0; i < length; i++)
+        parity ^= static_cast<std::uint8_t>(data[i]);
+
+    // Try every symbol count with an even split and keep the best one for the objective
+    std::vector<PLAN> best;
+    long bestModules = LONG_MAX;
+    int bestVersion = INT_MAX;
+
+    for (int count = 1; count <= maxSymbols && static_cast<size_t>(count) <= length; count++)
+    {
+        std::vector<PLAN> plans(static_cast<size_t>(count));
+        long modules = 0;
+        int largest = 0;
+        bool fits = true;
+
+        size_t start = 0;
+        for (int i = 0; i < count && fits; i++)
+        {
+            size_t chunk = length / count + (static_cast<size_t>(i) < length % count ? 1 : 0);
+            fits = PLAN_CHUNK(data + start, chunk, text, ecl, plans[i]);
+            start += chunk;
+
+            if (fits)
+            {
+                long size = plans[i].version * 4 + 17;
+                modules += size * size;
+                largest = std::max(largest, plans[i].version);
+            }
+        }
+        if (!fits)
+            continue;
+
+        bool better = objective == OBJECTIVE::TOTAL_MODULES
+            ? modules < bestModules
+            : largest < bestVersion || (largest == bestVersion && modules < bestModules);
+        if (better)
+        {
+            best = std::move(plans);
+            bestModules = modules;
+            bestVersion = largest;
+        }
+    }
+
+    if (best.empty())
+    {
+        std::ostringstream sb;
+        sb << "Data length = " << length << " bytes does not fit in " << maxSymbols << " symbols";
+        throw data_too_long(sb.str());
+    }
+
+    // The symbols are independent, so each one is built on its own thread
+    int total = static_cast<int>(best.size());
+    std::vector<std::future<QRCODE>> pending;
+    for (int i = 0; i < total; i++)
+    {
+        pending.push_back(std::async(std::launch::async, [&best, i, total, parity, ecl]()
+            {
+                std::vector<ENCODE> segments;
+                segments.reserve(best[i].segments.size() + 1);
+                segments.push_back(ENCODE::MODE::STRUCTURED_APPEND_TO_BINARY(i, total, parity));
+                for (const ENCODE& segment : best[i].segments)
+                    segments.push_back(segment);
+                return QRCODE::ENCODE_SEGMENT(segments, ecl, best[i].version, best[i].version);
+            }));
+    }
+
+    std::vector<QRCODE> symbols;
+    symbols.reserve(pending.size());
+    for (std::future<QRCODE>& symbol : pending)
+        symbols.push_back(symbol.get());
+
+    return QRCODESET(std::move(symbols), parity);
+}
+
+#endif
@@ -6,8 +6,12 @@
 #include <vector>
 #include <cstdlib>
 #include <cassert>
+#include <climits>
+#include <array>
+#include <algorithm>
 
 #include"BitBuffer.h"
+#include "CharClass.h"
 
 // QR namespace that encapsulates the QR code-related functionality
 namespace QR
@@ -69,6 +73,11 @@ namespace QR
             */
             static const MODE ECI;
 
+            /**
+            * @brief Predefined constant static instance representing Structured Append mode (0x3).
+            */
+            static const MODE STRUCTURED_APPEND;
+
             /**
             * @brief Checks if the given input string consists only of alphanumeric characters.
             *
@@ -109,6 +118,11 @@ namespace QR
             */
             static ENCODE NUMERIC_TO_BINARY(const char* input);
 
+            /**
+            * @brief NUMERIC_TO_BINARY for `length` digits that are not NUL-terminated.
+            */
+            static ENCODE NUMERIC_TO_BINARY(const char* input, size_t length);
+
             /**
             * @brief Converts an alphanumeric input to its binary representation.
             *
@@ -117,6 +131,11 @@ namespace QR
             */
             static ENCODE ALPHANUMERIC_TO_BINARY(const char* input);
 
+            /**
+            * @brief ALPHANUMERIC_TO_BINARY for `length` characters that are not NUL-terminated.
+            */
+            static ENCODE ALPHANUMERIC_TO_BINARY(const char* input, size_t length);
+
             /**
             * @brief Converts a byte input to its binary representation.
             *
@@ -125,6 +144,11 @@ namespace QR
             */
             static ENCODE BYTE_TO_BINARY(const std::vector<std::uint8_t>& input);
 
+            /**
+            * @brief BYTE_TO_BINARY for `length` bytes starting at `input`.
+            */
+            static ENCODE BYTE_TO_BINARY(const std::uint8_t* input, size_t length);
+
             /**
             * @brief Converts an ECI input to its binary representation.
             *
@@ -133,6 +157,16 @@ namespace QR
             */
             static ENCODE ECI_TO_BINARY(long input);
 
+            /**
+            * @brief Builds the Structured Append header placed first in every symbol of a set.
+            *
+            * @param index Position of the symbol in the set (0 - 15).
+            * @param total Number of symbols in the set (1 - 16).
+            * @param parity XOR of every byte of the complete, unsplit message.
+            * @return An ENCODE object holding the 16 header bits (no character count field).
+            */
+            static ENCODE STRUCTURED_APPEND_TO_BINARY(int index, int total, std::uint8_t parity);
+
             /**
             * @brief Chooses the appropriate mode for encoding the input string into segments.
             *
@@ -141,6 +175,29 @@ namespace QR
             */
             static std::vector<ENCODE> MODE_CHOOSER(const char* input);
 
+            /**
+            * @brief MODE_CHOOSER for characters that are not NUL-terminated, such as a field
+            * of a mapped file; they may contain NUL bytes, which are encoded in byte mode.
+            *
+            * @param input Pointer to the characters to encode.
+            * @param length Number of characters to encode.
+            */
+            static std::vector<ENCODE> MODE_CHOOSER(const char* input, size_t length);
+
+            /**
+            * @brief Splits the input into numeric, alphanumeric and byte segments so that the
+            * total bit length is minimal for the given version.
+            *
+            * The split depends on the character count field widths, which change at
+            * versions 10 and 27, so the result is only optimal inside the version group of `version`.
+            *
+            * @param input Pointer to the characters to encode.
+            * @param length Number of characters to encode.
+            * @param version A QR code version from the group the segments are meant for.
+            * @return A vector of ENCODE objects representing the encoding segments.
+            */
+            static std::vector<ENCODE> MODE_SEGMENTER(const char* input, size_t length, int version);
+
             
         };//End of MODE class
 
@@ -161,19 +218,18 @@ namespace QR
         int Bit_Counter;
 
         /**
-        * @brief Constant vector of boolean values holding the encoded data.
+        * @brief Constant bit buffer holding the encoded data.
         *
         * Ensures that the encoded information remains unchanged throughout the object's lifetime.
         */
-        const std::vector<bool> Data;
+        const BITBUFFER Data;
 
 
     public:
         // Constructor that initializes the ENCODE object with a constant reference to a MODE object,
-        // an integer bit counter, and a reference to a vector of boolean values.
-        // The vector is passed by reference, allowing the constructor to use the existing vector
-        // without making a copy, which can be more efficient.
-        ENCODE(const MODE& mode, int bit_counter, std::vector<bool>& data) :
+        // an integer bit counter, and a vector of boolean values, which is packed into the
+        // segment's bit buffer.
+        ENCODE(const MODE& mode, int bit_counter, const std::vector<bool>& data) :
             Mode(&mode), Bit_Counter(bit_counter), Data(data)
         {
             if (bit_counter < 0)
@@ -181,10 +237,10 @@ namespace QR
         }
 
         // Constructor that initializes the ENCODE object with a constant reference to a MODE object,
-        // an integer bit counter, and an rvalue reference to a vector of boolean values.
-        // This constructor uses std::move to transfer ownership of the vector, allowing the
-        // constructor to take a temporary vector and avoid unnecessary copies.
-        ENCODE(const MODE& mode, int bit_counter, std::vector<bool>&& data) :
+        // an integer bit counter, and an rvalue reference to a bit buffer.
+        // This constructor uses std::move to transfer ownership of the buffer, allowing the
+        // constructor to take a temporary buffer and avoid unnecessary copies.
+        ENCODE(const MODE& mode, int bit_counter, BITBUFFER&& data) :
             Mode(&mode), Bit_Counter(bit_counter), Data(std::move(data)) 
         {
             if (bit_counter < 0)
@@ -195,9 +251,9 @@ namespace QR
         // Returns a pointer to a constant MODE object, which represents the encoding mode being used.
         const MODE& MODE_GETTER() const;
 
-        // Function to retrieve the data as a BITBUFFER, which stores binary data in a vector of uint8_t.
+        // Function to retrieve the data as a BITBUFFER, which stores binary data in 64-bit words.
         // Returns a BITBUFFER containing the encoded data.
-        const std::vector<bool> &DATA_GETTER() const;
+        const BITBUFFER &DATA_GETTER() const;
 
         // Function to retrieve the size of the encoded data.
         // Returns the size of the encoded data as a size_t value.
@@ -235,6 +291,9 @@ const QR::ENCODE::MODE QR::ENCODE::MODE::KANJI(0x8, 8, 10, 12);
 
 const QR::ENCODE::MODE QR::ENCODE::MODE::ECI(0x7, 0, 0, 0);
 
+// Structured Append mode: mode indicator is 0x3, followed by a fixed 16-bit header and no character count
+const QR::ENCODE::MODE QR::ENCODE::MODE::STRUCTURED_APPEND(0x3, 0, 0, 0);
+
 // Alphanumeric string: This constant string contains the characters allowed in the alphanumeric mode of QR code encoding.
 // The characters are listed in order of their respective index values, which are used to convert characters to binary
 // when encoding an alphanumeric string into a QR code. 
@@ -245,27 +304,15 @@ const char* S_ALPHANUMERIC = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
 // Takes a C-style string 'input' as a parameter.
 bool QR::ENCODE::MODE::IS_ALPHANUMERIC(const char* input)
 {
-    // Loop through each character in the input string until the null terminator is reached.
-    for (;*input != '\0';input++)
-    {
-        // Check if the current character is not found in the predefined alphanumeric string (S_ALPHANUMERIC).
-        // If not found, return false indicating the input is not entirely alphanumeric.
-        if (!std::strchr(S_ALPHANUMERIC,*input))
-            return false;
-    }
-    // If all characters are alphanumeric, return true.
-    return true;
+    // Classify the whole string in SIMD blocks; digits are a subset of the alphanumeric set.
+    return CHARCLASS::CLASSIFY(input, std::strlen(input)) != CHARCLASS::TAG::BYTE;
 }
 
 // Function to check if the given input string consists only of numeric characters (digits).
 // Takes a C-style string 'input' as a parameter.
 bool QR::ENCODE::MODE::IS_NUMERIC(const char* input)
 {
-    // Loop through each character in the input string until the null terminator is reached.
-    for (const char* p = input; *p; ++p) {
-        if (*p < '0' || *p > '9') return false;
-    }
-    return true;
+    return CHARCLASS::CLASSIFY(input, std::strlen(input)) == CHARCLASS::TAG::NUMERIC;
 }
 
 int QR::ENCODE::MODE::MODE_BITS() const
@@ -280,73 +327,50 @@ int QR::ENCODE::MODE::CHAR_COUNTER_BITS(int version) const
 
 QR::ENCODE QR::ENCODE::MODE::NUMERIC_TO_BINARY(const char* input)
 {
-    int bit_counter = 0;
-    int counter = 0;
-    int datas = 0;
+    return NUMERIC_TO_BINARY(input, std::strlen(input));
+}
 
+QR::ENCODE QR::ENCODE::MODE::NUMERIC_TO_BINARY(const char* input, size_t length)
+{
+    // Digit triples become 10-bit groups, a trailing pair 7 bits and a single digit 4 bits
     BITBUFFER bit;
+    CHARCLASS::PACK_NUMERIC(input, length, bit);
 
-    for (; *input != '\0'; input++,bit_counter++)
-    {
-        char c = *input;
-
-        if (!IS_NUMERIC(input))
-            throw std::domain_error("Invalid value");
-
-        datas = datas * 10 + (c - '0');
-        counter++;
-        if (counter == 3)
-        {
-            bit.APPEND_BITS(static_cast<std::uint32_t>(datas),10);
-            counter = 0;
-            datas = 0;
-        }
-    }
-
-    if (counter > 0) 
-        bit.APPEND_BITS(static_cast<std::uint32_t>(datas),(counter == 1) ? 4 : 7);
-    
-    return ENCODE(NUMERIC,bit_counter, std::move(bit));
+    return ENCODE(NUMERIC, static_cast<int>(length), std::move(bit));
 }
 
 
 QR::ENCODE QR::ENCODE::MODE::ALPHANUMERIC_TO_BINARY(const char* input)
 {
-    int counter = 0;
+    return ALPHANUMERIC_TO_BINARY(input, std::strlen(input));
+}
 
+QR::ENCODE QR::ENCODE::MODE::ALPHANUMERIC_TO_BINARY(const char* input, size_t length)
+{
+    // Character pairs become 11-bit groups (45 * first + second), a trailing character 6 bits
     BITBUFFER bb;
-   
-    int accumData = 0;
-    int accumCount = 0;
-    int charCount = 0;
-    for (; *input != '\0'; input++, charCount++) {
-        const char *temp = std::strchr(S_ALPHANUMERIC, *input);
-        if (temp == nullptr)
-            throw std::domain_error("String contains unencodable characters in alphanumeric mode");
-        accumData = accumData * 45 + static_cast<int>(temp - S_ALPHANUMERIC);
-        accumCount++;
-        if (accumCount == 2) {
-            bb.APPEND_BITS(static_cast<std::uint32_t>(accumData),11);
-            accumData = 0;
-            accumCount = 0;
-        }
-    }
-    if (accumCount > 0)
-        bb.APPEND_BITS(static_cast<std::uint32_t>(accumData), (accumCount == 1) ? 4 : 6);
-    return ENCODE(MODE::NUMERIC, charCount, std::move(bb));
+    CHARCLASS::PACK_ALPHANUMERIC(input, length, bb);
+
+    return ENCODE(MODE::ALPHANUMERIC, static_cast<int>(length), std::move(bb));
 }
 
 
 QR::ENCODE QR::ENCODE::MODE::BYTE_TO_BINARY(const std::vector<std::uint8_t>& input)
+{
+    return BYTE_TO_BINARY(input.data(), input.size());
+}
+
+QR::ENCODE QR::ENCODE::MODE::BYTE_TO_BINARY(const std::uint8_t* input, size_t length)
 {
     BITBUFFER bit;
+    bit.reserve(length * 8);
 
-    for (std::uint8_t b : input)
+    for (size_t i = 0; i < length; i++)
     {
-        bit.APPEND_BITS(b,8);
+        bit.APPEND_WORD(input[i], 8);
     }
 
-    return ENCODE(MODE::BYTE, static_cast<int>(input.size()), std::move(bit));
+    return ENCODE(MODE::BYTE, static_cast<int>(length), std::move(bit));
 }
 
 QR::ENCODE QR::ENCODE::MODE::ECI_TO_BINARY(long input)
@@ -374,26 +398,112 @@ QR::ENCODE QR::ENCODE::MODE::ECI_TO_BINARY(long input)
     return ENCODE(MODE::ECI, 0, std::move(bit));
 }
 
+QR::ENCODE QR::ENCODE::MODE::STRUCTURED_APPEND_TO_BINARY(int index, int total, std::uint8_t parity)
+{
+    if (total < 1 || total > 16 || index < 0 || index >= total)
+        throw std::domain_error("Structured Append position is invalid");
+
+    BITBUFFER bit;
+    bit.APPEND_BITS(static_cast<std::uint32_t>(index), 4);
+    bit.APPEND_BITS(static_cast<std::uint32_t>(total - 1), 4);
+    bit.APPEND_BITS(parity, 8);
+    return ENCODE(MODE::STRUCTURED_APPEND, 0, std::move(bit));
+}
+
 
 std::vector<QR::ENCODE> QR::ENCODE::MODE::MODE_CHOOSER(const char* input)
+{
+    return MODE_CHOOSER(input, std::strlen(input));
+}
+
+std::vector<QR::ENCODE> QR::ENCODE::MODE::MODE_CHOOSER(const char* input, size_t length)
 {
     std::vector<ENCODE> Chooser;
 
-    if (*input == '\0') throw std::domain_error("Invalid value");
-    else if (IS_NUMERIC(input))      Chooser.push_back(NUMERIC_TO_BINARY(input));
-    else if (IS_ALPHANUMERIC(input)) Chooser.push_back(ALPHANUMERIC_TO_BINARY(input));
+    if (length == 0) throw std::domain_error("Invalid value");
+
+    // One classification pass decides the mode for the whole string
+    CHARCLASS::TAG tag = CHARCLASS::CLASSIFY(input, length);
+
+    if (tag == CHARCLASS::TAG::NUMERIC)
+        Chooser.push_back(NUMERIC_TO_BINARY(input, length));
+    else if (tag == CHARCLASS::TAG::ALPHANUMERIC)
+        Chooser.push_back(ALPHANUMERIC_TO_BINARY(input, length));
     else
+        Chooser.push_back(BYTE_TO_BINARY(reinterpret_cast<const std::uint8_t*>(input), length));
+
+    return Chooser;
+}
+
+std::vector<QR::ENCODE> QR::ENCODE::MODE::MODE_SEGMENTER(const char* input, size_t length, int version)
+{
+    if (length == 0) throw std::domain_error("Invalid value");
+
+    // Costs are kept in sixths of a bit: byte 8 bits, alphanumeric 5.5 bits, numeric 3.33 bits per character
+    const MODE* modes[3] = { &NUMERIC, &ALPHANUMERIC, &BYTE };
+    const int charCost[3] = { 20, 33, 48 };
+    int headCost[3];
+    for (int m = 0; m < 3; m++)
+        headCost[m] = (4 + modes[m]->CHAR_COUNTER_BITS(version)) * 6;
+
+    std::vector<CHARCLASS::TAG> tags(length);
+    CHARCLASS::TAG_BYTES(input, length, tags.data());
+
+    // fromMode[i][m]: mode of character i when the segment after it continues in mode m (-1 = impossible)
+    std::vector<std::array<std::int8_t, 3>> fromMode(length);
+    std::array<long, 3> cost = { headCost[0], headCost[1], headCost[2] };
+
+    for (size_t i = 0; i < length; i++)
+    {
+        // Character i extends the running segment of every mode able to hold it
+        std::array<long, 3> stay = { LONG_MAX, LONG_MAX, LONG_MAX };
+        for (int m = static_cast<int>(tags[i]); m < 3; m++)
+            stay[m] = cost[m] + charCost[m];
+
+        // Switching modes after character i closes the segment at a whole bit
+        for (int to = 0; to < 3; to++)
+        {
+            cost[to] = stay[to];
+            fromMode[i][to] = static_cast<std::int8_t>(stay[to] == LONG_MAX ? -1 : to);
+            for (int from = static_cast<int>(tags[i]); from < 3; from++)
+            {
+                long switched = (stay[from] + 5) / 6 * 6 + headCost[to];
+                if (switched < cost[to])
+                {
+                    cost[to] = switched;
+                    fromMode[i][to] = static_cast<std::int8_t>(from);
+                }
+            }
+        }
+    }
+
+    int mode = static_cast<int>(std::min_element(cost.begin(), cost.end()) - cost.begin());
+    std::vector<int> charModes(length);
+    for (size_t i = length; i-- > 0;)
+    {
+        mode = fromMode[i][mode];
+        charModes[i] = mode;
+    }
+
+    std::vector<ENCODE> segments;
+    for (size_t start = 0; start < length;)
     {
-        std::vector<std::uint8_t> bytes;
-        for (; *input != '\0'; input++)
-            bytes.push_back(static_cast<std::uint8_t>(*input));
-        Chooser.push_back(BYTE_TO_BINARY(bytes));
+        size_t end = start + 1;
+        while (end < length && charModes[end] == charModes[start])
+            end++;
+
+        if (charModes[start] == 0)
+            segments.push_back(NUMERIC_TO_BINARY(input + start, end - start));
+        else if (charModes[start] == 1)
+            segments.push_back(ALPHANUMERIC_TO_BINARY(input + start, end - start));
+        else
+            segments.push_back(BYTE_TO_BINARY(reinterpret_cast<const std::uint8_t*>(input + start), end - start));
+        start = end;
     }
-                                     
-   return Chooser;
+    return segments;
 }
 
-inline const std::vector<bool> &QR::ENCODE::DATA_GETTER() const
+inline const QR::BITBUFFER &QR::ENCODE::DATA_GETTER() const
 {
     return Data;
 }
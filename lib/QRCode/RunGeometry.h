@@ -0,0 +1,202 @@
+#ifndef RUNGEOMETRY_H
+#define RUNGEOMETRY_H
+
+#include "MatrixView.h"
+
+#include <bit>
+#include <span>
+#include <vector>
+#include <cstdint>
+
+namespace QR
+{
+    /**
+    * @brief Run-length description of a symbol: for every row, its horizontal spans of dark modules.
+    *
+    * QR rows are mostly long runs, so renderers that emit one span (an SVG path segment, a
+    * memset of pixels, a block of terminal cells) per run do work proportional to the number
+    * of runs instead of the number of modules. The runs of a row are sorted by x and never
+    * touch each other.
+    */
+    class RUN_GEOMETRY
+    {
+    public:
+        /**
+        * @brief A horizontal span of dark modules inside one row.
+        */
+        struct RUN
+        {
+            std::uint16_t x;         // First dark module
+            std::uint16_t length;    // Number of dark modules
+        };
+
+        /**
+        * @brief An axis aligned rectangle of dark modules.
+        */
+        struct RECT
+        {
+            std::uint16_t x;
+            std::uint16_t y;
+            std::uint16_t width;
+            std::uint16_t height;
+        };
+
+        /**
+        * @brief Creates an empty geometry (size 0).
+        */
+        RUN_GEOMETRY();
+
+        /**
+        * @brief Extracts the dark runs of every row of a packed matrix.
+        *
+        * Whole words of light or dark modules are skipped at once with countl_zero.
+        */
+        explicit RUN_GEOMETRY(const MATRIX_VIEW& view);
+
+        /**
+        * @brief Number of modules per side of the symbol the runs describe.
+        */
+        int SIZE_GETTER() const;
+
+        /**
+        * @brief Dark runs of row `y`, left to right. No bounds checks.
+        */
+        std::span<const RUN> ROW(int y) const;
+
+        /**
+        * @brief Total number of runs over all rows.
+        */
+        size_t COUNT_GETTER() const;
+
+        /**
+        * @brief Approximate heap memory held by the runs, in bytes.
+        */
+        size_t BYTES_GETTER() const;
+
+        /**
+        * @brief Merges runs with the same x and length in consecutive rows into rectangles.
+        *
+        * The rectangles cover exactly the dark modules and never overlap, so they can be
+        * drawn in any order. Finder patterns, timing lines and other vertical structure
+        * collapse into a handful of rectangles.
+        *
+        * @return The rectangles, ordered by their top row then by x.
+        */
+        std::vector<RECT> RECTANGLES() const;
+
+    private:
+        /**
+        * @brief First module at or after `from` whose color is `dark`, or `size` if none.
+        */
+        static int FIND(std::span<const std::uint64_t> row, int from, bool dark, int size);
+
+        int Size;
+
+        std::vector<RUN> Runs;
+
+        // Runs of row y are Runs[RowStart[y]] to Runs[RowStart[y + 1] - 1]
+        std::vector<std::uint32_t> RowStart;
+    };
+}
+
+inline QR::RUN_GEOMETRY::RUN_GEOMETRY()
+    : Size(0), RowStart(1, 0)
+{
+}
+
+inline QR::RUN_GEOMETRY::RUN_GEOMETRY(const MATRIX_VIEW& view)
+    : Size(view.SIZE_GETTER())
+{
+    RowStart.reserve(static_cast<size_t>(Size) + 1);
+    RowStart.push_back(0);
+
+    for (std::span<const std::uint64_t> row : view.ROWS())
+    {
+        int x = FIND(row, 0, true, Size);
+        while (x < Size)
+        {
+            int end = FIND(row, x, false, Size);
+            Runs.push_back(RUN{ static_cast<std::uint16_t>(x), static_cast<std::uint16_t>(end - x) });
+            x = FIND(row, end, true, Size);
+        }
+        RowStart.push_back(static_cast<std::uint32_t>(Runs.size()));
+    }
+    Runs.shrink_to_fit();
+}
+
+inline int QR::RUN_GEOMETRY::FIND(std::span<const std::uint64_t> row, int from, bool dark, int size)
+{
+    if (from >= size)
+        return size;
+
+    // Looking for a light module is looking for a set bit in the inverted row; the zero
+    // padding inverts to ones, so the search always stops by the end of the last word
+    const std::uint64_t flip = dark ? 0 : ~std::uint64_t(0);
+    size_t w = static_cast<size_t>(from) >> 6;
+    std::uint64_t word = (row[w] ^ flip) & (~std::uint64_t(0) >> (from & 63));
+    while (word == 0)
+    {
+        if (++w == row.size())
+            return size;
+        word = row[w] ^ flip;
+    }
+    int found = static_cast<int>(w * 64) + std::countl_zero(word);
+    return found < size ? found : size;
+}
+
+inline int QR::RUN_GEOMETRY::SIZE_GETTER() const
+{
+    return Size;
+}
+
+inline std::span<const QR::RUN_GEOMETRY::RUN> QR::RUN_GEOMETRY::ROW(int y) const
+{
+    return std::span<const RUN>(Runs.data() + RowStart[y], RowStart[y + 1] - RowStart[y]);
+}
+
+inline size_t QR::RUN_GEOMETRY::COUNT_GETTER() const
+{
+    return Runs.size();
+}
+
+inline size_t QR::RUN_GEOMETRY::BYTES_GETTER() const
+{
+    return Runs.capacity() * sizeof(RUN) + RowStart.capacity() * sizeof(std::uint32_t);
+}
+
+inline std::vector<QR::RUN_GEOMETRY::RECT> QR::RUN_GEOMETRY::RECTANGLES() const
+{
+    std::vector<RECT> rects;
+
+    // Index into `rects` of the rectangle each run of the previous row belongs to
+    std::vector<size_t> previous, current;
+
+    for (int y = 0; y < Size; y++)
+    {
+        std::span<const RUN> above = y > 0 ? ROW(y - 1) : std::span<const RUN>();
+        std::span<const RUN> runs = ROW(y);
+        current.clear();
+
+        // Both rows are sorted by x, so a single merge pass pairs identical runs
+        size_t p = 0;
+        for (const RUN& run : runs)
+        {
+            while (p < above.size() && above[p].x < run.x)
+                p++;
+            if (p < above.size() && above[p].x == run.x && above[p].length == run.length)
+            {
+                rects[previous[p]].height++;
+                current.push_back(previous[p]);
+            }
+            else
+            {
+                rects.push_back(RECT{ run.x, static_cast<std::uint16_t>(y), run.length, 1 });
+                current.push_back(rects.size() - 1);
+            }
+        }
+        previous.swap(current);
+    }
+    return rects;
+}
+
+#endif
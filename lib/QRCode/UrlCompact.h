@@ -0,0 +1,149 @@
+#ifndef URLCOMPACT_H
+#define URLCOMPACT_H
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cctype>
+
+#include "QREncode.h"
+
+namespace QR
+{
+    /**
+    * @brief Opt-in URL compaction pass run before segmentation.
+    *
+    * Lower case URLs never qualify for alphanumeric mode, so every character costs 8 bits.
+    * The scheme, the host and the hex digits of percent-encodings are case-insensitive
+    * (RFC 3986, sections 3.1, 3.2.2 and 2.1), so they are upper cased; the user info, path,
+    * query and fragment are otherwise left untouched. The result is then split into
+    * numeric, alphanumeric and byte segments with ENCODE::MODE::MODE_SEGMENTER.
+    */
+    struct URLCOMPACT
+    {
+        /**
+        * @brief Outcome of a compaction pass.
+        */
+        struct RESULT
+        {
+            std::string TEXT;               // The compacted URL
+            std::vector<ENCODE> SEGMENTS;   // Optimal segments of TEXT for the requested version
+            int BITS_SAVED;                 // Bits saved against MODE_CHOOSER on the original URL
+        };
+
+        /**
+        * @brief Upper cases the case-insensitive components of a URL.
+        *
+        * Input that does not start with a valid scheme followed by ':' is returned unchanged,
+        * except for percent-encodings, whose hex digits are always case-insensitive.
+        *
+        * @param url The URL to compact.
+        * @return The compacted URL, with the same meaning as the input.
+        */
+        static std::string NORMALIZE(const char* url);
+
+        /**
+        * @brief Normalizes and segments a URL for a given version.
+        *
+        * @param url The URL to compact.
+        * @param version A QR code version from the group the segments are meant for.
+        * @return The compacted text, its segments and the number of bits saved.
+        */
+        static RESULT COMPACT(const char* url, int version);
+
+    private:
+        static bool IS_HEX(char c);
+
+        static char TO_UPPER(char c);
+    };
+}
+
+inline bool QR::URLCOMPACT::IS_HEX(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+inline char QR::URLCOMPACT::TO_UPPER(char c)
+{
+    // ASCII only: bytes of UTF-8 sequences are left alone
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+inline std::string QR::URLCOMPACT::NORMALIZE(const char* url)
+{
+    std::string text(url);
+    size_t length = text.size();
+    size_t i = 0;
+
+    // scheme = ALPHA *( ALPHA / DIGIT / "+" / "-" / "." ) ":"
+    size_t colon = 0;
+    if (length > 0 && ((text[0] >= 'a' && text[0] <= 'z') || (text[0] >= 'A' && text[0] <= 'Z')))
+    {
+        colon = 1;
+        while (colon < length && (std::isalnum(static_cast<unsigned char>(text[colon])) ||
+            text[colon] == '+' || text[colon] == '-' || text[colon] == '.'))
+            colon++;
+        if (colon >= length || text[colon] != ':')
+            colon = 0;
+    }
+
+    if (colon > 0)
+    {
+        for (; i < colon; i++)
+            text[i] = TO_UPPER(text[i]);
+        i = colon + 1;
+
+        // authority = [ userinfo "@" ] host [ ":" port ], only present after "//"
+        if (i + 1 < length && text[i] == '/' && text[i + 1] == '/')
+        {
+            i += 2;
+            size_t end = text.find_first_of("/?#", i);
+            if (end == std::string::npos)
+                end = length;
+
+            // User info is case-sensitive; skip past the last '@' inside the authority
+            size_t at = text.rfind('@', end - 1);
+            if (at != std::string::npos && at >= i)
+                i = at + 1;
+
+            // Host and port: letters are case-insensitive, digits and ':' are unaffected.
+            // An IPv6 zone identifier ("[fe80::1%25eth0]") is case-sensitive and kept as is.
+            size_t hostEnd = end;
+            if (i < end && text[i] == '[')
+            {
+                size_t zone = text.find("%25", i);
+                if (zone != std::string::npos && zone < end)
+                    hostEnd = zone;
+            }
+            for (; i < hostEnd; i++)
+                text[i] = TO_UPPER(text[i]);
+        }
+    }
+
+    // Path, query and fragment: only the hex digits of "%XX" triplets are case-insensitive
+    for (; i + 2 < length; i++)
+    {
+        if (text[i] == '%' && IS_HEX(text[i + 1]) && IS_HEX(text[i + 2]))
+        {
+            text[i + 1] = TO_UPPER(text[i + 1]);
+            text[i + 2] = TO_UPPER(text[i + 2]);
+            i += 2;
+        }
+    }
+    return text;
+}
+
+inline QR::URLCOMPACT::RESULT QR::URLCOMPACT::COMPACT(const char* url, int version)
+{
+    RESULT result{ NORMALIZE(url), {}, 0 };
+    result.SEGMENTS = ENCODE::MODE::MODE_SEGMENTER(result.TEXT.data(), result.TEXT.size(), version);
+
+    const std::vector<ENCODE> plain = ENCODE::MODE::MODE_CHOOSER(url);
+    int before = ENCODE::GET_TOTAL_BITS(plain, version);
+    int after = ENCODE::GET_TOTAL_BITS(result.SEGMENTS, version);
+    if (before != -1 && after != -1)
+        result.BITS_SAVED = before - after;
+    return result;
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef ARCHIVECHECK_H
+#define ARCHIVECHECK_H
+
+#include "Check.h"
+#include "../../lib/Archive/Archive.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <filesystem>
+
+namespace QR
+{
+    /**
+    * @brief The symbols the archive check stores, and how it compares them with what it reads back.
+    */
+    struct ARCHIVE_SAMPLES
+    {
+        static std::string KEY(int i);
+
+        /**
+        * @brief The symbol stored under KEY(i); the levels vary so the records differ in size.
+        */
+        static QRCODE SYMBOL(int i);
+
+        /**
+        * @brief Whether `key` is in the archive with the version, level, mask and modules of SYMBOL(i).
+        */
+        static bool STORED(const ARCHIVE_READER& reader, int i);
+
+        /**
+        * @brief Offset of the end of the records, from the trailer of a finished archive.
+        */
+        static std::uint64_t RECORDS_END(const std::filesystem::path& path);
+    };
+}
+
+inline std::string QR::ARCHIVE_SAMPLES::KEY(int i)
+{
+    return "item-" + std::to_string(i);
+}
+
+inline QR::QRCODE QR::ARCHIVE_SAMPLES::SYMBOL(int i)
+{
+    const std::string text = "https://example.com/archive/" + std::to_string(i * 7919);
+    return QRCODE::ENCODE_TEXT(text.c_str(), static_cast<QRCODE::VERSION::ERROR>(i % 4));
+}
+
+inline bool QR::ARCHIVE_SAMPLES::STORED(const ARCHIVE_READER& reader, int i)
+{
+    ARCHIVE_RECORD record;
+    if (!reader.FIND(KEY(i), record))
+        return false;
+    const QRCODE symbol = SYMBOL(i);
+    const MATRIX_VIEW expected = symbol.VIEW_GETTER(), found = record.VIEW_GETTER();
+    if (record.VERSION_GETTER() != symbol.VERSION_GETTER() || record.ERROR_CORRECTION() != symbol.ERROR_CORRECTION()
+        || record.MASK_GETTER() != symbol.MASK_GETTER() || found.SIZE_GETTER() != expected.SIZE_GETTER())
+        return false;
+    for (int y = 0; y < expected.SIZE_GETTER(); y++)
+    {
+        for (int x = 0; x < expected.SIZE_GETTER(); x++)
+        {
+            if (found.TEST(x, y) != expected.TEST(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+inline std::uint64_t QR::ARCHIVE_SAMPLES::RECORDS_END(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(-static_cast<std::streamoff>(ARCHIVE_FORMAT::TRAILER_SIZE) + 8, std::ios::end);
+    std::uint64_t end = 0;
+    file.read(reinterpret_cast<char*>(&end), 8);
+    if (!file)
+        throw std::runtime_error("Read failed");
+    return end;
+}
+
+inline void QR::CHECK::ARCHIVE()
+{
+    const int first = 100, more = 10;
+    const std::filesystem::path directory = std::filesystem::temp_directory_path()
+        / ("qrcheck-" + std::to_string(std::random_device()()));
+    std::filesystem::create_directories(directory);
+    const std::filesystem::path path = directory / "archive.qra", crashed = directory / "crashed.qra",
+        cut = directory / "cut.qra";
+
+    try
+    {
+        {
+            ARCHIVE_WRITER writer(path.string());
+            for (int i = 0; i < first; i++)
+                writer.APPEND(ARCHIVE_SAMPLES::KEY(i), ARCHIVE_SAMPLES::SYMBOL(i));
+            writer.FINISH();
+        }
+
+        // A record cut short, with the index gone: the walk keeps every record but the last
+        std::filesystem::copy_file(path, cut);
+        std::filesystem::resize_file(cut, ARCHIVE_SAMPLES::RECORDS_END(cut) - 5);
+        {
+            ARCHIVE_WRITER writer(cut.string());
+            EXPECT(writer.COUNT_GETTER() == first - 1, "archive: a cut record was not dropped");
+        }
+        {
+            ARCHIVE_READER reader(cut.string());
+            bool stored = true;
+            for (int i = 0; i < first - 1; i++)
+                stored = stored && ARCHIVE_SAMPLES::STORED(reader, i);
+            EXPECT(stored, "archive: records before the cut one were lost");
+            EXPECT(!ARCHIVE_SAMPLES::STORED(reader, first - 1), "archive: the cut record is still indexed");
+        }
+
+        // Reopened and appended to while a reader has it mapped, then copied as it stands: a
+        // writer that stopped here. Both still see the records of the old index
+        {
+            ARCHIVE_READER mapped(path.string());
+            ARCHIVE_WRITER writer(path.string());
+            EXPECT(writer.COUNT_GETTER() == first, "archive: reopened with the wrong key count");
+            for (int i = first; i < first + more; i++)
+                writer.APPEND(ARCHIVE_SAMPLES::KEY(i), ARCHIVE_SAMPLES::SYMBOL(i));
+            std::filesystem::copy_file(path, crashed);
+
+            ARCHIVE_READER reader(crashed.string());
+            EXPECT(reader.COUNT_GETTER() == first, "archive: a reader opened during an append sees "
+                + std::to_string(reader.COUNT_GETTER()) + " keys");
+            bool stored = true;
+            for (int i = 0; i < first; i++)
+                stored = stored && ARCHIVE_SAMPLES::STORED(reader, i) && ARCHIVE_SAMPLES::STORED(mapped, i);
+            EXPECT(stored, "archive: the old index is not readable during an append");
+            EXPECT(!ARCHIVE_SAMPLES::STORED(reader, first), "archive: a record is visible before FINISH");
+
+            writer.FINISH();
+            stored = true;
+            for (int i = 0; i < first; i++)
+                stored = stored && ARCHIVE_SAMPLES::STORED(mapped, i);
+            EXPECT(stored && mapped.COUNT_GETTER() == first, "archive: a mapped reader changed under a FINISH");
+        }
+
+        // The next writer walks the records and indexes them again
+        {
+            ARCHIVE_WRITER writer(crashed.string());
+            EXPECT(writer.COUNT_GETTER() >= first && writer.COUNT_GETTER() <= first + more,
+                "archive: recovered " + std::to_string(writer.COUNT_GETTER()) + " keys");
+            writer.FINISH();
+        }
+        {
+            ARCHIVE_READER reader(crashed.string());
+            bool stored = true;
+            for (int i = 0; i < first; i++)
+                stored = stored && ARCHIVE_SAMPLES::STORED(reader, i);
+            EXPECT(stored, "archive: records before the crash were lost");
+            for (int i = first; i < first + more; i++)
+            {
+                ARCHIVE_RECORD record;
+                EXPECT(!reader.FIND(ARCHIVE_SAMPLES::KEY(i), record) || ARCHIVE_SAMPLES::STORED(reader, i),
+                    "archive: a recovered record differs");
+            }
+        }
+
+        // The writer that was not stopped appended a second index
+        {
+            ARCHIVE_READER reader(path.string());
+            EXPECT(reader.COUNT_GETTER() == static_cast<size_t>(first + more), "archive: wrong key count after the append");
+            bool stored = true;
+            for (int i = 0; i < first + more; i++)
+                stored = stored && ARCHIVE_SAMPLES::STORED(reader, i);
+            EXPECT(stored, "archive: records missing after the append");
+        }
+    }
+    catch (...)
+    {
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+        throw;
+    }
+    std::filesystem::remove_all(directory);
+}
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef BITMAPCHECK_H
+#define BITMAPCHECK_H
+
+#include "Check.h"
+#include "../../lib/Image/Sink.h"
+#include "../../lib/Image/BitmapStream.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Decoders of the bitmap formats, written from their specifications; each returns
+    * the pixels row by row, true for dark, and throws std::runtime_error on a malformed file.
+    */
+    struct BITMAP_READER
+    {
+        static std::uint32_t LE16(const std::string& data, size_t at);
+
+        static std::uint32_t LE32(const std::string& data, size_t at);
+
+        /**
+        * @brief Bit `x` of the row starting at byte `row`, most significant bit first.
+        */
+        static bool BIT(const std::string& data, size_t row, size_t x);
+
+        /**
+        * @brief Reads the fields of a binary Netpbm header; returns where the pixels start.
+        */
+        static size_t NETPBM(const std::string& data, const char* magic, int fields, int* values);
+
+        static std::vector<bool> PBM(const std::string& data, int& width);
+
+        static std::vector<bool> PGM(const std::string& data, int& width);
+
+        static std::vector<bool> BMP(const std::string& data, int& width);
+
+        static std::vector<bool> TIFF(const std::string& data, int& width);
+    };
+}
+
+inline std::uint32_t QR::BITMAP_READER::LE16(const std::string& data, size_t at)
+{
+    if (at + 2 > data.size())
+        throw std::runtime_error("truncated");
+    return static_cast<std::uint8_t>(data[at]) | (static_cast<std::uint8_t>(data[at + 1]) << 8);
+}
+
+inline std::uint32_t QR::BITMAP_READER::LE32(const std::string& data, size_t at)
+{
+    return LE16(data, at) | (LE16(data, at + 2) << 16);
+}
+
+inline bool QR::BITMAP_READER::BIT(const std::string& data, size_t row, size_t x)
+{
+    if (row + x / 8 >= data.size())
+        throw std::runtime_error("truncated");
+    return (static_cast<std::uint8_t>(data[row + x / 8]) >> (7 - x % 8)) & 1;
+}
+
+inline size_t QR::BITMAP_READER::NETPBM(const std::string& data, const char* magic, int fields, int* values)
+{
+    std::istringstream header(data);
+    std::string found;
+    header >> found;
+    if (found != magic)
+        throw std::runtime_error("bad magic");
+    for (int i = 0; i < fields; i++)
+    {
+        if (!(header >> values[i]))
+            throw std::runtime_error("bad header");
+    }
+
+    // A single whitespace character ends the header
+    return static_cast<size_t>(header.tellg()) + 1;
+}
+
+inline std::vector<bool> QR::BITMAP_READER::PBM(const std::string& data, int& width)
+{
+    int values[2];
+    size_t at = NETPBM(data, "P4", 2, values);
+    width = values[0];
+    const size_t rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    if (values[1] != width || data.size() != at + rowBytes * width)
+        throw std::runtime_error("bad size");
+    std::vector<bool> pixels;
+    for (int y = 0; y < width; y++)
+        for (int x = 0; x < width; x++)
+            pixels.push_back(BIT(data, at + y * rowBytes, x));
+    return pixels;
+}
+
+inline std::vector<bool> QR::BITMAP_READER::PGM(const std::string& data, int& width)
+{
+    int values[3];
+    size_t at = NETPBM(data, "P5", 3, values);
+    width = values[0];
+    if (values[1] != width || values[2] != 255 || data.size() != at + static_cast<size_t>(width) * width)
+        throw std::runtime_error("bad size");
+    std::vector<bool> pixels;
+    for (size_t i = at; i < data.size(); i++)
+    {
+        const std::uint8_t gray = static_cast<std::uint8_t>(data[i]);
+        if (gray != 0 && gray != 255)
+            throw std::runtime_error("gray level other than black or white");
+        pixels.push_back(gray == 0);
+    }
+    return pixels;
+}
+
+inline std::vector<bool> QR::BITMAP_READER::BMP(const std::string& data, int& width)
+{
+    if (data.size() < 62 || data[0] != 'B' || data[1] != 'M' || LE32(data, 2) != data.size())
+        throw std::runtime_error("bad file header");
+    const std::uint32_t offset = LE32(data, 10);
+    width = static_cast<int>(LE32(data, 18));
+    const int height = static_cast<int>(LE32(data, 22));
+    if (LE32(data, 14) != 40 || height != width || LE16(data, 26) != 1 || LE16(data, 28) != 1 || LE32(data, 30) != 0)
+        throw std::runtime_error("bad info header");
+
+    // Which palette entry is dark
+    const std::uint32_t first = LE32(data, 54) & 0xFFFFFF, second = LE32(data, 58) & 0xFFFFFF;
+    if (!((first == 0xFFFFFF && second == 0) || (first == 0 && second == 0xFFFFFF)))
+        throw std::runtime_error("bad palette");
+    const bool darkIsOne = second == 0;
+
+    const size_t rowBytes = ((static_cast<size_t>(width) + 31) / 32) * 4;
+    if (data.size() != offset + rowBytes * height)
+        throw std::runtime_error("bad size");
+    std::vector<bool> pixels;
+    for (int y = 0; y < height; y++)
+    {
+        // Stored bottom-up
+        const size_t row = offset + static_cast<size_t>(height - 1 - y) * rowBytes;
+        for (int x = 0; x < width; x++)
+            pixels.push_back(BIT(data, row, x) == darkIsOne);
+    }
+    return pixels;
+}
+
+inline std::vector<bool> QR::BITMAP_READER::TIFF(const std::string& data, int& width)
+{
+    if (data.size() < 8 || data.compare(0, 4, std::string("II*\0", 4)) != 0)
+        throw std::runtime_error("bad header");
+    const std::uint32_t ifd = LE32(data, 4);
+    const std::uint32_t entries = LE16(data, ifd);
+
+    std::uint32_t height = 0, compression = 1, photometric = 9, bits = 0, samples = 1, rowsPerStrip = 0;
+    std::vector<std::uint32_t> offsets, counts;
+    width = 0;
+    for (std::uint32_t i = 0; i < entries; i++)
+    {
+        const size_t at = ifd + 2 + 12 * i;
+        const std::uint32_t tag = LE16(data, at), type = LE16(data, at + 2), count = LE32(data, at + 4);
+        auto value = [&](std::uint32_t k)
+            {
+                const size_t size = type == 3 ? 2 : 4;
+                const size_t where = count * size <= 4 ? at + 8 : LE32(data, at + 8);
+                return type == 3 ? LE16(data, where + k * size) : LE32(data, where + k * size);
+            };
+        switch (tag)
+        {
+        case 256: width = static_cast<int>(value(0)); break;
+        case 257: height = value(0); break;
+        case 258: bits = value(0); break;
+        case 259: compression = value(0); break;
+        case 262: photometric = value(0); break;
+        case 277: samples = value(0); break;
+        case 278: rowsPerStrip = value(0); break;
+        case 273: for (std::uint32_t k = 0; k < count; k++) offsets.push_back(value(k)); break;
+        case 279: for (std::uint32_t k = 0; k < count; k++) counts.push_back(value(k)); break;
+        default: break;
+        }
+    }
+    if (static_cast<int>(height) != width || bits != 1 || samples != 1 || photometric > 1 || rowsPerStrip == 0
+        || offsets.size() != counts.size() || offsets.size() != (height + rowsPerStrip - 1) / rowsPerStrip)
+        throw std::runtime_error("bad tags");
+
+    // Strips, unpacked
+    const size_t rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    std::string rows;
+    for (size_t s = 0; s < offsets.size(); s++)
+    {
+        if (static_cast<size_t>(offsets[s]) + counts[s] > data.size())
+            throw std::runtime_error("strip outside the file");
+        const std::string strip = data.substr(offsets[s], counts[s]);
+        if (compression == 1)
+            rows += strip;
+        else if (compression == 32773)
+        {
+            for (size_t i = 0; i < strip.size();)
+            {
+                const int n = static_cast<std::int8_t>(strip[i++]);
+                if (n >= 0)
+                {
+                    rows += strip.substr(i, static_cast<size_t>(n) + 1);
+                    i += static_cast<size_t>(n) + 1;
+                }
+                else if (n != -128)
+                    rows += std::string(static_cast<size_t>(1 - n), strip.at(i++));
+            }
+        }
+        else
+            throw std::runtime_error("unknown compression");
+    }
+    if (rows.size() != rowBytes * height)
+        throw std::runtime_error("bad size");
+
+    std::vector<bool> pixels;
+    for (std::uint32_t y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            pixels.push_back(BIT(rows, y * rowBytes, x) == (photometric == 0));
+    return pixels;
+}
+
+inline void QR::CHECK::BITMAPS()
+{
+    using WRITER = void (*)(SINK&, const MATRIX_VIEW&, int, int);
+    using READER = std::vector<bool> (*)(const std::string&, int&);
+    const struct
+    {
+        const char* name;
+        WRITER write;
+        READER read;
+    } formats[] = {
+        { "pbm", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border) { BITMAP_STREAM::PBM(sink, view, scale, border); }, BITMAP_READER::PBM },
+        { "pgm", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border) { BITMAP_STREAM::PGM(sink, view, scale, border); }, BITMAP_READER::PGM },
+        { "bmp", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border) { BITMAP_STREAM::BMP(sink, view, scale, border); }, BITMAP_READER::BMP },
+        { "tiff", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border)
+            { BITMAP_STREAM::TIFF(sink, view, scale, border, BITMAP_STREAM::TIFF_COMPRESSION::NONE); }, BITMAP_READER::TIFF },
+        { "tiff packbits", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border)
+            { BITMAP_STREAM::TIFF(sink, view, scale, border, BITMAP_STREAM::TIFF_COMPRESSION::PACKBITS); }, BITMAP_READER::TIFF },
+    };
+
+    for (const QRCODE& symbol : SYMBOLS())
+    {
+        const MATRIX_VIEW view = symbol.VIEW_GETTER();
+        for (int scale : { 1, 3, 8 })
+        {
+            for (int border : { 0, 4 })
+            {
+                const std::vector<bool> expected = PIXELS(view, scale, border);
+                for (const auto& format : formats)
+                {
+                    const std::string name = std::string(format.name) + " version " + std::to_string(symbol.VERSION_GETTER())
+                        + " scale " + std::to_string(scale) + " border " + std::to_string(border);
+                    std::string data;
+                    STRING_SINK sink(data);
+                    format.write(sink, view, scale, border);
+                    try
+                    {
+                        int width = 0;
+                        const std::vector<bool> pixels = format.read(data, width);
+                        EXPECT(width == (view.SIZE_GETTER() + 2 * border) * scale, name + ": wrong width");
+                        EXPECT(pixels == expected, name + ": pixels differ");
+                    }
+                    catch (const std::exception& error)
+                    {
+                        EXPECT(false, name + ": " + error.what());
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef BLITCHECK_H
+#define BLITCHECK_H
+
+#include "Check.h"
+#include "../../lib/Image/Blit.h"
+
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdint>
+
+namespace QR
+{
+    /**
+    * @brief BLITTER drawn again pixel by pixel, with the blend rounded exactly.
+    */
+    struct BLIT_REFERENCE
+    {
+        /**
+        * @brief (dst * (255 - alpha) + src * alpha) / 255, rounded to nearest.
+        */
+        static std::uint8_t BLEND(int dst, int src, int alpha);
+
+        /**
+        * @brief Whether frame pixel (fx, fy) is covered by the symbol drawn at (x, y), and if so
+        * whether it is dark.
+        */
+        static bool COVERED(const MATRIX_VIEW& view, int scale, int border, int x, int y, int fx, int fy, bool& dark);
+
+        /**
+        * @brief Stores or blends `count` bytes of `color` at `out`.
+        */
+        static void PAINT(std::uint8_t* out, const std::uint8_t* color, int count, int alpha);
+
+        /**
+        * @brief BT.601 video range, as BLITTER converts.
+        */
+        static void YUV(const RASTER::COLOR& c, std::uint8_t& y, std::uint8_t& u, std::uint8_t& v);
+    };
+}
+
+inline std::uint8_t QR::BLIT_REFERENCE::BLEND(int dst, int src, int alpha)
+{
+    const int sum = dst * (255 - alpha) + src * alpha;
+    return static_cast<std::uint8_t>((2 * sum + 255) / 510);
+}
+
+inline bool QR::BLIT_REFERENCE::COVERED(const MATRIX_VIEW& view, int scale, int border, int x, int y, int fx, int fy, bool& dark)
+{
+    const int side = (view.SIZE_GETTER() + 2 * border) * scale;
+    const int sx = fx - x, sy = fy - y;
+    if (sx < 0 || sy < 0 || sx >= side || sy >= side)
+        return false;
+    const int mx = sx / scale - border, my = sy / scale - border;
+    dark = mx >= 0 && my >= 0 && mx < view.SIZE_GETTER() && my < view.SIZE_GETTER() && view.TEST(mx, my);
+    return true;
+}
+
+inline void QR::BLIT_REFERENCE::PAINT(std::uint8_t* out, const std::uint8_t* color, int count, int alpha)
+{
+    for (int i = 0; i < count; i++)
+        out[i] = alpha == 0 ? out[i] : alpha == 255 ? color[i] : BLEND(out[i], color[i], alpha);
+}
+
+inline void QR::BLIT_REFERENCE::YUV(const RASTER::COLOR& c, std::uint8_t& y, std::uint8_t& u, std::uint8_t& v)
+{
+    y = static_cast<std::uint8_t>((66 * c.r + 129 * c.g + 25 * c.b + 128 + 4096) >> 8);
+    u = static_cast<std::uint8_t>((-38 * c.r - 74 * c.g + 112 * c.b + 128 + 32768) >> 8);
+    v = static_cast<std::uint8_t>((112 * c.r - 94 * c.g - 18 * c.b + 128 + 32768) >> 8);
+}
+
+inline void QR::CHECK::BLIT()
+{
+    // On x86 builds runs of 16 bytes and more are blended by the SSE2 loop and the rest by
+    // the scalar one; both must give the exactly rounded result
+    const std::vector<QRCODE> symbols = SYMBOLS();
+    std::mt19937 random(2024);
+    auto pick = [&random](int low, int high) { return std::uniform_int_distribution<int>(low, high)(random); };
+    auto alpha = [&]()
+        {
+            const int kind = pick(0, 3);
+            return static_cast<std::uint8_t>(kind == 0 ? 0 : kind == 1 ? 255 : pick(1, 254));
+        };
+
+    for (int n = 0; n < 300; n++)
+    {
+        const QRCODE& symbol = symbols[static_cast<size_t>(pick(0, 1))];
+        const MATRIX_VIEW view = symbol.VIEW_GETTER();
+        const BLITTER::FORMAT format = static_cast<BLITTER::FORMAT>(n % 3);
+        const int scale = pick(1, n % 4 == 0 ? 24 : 6);
+        const int border = pick(0, 5);
+        const RASTER::COLOR dark{ static_cast<std::uint8_t>(pick(0, 255)), static_cast<std::uint8_t>(pick(0, 255)),
+            static_cast<std::uint8_t>(pick(0, 255)), alpha() };
+        const RASTER::COLOR light{ static_cast<std::uint8_t>(pick(0, 255)), static_cast<std::uint8_t>(pick(0, 255)),
+            static_cast<std::uint8_t>(pick(0, 255)), alpha() };
+        const BLITTER blitter(format, scale, border, dark, light);
+        const int side = blitter.PIXELS(view.SIZE_GETTER());
+
+        // Frames smaller and larger than the symbol, placed to hang over any edge
+        const int width = pick(1, 300), height = pick(1, 300);
+        const int x = pick(-side, width), y = pick(-side, height);
+        const std::string name = "blit case " + std::to_string(n) + " format " + std::to_string(n % 3) + " scale "
+            + std::to_string(scale) + " at " + std::to_string(x) + "," + std::to_string(y);
+
+        auto noise = [&random](std::vector<std::uint8_t>& bytes)
+            {
+                for (std::uint8_t& byte : bytes)
+                    byte = static_cast<std::uint8_t>(random());
+            };
+
+        if (format != BLITTER::FORMAT::NV12)
+        {
+            const bool bgra = format == BLITTER::FORMAT::BGRA32;
+            const std::uint8_t darkBytes[4] = { bgra ? dark.b : dark.r, dark.g, bgra ? dark.r : dark.b, 255 };
+            const std::uint8_t lightBytes[4] = { bgra ? light.b : light.r, light.g, bgra ? light.r : light.b, 255 };
+            const size_t stride = static_cast<size_t>(width) * 4 + static_cast<size_t>(pick(0, 13));
+            std::vector<std::uint8_t> frame(stride * height);
+            noise(frame);
+            std::vector<std::uint8_t> expected = frame;
+            for (int fy = 0; fy < height; fy++)
+            {
+                for (int fx = 0; fx < width; fx++)
+                {
+                    bool isDark;
+                    if (BLIT_REFERENCE::COVERED(view, scale, border, x, y, fx, fy, isDark))
+                        BLIT_REFERENCE::PAINT(&expected[stride * fy + 4 * static_cast<size_t>(fx)], isDark ? darkBytes : lightBytes,
+                            4, isDark ? dark.a : light.a);
+                }
+            }
+            blitter.DRAW(view, frame.data(), width, height, stride, x, y);
+            EXPECT(frame == expected, name + ": pixels differ");
+            continue;
+        }
+
+        std::uint8_t darkYuv[3], lightYuv[3];
+        BLIT_REFERENCE::YUV(dark, darkYuv[0], darkYuv[1], darkYuv[2]);
+        BLIT_REFERENCE::YUV(light, lightYuv[0], lightYuv[1], lightYuv[2]);
+        const int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+        const size_t lumaStride = static_cast<size_t>(width) + static_cast<size_t>(pick(0, 13));
+        const size_t chromaStride = static_cast<size_t>(chromaWidth) * 2 + static_cast<size_t>(pick(0, 13));
+        std::vector<std::uint8_t> luma(lumaStride * height), chroma(chromaStride * chromaHeight);
+        noise(luma);
+        noise(chroma);
+        std::vector<std::uint8_t> expectedLuma = luma, expectedChroma = chroma;
+        for (int fy = 0; fy < height; fy++)
+        {
+            for (int fx = 0; fx < width; fx++)
+            {
+                bool isDark;
+                if (BLIT_REFERENCE::COVERED(view, scale, border, x, y, fx, fy, isDark))
+                    BLIT_REFERENCE::PAINT(&expectedLuma[lumaStride * fy + fx], isDark ? darkYuv : lightYuv, 1,
+                        isDark ? dark.a : light.a);
+            }
+        }
+
+        // Chroma of each 2 x 2 block from its top left pixel
+        for (int cy = 0; cy < chromaHeight; cy++)
+        {
+            for (int cx = 0; cx < chromaWidth; cx++)
+            {
+                bool isDark;
+                if (BLIT_REFERENCE::COVERED(view, scale, border, x, y, 2 * cx, 2 * cy, isDark))
+                    BLIT_REFERENCE::PAINT(&expectedChroma[chromaStride * cy + 2 * static_cast<size_t>(cx)],
+                        (isDark ? darkYuv : lightYuv) + 1, 2, isDark ? dark.a : light.a);
+            }
+        }
+        blitter.DRAW(view, luma.data(), lumaStride, chroma.data(), chromaStride, width, height, x, y);
+        EXPECT(luma == expectedLuma, name + ": luma differs");
+        EXPECT(chroma == expectedChroma, name + ": chroma differs");
+    }
+}
+
+#endif
@@ -0,0 +1,324 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include "../../lib/QRCode/QRCode.h"
+#include "../../lib/QRCode/MatrixView.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Regression checks of the writers and archives, run by check.cpp.
+    *
+    * The checks decode what the library wrote with code of their own, kept short and written
+    * from the format specifications, and compare the result with the symbol's modules. A
+    * failed expectation is printed and counted; the program exits with 1 if any failed.
+    */
+    class CHECK
+    {
+    public:
+        /**
+        * @brief Counts and prints `what` if `condition` is false.
+        */
+        static void EXPECT(bool condition, const std::string& what);
+
+        static int FAILURES();
+
+        /**
+        * @brief The pixels a writer should produce, row by row, true for dark: `scale` pixels
+        * per module and `border` light modules around the symbol.
+        */
+        static std::vector<bool> PIXELS(const MATRIX_VIEW& view, int scale, int border);
+
+        /**
+        * @brief Symbols of the smallest, a middle and the largest version, for the writers.
+        */
+        static std::vector<QRCODE> SYMBOLS();
+
+        /**
+        * @brief Decompresses raw DEFLATE data (RFC 1951), or a zlib stream (RFC 1950) whose
+        * Adler-32 is checked.
+        *
+        * @throws std::runtime_error if the data is not valid.
+        */
+        static std::vector<std::uint8_t> INFLATE(const std::uint8_t* data, size_t length, bool zlib);
+
+        static void DEFLATE();
+
+        static void BITMAPS();
+
+        static void PRINTERS();
+
+        static void ARCHIVE();
+
+        static void CONTACT_SHEETS();
+
+        static void PIPELINE();
+
+        static void STAGES();
+
+        static void BLIT();
+
+    private:
+        /**
+        * @brief Canonical Huffman code of a block, decoded a bit at a time (as in zlib's puff).
+        */
+        struct HUFFMAN
+        {
+            std::uint16_t counts[16];
+            std::uint16_t symbols[320];
+        };
+
+        struct BITS
+        {
+            const std::uint8_t* data;
+            size_t length;
+            size_t position;
+            std::uint32_t buffer;
+            int count;
+
+            int GET(int bits);
+        };
+
+        static void BUILD(HUFFMAN& code, const std::uint8_t* lengths, int count);
+
+        static int DECODE(BITS& in, const HUFFMAN& code);
+
+        static int& FAILED();
+    };
+}
+
+inline int& QR::CHECK::FAILED()
+{
+    static int failed = 0;
+    return failed;
+}
+
+inline void QR::CHECK::EXPECT(bool condition, const std::string& what)
+{
+    if (condition)
+        return;
+    FAILED()++;
+    std::cerr << "FAILED: " << what << '\n';
+}
+
+inline int QR::CHECK::FAILURES()
+{
+    return FAILED();
+}
+
+inline std::vector<bool> QR::CHECK::PIXELS(const MATRIX_VIEW& view, int scale, int border)
+{
+    const int size = view.SIZE_GETTER();
+    const int width = (size + 2 * border) * scale;
+    std::vector<bool> pixels(static_cast<size_t>(width) * width, false);
+    for (int y = 0; y < width; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int mx = x / scale - border, my = y / scale - border;
+            if (mx >= 0 && my >= 0 && mx < size && my < size)
+                pixels[static_cast<size_t>(y) * width + x] = view.TEST(mx, my);
+        }
+    }
+    return pixels;
+}
+
+inline std::vector<QR::QRCODE> QR::CHECK::SYMBOLS()
+{
+    std::vector<QRCODE> symbols;
+    symbols.push_back(QRCODE::ENCODE_TEXT("HELLO", QRCODE::VERSION::ERROR::LOW));
+    symbols.push_back(QRCODE::ENCODE_TEXT("https://example.com/check/0123456789/abcdefghijklmnopqrstuvwxyz/0123456789/abcdefghijklmnopqrstuvwxyz",
+        QRCODE::VERSION::ERROR::HIGH));
+    symbols.push_back(QRCODE::ENCODE_BINARY(std::vector<std::uint8_t>(2900, 0xA5), QRCODE::VERSION::ERROR::LOW));
+    return symbols;
+}
+
+inline int QR::CHECK::BITS::GET(int bits)
+{
+    while (count < bits)
+    {
+        if (position >= length)
+            throw std::runtime_error("Inflate: out of data");
+        buffer |= static_cast<std::uint32_t>(data[position++]) << count;
+        count += 8;
+    }
+    int value = static_cast<int>(buffer & ((1u << bits) - 1));
+    buffer >>= bits;
+    count -= bits;
+    return value;
+}
+
+inline void QR::CHECK::BUILD(HUFFMAN& code, const std::uint8_t* lengths, int count)
+{
+    std::uint16_t offsets[16] = {};
+    for (int i = 0; i < 16; i++)
+        code.counts[i] = 0;
+    for (int i = 0; i < count; i++)
+        code.counts[lengths[i]]++;
+    code.counts[0] = 0;
+    for (int i = 1; i < 15; i++)
+        offsets[i + 1] = static_cast<std::uint16_t>(offsets[i] + code.counts[i]);
+    for (int i = 0; i < count; i++)
+    {
+        if (lengths[i] != 0)
+            code.symbols[offsets[lengths[i]]++] = static_cast<std::uint16_t>(i);
+    }
+}
+
+inline int QR::CHECK::DECODE(BITS& in, const HUFFMAN& code)
+{
+    int value = 0, first = 0, index = 0;
+    for (int length = 1; length < 16; length++)
+    {
+        value |= in.GET(1);
+        int count = code.counts[length];
+        if (value - first < count)
+            return code.symbols[index + value - first];
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    throw std::runtime_error("Inflate: bad code");
+}
+
+inline std::vector<std::uint8_t> QR::CHECK::INFLATE(const std::uint8_t* data, size_t length, bool zlib)
+{
+    static const std::uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const std::uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const std::uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    static const std::uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    static const std::uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    BITS in{ data, length, 0, 0, 0 };
+    if (zlib)
+    {
+        if (length < 6 || (data[0] & 15) != 8 || ((data[0] << 8) | data[1]) % 31 != 0 || (data[1] & 0x20) != 0)
+            throw std::runtime_error("Inflate: bad zlib header");
+        in.position = 2;
+    }
+
+    std::vector<std::uint8_t> out;
+    bool last = false;
+    while (!last)
+    {
+        last = in.GET(1) == 1;
+        int type = in.GET(2);
+        if (type == 0)
+        {
+            // Stored: byte aligned, then LEN and its complement
+            in.buffer = 0;
+            in.count = 0;
+            if (in.position + 4 > length)
+                throw std::runtime_error("Inflate: out of data");
+            size_t stored = data[in.position] | (data[in.position + 1] << 8);
+            size_t complement = data[in.position + 2] | (data[in.position + 3] << 8);
+            if (stored != (~complement & 0xFFFF) || in.position + 4 + stored > length)
+                throw std::runtime_error("Inflate: bad stored block");
+            out.insert(out.end(), data + in.position + 4, data + in.position + 4 + stored);
+            in.position += 4 + stored;
+            continue;
+        }
+        if (type == 3)
+            throw std::runtime_error("Inflate: bad block type");
+
+        HUFFMAN literals, distances;
+        std::uint8_t lengths[320] = {};
+        if (type == 1)
+        {
+            for (int i = 0; i < 288; i++)
+                lengths[i] = static_cast<std::uint8_t>(i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8);
+            BUILD(literals, lengths, 288);
+            for (int i = 0; i < 30; i++)
+                lengths[i] = 5;
+            BUILD(distances, lengths, 30);
+        }
+        else
+        {
+            int literalCount = in.GET(5) + 257;
+            int distanceCount = in.GET(5) + 1;
+            int codeCount = in.GET(4) + 4;
+            for (int i = 0; i < codeCount; i++)
+                lengths[order[i]] = static_cast<std::uint8_t>(in.GET(3));
+            HUFFMAN lengthCode;
+            BUILD(lengthCode, lengths, 19);
+
+            int i = 0;
+            while (i < literalCount + distanceCount)
+            {
+                int symbol = DECODE(in, lengthCode);
+                if (symbol < 16)
+                {
+                    lengths[i++] = static_cast<std::uint8_t>(symbol);
+                    continue;
+                }
+                int repeat = symbol == 16 ? 3 + in.GET(2) : symbol == 17 ? 3 + in.GET(3) : 11 + in.GET(7);
+                std::uint8_t value = 0;
+                if (symbol == 16)
+                {
+                    if (i == 0)
+                        throw std::runtime_error("Inflate: bad repeat");
+                    value = lengths[i - 1];
+                }
+                if (i + repeat > literalCount + distanceCount)
+                    throw std::runtime_error("Inflate: bad repeat");
+                while (repeat-- > 0)
+                    lengths[i++] = value;
+            }
+            BUILD(literals, lengths, literalCount);
+            BUILD(distances, lengths + literalCount, distanceCount);
+        }
+
+        for (;;)
+        {
+            int symbol = DECODE(in, literals);
+            if (symbol < 256)
+                out.push_back(static_cast<std::uint8_t>(symbol));
+            else if (symbol == 256)
+                break;
+            else
+            {
+                symbol -= 257;
+                if (symbol >= 29)
+                    throw std::runtime_error("Inflate: bad length");
+                size_t copy = lengthBase[symbol] + in.GET(lengthExtra[symbol]);
+                int code = DECODE(in, distances);
+                if (code >= 30)
+                    throw std::runtime_error("Inflate: bad distance");
+                size_t distance = distanceBase[code] + in.GET(distanceExtra[code]);
+                if (distance > out.size())
+                    throw std::runtime_error("Inflate: distance too far back");
+                for (size_t k = 0; k < copy; k++)
+                    out.push_back(out[out.size() - distance]);
+            }
+        }
+    }
+
+    if (zlib)
+    {
+        std::uint32_t a = 1, b = 0;
+        for (std::uint8_t byte : out)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        if (in.position + 4 > length)
+            throw std::runtime_error("Inflate: out of data");
+        const std::uint8_t* trailer = data + in.position;
+        std::uint32_t adler = (std::uint32_t(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+        if (adler != ((b << 16) | a))
+            throw std::runtime_error("Inflate: bad Adler-32");
+    }
+    return out;
+}
+
+#endif
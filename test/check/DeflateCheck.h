@@ -0,0 +1,117 @@
+#ifndef DEFLATECHECK_H
+#define DEFLATECHECK_H
+
+#include "Check.h"
+#include "../../lib/Image/Sink.h"
+#include "../../lib/Image/Deflate.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <exception>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief Inputs that reach stored, fixed and dynamic blocks, long matches and the window edge.
+    */
+    struct DEFLATE_INPUTS
+    {
+        static std::vector<std::string> ALL();
+    };
+}
+
+inline std::vector<std::string> QR::DEFLATE_INPUTS::ALL()
+{
+    std::vector<std::string> inputs = { "", "a", "abcabcabcabcabcabcabcabc" };
+
+    std::string random;
+    std::uint32_t state = 12345;
+    for (int i = 0; i < 100000; i++)
+    {
+        state = state * 1103515245 + 12345;
+        random += static_cast<char>(state >> 24);
+    }
+    inputs.push_back(random);
+
+    // PNG-like scanlines: filter bytes and long runs, repeated rows farther apart than the window
+    std::string scanlines;
+    for (int row = 0; row < 3000; row++)
+    {
+        scanlines += static_cast<char>(row % 5 == 0 ? 0 : 2);
+        for (int x = 0; x < 60; x++)
+            scanlines += static_cast<char>(((x * 7 + row / 5) % 11) < 4 ? 0xFF : 0x00);
+    }
+    inputs.push_back(scanlines);
+
+    std::string text;
+    for (int i = 0; i < 5000; i++)
+        text += "https://example.com/item/" + std::to_string(i * 7919 % 10007) + "\n";
+    inputs.push_back(text);
+    return inputs;
+}
+
+inline void QR::CHECK::DEFLATE()
+{
+    const std::vector<std::string> inputs = DEFLATE_INPUTS::ALL();
+    for (size_t n = 0; n < inputs.size(); n++)
+    {
+        const std::string& input = inputs[n];
+        for (int level : { 1, 6, 9 })
+        {
+            for (bool zlib : { true, false })
+            {
+                for (bool flush : { false, true })
+                {
+                    const std::string name = "deflate input " + std::to_string(n) + " level " + std::to_string(level)
+                        + (zlib ? " zlib" : " raw") + (flush ? " flushed" : "");
+
+                    // Written in uneven pieces, with a sync flush half way when asked
+                    std::string compressed;
+                    STRING_SINK sink(compressed);
+                    DEFLATE_STREAM deflate(sink, zlib, level);
+                    const size_t half = input.size() / 2;
+                    for (size_t at = 0; at < input.size();)
+                    {
+                        size_t piece = std::min<size_t>(input.size() - at, 1 + (at * 31) % 7000);
+                        if (flush && at < half && at + piece >= half)
+                        {
+                            deflate.WRITE(input.data() + at, half - at);
+                            deflate.FLUSH();
+
+                            // Everything written so far decodes once an empty final block is added
+                            std::string closed = compressed.substr(zlib ? 2 : 0) + std::string("\x03\x00", 2);
+                            try
+                            {
+                                std::vector<std::uint8_t> prefix = INFLATE(reinterpret_cast<const std::uint8_t*>(closed.data()), closed.size(), false);
+                                EXPECT(std::string(prefix.begin(), prefix.end()) == input.substr(0, half), name + ": flushed prefix differs");
+                            }
+                            catch (const std::exception& error)
+                            {
+                                EXPECT(false, name + ": flushed prefix: " + error.what());
+                            }
+                            piece = at + piece - half;
+                            at = half;
+                        }
+                        deflate.WRITE(input.data() + at, piece);
+                        at += piece;
+                    }
+                    deflate.FINISH();
+
+                    try
+                    {
+                        std::vector<std::uint8_t> output = INFLATE(reinterpret_cast<const std::uint8_t*>(compressed.data()), compressed.size(), zlib);
+                        EXPECT(std::string(output.begin(), output.end()) == input, name + ": round trip differs");
+                    }
+                    catch (const std::exception& error)
+                    {
+                        EXPECT(false, name + ": " + error.what());
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif
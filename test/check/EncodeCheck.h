@@ -0,0 +1,182 @@
+#ifndef ENCODECHECK_H
+#define ENCODECHECK_H
+
+#include "Check.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <exception>
+
+namespace QR
+{
+    /**
+    * @brief What the staged encode is compared with: the one-shot encode, and codewords
+    * interleaved the way the specification lays them out, block by block.
+    */
+    struct STAGE_REFERENCE
+    {
+        /**
+        * @brief Reed-Solomon remainder of `data` by the generator of degree `degree`, in
+        * GF(256) modulo x^8 + x^4 + x^3 + x^2 + 1, by long division.
+        */
+        static std::vector<std::uint8_t> REMAINDER(const std::vector<std::uint8_t>& data, int degree);
+
+        /**
+        * @brief Splits the data codewords into blocks, adds their remainders, and reads the
+        * blocks column by column: data first, then error correction.
+        */
+        static std::vector<std::uint8_t> INTERLEAVE(int version, QRCODE::VERSION::ERROR ecl,
+            const std::vector<std::uint8_t>& data);
+
+        static bool SAME(const MATRIX_VIEW& a, const MATRIX_VIEW& b);
+    };
+}
+
+inline std::vector<std::uint8_t> QR::STAGE_REFERENCE::REMAINDER(const std::vector<std::uint8_t>& data, int degree)
+{
+    auto multiply = [](int a, int b)
+        {
+            int product = 0;
+            for (int bit = 7; bit >= 0; bit--)
+            {
+                product = (product << 1) ^ ((product >> 7) * 0x11D);
+                if ((b >> bit) & 1)
+                    product ^= a;
+            }
+            return product;
+        };
+
+    // Generator (x - a^0)(x - a^1)...(x - a^(degree - 1)), highest coefficient first
+    std::vector<int> generator = { 1 };
+    int root = 1;
+    for (int i = 0; i < degree; i++)
+    {
+        std::vector<int> next(generator.size() + 1, 0);
+        for (size_t j = 0; j < generator.size(); j++)
+        {
+            next[j] ^= generator[j];
+            next[j + 1] ^= multiply(generator[j], root);
+        }
+        generator = next;
+        root = multiply(root, 2);
+    }
+
+    std::vector<int> rest(data.begin(), data.end());
+    rest.resize(data.size() + static_cast<size_t>(degree), 0);
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        const int factor = rest[i];
+        for (size_t j = 0; j < generator.size(); j++)
+            rest[i + j] ^= multiply(generator[j], factor);
+    }
+    return std::vector<std::uint8_t>(rest.end() - degree, rest.end());
+}
+
+inline std::vector<std::uint8_t> QR::STAGE_REFERENCE::INTERLEAVE(int version, QRCODE::VERSION::ERROR ecl,
+    const std::vector<std::uint8_t>& data)
+{
+    const int blocks = QRCODE::VERSION::NUM_ERROR_CORRECTION_BLOCKS[static_cast<int>(ecl)][version];
+    const int degree = QRCODE::VERSION::ECC_CODEWORDS_PER_BLOCK[static_cast<int>(ecl)][version];
+    const int total = QRCODE::VERSION::GET_CAPACITY_BITS(version) / 8;
+    const int longBlocks = total % blocks;
+    const int shortData = total / blocks - degree;
+
+    std::vector<std::vector<std::uint8_t>> dataBlocks, eccBlocks;
+    size_t at = 0;
+    for (int i = 0; i < blocks; i++)
+    {
+        const size_t length = static_cast<size_t>(shortData + (i >= blocks - longBlocks ? 1 : 0));
+        dataBlocks.emplace_back(data.begin() + at, data.begin() + at + length);
+        eccBlocks.push_back(REMAINDER(dataBlocks.back(), degree));
+        at += length;
+    }
+
+    std::vector<std::uint8_t> out;
+    for (int column = 0; column <= shortData; column++)
+    {
+        for (const auto& block : dataBlocks)
+        {
+            if (static_cast<size_t>(column) < block.size())
+                out.push_back(block[static_cast<size_t>(column)]);
+        }
+    }
+    for (int column = 0; column < degree; column++)
+    {
+        for (const auto& block : eccBlocks)
+            out.push_back(block[static_cast<size_t>(column)]);
+    }
+    return out;
+}
+
+inline bool QR::STAGE_REFERENCE::SAME(const MATRIX_VIEW& a, const MATRIX_VIEW& b)
+{
+    if (a.SIZE_GETTER() != b.SIZE_GETTER())
+        return false;
+    for (int y = 0; y < a.SIZE_GETTER(); y++)
+    {
+        for (int x = 0; x < a.SIZE_GETTER(); x++)
+        {
+            if (a.TEST(x, y) != b.TEST(x, y))
+                return false;
+        }
+    }
+    return true;
+}
+
+inline void QR::CHECK::STAGES()
+{
+    // A known answer: "HELLO WORLD" at 1-M, data then error correction codewords
+    {
+        const std::vector<ENCODE> segments = ENCODE::MODE::MODE_CHOOSER("HELLO WORLD");
+        const QRCODE::PLAN plan = QRCODE::PLAN_SEGMENTS(segments, QRCODE::VERSION::ERROR::MEDIUM, 1, 40, false);
+        std::vector<std::uint8_t> data, codewords;
+        QRCODE::DATA_CODEWORDS(segments, plan, data);
+        QRCODE::ECC_CODEWORDS(plan.version, plan.ecl, data, codewords);
+        const std::vector<std::uint8_t> expected = { 0x20, 0x5B, 0x0B, 0x78, 0xD1, 0x72, 0xDC, 0x4D, 0x43, 0x40, 0xEC, 0x11,
+            0xEC, 0x11, 0xEC, 0x11, 0xC4, 0x23, 0x27, 0x77, 0xEB, 0xD7, 0xE7, 0xE2, 0x5D, 0x17 };
+        EXPECT(plan.version == 1 && codewords == expected, "stages: HELLO WORLD 1-M codewords differ");
+    }
+
+    // Versions with one block, two block sizes and the most blocks; the buffers are reused
+    std::vector<std::uint8_t> data, codewords;
+    for (int version : { 1, 5, 7, 15, 22, 36, 40 })
+    {
+        for (int level = 0; level < 4; level++)
+        {
+            const QRCODE::VERSION::ERROR ecl = static_cast<QRCODE::VERSION::ERROR>(level);
+
+            // An alphanumeric and a numeric segment, short enough for level H
+            std::string text = "QR";
+            for (int i = 0; text.size() < static_cast<size_t>(version) * 8 + 2; i++)
+                text += std::to_string((version * 31 + level) * 7919 + i);
+            text.resize(static_cast<size_t>(version) * 8 + 2);
+            const std::vector<ENCODE> segments = ENCODE::MODE::MODE_CHOOSER(text.c_str());
+            for (int mask : { -1, 0, 3, 7 })
+            {
+                const std::string name = "stages version " + std::to_string(version) + " level " + std::to_string(level)
+                    + " mask " + std::to_string(mask);
+                try
+                {
+                    const QRCODE::PLAN plan = QRCODE::PLAN_SEGMENTS(segments, ecl, version, version, false);
+                    QRCODE::DATA_CODEWORDS(segments, plan, data);
+                    QRCODE::ECC_CODEWORDS(plan.version, plan.ecl, data, codewords);
+                    EXPECT(codewords == STAGE_REFERENCE::INTERLEAVE(plan.version, plan.ecl, data), name + ": interleave differs");
+
+                    QRCODE staged = QRCODE::PLACE(plan.version, plan.ecl, codewords);
+                    const int applied = staged.MASK_FINISH(mask);
+                    const QRCODE whole = QRCODE::ENCODE_SEGMENT(segments, ecl, version, version, mask, false);
+                    EXPECT(staged.VERSION_GETTER() == whole.VERSION_GETTER() && staged.ERROR_CORRECTION() == whole.ERROR_CORRECTION()
+                        && applied == whole.MASK_GETTER() && (mask == -1 || applied == mask), name + ": parameters differ");
+                    EXPECT(STAGE_REFERENCE::SAME(staged.VIEW_GETTER(), whole.VIEW_GETTER()), name + ": modules differ");
+                }
+                catch (const std::exception& error)
+                {
+                    EXPECT(false, name + ": " + error.what());
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef PIPELINECHECK_H
+#define PIPELINECHECK_H
+
+#include "Check.h"
+#include "SheetCheck.h"
+#include "../../lib/Image/Sink.h"
+#include "../../lib/Image/BitmapStream.h"
+#include "../../lib/Pipeline/BoundedQueue.h"
+#include "../../lib/Pipeline/ExportPipeline.h"
+
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace QR
+{
+    /**
+    * @brief The payloads the pipeline check exports, and what a sequential encode makes of them.
+    */
+    struct PIPELINE_SAMPLES
+    {
+        /**
+        * @brief Payloads of every mode and many sizes; one, at `TOO_LONG`, fits no version.
+        */
+        static std::vector<std::string> PAYLOADS();
+
+        static constexpr size_t TOO_LONG = 17;
+
+        static std::string NAME(size_t index);
+
+        /**
+        * @brief Runs `pipeline` over the payloads and returns the outputs as they arrived;
+        * `rejected` receives the names handed to PIPELINE_OPTIONS::reject.
+        */
+        static std::vector<std::pair<std::string, std::string>> RUN(PIPELINE_OPTIONS options,
+            std::vector<std::string>& rejected, PIPELINE_STATS& stats);
+    };
+}
+
+inline std::vector<std::string> QR::PIPELINE_SAMPLES::PAYLOADS()
+{
+    std::vector<std::string> payloads;
+    for (int i = 0; i < 40; i++)
+    {
+        if (i % 3 == 0)
+            payloads.push_back(std::to_string(i * 1234567));
+        else if (i % 3 == 1)
+            payloads.push_back("HTTPS://EXAMPLE.COM/" + std::string(static_cast<size_t>(i) * 9, 'A'));
+        else
+            payloads.push_back("https://example.com/pipeline?item=" + std::string(static_cast<size_t>(i) * 5, 'x'));
+    }
+    payloads[TOO_LONG] = std::string(4000, 'x');
+    return payloads;
+}
+
+inline std::string QR::PIPELINE_SAMPLES::NAME(size_t index)
+{
+    return "item-" + std::to_string(index);
+}
+
+inline std::vector<std::pair<std::string, std::string>> QR::PIPELINE_SAMPLES::RUN(PIPELINE_OPTIONS options,
+    std::vector<std::string>& rejected, PIPELINE_STATS& stats)
+{
+    const std::vector<std::string> payloads = PAYLOADS();
+    std::mutex lock;
+    std::vector<std::pair<std::string, std::string>> outputs;
+    options.reject = [&](const std::string& name, const std::exception&)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            rejected.push_back(name);
+        };
+
+    size_t next = 0;
+    EXPORT_PIPELINE pipeline(options);
+    stats = pipeline.RUN([&](std::string& name, std::string& text)
+        {
+            if (next == payloads.size())
+                return false;
+            name = NAME(next);
+            text = payloads[next++];
+            return true;
+        }, [&](const std::string& name, std::string& data)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            outputs.emplace_back(name, std::move(data));
+        });
+    return outputs;
+}
+
+inline void QR::CHECK::PIPELINE()
+{
+    // Producers and consumers racing through a small ring: every value arrives once, and each
+    // consumer sees the values of one producer in the order they were pushed
+    {
+        const int producers = 4, consumers = 3, count = 20000;
+        BOUNDED_QUEUE<int> queue(5, producers);
+        EXPECT(queue.CAPACITY_GETTER() == 8, "queue: capacity not rounded up to a power of two");
+
+        std::vector<std::future<void>> pushers;
+        for (int p = 0; p < producers; p++)
+        {
+            pushers.push_back(std::async(std::launch::async, [&queue, p]()
+                {
+                    double waited = 0;
+                    for (int i = 0; i < count; i++)
+                    {
+                        int value = p * count + i;
+                        queue.PUSH(value, waited);
+                    }
+                    queue.PRODUCER_DONE();
+                }));
+        }
+        std::vector<std::future<std::vector<int>>> poppers;
+        for (int c = 0; c < consumers; c++)
+        {
+            poppers.push_back(std::async(std::launch::async, [&queue]()
+                {
+                    std::vector<int> values;
+                    double waited = 0;
+                    int value;
+                    while (queue.POP(value, waited))
+                        values.push_back(value);
+                    return values;
+                }));
+        }
+        for (auto& pusher : pushers)
+            pusher.get();
+
+        std::vector<int> all;
+        bool ordered = true;
+        for (auto& popper : poppers)
+        {
+            const std::vector<int> values = popper.get();
+            std::vector<int> last(producers, -1);
+            for (int value : values)
+            {
+                ordered = ordered && value > last[value / count];
+                last[value / count] = value;
+            }
+            all.insert(all.end(), values.begin(), values.end());
+        }
+        std::sort(all.begin(), all.end());
+        bool once = all.size() == static_cast<size_t>(producers) * count;
+        for (size_t i = 0; once && i < all.size(); i++)
+            once = all[i] == static_cast<int>(i);
+        EXPECT(once, "queue: values lost or repeated");
+        EXPECT(ordered, "queue: a producer's values overtook each other");
+        EXPECT(queue.CLOSED(), "queue: not closed after the last producer");
+    }
+
+    // CLOSE fails a blocked push, and POP drains what is left before reporting the end
+    {
+        BOUNDED_QUEUE<int> queue(2, 1);
+        int value = 0;
+        EXPECT(!queue.TRY_POP(value), "queue: popped from an empty queue");
+        for (int i = 0; i < 2; i++)
+        {
+            value = i;
+            EXPECT(queue.TRY_PUSH(value), "queue: a free cell was refused");
+        }
+        value = 2;
+        EXPECT(!queue.TRY_PUSH(value), "queue: pushed into a full queue");
+
+        auto blocked = std::async(std::launch::async, [&queue]()
+            {
+                int more = 3;
+                double waited = 0;
+                return queue.PUSH(more, waited);
+            });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        queue.CLOSE();
+        EXPECT(!blocked.get(), "queue: a push blocked on a full queue succeeded after CLOSE");
+
+        std::vector<int> drained;
+        double waited = 0;
+        while (queue.POP(value, waited))
+            drained.push_back(value);
+        EXPECT(drained == std::vector<int>({ 0, 1 }), "queue: CLOSE lost the values left in the queue");
+    }
+
+    // The sequential encode the pipeline must match, by name
+    const std::vector<std::string> payloads = PIPELINE_SAMPLES::PAYLOADS();
+    const QRCODE::VERSION::ERROR ecl = QRCODE::VERSION::ERROR::QUARTILE;
+    const int scale = 3, border = 2;
+    std::vector<std::string> names;
+    std::vector<std::vector<bool>> pixels;
+    std::vector<std::string> pbms;
+    for (size_t i = 0; i < payloads.size(); i++)
+    {
+        if (i == PIPELINE_SAMPLES::TOO_LONG)
+            continue;
+        const QRCODE code = QRCODE::ENCODE_SEGMENT(ENCODE::MODE::MODE_CHOOSER(payloads[i].data(), payloads[i].size()), ecl);
+        names.push_back(PIPELINE_SAMPLES::NAME(i));
+        pixels.push_back(PIXELS(code.VIEW_GETTER(), scale, border));
+        pbms.emplace_back();
+        STRING_SINK sink(pbms.back());
+        BITMAP_STREAM::PBM(sink, code.VIEW_GETTER(), scale, border);
+    }
+
+    for (bool ordered : { true, false })
+    {
+        for (bool png : { true, false })
+        {
+            PIPELINE_OPTIONS options;
+            options.encoders = 3;
+            options.renderers = 2;
+            options.compressors = 2;
+            options.writers = 3;
+            options.depth = 4;
+            options.ordered = ordered;
+            options.ecl = ecl;
+            options.scale = scale;
+            options.border = border;
+            if (!png)
+                options.render = [](const QRCODE& code, SINK& sink) { BITMAP_STREAM::PBM(sink, code.VIEW_GETTER(), scale, border); };
+            const std::string name = std::string("pipeline ") + (ordered ? "ordered" : "unordered") + (png ? " png" : " pbm");
+
+            std::vector<std::string> rejected;
+            PIPELINE_STATS stats;
+            std::vector<std::pair<std::string, std::string>> outputs = PIPELINE_SAMPLES::RUN(options, rejected, stats);
+            EXPECT(rejected == std::vector<std::string>({ PIPELINE_SAMPLES::NAME(PIPELINE_SAMPLES::TOO_LONG) }),
+                name + ": the over-long payload was not the one rejected");
+            EXPECT(stats.stages[1].failed == 1 && stats.stages[4].items == names.size(), name + ": wrong stage counts");
+
+            if (!ordered)
+                std::sort(outputs.begin(), outputs.end(), [](const auto& a, const auto& b)
+                    {
+                        return std::stoi(a.first.substr(5)) < std::stoi(b.first.substr(5));
+                    });
+            bool same = outputs.size() == names.size();
+            for (size_t i = 0; same && i < outputs.size(); i++)
+            {
+                same = outputs[i].first == names[i];
+                if (!same)
+                    break;
+                if (!png)
+                {
+                    same = outputs[i].second == pbms[i];
+                    continue;
+                }
+                try
+                {
+                    int width = 0, height = 0;
+                    same = SHEET_READER::PNG(outputs[i].second, width, height) == pixels[i];
+                }
+                catch (const std::exception& error)
+                {
+                    EXPECT(false, name + ": " + outputs[i].first + ": " + error.what());
+                    same = false;
+                }
+            }
+            EXPECT(same, name + ": the outputs differ from a sequential encode, or arrived out of order");
+        }
+    }
+}
+
+#endif
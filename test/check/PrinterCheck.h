@@ -0,0 +1,227 @@
+#ifndef PRINTERCHECK_H
+#define PRINTERCHECK_H
+
+#include "Check.h"
+#include "../../lib/Image/Sink.h"
+#include "../../lib/Image/PrinterStream.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Decoders of the printer commands, written from the ZPL and ESC/POS manuals; each
+    * returns the printed dots row by row, true for dark, and throws std::runtime_error on
+    * malformed output.
+    */
+    struct PRINTER_READER
+    {
+        /**
+        * @brief Reads a label holding one ^GF field in compressed ASCII at ^FO0,0.
+        */
+        static std::vector<bool> ZPL(const std::string& data, int& width);
+
+        /**
+        * @brief Reads a run of GS v 0 commands in normal density.
+        */
+        static std::vector<bool> ESCPOS(const std::string& data, int& width);
+
+        /**
+        * @brief Reads the decimal number at `at`, up to the next ','.
+        */
+        static size_t NUMBER(const std::string& data, size_t& at);
+
+        /**
+        * @brief Appends the dots of a packed row, first dot in the top bit.
+        */
+        static void DOTS(const std::uint8_t* row, size_t lineBytes, std::vector<std::vector<bool>>& rows);
+
+        /**
+        * @brief Checks the rows are square and cuts the padding bits off them.
+        */
+        static std::vector<bool> SQUARE(const std::vector<std::vector<bool>>& rows, size_t lineBytes, int& width);
+    };
+}
+
+inline size_t QR::PRINTER_READER::NUMBER(const std::string& data, size_t& at)
+{
+    size_t value = 0, digits = 0;
+    while (at < data.size() && data[at] >= '0' && data[at] <= '9')
+    {
+        value = value * 10 + static_cast<size_t>(data[at++] - '0');
+        digits++;
+    }
+    if (digits == 0 || at >= data.size() || data[at] != ',')
+        throw std::runtime_error("bad number");
+    at++;
+    return value;
+}
+
+inline void QR::PRINTER_READER::DOTS(const std::uint8_t* row, size_t lineBytes, std::vector<std::vector<bool>>& rows)
+{
+    std::vector<bool> dots;
+    for (size_t x = 0; x < lineBytes * 8; x++)
+        dots.push_back((row[x / 8] >> (7 - x % 8)) & 1);
+    rows.push_back(dots);
+}
+
+inline std::vector<bool> QR::PRINTER_READER::SQUARE(const std::vector<std::vector<bool>>& rows, size_t lineBytes, int& width)
+{
+    width = static_cast<int>(rows.size());
+    if (lineBytes != (rows.size() + 7) / 8)
+        throw std::runtime_error("row length does not match the row count");
+    std::vector<bool> pixels;
+    for (const std::vector<bool>& row : rows)
+    {
+        for (size_t x = 0; x < row.size(); x++)
+        {
+            if (x < rows.size())
+                pixels.push_back(row[x]);
+            else if (row[x])
+                throw std::runtime_error("padding bit set");
+        }
+    }
+    return pixels;
+}
+
+inline std::vector<bool> QR::PRINTER_READER::ZPL(const std::string& data, int& width)
+{
+    const std::string head = "^XA^FO0,0^GFA,", foot = "^FS^XZ\n";
+    if (data.compare(0, head.size(), head) != 0 || data.size() < head.size() + foot.size()
+        || data.compare(data.size() - foot.size(), foot.size(), foot) != 0)
+        throw std::runtime_error("bad label");
+    size_t at = head.size();
+    const size_t bytes = NUMBER(data, at), fieldBytes = NUMBER(data, at), lineBytes = NUMBER(data, at);
+    if (lineBytes == 0)
+        throw std::runtime_error("bad row length");
+
+    // Compressed ASCII: G-Y count 1-19 and g-z 20-400, adding up, before the digit they repeat
+    const size_t end = data.size() - foot.size();
+    std::vector<std::vector<bool>> rows;
+    std::vector<std::uint8_t> previous;
+    std::string hex;
+    size_t count = 0;
+    for (; at < end; at++)
+    {
+        const char c = data[at];
+        if (c >= 'G' && c <= 'Y')
+            count += static_cast<size_t>(c - 'G' + 1);
+        else if (c >= 'g' && c <= 'z')
+            count += static_cast<size_t>(c - 'g' + 1) * 20;
+        else if ((c >= '0' && c <= '9') || (c >= 'A' && c <= 'F'))
+        {
+            hex.append(count > 0 ? count : 1, c);
+            count = 0;
+        }
+        else if (c == ',' || c == '!')
+        {
+            if (count > 0 || hex.size() >= 2 * lineBytes)
+                throw std::runtime_error("misplaced fill");
+            hex.resize(2 * lineBytes, c == ',' ? '0' : 'F');
+        }
+        else if (c == ':')
+        {
+            if (count > 0 || !hex.empty() || previous.empty())
+                throw std::runtime_error("misplaced repeat");
+            DOTS(previous.data(), lineBytes, rows);
+        }
+        else
+            throw std::runtime_error("unexpected character in the field");
+
+        if (hex.size() > 2 * lineBytes)
+            throw std::runtime_error("row too long");
+        if (hex.size() == 2 * lineBytes)
+        {
+            previous.clear();
+            for (size_t i = 0; i < lineBytes; i++)
+                previous.push_back(static_cast<std::uint8_t>(std::stoi(hex.substr(2 * i, 2), nullptr, 16)));
+            DOTS(previous.data(), lineBytes, rows);
+            hex.clear();
+        }
+    }
+    if (count > 0 || !hex.empty())
+        throw std::runtime_error("unfinished row");
+    if (bytes != fieldBytes || bytes != lineBytes * rows.size())
+        throw std::runtime_error("byte count does not match the field");
+    return SQUARE(rows, lineBytes, width);
+}
+
+inline std::vector<bool> QR::PRINTER_READER::ESCPOS(const std::string& data, int& width)
+{
+    std::vector<std::vector<bool>> rows;
+    size_t lineBytes = 0;
+    for (size_t at = 0; at < data.size();)
+    {
+        if (data.size() - at < 8 || data.compare(at, 4, std::string("\x1D" "v0\0", 4)) != 0)
+            throw std::runtime_error("bad command");
+        const std::uint8_t* command = reinterpret_cast<const std::uint8_t*>(data.data() + at);
+        const size_t bandBytes = command[4] | (command[5] << 8), dots = command[6] | (command[7] << 8);
+        if (bandBytes == 0 || dots == 0 || dots > static_cast<size_t>(PRINTER_STREAM::BAND_DOTS)
+            || (lineBytes != 0 && bandBytes != lineBytes))
+            throw std::runtime_error("bad band size");
+        lineBytes = bandBytes;
+        at += 8;
+        if (data.size() - at < lineBytes * dots)
+            throw std::runtime_error("truncated band");
+        for (size_t y = 0; y < dots; y++, at += lineBytes)
+            DOTS(reinterpret_cast<const std::uint8_t*>(data.data() + at), lineBytes, rows);
+    }
+    return SQUARE(rows, lineBytes, width);
+}
+
+inline void QR::CHECK::PRINTERS()
+{
+    using WRITER = void (*)(SINK&, const MATRIX_VIEW&, int, int);
+    using READER = std::vector<bool> (*)(const std::string&, int&);
+    const struct
+    {
+        const char* name;
+        WRITER write;
+        READER read;
+    } formats[] = {
+        { "zpl", [](SINK& sink, const MATRIX_VIEW& view, int scale, int border) { PRINTER_STREAM::ZPL(sink, view, scale, border); }, PRINTER_READER::ZPL },
+        { "escpos", PRINTER_STREAM::ESCPOS, PRINTER_READER::ESCPOS },
+    };
+
+    for (const QRCODE& symbol : SYMBOLS())
+    {
+        const MATRIX_VIEW view = symbol.VIEW_GETTER();
+        for (int scale : { 1, 3, 8 })
+        {
+            for (int border : { 0, 4 })
+            {
+                const std::vector<bool> expected = PIXELS(view, scale, border);
+                for (const auto& format : formats)
+                {
+                    const std::string name = std::string(format.name) + " version " + std::to_string(symbol.VERSION_GETTER())
+                        + " scale " + std::to_string(scale) + " border " + std::to_string(border);
+                    std::string data;
+                    STRING_SINK sink(data);
+                    format.write(sink, view, scale, border);
+                    try
+                    {
+                        int width = 0;
+                        const std::vector<bool> pixels = format.read(data, width);
+                        EXPECT(width == (view.SIZE_GETTER() + 2 * border) * scale, name + ": wrong width");
+                        EXPECT(pixels == expected, name + ": dots differ");
+                    }
+                    catch (const std::exception& error)
+                    {
+                        EXPECT(false, name + ": " + error.what());
+                    }
+                }
+            }
+        }
+    }
+
+    // The field origin
+    std::string label;
+    STRING_SINK sink(label);
+    PRINTER_STREAM::ZPL(sink, SYMBOLS().front().VIEW_GETTER(), 2, 1, 30, 45);
+    EXPECT(label.compare(0, 15, "^XA^FO30,45^GFA") == 0, "zpl: field origin not written");
+}
+
+#endif
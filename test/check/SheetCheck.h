@@ -0,0 +1,193 @@
+#ifndef SHEETCHECK_H
+#define SHEETCHECK_H
+
+#include "Check.h"
+#include "../../lib/Image/Sink.h"
+#include "../../lib/Image/Raster.h"
+#include "../../lib/Image/ContactSheet.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+namespace QR
+{
+    /**
+    * @brief Decoder of the 1-bit palette PNG a contact sheet is, written from the specification.
+    */
+    struct SHEET_READER
+    {
+        static std::uint32_t BE32(const std::string& data, size_t at);
+
+        static std::uint32_t CRC32(const std::string& data, size_t at, size_t length);
+
+        /**
+        * @brief The pixels row by row, true for dark (palette index 1); the zlib stream of the
+        * IDAT chunks is inflated and its Adler-32 checked.
+        *
+        * @throws std::runtime_error on a malformed file.
+        */
+        static std::vector<bool> PNG(const std::string& data, int& width, int& height);
+
+        /**
+        * @brief The sheet WRITE should produce: each symbol's pixels placed in its cell as
+        * CONTACT_SHEET centers it, everything else light.
+        */
+        static std::vector<bool> EXPECTED(const std::vector<MATRIX_VIEW>& views, const SHEET_OPTIONS& options,
+            int& width, int& height);
+    };
+}
+
+inline std::uint32_t QR::SHEET_READER::BE32(const std::string& data, size_t at)
+{
+    if (at + 4 > data.size())
+        throw std::runtime_error("truncated");
+    return (std::uint32_t(static_cast<std::uint8_t>(data[at])) << 24) | (static_cast<std::uint8_t>(data[at + 1]) << 16)
+        | (static_cast<std::uint8_t>(data[at + 2]) << 8) | static_cast<std::uint8_t>(data[at + 3]);
+}
+
+inline std::uint32_t QR::SHEET_READER::CRC32(const std::string& data, size_t at, size_t length)
+{
+    std::uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = at; i < at + length; i++)
+    {
+        crc ^= static_cast<std::uint8_t>(data[i]);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+inline std::vector<bool> QR::SHEET_READER::PNG(const std::string& data, int& width, int& height)
+{
+    if (data.compare(0, 8, "\x89PNG\r\n\x1A\n", 8) != 0)
+        throw std::runtime_error("bad signature");
+
+    std::string idat;
+    bool ended = false;
+    width = height = 0;
+    for (size_t at = 8; !ended;)
+    {
+        const std::uint32_t length = BE32(data, at);
+        if (at + 12 + length > data.size())
+            throw std::runtime_error("truncated chunk");
+        const std::string type = data.substr(at + 4, 4);
+        if (BE32(data, at + 8 + length) != CRC32(data, at + 4, length + 4))
+            throw std::runtime_error("bad CRC of " + type);
+        if (type == "IHDR")
+        {
+            width = static_cast<int>(BE32(data, at + 8));
+            height = static_cast<int>(BE32(data, at + 12));
+            if (length != 13 || data[at + 16] != 1 || data[at + 17] != 3 || data[at + 20] != 0)
+                throw std::runtime_error("not a 1-bit palette image");
+        }
+        else if (type == "PLTE")
+        {
+            if (data.compare(at + 8, length, "\xFF\xFF\xFF\x00\x00\x00", 6) != 0)
+                throw std::runtime_error("bad palette");
+        }
+        else if (type == "IDAT")
+            idat += data.substr(at + 8, length);
+        else if (type == "IEND")
+            ended = true;
+        at += 12 + length;
+    }
+
+    const std::vector<std::uint8_t> lines = CHECK::INFLATE(reinterpret_cast<const std::uint8_t*>(idat.data()), idat.size(), true);
+    const size_t rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    if (width < 1 || height < 1 || lines.size() != (rowBytes + 1) * height)
+        throw std::runtime_error("bad image data size");
+
+    // Filters None and Up; the writer uses no others
+    std::vector<std::uint8_t> previous(rowBytes, 0), row(rowBytes);
+    std::vector<bool> pixels;
+    for (int y = 0; y < height; y++)
+    {
+        const std::uint8_t* line = lines.data() + (rowBytes + 1) * y;
+        if (line[0] > 2 || line[0] == 1)
+            throw std::runtime_error("unexpected filter " + std::to_string(line[0]));
+        for (size_t i = 0; i < rowBytes; i++)
+            row[i] = static_cast<std::uint8_t>(line[i + 1] + (line[0] == 2 ? previous[i] : 0));
+        for (int x = 0; x < width; x++)
+            pixels.push_back((row[x / 8] >> (7 - x % 8)) & 1);
+        previous = row;
+    }
+    return pixels;
+}
+
+inline std::vector<bool> QR::SHEET_READER::EXPECTED(const std::vector<MATRIX_VIEW>& views, const SHEET_OPTIONS& options,
+    int& width, int& height)
+{
+    int largest = 0;
+    for (const MATRIX_VIEW& view : views)
+        largest = std::max(largest, view.SIZE_GETTER());
+    const int cell = ((largest + 2 * options.border) * options.scale + 7) & ~7;
+    const int columns = std::min(options.columns, static_cast<int>(views.size()));
+    const int rows = static_cast<int>((views.size() + columns - 1) / columns);
+    width = cell * columns;
+    height = cell * rows;
+
+    std::vector<bool> sheet(static_cast<size_t>(width) * height, false);
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        const int side = (views[i].SIZE_GETTER() + 2 * options.border) * options.scale;
+        const int left = static_cast<int>(i % columns) * cell + (((cell - side) / 2) & ~7);
+        const int top = static_cast<int>(i / columns) * cell + (cell - side) / 2;
+        const std::vector<bool> tile = CHECK::PIXELS(views[i], options.scale, options.border);
+        for (int y = 0; y < side; y++)
+            for (int x = 0; x < side; x++)
+                sheet[static_cast<size_t>(top + y) * width + left + x] = tile[static_cast<size_t>(y) * side + x];
+    }
+    return sheet;
+}
+
+inline void QR::CHECK::CONTACT_SHEETS()
+{
+    // Symbols of different sizes, so cells are centered, and a last row left short
+    std::vector<QRCODE> symbols = SYMBOLS();
+    for (int i = 0; i < 8; i++)
+    {
+        const std::string text = "https://example.com/sheet/" + std::string(static_cast<size_t>(i) * 12, 'x') + std::to_string(i);
+        symbols.push_back(QRCODE::ENCODE_TEXT(text.c_str(), static_cast<QRCODE::VERSION::ERROR>(i % 4)));
+    }
+    std::vector<MATRIX_VIEW> views;
+    for (const QRCODE& symbol : symbols)
+        views.push_back(symbol.VIEW_GETTER());
+
+    for (int columns : { 3, 4, 20 })
+    {
+        for (int threads : { 1, 3 })
+        {
+            for (int level : { 1, 9 })
+            {
+                SHEET_OPTIONS options;
+                options.columns = columns;
+                options.threads = threads;
+                options.level = level;
+                options.scale = 2;
+                options.border = columns == 4 ? 0 : 4;
+                const std::string name = "contact sheet columns " + std::to_string(columns) + " threads "
+                    + std::to_string(threads) + " level " + std::to_string(level);
+
+                std::string data;
+                STRING_SINK sink(data);
+                CONTACT_SHEET::WRITE(sink, views, options);
+                try
+                {
+                    int width = 0, height = 0, expectedWidth = 0, expectedHeight = 0;
+                    const std::vector<bool> pixels = SHEET_READER::PNG(data, width, height);
+                    const std::vector<bool> expected = SHEET_READER::EXPECTED(views, options, expectedWidth, expectedHeight);
+                    EXPECT(width == expectedWidth && height == expectedHeight, name + ": wrong size");
+                    EXPECT(pixels == expected, name + ": pixels differ");
+                }
+                catch (const std::exception& error)
+                {
+                    EXPECT(false, name + ": " + error.what());
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include "Check.h"
+#include "DeflateCheck.h"
+#include "BitmapCheck.h"
+#include "PrinterCheck.h"
+#include "ArchiveCheck.h"
+#include "SheetCheck.h"
+#include "PipelineCheck.h"
+#include "EncodeCheck.h"
+#include "BlitCheck.h"
+
+#include <string>
+#include <iostream>
+#include <exception>
+
+using namespace QR;
+
+// The library is header-only and not every header can be included by two translation units,
+// so the checks are headers too and this is the only source file.
+// Build and run: g++ -std=c++20 -O2 test/check/check.cpp -o check -pthread && ./check
+int main()
+{
+	const struct
+	{
+		const char* name;
+		void (*run)();
+	} checks[] = {
+		{ "deflate", CHECK::DEFLATE },
+		{ "bitmaps", CHECK::BITMAPS },
+		{ "printers", CHECK::PRINTERS },
+		{ "archive", CHECK::ARCHIVE },
+		{ "contact sheets", CHECK::CONTACT_SHEETS },
+		{ "pipeline", CHECK::PIPELINE },
+		{ "stages", CHECK::STAGES },
+		{ "blit", CHECK::BLIT },
+	};
+
+	for (const auto& check : checks)
+	{
+		const int before = CHECK::FAILURES();
+		try
+		{
+			check.run();
+		}
+		catch (const std::exception& e)
+		{
+			CHECK::EXPECT(false, std::string(check.name) + ": " + e.what());
+		}
+		std::cout << (CHECK::FAILURES() == before ? "ok      " : "FAILED  ") << check.name << std::endl;
+	}
+	return CHECK::FAILURES() == 0 ? 0 : 1;
+}